@@ -28,6 +28,8 @@ lib_libopenvswitch_a_SOURCES = \
 	lib/cfm.h \
 	lib/classifier.c \
 	lib/classifier.h \
+	lib/cmap.c \
+	lib/cmap.h \
 	lib/command-line.c \
 	lib/command-line.h \
 	lib/compiler.h \
@@ -131,6 +133,8 @@ lib_libopenvswitch_a_SOURCES = \
 	lib/ovs-atomic-pthreads.c \
 	lib/ovs-atomic-pthreads.h \
 	lib/ovs-atomic.h \
+	lib/ovs-rcu.c \
+	lib/ovs-rcu.h \
 	lib/ovs-thread.c \
 	lib/ovs-thread.h \
 	lib/ovsdb-data.c \
@@ -167,6 +171,8 @@ lib_libopenvswitch_a_SOURCES = \
 	lib/simap.h \
 	lib/signals.c \
 	lib/signals.h \
+	lib/skiplist.c \
+	lib/skiplist.h \
 	lib/smap.c \
 	lib/smap.h \
 	lib/socket-util.c \
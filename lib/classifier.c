@@ -24,6 +24,7 @@
 #include "hash.h"
 #include "odp-util.h"
 #include "ofp-util.h"
+#include "ovs-rcu.h"
 #include "packets.h"
 
 static struct cls_table *find_table(const struct classifier *,
@@ -31,6 +32,7 @@ static struct cls_table *find_table(const struct classifier *,
 static struct cls_table *insert_table(struct classifier *,
                                       const struct minimask *);
 
+static void free_table(struct cls_table *);
 static void destroy_table(struct classifier *, struct cls_table *);
 
 static void update_tables_after_insertion(struct classifier *,
@@ -57,6 +59,16 @@ static struct cls_rule *insert_rule(struct classifier *,
 
 static struct cls_rule *next_rule_in_list__(struct cls_rule *);
 static struct cls_rule *next_rule_in_list(struct cls_rule *);
+
+static void cls_write_begin(struct classifier *);
+static void cls_write_end(struct classifier *);
+static void cls_hmap_insert(struct hmap *, struct hmap_node *, size_t hash);
+static void cls_hmap_replace(struct hmap *, const struct hmap_node *old,
+                             struct hmap_node *new);
+static void cls_list_insert(struct list *before, struct list *elem);
+static void cls_list_move(struct list *before, struct list *elem);
+static unsigned int cls_read_seqno(const struct classifier *);
+static bool cls_read_retry(const struct classifier *, unsigned int seqno);
 
 /* cls_rule. */
 
@@ -143,10 +155,13 @@ classifier_init(struct classifier *cls)
     cls->n_rules = 0;
     hmap_init(&cls->tables);
     list_init(&cls->tables_priority);
+    atomic_init(&cls->seqno, 0);
 }
 
 /* Destroys 'cls'.  Rules within 'cls', if any, are not freed; this is the
- * caller's responsibility. */
+ * caller's responsibility.
+ *
+ * No thread may be looking up in 'cls' any longer. */
 void
 classifier_destroy(struct classifier *cls)
 {
@@ -154,7 +169,7 @@ classifier_destroy(struct classifier *cls)
         struct cls_table *table, *next_table;
 
         HMAP_FOR_EACH_SAFE (table, next_table, hmap_node, &cls->tables) {
-            destroy_table(cls, table);
+            free_table(table);
         }
         hmap_destroy(&cls->tables);
     }
@@ -181,7 +196,8 @@ classifier_count(const struct classifier *cls)
  * fixed fields, and priority), replaces the old rule by 'rule' and returns the
  * rule that was replaced.  The caller takes ownership of the returned rule and
  * is thus responsible for destroying it with cls_rule_destroy(), freeing the
- * memory block in which it resides, etc., as necessary.
+ * memory block in which it resides, etc., as necessary (with
+ * ovsrcu_postpone(), if 'cls' has concurrent readers).
  *
  * Returns NULL if 'cls' does not contain a rule with an identical key, after
  * inserting the new rule.  In this case, no rules are displaced by the new
@@ -193,6 +209,7 @@ classifier_replace(struct classifier *cls, struct cls_rule *rule)
     struct cls_rule *old_rule;
     struct cls_table *table;
 
+    cls_write_begin(cls);
     table = find_table(cls, &rule->match.mask);
     if (!table) {
         table = insert_table(cls, &rule->match.mask);
@@ -203,6 +220,8 @@ classifier_replace(struct classifier *cls, struct cls_rule *rule)
         table->n_table_rules++;
         cls->n_rules++;
     }
+    cls_write_end(cls);
+
     return old_rule;
 }
 
@@ -221,13 +240,15 @@ classifier_insert(struct classifier *cls, struct cls_rule *rule)
 
 /* Removes 'rule' from 'cls'.  It is the caller's responsibility to destroy
  * 'rule' with cls_rule_destroy(), freeing the memory block in which 'rule'
- * resides, etc., as necessary. */
+ * resides, etc., as necessary.  If other threads might be looking up in 'cls'
+ * concurrently, the caller must do so with ovsrcu_postpone(). */
 void
 classifier_remove(struct classifier *cls, struct cls_rule *rule)
 {
     struct cls_rule *head;
     struct cls_table *table;
 
+    cls_write_begin(cls);
     table = find_table(cls, &rule->match.mask);
     head = find_equal(table, &rule->match.flow, rule->hmap_node.hash);
     if (head != rule) {
@@ -239,7 +260,7 @@ classifier_remove(struct classifier *cls, struct cls_rule *rule)
                                              struct cls_rule, list);
 
         list_remove(&rule->list);
-        hmap_replace(&table->rules, &rule->hmap_node, &next->hmap_node);
+        cls_hmap_replace(&table->rules, &rule->hmap_node, &next->hmap_node);
     }
 
     if (--table->n_table_rules == 0) {
@@ -248,19 +269,12 @@ classifier_remove(struct classifier *cls, struct cls_rule *rule)
         update_tables_after_removal(cls, table, rule->priority);
     }
     cls->n_rules--;
+    cls_write_end(cls);
 }
 
-/* Finds and returns the highest-priority rule in 'cls' that matches 'flow'.
- * Returns a null pointer if no rules in 'cls' match 'flow'.  If multiple rules
- * of equal priority match 'flow', returns one arbitrarily.
- *
- * If a rule is found and 'wc' is non-null, bitwise-OR's 'wc' with the
- * set of bits that were significant in the lookup.  At some point
- * earlier, 'wc' should have been initialized (e.g., by
- * flow_wildcards_init_catchall()). */
-struct cls_rule *
-classifier_lookup(const struct classifier *cls, const struct flow *flow,
-                  struct flow_wildcards *wc)
+static struct cls_rule *
+classifier_lookup__(const struct classifier *cls, const struct flow *flow,
+                    struct flow_wildcards *wc)
 {
     struct cls_table *table;
     struct cls_rule *best;
@@ -294,6 +308,35 @@ classifier_lookup(const struct classifier *cls, const struct flow *flow,
     return best;
 }
 
+/* Finds and returns the highest-priority rule in 'cls' that matches 'flow'.
+ * Returns a null pointer if no rules in 'cls' match 'flow'.  If multiple rules
+ * of equal priority match 'flow', returns one arbitrarily.
+ *
+ * If a rule is found and 'wc' is non-null, bitwise-OR's 'wc' with the
+ * set of bits that were significant in the lookup.  At some point
+ * earlier, 'wc' should have been initialized (e.g., by
+ * flow_wildcards_init_catchall()).
+ *
+ * This function may be called concurrently with a modification to 'cls' in
+ * another thread.  In that case, the caller is responsible for making sure
+ * that the returned rule is not freed while it is still in use, e.g. by
+ * freeing removed rules with ovsrcu_postpone() and not holding the returned
+ * rule across a quiescent state. */
+struct cls_rule *
+classifier_lookup(const struct classifier *cls, const struct flow *flow,
+                  struct flow_wildcards *wc)
+{
+    struct cls_rule *rule;
+    unsigned int seqno;
+
+    do {
+        seqno = cls_read_seqno(cls);
+        rule = classifier_lookup__(cls, flow, wc);
+    } while (cls_read_retry(cls, seqno));
+
+    return rule;
+}
+
 /* Finds and returns a rule in 'cls' with exactly the same priority and
  * matching criteria as 'target'.  Returns a null pointer if 'cls' doesn't
  * contain an exact match. */
@@ -541,22 +584,28 @@ insert_table(struct classifier *cls, const struct minimask *mask)
     table = xzalloc(sizeof *table);
     hmap_init(&table->rules);
     minimask_clone(&table->mask, mask);
-    hmap_insert(&cls->tables, &table->hmap_node, minimask_hash(mask, 0));
-    list_push_back(&cls->tables_priority, &table->list_node);
+    cls_hmap_insert(&cls->tables, &table->hmap_node, minimask_hash(mask, 0));
+    cls_list_insert(&cls->tables_priority, &table->list_node);
 
     return table;
 }
 
 static void
-destroy_table(struct classifier *cls, struct cls_table *table)
+free_table(struct cls_table *table)
 {
     minimask_destroy(&table->mask);
-    hmap_remove(&cls->tables, &table->hmap_node);
     hmap_destroy(&table->rules);
-    list_remove(&table->list_node);
     free(table);
 }
 
+static void
+destroy_table(struct classifier *cls, struct cls_table *table)
+{
+    hmap_remove(&cls->tables, &table->hmap_node);
+    list_remove(&table->list_node);
+    ovsrcu_postpone(free_table, table);
+}
+
 /* This function performs the following updates for 'table' in 'cls' following
  * the addition of a new rule with priority 'new_priority' to 'table':
  *
@@ -593,8 +642,7 @@ update_tables_after_insertion(struct classifier *cls, struct cls_table *table,
 
         /* Move 'table' just after 'iter' (unless it's already there). */
         if (iter->list_node.next != &table->list_node) {
-            list_splice(iter->list_node.next,
-                        &table->list_node, table->list_node.next);
+            cls_list_move(iter->list_node.next, &table->list_node);
         }
     }
 }
@@ -641,8 +689,7 @@ update_tables_after_removal(struct classifier *cls, struct cls_table *table,
 
         /* Move 'table' just before 'iter' (unless it's already there). */
         if (iter->list_node.prev != &table->list_node) {
-            list_splice(&iter->list_node,
-                        &table->list_node, table->list_node.next);
+            cls_list_move(&iter->list_node, &table->list_node);
         }
     }
 }
@@ -651,12 +698,27 @@ static struct cls_rule *
 find_match(const struct cls_table *table, const struct flow *flow)
 {
     uint32_t hash = flow_hash_in_minimask(flow, &table->mask, 0);
-    struct cls_rule *rule;
-
-    HMAP_FOR_EACH_WITH_HASH (rule, hmap_node, hash, &table->rules) {
-        if (miniflow_equal_flow_in_minimask(&rule->match.flow, flow,
-                                            &table->mask)) {
-            return rule;
+    const struct hmap *rules = &table->rules;
+    struct hmap_node *const *buckets;
+    struct hmap_node *node;
+    size_t mask;
+
+    /* A concurrent cls_hmap_expand() publishes a larger bucket array before
+     * the matching mask, so reading them in the opposite order never indexes
+     * past the end of the array. */
+    mask = rules->mask;
+    atomic_thread_fence(memory_order_acquire);
+    buckets = rules->buckets;
+
+    for (node = buckets[hash & mask]; node; node = node->next) {
+        if (node->hash == hash) {
+            struct cls_rule *rule = CONTAINER_OF(node, struct cls_rule,
+                                                 hmap_node);
+
+            if (miniflow_equal_flow_in_minimask(&rule->match.flow, flow,
+                                                &table->mask)) {
+                return rule;
+            }
         }
     }
 
@@ -688,8 +750,8 @@ insert_rule(struct classifier *cls,
 
     head = find_equal(table, &new->match.flow, new->hmap_node.hash);
     if (!head) {
-        hmap_insert(&table->rules, &new->hmap_node, new->hmap_node.hash);
         list_init(&new->list);
+        cls_hmap_insert(&table->rules, &new->hmap_node, new->hmap_node.hash);
         goto out;
     } else {
         /* Scan the list for the insertion point that will keep the list in
@@ -699,8 +761,8 @@ insert_rule(struct classifier *cls,
             if (new->priority >= rule->priority) {
                 if (rule == head) {
                     /* 'new' is the new highest-priority flow in the list. */
-                    hmap_replace(&table->rules,
-                                 &rule->hmap_node, &new->hmap_node);
+                    cls_hmap_replace(&table->rules,
+                                     &rule->hmap_node, &new->hmap_node);
                 }
 
                 if (new->priority == rule->priority) {
@@ -738,3 +800,150 @@ next_rule_in_list(struct cls_rule *rule)
     struct cls_rule *next = next_rule_in_list__(rule);
     return next->priority < rule->priority ? next : NULL;
 }
+
+/* Concurrency.
+ *
+ * Modifications to a classifier are bracketed by cls_write_begin() and
+ * cls_write_end(), which increment the classifier's 'seqno' so that it is odd
+ * while a modification is in progress.  classifier_lookup() reads 'seqno'
+ * before and after it searches the classifier and retries if it changed, as
+ * with a Linux kernel seqlock.
+ *
+ * A lookup that raced with a modification may have followed pointers into
+ * memory that the modification unlinked, so such memory is freed with
+ * ovsrcu_postpone(), which waits until every thread has passed through a
+ * quiescent state and thus finished any lookup that might have seen it.
+ *
+ * The modifying code also takes care to initialize a node completely before
+ * making it reachable through a pointer that a reader might follow, so that
+ * a racing reader never sees a half-initialized node. */
+
+static unsigned int
+cls_read_seqno(const struct classifier *cls_)
+{
+    struct classifier *cls = CONST_CAST(struct classifier *, cls_);
+    unsigned int seqno;
+
+    atomic_read_explicit(&cls->seqno, &seqno, memory_order_acquire);
+    return seqno;
+}
+
+static bool
+cls_read_retry(const struct classifier *cls_, unsigned int seqno)
+{
+    struct classifier *cls = CONST_CAST(struct classifier *, cls_);
+    unsigned int seqno2;
+
+    atomic_thread_fence(memory_order_acquire);
+    atomic_read_explicit(&cls->seqno, &seqno2, memory_order_relaxed);
+    return (seqno & 1) != 0 || seqno != seqno2;
+}
+
+static void
+cls_write_begin(struct classifier *cls)
+{
+    unsigned int orig;
+
+    atomic_add(&cls->seqno, 1, &orig);
+    ovs_assert(!(orig & 1));
+    atomic_thread_fence(memory_order_release);
+}
+
+static void
+cls_write_end(struct classifier *cls)
+{
+    unsigned int orig;
+
+    atomic_add_explicit(&cls->seqno, 1, &orig, memory_order_release);
+}
+
+/* Doubles the number of buckets in 'hmap', postponing freeing the old bucket
+ * array until no reader can be using it.
+ *
+ * Moving the nodes to the new buckets rewrites their 'next' pointers, so a
+ * reader racing with this function might skip nodes, but it retries anyway
+ * because of the classifier's 'seqno'. */
+static void
+cls_hmap_expand(struct hmap *hmap)
+{
+    size_t new_mask = hmap->mask * 2 + 1;
+    struct hmap_node **buckets;
+    size_t i;
+
+    buckets = xcalloc(new_mask + 1, sizeof *buckets);
+    for (i = 0; i <= hmap->mask; i++) {
+        struct hmap_node *node, *next;
+
+        for (node = hmap->buckets[i]; node; node = next) {
+            struct hmap_node **bucket = &buckets[node->hash & new_mask];
+
+            next = node->next;
+            node->next = *bucket;
+            *bucket = node;
+        }
+    }
+
+    if (hmap->buckets != &hmap->one) {
+        ovsrcu_postpone(free, hmap->buckets);
+    }
+
+    /* Publish the new buckets before the new mask (see find_match()). */
+    atomic_thread_fence(memory_order_release);
+    hmap->buckets = buckets;
+    atomic_thread_fence(memory_order_release);
+    hmap->mask = new_mask;
+}
+
+/* Like hmap_insert(), but safe against concurrent readers. */
+static void
+cls_hmap_insert(struct hmap *hmap, struct hmap_node *node, size_t hash)
+{
+    struct hmap_node **bucket = &hmap->buckets[hash & hmap->mask];
+
+    node->hash = hash;
+    node->next = *bucket;
+    atomic_thread_fence(memory_order_release);
+    *bucket = node;
+
+    if (++hmap->n / 2 > hmap->mask) {
+        cls_hmap_expand(hmap);
+    }
+}
+
+/* Like hmap_replace(), but safe against concurrent readers. */
+static void
+cls_hmap_replace(struct hmap *hmap,
+                 const struct hmap_node *old, struct hmap_node *new)
+{
+    struct hmap_node **bucket = &hmap->buckets[old->hash & hmap->mask];
+
+    while (*bucket != old) {
+        bucket = &(*bucket)->next;
+    }
+    new->hash = old->hash;
+    new->next = old->next;
+    atomic_thread_fence(memory_order_release);
+    *bucket = new;
+}
+
+/* Like list_insert(), but safe against concurrent readers that only follow
+ * 'next' pointers. */
+static void
+cls_list_insert(struct list *before, struct list *elem)
+{
+    elem->prev = before->prev;
+    elem->next = before;
+    atomic_thread_fence(memory_order_release);
+    before->prev->next = elem;
+    before->prev = elem;
+}
+
+/* Moves 'elem' from its current position in a list to just before 'before',
+ * in a way that is safe against concurrent readers that only follow 'next'
+ * pointers: 'elem->next' always points to a member of the list. */
+static void
+cls_list_move(struct list *before, struct list *elem)
+{
+    list_remove(elem);
+    cls_list_insert(before, elem);
+}
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2009, 2010, 2011, 2012 Nicira, Inc.
+ * Copyright (c) 2009, 2010, 2011, 2012, 2013 Nicira, Inc.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -24,6 +24,24 @@
  *              a hash map from fixed field values to "struct cls_rule",
  *                      which can contain a list of otherwise identical rules
  *                      with lower priorities.
+ *
+ *
+ * Thread-safety
+ * =============
+ *
+ * Any number of threads may call classifier_lookup() on a classifier
+ * concurrently with one thread that modifies it with classifier_insert(),
+ * classifier_replace(), or classifier_remove().  Lookups never block: they
+ * run optimistically and retry if a modification raced with them.  All the
+ * other functions, including iteration with a cls_cursor, must be serialized
+ * with modifications by the caller.
+ *
+ * Memory that a concurrent lookup might still be examining must not be freed
+ * immediately.  The classifier takes care of this for its own internal data.
+ * A client that removes a rule from a classifier that has concurrent readers
+ * must likewise use ovsrcu_postpone() (see ovs-rcu.h) to destroy the rule and
+ * free the memory that contains it.  A reader must not use a rule returned by
+ * classifier_lookup() after it passes through a quiescent state.
  */
 
 #include "flow.h"
@@ -32,6 +50,7 @@
 #include "match.h"
 #include "openflow/nicira-ext.h"
 #include "openflow/openflow.h"
+#include "ovs-atomic.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -42,6 +61,7 @@ struct classifier {
     int n_rules;                /* Total number of rules. */
     struct hmap tables;         /* Contains "struct cls_table"s.  */
     struct list tables_priority; /* Tables in descending priority order */
+    atomic_uint seqno;          /* Odd while a modification is in progress. */
 };
 
 /* A set of rules that all have the same fields wildcarded. */
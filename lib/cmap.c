@@ -0,0 +1,803 @@
+/*
+ * Copyright (c) 2013 Nicira, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+#include "cmap.h"
+#include <string.h>
+#include "hash.h"
+#include "ovs-rcu.h"
+#include "random.h"
+#include "util.h"
+
+/* Optimistic Concurrent Cuckoo Hash
+ * =================================
+ *
+ * A "cuckoo hash" is an open addressing hash table schema, designed such that
+ * a given element can be in one of only a small number of buckets 'd', each of
+ * which holds up to a small number 'k' elements.  Thus, the expected and
+ * worst-case lookup times are O(1) because they require comparing no more
+ * than a fixed number of elements (k * d).  Inserting a new element can
+ * require moving around existing elements, but it is also O(1) amortized
+ * expected time.
+ *
+ * An optimistic concurrent hash table goes one step further, making it
+ * possible for a single writer to execute concurrently with any number of
+ * readers without requiring the readers to take any locks.
+ *
+ * This cuckoo hash implementation uses:
+ *
+ *    - Two hash functions (d=2).  More hash functions allow for a higher load
+ *      factor, but increasing 'k' is easier and the benefits of increasing 'd'
+ *      quickly fall off with the 'k' values used here.  Also, the method of
+ *      generating hashes used in this implementation is hard to reasonably
+ *      extend beyond d=2.  Finally, each additional hash function means that a
+ *      lookup has to look at least one extra cache line.
+ *
+ *    - 5 or 7 elements per bucket (k=5 or k=7), chosen to make buckets
+ *      exactly one cache line in size on 64-bit and 32-bit platforms,
+ *      respectively.  Each lookup therefore touches at most two cache lines,
+ *      instead of following a chain of 'next' pointers as in an hmap.
+ *
+ * Each bucket has a counter that the writer increments to an odd value before
+ * it changes the bucket and to an even value afterward.  A reader that finds
+ * that the counter changed while it searched the bucket, or that it was odd,
+ * searches again.  Moving an element to its alternate bucket first copies it
+ * there and only then removes it from its original bucket, so a reader always
+ * finds it in at least one of the two.
+ *
+ * Nodes with identical hash values are chained together in a list hanging off
+ * a single slot, so the hash values within the two buckets for any given hash
+ * are unique.
+ *
+ * The writer allocates a new table when the load factor gets too high or too
+ * low, or when an insertion cannot find a place for an element, and frees the
+ * old table with ovsrcu_postpone() so that readers still examining it are not
+ * disturbed.
+ */
+
+/* An entry is an int and a pointer: 8 bytes on 32-bit, 12 bytes on 64-bit. */
+#define CMAP_ENTRY_SIZE (4 + sizeof(void *))
+
+/* Number of entries per bucket: 7 on 32-bit, 5 on 64-bit. */
+#define CMAP_K ((CACHE_LINE_SIZE - 4) / CMAP_ENTRY_SIZE)
+
+/* A cuckoo hash bucket.  Designed to be cache-aligned and exactly one cache
+ * line long. */
+struct cmap_bucket {
+    /* Allows readers to track in-progress changes.  Initially zero, each
+     * writer increments this value just before and just after each change (see
+     * cmap_set_bucket()).  Thus, a reader can ensure that it gets a consistent
+     * snapshot by waiting for the counter to become even (see
+     * read_even_counter()), then checking that its value does not change while
+     * examining the bucket (see counter_changed()). */
+    atomic_uint32_t counter;
+
+    /* (hash, node) slots.  They are parallel arrays instead of an array of
+     * structs to reduce the amount of space lost to padding.
+     *
+     * The slots are in no particular order.  A null pointer indicates that a
+     * pair is unused.  In-use slots are not necessarily in the earliest
+     * slots. */
+    uint32_t hashes[CMAP_K];
+    struct cmap_node nodes[CMAP_K];
+};
+
+/* Default maximum load factor (as a fraction of UINT32_MAX + 1) before
+ * enlarging a cmap.  Reasonable values lie between about 75% and 93%.  Smaller
+ * values waste memory; larger values increase the average insertion time. */
+#define CMAP_MAX_LOAD ((uint32_t) (UINT32_MAX * .85))
+
+/* Default minimum load factor (as a fraction of UINT32_MAX + 1) before
+ * shrinking a cmap.  Currently, the value is chosen to be 20%, this means cmap
+ * will have a 40% load factor after shrink. */
+#define CMAP_MIN_LOAD ((uint32_t) (UINT32_MAX * .20))
+
+/* The implementation of a concurrent hash map. */
+struct cmap_impl {
+    unsigned int n;             /* Number of in-use elements. */
+    unsigned int max_n;         /* Max elements before enlarging. */
+    unsigned int min_n;         /* Min elements before shrinking. */
+    uint32_t mask;              /* Number of 'buckets', minus one. */
+    uint32_t basis;             /* Basis for rehashing client's hash values. */
+
+    /* Padding to make cmap_impl exactly one cache line long. */
+    uint8_t pad[CACHE_LINE_SIZE - sizeof(unsigned int) * 5];
+
+    struct cmap_bucket buckets[1];
+};
+BUILD_ASSERT_DECL(offsetof(struct cmap_impl, buckets) == CACHE_LINE_SIZE);
+
+/* An empty cmap, used by every cmap that has never had any elements, so that
+ * cmap_init() does not need to allocate memory. */
+static const struct cmap_impl empty_cmap;
+
+static struct cmap_impl *cmap_rehash(struct cmap *, uint32_t mask);
+
+/* Given a rehashed value 'hash', returns the other hash for that rehashed
+ * value.  This is symmetric: other_hash(other_hash(x)) == x. */
+static uint32_t
+other_hash(uint32_t hash)
+{
+    return (hash << 16) | (hash >> 16);
+}
+
+/* Returns the rehashed value for 'hash' within 'impl'.  Rehashing with a
+ * per-table random basis keeps clients' poor hash functions, or adversarial
+ * inputs, from forcing many elements into the same pair of buckets. */
+static uint32_t
+rehash(const struct cmap_impl *impl, uint32_t hash)
+{
+    return hash_finish(impl->basis, hash);
+}
+
+static struct cmap_impl *
+cmap_get_impl(const struct cmap *cmap)
+{
+    return ovsrcu_get(struct cmap_impl *, &cmap->impl);
+}
+
+static uint32_t
+calc_max_n(uint32_t mask)
+{
+    return ((uint64_t) (mask + 1) * CMAP_K * CMAP_MAX_LOAD) >> 32;
+}
+
+static uint32_t
+calc_min_n(uint32_t mask)
+{
+    return ((uint64_t) (mask + 1) * CMAP_K * CMAP_MIN_LOAD) >> 32;
+}
+
+static struct cmap_impl *
+cmap_impl_create(uint32_t mask)
+{
+    struct cmap_impl *impl;
+
+    ovs_assert(is_pow2(mask + 1));
+
+    impl = xzalloc_cacheline(sizeof *impl + mask * sizeof *impl->buckets);
+    impl->n = 0;
+    impl->max_n = calc_max_n(mask);
+    impl->min_n = calc_min_n(mask);
+    impl->mask = mask;
+    impl->basis = random_uint32();
+
+    return impl;
+}
+
+static void
+cmap_impl_free(struct cmap_impl *impl)
+{
+    if (impl != &empty_cmap) {
+        free_cacheline(impl);
+    }
+}
+
+/* Initializes 'cmap' as an empty concurrent hash map. */
+void
+cmap_init(struct cmap *cmap)
+{
+    ovsrcu_set(&cmap->impl, &empty_cmap);
+}
+
+/* Destroys 'cmap'.
+ *
+ * The client is responsible for destroying any data previously held in
+ * 'cmap'. */
+void
+cmap_destroy(struct cmap *cmap)
+{
+    if (cmap) {
+        ovsrcu_postpone(cmap_impl_free, cmap_get_impl(cmap));
+    }
+}
+
+/* Returns the number of elements in 'cmap'. */
+size_t
+cmap_count(const struct cmap *cmap)
+{
+    return cmap_get_impl(cmap)->n;
+}
+
+/* Returns true if 'cmap' is empty, false otherwise. */
+bool
+cmap_is_empty(const struct cmap *cmap)
+{
+    return cmap_count(cmap) == 0;
+}
+
+static uint32_t
+read_counter(const struct cmap_bucket *bucket_)
+{
+    struct cmap_bucket *bucket = CONST_CAST(struct cmap_bucket *, bucket_);
+    uint32_t counter;
+
+    atomic_read_explicit(&bucket->counter, &counter, memory_order_acquire);
+    return counter;
+}
+
+static uint32_t
+read_even_counter(const struct cmap_bucket *bucket)
+{
+    uint32_t counter;
+
+    do {
+        counter = read_counter(bucket);
+    } while (OVS_UNLIKELY(counter & 1));
+
+    return counter;
+}
+
+static bool
+counter_changed(const struct cmap_bucket *b_, uint32_t c)
+{
+    struct cmap_bucket *b = CONST_CAST(struct cmap_bucket *, b_);
+    uint32_t counter;
+
+    /* Need to make sure the counter read is not moved up, before the hash and
+     * cmap_node_next().  The atomic_read_explicit() with memory_order_acquire
+     * in read_counter() still allows prior reads to be moved after the
+     * barrier.  atomic_thread_fence prevents all following memory accesses
+     * from moving prior to preceding loads. */
+    atomic_thread_fence(memory_order_acquire);
+    atomic_read_explicit(&b->counter, &counter, memory_order_relaxed);
+
+    return OVS_UNLIKELY(counter != c);
+}
+
+static struct cmap_node *
+cmap_find_in_bucket(const struct cmap_bucket *bucket, uint32_t hash)
+{
+    int i;
+
+    for (i = 0; i < CMAP_K; i++) {
+        if (bucket->hashes[i] == hash) {
+            struct cmap_node *node = cmap_node_next(&bucket->nodes[i]);
+
+            if (node) {
+                return node;
+            }
+        }
+    }
+    return NULL;
+}
+
+/* Searches 'cmap' for an element with the specified 'hash'.  If one or more is
+ * found, returns a pointer to the first one, otherwise a null pointer.  All of
+ * the nodes on the returned list are guaranteed to have exactly the given
+ * 'hash'.
+ *
+ * This function works even if 'cmap' is changing concurrently.  If 'cmap' is
+ * not changing, then cmap_find_protected() is slightly faster.
+ *
+ * CMAP_FOR_EACH_WITH_HASH is usually more convenient. */
+struct cmap_node *
+cmap_find(const struct cmap *cmap, uint32_t hash)
+{
+    const struct cmap_impl *impl = cmap_get_impl(cmap);
+    uint32_t h1 = rehash(impl, hash);
+    uint32_t h2 = other_hash(h1);
+    const struct cmap_bucket *b1;
+    const struct cmap_bucket *b2;
+    struct cmap_node *node;
+    uint32_t c1, c2;
+
+    b1 = &impl->buckets[h1 & impl->mask];
+    b2 = &impl->buckets[h2 & impl->mask];
+
+retry:
+    c1 = read_even_counter(b1);
+    node = cmap_find_in_bucket(b1, hash);
+    if (counter_changed(b1, c1)) {
+        goto retry;
+    }
+    if (node) {
+        return node;
+    }
+
+    c2 = read_even_counter(b2);
+    node = cmap_find_in_bucket(b2, hash);
+    if (counter_changed(b2, c2)) {
+        goto retry;
+    }
+    if (node) {
+        return node;
+    }
+
+    /* The element might have moved from 'b2' to 'b1' while we were searching
+     * 'b2'. */
+    if (counter_changed(b1, c1)) {
+        goto retry;
+    }
+    return NULL;
+}
+
+static int
+cmap_find_slot_protected(struct cmap_bucket *b, uint32_t hash)
+{
+    int i;
+
+    for (i = 0; i < CMAP_K; i++) {
+        if (b->hashes[i] == hash && cmap_node_next_protected(&b->nodes[i])) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static struct cmap_node *
+cmap_find_bucket_protected(struct cmap_impl *impl, uint32_t hash, uint32_t h)
+{
+    struct cmap_bucket *b = &impl->buckets[h & impl->mask];
+    int i = cmap_find_slot_protected(b, hash);
+
+    return i >= 0 ? cmap_node_next_protected(&b->nodes[i]) : NULL;
+}
+
+/* Like cmap_find(), but only for use if 'cmap' cannot change concurrently.
+ *
+ * CMAP_FOR_EACH_WITH_HASH_PROTECTED is usually more convenient. */
+struct cmap_node *
+cmap_find_protected(const struct cmap *cmap, uint32_t hash)
+{
+    struct cmap_impl *impl = cmap_get_impl(cmap);
+    uint32_t h1 = rehash(impl, hash);
+    uint32_t h2 = other_hash(h1);
+    struct cmap_node *node;
+
+    node = cmap_find_bucket_protected(impl, hash, h1);
+    if (node) {
+        return node;
+    }
+    return cmap_find_bucket_protected(impl, hash, h2);
+}
+
+static int
+cmap_find_empty_slot_protected(const struct cmap_bucket *b)
+{
+    int i;
+
+    for (i = 0; i < CMAP_K; i++) {
+        if (!cmap_node_next_protected(&b->nodes[i])) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void
+cmap_set_bucket(struct cmap_bucket *b, int i,
+                struct cmap_node *node, uint32_t hash)
+{
+    uint32_t c;
+
+    atomic_read_explicit(&b->counter, &c, memory_order_relaxed);
+    atomic_store_explicit(&b->counter, c + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    ovsrcu_set(&b->nodes[i].next, node);
+    b->hashes[i] = hash;
+    atomic_store_explicit(&b->counter, c + 2, memory_order_release);
+}
+
+/* Searches 'b' for a node with the given 'hash'.  If it finds one, adds
+ * 'new_node' to the node's linked list and returns true.  If it does not find
+ * one, returns false. */
+static bool
+cmap_insert_dup(struct cmap_node *new_node, uint32_t hash,
+                struct cmap_bucket *b)
+{
+    int i = cmap_find_slot_protected(b, hash);
+
+    if (i >= 0) {
+        struct cmap_node *node = cmap_node_next_protected(&b->nodes[i]);
+
+        /* Link 'new_node' at the head of the list.  Readers that are already
+         * traversing the list are unaffected. */
+        ovsrcu_init(&new_node->next, node);
+        ovsrcu_set(&b->nodes[i].next, new_node);
+        return true;
+    }
+    return false;
+}
+
+/* Searches 'b' for an empty slot.  If successful, stores 'node' and 'hash' in
+ * the slot and returns true.  Otherwise, returns false. */
+static bool
+cmap_insert_bucket(struct cmap_node *node, uint32_t hash,
+                   struct cmap_bucket *b)
+{
+    int i = cmap_find_empty_slot_protected(b);
+
+    if (i >= 0) {
+        cmap_set_bucket(b, i, node, hash);
+        return true;
+    }
+    return false;
+}
+
+/* Returns the other bucket that b->nodes[slot] could occupy in 'impl'.  (This
+ * might be the same as 'b'.) */
+static struct cmap_bucket *
+other_bucket_protected(struct cmap_impl *impl, struct cmap_bucket *b, int slot)
+{
+    uint32_t h1 = rehash(impl, b->hashes[slot]);
+    uint32_t h2 = other_hash(h1);
+    uint32_t b_idx = b - impl->buckets;
+    uint32_t other_h = (h1 & impl->mask) == b_idx ? h2 : h1;
+
+    return &impl->buckets[other_h & impl->mask];
+}
+
+/* Maximum number of elements that cmap_insert_bfs() moves to make room for a
+ * new element. */
+enum { MAX_DEPTH = 4 };
+
+/* A path from a starting bucket through the alternate buckets of the elements
+ * in a sequence of slots. */
+struct cmap_path {
+    struct cmap_bucket *buckets[MAX_DEPTH + 1]; /* Buckets along the path. */
+    int slots[MAX_DEPTH];       /* Slot in buckets[i] moved to buckets[i+1]. */
+    int n;                      /* Number of elements in 'slots'. */
+};
+
+static bool
+cmap_path_contains(const struct cmap_path *path, const struct cmap_bucket *b)
+{
+    int i;
+
+    for (i = 0; i <= path->n; i++) {
+        if (path->buckets[i] == b) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Searches 'impl', breadth-first, for a sequence of at most MAX_DEPTH moves
+ * of elements to their alternate buckets that frees a slot in 'b1' or 'b2',
+ * which must both be full.  If successful, makes the moves, stores 'new_node'
+ * and 'hash' in the freed slot, and returns true.  Otherwise, returns false
+ * without changing 'impl'.
+ *
+ * Each move first copies an element into its alternate bucket and only then
+ * overwrites the original slot, starting from the far end of the path, so
+ * that readers can always find every element in one of its buckets. */
+static bool
+cmap_insert_bfs(struct cmap_impl *impl, struct cmap_node *new_node,
+                uint32_t hash, struct cmap_bucket *b1, struct cmap_bucket *b2)
+{
+    enum { MAX_QUEUE = 512 };
+    struct cmap_path *queue;
+    int head, tail;
+    bool found;
+
+    queue = xmalloc(MAX_QUEUE * sizeof *queue);
+    head = tail = 0;
+    found = false;
+
+    queue[head].buckets[0] = b1;
+    queue[head++].n = 0;
+    if (b1 != b2) {
+        queue[head].buckets[0] = b2;
+        queue[head++].n = 0;
+    }
+
+    while (tail < head && !found) {
+        const struct cmap_path *path = &queue[tail++];
+        struct cmap_bucket *this = path->buckets[path->n];
+        int i;
+
+        for (i = 0; i < CMAP_K; i++) {
+            struct cmap_bucket *next = other_bucket_protected(impl, this, i);
+            int j;
+
+            if (cmap_path_contains(path, next)) {
+                continue;
+            }
+
+            j = cmap_find_empty_slot_protected(next);
+            if (j >= 0) {
+                /* Move each element along the path into the following bucket,
+                 * working backward from the empty slot. */
+                int k;
+
+                cmap_set_bucket(next, j,
+                                cmap_node_next_protected(&this->nodes[i]),
+                                this->hashes[i]);
+                for (k = path->n; k > 0; k--) {
+                    struct cmap_bucket *from = path->buckets[k - 1];
+                    int slot = path->slots[k - 1];
+
+                    cmap_set_bucket(path->buckets[k], k < path->n
+                                    ? path->slots[k] : i,
+                                    cmap_node_next_protected(
+                                        &from->nodes[slot]),
+                                    from->hashes[slot]);
+                }
+                cmap_set_bucket(path->buckets[0],
+                                path->n ? path->slots[0] : i,
+                                new_node, hash);
+                found = true;
+                break;
+            }
+
+            if (path->n < MAX_DEPTH && head < MAX_QUEUE) {
+                struct cmap_path *op = &queue[head++];
+
+                *op = *path;
+                op->slots[op->n++] = i;
+                op->buckets[op->n] = next;
+            }
+        }
+    }
+
+    free(queue);
+    return found;
+}
+
+/* Adds 'node', with the given 'hash', to 'impl'.
+ *
+ * 'node' is ordinarily a single node, with a null 'next' pointer.  When
+ * rehashing, however, it may be a longer chain of nodes. */
+static bool
+cmap_try_insert(struct cmap_impl *impl, struct cmap_node *node, uint32_t hash)
+{
+    uint32_t h1 = rehash(impl, hash);
+    uint32_t h2 = other_hash(h1);
+    struct cmap_bucket *b1 = &impl->buckets[h1 & impl->mask];
+    struct cmap_bucket *b2 = &impl->buckets[h2 & impl->mask];
+
+    return (OVS_UNLIKELY(cmap_insert_dup(node, hash, b1) ||
+                         cmap_insert_dup(node, hash, b2)) ||
+            OVS_LIKELY(cmap_insert_bucket(node, hash, b1) ||
+                       cmap_insert_bucket(node, hash, b2)) ||
+            cmap_insert_bfs(impl, node, hash, b1, b2));
+}
+
+/* Inserts 'node', with the given 'hash', into 'cmap'.  The caller must ensure
+ * that 'cmap' cannot change concurrently (from another thread).  If duplicates
+ * are undesirable, the caller must have already verified that 'cmap' does not
+ * contain a duplicate of 'node'. */
+void
+cmap_insert(struct cmap *cmap, struct cmap_node *node, uint32_t hash)
+{
+    struct cmap_impl *impl = cmap_get_impl(cmap);
+
+    ovsrcu_init(&node->next, NULL);
+
+    if (OVS_UNLIKELY(impl->n >= impl->max_n)) {
+        impl = cmap_rehash(cmap, (impl->mask << 1) | 1);
+    }
+
+    while (OVS_UNLIKELY(!cmap_try_insert(impl, node, hash))) {
+        impl = cmap_rehash(cmap, impl->mask);
+    }
+    impl->n++;
+}
+
+/* Replaces 'node' by 'replacement' on the chain for 'hash' in the bucket of
+ * 'impl' selected by 'h', or just removes 'node' if 'replacement' is null.
+ * Returns false if 'node' is not in that bucket. */
+static bool
+cmap_replace__(struct cmap_impl *impl, struct cmap_node *node,
+               struct cmap_node *replacement, uint32_t hash, uint32_t h)
+{
+    struct cmap_bucket *b = &impl->buckets[h & impl->mask];
+    struct cmap_node *iter;
+    int slot;
+
+    slot = cmap_find_slot_protected(b, hash);
+    if (slot < 0) {
+        return false;
+    }
+
+    /* The pointer to 'node' is changed to point to 'replacement', which is
+     * the next node if no replacement node is given. */
+    if (!replacement) {
+        replacement = cmap_node_next_protected(node);
+    } else {
+        /* 'replacement' takes the position of 'node' in the list. */
+        ovsrcu_init(&replacement->next, cmap_node_next_protected(node));
+    }
+
+    /* The bucket slot itself acts as the head of the list. */
+    iter = &b->nodes[slot];
+    for (;;) {
+        struct cmap_node *next = cmap_node_next_protected(iter);
+
+        if (!next) {
+            return false;
+        } else if (next == node) {
+            ovsrcu_set(&iter->next, replacement);
+            return true;
+        }
+        iter = next;
+    }
+}
+
+/* Removes 'node' from 'cmap'.  The caller must ensure that 'cmap' cannot
+ * change concurrently (from another thread).
+ *
+ * 'node' must not be destroyed or modified or inserted back into 'cmap' or
+ * into any other concurrent hash map while any other thread might be
+ * accessing it.  One correct way to do this is to free it from an RCU
+ * callback with ovsrcu_postpone(). */
+void
+cmap_remove(struct cmap *cmap, struct cmap_node *node, uint32_t hash)
+{
+    struct cmap_impl *impl = cmap_get_impl(cmap);
+    uint32_t h1 = rehash(impl, hash);
+    uint32_t h2 = other_hash(h1);
+
+    ovs_assert(cmap_replace__(impl, node, NULL, hash, h1) ||
+               cmap_replace__(impl, node, NULL, hash, h2));
+    impl->n--;
+    if (OVS_UNLIKELY(impl->n < impl->min_n) && impl->mask) {
+        cmap_rehash(cmap, impl->mask >> 1);
+    }
+}
+
+/* Replaces 'old_node' in 'cmap' with 'new_node'.  The caller must ensure that
+ * 'cmap' cannot change concurrently (from another thread).
+ *
+ * 'old_node' must not be destroyed or modified or inserted back into 'cmap' or
+ * into any other concurrent hash map while any other thread might be
+ * accessing it.  One correct way to do this is to free it from an RCU
+ * callback with ovsrcu_postpone(). */
+void
+cmap_replace(struct cmap *cmap, struct cmap_node *old_node,
+             struct cmap_node *new_node, uint32_t hash)
+{
+    struct cmap_impl *impl = cmap_get_impl(cmap);
+    uint32_t h1 = rehash(impl, hash);
+    uint32_t h2 = other_hash(h1);
+
+    ovs_assert(cmap_replace__(impl, old_node, new_node, hash, h1) ||
+               cmap_replace__(impl, old_node, new_node, hash, h2));
+}
+
+static bool
+cmap_try_rehash(const struct cmap_impl *old, struct cmap_impl *new)
+{
+    const struct cmap_bucket *b;
+
+    for (b = old->buckets; b <= &old->buckets[old->mask]; b++) {
+        int i;
+
+        for (i = 0; i < CMAP_K; i++) {
+            /* Each slot holds a whole chain of nodes with a single hash, which
+             * moves to 'new' as a unit. */
+            struct cmap_node *node = cmap_node_next_protected(&b->nodes[i]);
+
+            if (node && !cmap_try_insert(new, node, b->hashes[i])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static struct cmap_impl *
+cmap_rehash(struct cmap *cmap, uint32_t mask)
+{
+    struct cmap_impl *old = cmap_get_impl(cmap);
+    struct cmap_impl *new;
+
+    new = cmap_impl_create(mask);
+    ovs_assert(old->n < new->max_n);
+
+    while (!cmap_try_rehash(old, new)) {
+        memset(new->buckets, 0, (mask + 1) * sizeof *new->buckets);
+        new->basis = random_uint32();
+    }
+
+    new->n = old->n;
+    ovsrcu_set(&cmap->impl, new);
+    ovsrcu_postpone(cmap_impl_free, old);
+
+    return new;
+}
+
+/* Initializes 'cursor' for iterating through 'cmap'.  See CMAP_FOR_EACH. */
+void
+cmap_cursor_init(struct cmap_cursor *cursor, const struct cmap *cmap)
+{
+    cursor->impl = cmap_get_impl(cmap);
+    cursor->bucket_idx = 0;
+    cursor->entry_idx = 0;
+}
+
+/* Returns the node that follows 'node' in the iteration of 'cursor', or the
+ * first node if 'node' is null, or a null pointer if there are no more
+ * nodes. */
+struct cmap_node *
+cmap_cursor_next(struct cmap_cursor *cursor, const struct cmap_node *node)
+{
+    const struct cmap_impl *impl = cursor->impl;
+
+    if (node) {
+        struct cmap_node *next = cmap_node_next(node);
+
+        if (next) {
+            return next;
+        }
+    }
+
+    while (cursor->bucket_idx <= impl->mask) {
+        const struct cmap_bucket *b = &impl->buckets[cursor->bucket_idx];
+
+        while (cursor->entry_idx < CMAP_K) {
+            struct cmap_node *next;
+
+            next = cmap_node_next(&b->nodes[cursor->entry_idx++]);
+            if (next) {
+                return next;
+            }
+        }
+
+        cursor->bucket_idx++;
+        cursor->entry_idx = 0;
+    }
+
+    return NULL;
+}
+
+/* Returns the node at 'position' in 'cmap' and advances 'position' to the
+ * following node, or returns a null pointer and resets 'position' to the
+ * beginning if there are no more nodes. */
+struct cmap_node *
+cmap_next_position(const struct cmap *cmap,
+                   struct cmap_position *position)
+{
+    const struct cmap_impl *impl = cmap_get_impl(cmap);
+    unsigned int bucket = position->bucket;
+    unsigned int entry = position->entry;
+    unsigned int offset = position->offset;
+
+    while (bucket <= impl->mask) {
+        const struct cmap_bucket *b = &impl->buckets[bucket];
+
+        while (entry < CMAP_K) {
+            struct cmap_node *node = cmap_node_next(&b->nodes[entry]);
+            unsigned int i;
+
+            for (i = 0; node; i++, node = cmap_node_next(node)) {
+                if (i == offset) {
+                    if (cmap_node_next(node)) {
+                        offset++;
+                    } else {
+                        entry++;
+                        offset = 0;
+                    }
+
+                    position->bucket = bucket;
+                    position->entry = entry;
+                    position->offset = offset;
+                    return node;
+                }
+            }
+
+            entry++;
+            offset = 0;
+        }
+
+        bucket++;
+        entry = offset = 0;
+    }
+
+    position->bucket = position->entry = position->offset = 0;
+    return NULL;
+}
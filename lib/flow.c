@@ -861,9 +861,9 @@ flow_hash_in_wildcards(const struct flow *flow,
 
     hash = basis;
     for (i = 0; i < FLOW_U32S; i++) {
-        hash = mhash_add(hash, flow_u32[i] & wc_u32[i]);
+        hash = hash_add(hash, flow_u32[i] & wc_u32[i]);
     }
-    return mhash_finish(hash, 4 * FLOW_U32S);
+    return hash_finish(hash, 4 * FLOW_U32S);
 }
 
 /* Sets the VLAN VID that 'flow' matches to 'vid', which is interpreted as an
@@ -1118,6 +1118,16 @@ miniflow_destroy(struct miniflow *flow)
     }
 }
 
+/* Returns the number of bytes of heap memory owned by 'flow', not including
+ * the storage in which 'flow' itself resides. */
+size_t
+miniflow_heap_size(const struct miniflow *flow)
+{
+    return (flow->values != flow->inline_values
+            ? miniflow_n_values(flow) * sizeof *flow->values
+            : 0);
+}
+
 /* Initializes 'dst' as a copy of 'src'. */
 void
 miniflow_expand(const struct miniflow *src, struct flow *dst)
@@ -1272,12 +1282,12 @@ miniflow_hash_in_minimask(const struct miniflow *flow,
         for (map = mask->masks.map[i]; map; map = zero_rightmost_1bit(map)) {
             int ofs = raw_ctz(map) + i * 32;
 
-            hash = mhash_add(hash, miniflow_get(flow, ofs) & *p);
+            hash = hash_add(hash, miniflow_get(flow, ofs) & *p);
             p++;
         }
     }
 
-    return mhash_finish(hash, (p - mask->masks.values) * 4);
+    return hash_finish(hash, (p - mask->masks.values) * 4);
 }
 
 /* Returns a hash value for the bits of 'flow' where there are 1-bits in
@@ -1301,12 +1311,12 @@ flow_hash_in_minimask(const struct flow *flow, const struct minimask *mask,
         for (map = mask->masks.map[i]; map; map = zero_rightmost_1bit(map)) {
             int ofs = raw_ctz(map) + i * 32;
 
-            hash = mhash_add(hash, flow_u32[ofs] & *p);
+            hash = hash_add(hash, flow_u32[ofs] & *p);
             p++;
         }
     }
 
-    return mhash_finish(hash, (p - mask->masks.values) * 4);
+    return hash_finish(hash, (p - mask->masks.values) * 4);
 }
 
 /* Initializes 'dst' as a copy of 'src'.  The caller must eventually free 'dst'
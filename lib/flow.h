@@ -321,6 +321,7 @@ struct miniflow {
 void miniflow_init(struct miniflow *, const struct flow *);
 void miniflow_clone(struct miniflow *, const struct miniflow *);
 void miniflow_destroy(struct miniflow *);
+size_t miniflow_heap_size(const struct miniflow *);
 
 void miniflow_expand(const struct miniflow *, struct flow *);
 
@@ -22,7 +22,7 @@
 uint32_t
 hash_3words(uint32_t a, uint32_t b, uint32_t c)
 {
-    return mhash_finish(mhash_add(mhash_add(mhash_add(a, 0), b), c), 12);
+    return hash_finish(hash_add(hash_add(hash_add(a, 0), b), c), 12);
 }
 
 /* Returns the hash of the 'n' bytes at 'p', starting from 'basis'. */
@@ -60,9 +60,9 @@ hash_words(const uint32_t p[], size_t n_words, uint32_t basis)
 
     hash = basis;
     for (i = 0; i < n_words; i++) {
-        hash = mhash_add(hash, p[i]);
+        hash = hash_add(hash, p[i]);
     }
-    return mhash_finish(hash, n_words * 4);
+    return hash_finish(hash, n_words * 4);
 }
 
 uint32_t
@@ -145,6 +145,9 @@ json_type_to_string(enum json_type type)
     case JSON_STRING:
         return "string";
 
+    case JSON_SERIALIZED_OBJECT:
+        return "serialized object";
+
     case JSON_N_TYPES:
     default:
         return "<invalid>";
@@ -179,6 +182,20 @@ json_string_create(const char *s)
     return json_string_create_nocopy(xstrdup(s));
 }
 
+/* Returns a JSON value whose serialized form is 's', which must be a complete
+ * JSON text, without parsing it.  Takes ownership of 's'.
+ *
+ * The returned value can only be serialized, destroyed, or cloned, so it is
+ * useful for building up large messages piecemeal without keeping a tree of
+ * "struct json"s for all of their contents. */
+struct json *
+json_serialized_object_create_nocopy(char *s)
+{
+    struct json *json = json_create(JSON_SERIALIZED_OBJECT);
+    json->u.string = s;
+    return json;
+}
+
 struct json *
 json_array_create_empty(void)
 {
@@ -344,6 +361,7 @@ json_destroy(struct json *json)
             break;
 
         case JSON_STRING:
+        case JSON_SERIALIZED_OBJECT:
             free(json->u.string);
             break;
 
@@ -404,6 +422,9 @@ json_clone(const struct json *json)
     case JSON_STRING:
         return json_string_create(json->u.string);
 
+    case JSON_SERIALIZED_OBJECT:
+        return json_serialized_object_create_nocopy(xstrdup(json->u.string));
+
     case JSON_NULL:
     case JSON_FALSE:
     case JSON_TRUE:
@@ -487,6 +508,7 @@ json_hash(const struct json *json, size_t basis)
         return json_hash_array(&json->u.array, basis);
 
     case JSON_STRING:
+    case JSON_SERIALIZED_OBJECT:
         return hash_string(json->u.string, basis);
 
     case JSON_NULL:
@@ -558,6 +580,7 @@ json_equal(const struct json *a, const struct json *b)
         return json_equal_array(&a->u.array, &b->u.array);
 
     case JSON_STRING:
+    case JSON_SERIALIZED_OBJECT:
         return !strcmp(a->u.string, b->u.string);
 
     case JSON_NULL:
@@ -1078,11 +1101,102 @@ json_parser_create(int flags)
     return p;
 }
 
+/* Returns true if any byte in 'x' is less than 'n', which must be at most
+ * 128. */
+static inline bool
+json_word_has_less(uint64_t x, uint8_t n)
+{
+    return ((x - UINT64_C(0x0101010101010101) * n)
+            & ~x & UINT64_C(0x8080808080808080)) != 0;
+}
+
+/* Returns true if any byte in 'x' equals 'c'. */
+static inline bool
+json_word_has_byte(uint64_t x, uint8_t c)
+{
+    return json_word_has_less(x ^ (UINT64_C(0x0101010101010101) * c), 1);
+}
+
+/* Returns the number of bytes at the beginning of the 'n' bytes in 's' that
+ * may appear as-is inside a quoted string, that is, that are not '"', '\\',
+ * or a control character.
+ *
+ * Most of the text in OVSDB traffic is inside strings, so this examines 8
+ * bytes at a time until it finds one of interest. */
+static size_t
+json_lex_string_span(const char *s, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + sizeof(uint64_t) <= n; i += sizeof(uint64_t)) {
+        uint64_t x;
+
+        memcpy(&x, &s[i], sizeof x);
+        if (json_word_has_less(x, 0x20)
+            || json_word_has_byte(x, '"')
+            || json_word_has_byte(x, '\\')) {
+            break;
+        }
+    }
+    for (; i < n; i++) {
+        unsigned char c = s[i];
+        if (c < 0x20 || c == '"' || c == '\\') {
+            break;
+        }
+    }
+    return i;
+}
+
+/* Returns the number of bytes at the beginning of the 'n' bytes in 's' that
+ * json_lex_input() would simply append to the token being accumulated in
+ * lexer state 'state'.  None of those bytes is a new-line. */
+static size_t
+json_lex_span(enum json_lex_state state, const char *s, size_t n)
+{
+    size_t i;
+
+    switch (state) {
+    case JSON_LEX_STRING:
+        return json_lex_string_span(s, n);
+
+    case JSON_LEX_NUMBER:
+        for (i = 0; i < n; i++) {
+            unsigned char c = s[i];
+            if (!isdigit(c) && c != '.' && c != 'e' && c != 'E'
+                && c != '-' && c != '+') {
+                break;
+            }
+        }
+        return i;
+
+    case JSON_LEX_KEYWORD:
+        for (i = 0; i < n && isalpha((unsigned char) s[i]); i++) {
+            continue;
+        }
+        return i;
+
+    case JSON_LEX_START:
+    case JSON_LEX_ESCAPE:
+    default:
+        return 0;
+    }
+}
+
 size_t
 json_parser_feed(struct json_parser *p, const char *input, size_t n)
 {
     size_t i;
     for (i = 0; !p->done && i < n; ) {
+        /* Copy the ordinary characters within a token in bulk. */
+        size_t span = json_lex_span(p->lex_state, &input[i], n - i);
+        if (span) {
+            ds_put_buffer(&p->buffer, &input[i], span);
+            p->byte_number += span;
+            p->column_number += span;
+            i += span;
+            continue;
+        }
+
         if (json_lex_input(p, input[i])) {
             p->byte_number++;
             if (input[i] == '\n') {
@@ -1164,13 +1278,27 @@ json_parser_top(struct json_parser *p)
     return &p->stack[p->height - 1];
 }
 
+/* Like json_object_put(), but takes ownership of 'name', which saves copying
+ * it for each member of every object parsed. */
+static void
+json_object_put_nocopy(struct json *json, char *name, struct json *value)
+{
+    struct shash_node *node = shash_find(json->u.object, name);
+    if (node) {
+        json_destroy(node->data);
+        node->data = value;
+        free(name);
+    } else {
+        shash_add_nocopy(json->u.object, name, value);
+    }
+}
+
 static void
 json_parser_put_value(struct json_parser *p, struct json *value)
 {
     struct json_parser_node *node = json_parser_top(p);
     if (node->json->type == JSON_OBJECT) {
-        json_object_put(node->json, p->member_name, value);
-        free(p->member_name);
+        json_object_put_nocopy(node->json, p->member_name, value);
         p->member_name = NULL;
     } else if (node->json->type == JSON_ARRAY) {
         json_array_add(node->json, value);
@@ -1383,6 +1511,11 @@ json_parser_input(struct json_parser *p, struct json_token *token)
     ds_clear(&p->buffer);
 }
 
+/* Nodes come straight from malloc().  Pooling them per thread was measured
+ * with "test-json benchmark" and did not pay off: even an allocator that
+ * never frees saved nothing measurable, because glibc's per-thread caches
+ * already serve these small fixed-size blocks cheaply, and a large free list
+ * made parsing several times slower by scattering nodes across memory. */
 static struct json *
 json_create(enum json_type type)
 {
@@ -1424,7 +1557,6 @@ static void json_serialize_object(const struct shash *object,
                                   struct json_serializer *);
 static void json_serialize_array(const struct json_array *,
                                  struct json_serializer *);
-static void json_serialize_string(const char *, struct ds *);
 
 /* Converts 'json' to a string in JSON format, encoded in UTF-8, and returns
  * that string.  The caller is responsible for freeing the returned string,
@@ -1497,7 +1629,11 @@ json_serialize(const struct json *json, struct json_serializer *s)
         break;
 
     case JSON_STRING:
-        json_serialize_string(json->u.string, ds);
+        json_string_escape(json->u.string, ds);
+        break;
+
+    case JSON_SERIALIZED_OBJECT:
+        ds_put_cstr(ds, json->u.string);
         break;
 
     case JSON_N_TYPES:
@@ -1526,7 +1662,7 @@ json_serialize_object_member(size_t i, const struct shash_node *node,
         indent_line(s);
     }
 
-    json_serialize_string(node->name, ds);
+    json_string_escape(node->name, ds);
     ds_put_char(ds, ':');
     if (s->flags & JSSF_PRETTY) {
         ds_put_char(ds, ' ');
@@ -1593,8 +1729,10 @@ json_serialize_array(const struct json_array *array, struct json_serializer *s)
     ds_put_char(ds, ']');
 }
 
-static void
-json_serialize_string(const char *string, struct ds *ds)
+/* Appends 'string' to 'ds' as a JSON string, that is, in double quotes and
+ * with special characters escaped. */
+void
+json_string_escape(const char *string, struct ds *ds)
 {
     uint8_t c;
 
@@ -1748,8 +1886,141 @@ json_serialized_length(const struct json *json)
     case JSON_STRING:
         return json_string_serialized_length(json->u.string);
 
+    case JSON_SERIALIZED_OBJECT:
+        return strlen(json->u.string);
+
     case JSON_N_TYPES:
     default:
         NOT_REACHED();
     }
 }
+
+/* Serializing JSON in chunks. */
+
+/* An object or array that a json_stream_serializer is in the middle of. */
+struct json_stream_frame {
+    const struct json *json;    /* JSON_OBJECT or JSON_ARRAY. */
+    size_t n;                   /* Number of members already serialized. */
+    struct hmap_node *next;     /* JSON_OBJECT only: next member. */
+};
+
+/* Incrementally serializes a JSON value, in the format produced by
+ * json_to_string() without any flags, a chunk at a time.  This bounds the
+ * amount of text that has to be in memory at once, which matters for values
+ * whose serialized form is very large. */
+struct json_stream_serializer {
+    struct json *json;          /* The value to serialize. */
+    bool started;               /* Has any output been produced? */
+
+    /* Objects and arrays that have been started but not finished, outermost
+     * first. */
+    struct json_stream_frame *stack;
+    size_t n_stack, allocated_stack;
+};
+
+/* Returns a new serializer for 'json', taking ownership of 'json'.  The caller
+ * must not modify 'json' afterward.  Use json_stream_serializer_next() to
+ * obtain the serialized text. */
+struct json_stream_serializer *
+json_stream_serializer_create(struct json *json)
+{
+    struct json_stream_serializer *s = xzalloc(sizeof *s);
+    s->json = json;
+    return s;
+}
+
+/* Frees 's' and the JSON value that it was serializing. */
+void
+json_stream_serializer_destroy(struct json_stream_serializer *s)
+{
+    if (s) {
+        json_destroy(s->json);
+        free(s->stack);
+        free(s);
+    }
+}
+
+/* Starts serializing 'json' into 'ds' on behalf of 's'.  Scalars are
+ * serialized completely, objects and arrays are only opened. */
+static void
+json_stream_serializer_start(struct json_stream_serializer *s,
+                             const struct json *json, struct ds *ds)
+{
+    struct json_stream_frame *frame;
+
+    if (json->type != JSON_OBJECT && json->type != JSON_ARRAY) {
+        json_to_ds(json, 0, ds);
+        return;
+    }
+
+    if (s->n_stack >= s->allocated_stack) {
+        s->stack = x2nrealloc(s->stack, &s->allocated_stack, sizeof *s->stack);
+    }
+    frame = &s->stack[s->n_stack++];
+    frame->json = json;
+    frame->n = 0;
+    if (json->type == JSON_OBJECT) {
+        ds_put_char(ds, '{');
+        frame->next = hmap_first(&json->u.object->map);
+    } else {
+        ds_put_char(ds, '[');
+        frame->next = NULL;
+    }
+}
+
+/* Appends the next part of the serialization of 's''s JSON value to 'ds'.
+ * Stops once it has appended at least 'max' bytes, or at the end of the
+ * serialization.  (It can append somewhat more than 'max' bytes, because it
+ * never splits a scalar value or an object member's name.)
+ *
+ * Returns true if the serialization is complete, false if more remains. */
+bool
+json_stream_serializer_next(struct json_stream_serializer *s, struct ds *ds,
+                            size_t max)
+{
+    size_t start = ds->length;
+
+    if (!s->started) {
+        s->started = true;
+        json_stream_serializer_start(s, s->json, ds);
+    }
+
+    while (s->n_stack && ds->length - start < max) {
+        struct json_stream_frame *frame = &s->stack[s->n_stack - 1];
+        const struct json *json = frame->json;
+
+        if (json->type == JSON_OBJECT) {
+            struct shash_node *node;
+
+            if (!frame->next) {
+                ds_put_char(ds, '}');
+                s->n_stack--;
+                continue;
+            }
+
+            node = CONTAINER_OF(frame->next, struct shash_node, node);
+            frame->next = hmap_next(&json->u.object->map, frame->next);
+            if (frame->n++) {
+                ds_put_char(ds, ',');
+            }
+            json_string_escape(node->name, ds);
+            ds_put_char(ds, ':');
+            json_stream_serializer_start(s, node->data, ds);
+        } else {
+            const struct json_array *array = &json->u.array;
+
+            if (frame->n >= array->n) {
+                ds_put_char(ds, ']');
+                s->n_stack--;
+                continue;
+            }
+
+            if (frame->n) {
+                ds_put_char(ds, ',');
+            }
+            json_stream_serializer_start(s, array->elems[frame->n++], ds);
+        }
+    }
+
+    return !s->n_stack;
+}
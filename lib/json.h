@@ -48,6 +48,7 @@ enum json_type {
     JSON_INTEGER,               /* 123. */
     JSON_REAL,                  /* 123.456. */
     JSON_STRING,                /* "..." */
+    JSON_SERIALIZED_OBJECT,     /* Internal: a value already serialized. */
     JSON_N_TYPES
 };
 
@@ -67,7 +68,7 @@ struct json {
         struct json_array array;
         long long int integer;
         double real;
-        char *string;
+        char *string;           /* JSON_STRING or JSON_SERIALIZED_OBJECT. */
     } u;
 };
 
@@ -77,6 +78,7 @@ struct json *json_string_create(const char *);
 struct json *json_string_create_nocopy(char *);
 struct json *json_integer_create(long long int);
 struct json *json_real_create(double);
+struct json *json_serialized_object_create_nocopy(char *);
 
 struct json *json_array_create_empty(void);
 void json_array_add(struct json *, struct json *element);
@@ -129,10 +131,17 @@ char *json_to_string(const struct json *, int flags);
 void json_to_ds(const struct json *, int flags, struct ds *);
 
 size_t json_serialized_length(const struct json *);
+
+/* Serializing JSON in chunks. */
+struct json_stream_serializer *json_stream_serializer_create(struct json *);
+bool json_stream_serializer_next(struct json_stream_serializer *,
+                                 struct ds *, size_t max);
+void json_stream_serializer_destroy(struct json_stream_serializer *);
 
 /* JSON string formatting operations. */
 
 bool json_string_unescape(const char *in, size_t in_len, char **outp);
+void json_string_escape(const char *in, struct ds *out);
 
 #ifdef  __cplusplus
 }
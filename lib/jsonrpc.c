@@ -25,7 +25,7 @@
 #include "fatal-signal.h"
 #include "json.h"
 #include "list.h"
-#include "ofpbuf.h"
+#include "ovs-atomic.h"
 #include "ovs-thread.h"
 #include "poll-loop.h"
 #include "reconnect.h"
@@ -47,16 +47,52 @@ struct jsonrpc {
     struct jsonrpc_msg *received;
 
     /* Output. */
-    struct list output;         /* Contains "struct ofpbuf"s. */
+    struct list output;         /* Contains "struct jsonrpc_output"s. */
     size_t backlog;
 };
 
+/* Messages whose serialized form is longer than this are serialized
+ * incrementally, one chunk of about this size at a time, as the stream
+ * accepts data. */
+#define JSONRPC_CHUNK_SIZE (64 * 1024)
+
+/* An entry in a jsonrpc's output queue.
+ *
+ * 'data' points into 'text', which the entry owns, or into 'shared', or into
+ * 'chunk'.  In the last case 'serializer' is nonnull until the entire message
+ * has been serialized, and the next chunk is only serialized once the previous
+ * one has been sent, so that a large message never has to exist as a single
+ * block of text. */
+struct jsonrpc_output {
+    struct list list_node;      /* In struct jsonrpc's 'output' list. */
+    const char *data;           /* Next byte to send. */
+    size_t size;                /* Number of bytes at 'data' to send. */
+
+    char *text;
+    struct jsonrpc_shared *shared;
+    struct ds chunk;
+    struct json_stream_serializer *serializer;
+};
+
 /* Rate limit for error messages. */
 static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 5);
 
 static void jsonrpc_received(struct jsonrpc *);
 static void jsonrpc_cleanup(struct jsonrpc *);
 static void jsonrpc_error(struct jsonrpc *, int error);
+static void jsonrpc_output_refill(struct jsonrpc_output *);
+static void jsonrpc_output_delete(struct jsonrpc_output *);
+
+/* A JSON value serialized once, to be sent as the last parameter of
+ * notifications over any number of JSON-RPC connections without serializing
+ * or copying it again for each one.  Each entry in an output queue that
+ * refers to it holds a reference.  The connections may be run by different
+ * threads, so the reference count is atomic. */
+struct jsonrpc_shared {
+    atomic_uint ref_cnt;
+    char *text;
+    size_t length;
+};
 
 /* This is just the same as stream_open() except that it uses the default
  * JSONRPC ports if none is specified. */
@@ -117,16 +153,23 @@ jsonrpc_run(struct jsonrpc *rpc)
 
     stream_run(rpc->stream);
     while (!list_is_empty(&rpc->output)) {
-        struct ofpbuf *buf = ofpbuf_from_list(rpc->output.next);
+        struct jsonrpc_output *out = CONTAINER_OF(rpc->output.next,
+                                                  struct jsonrpc_output,
+                                                  list_node);
         int retval;
 
-        retval = stream_send(rpc->stream, buf->data, buf->size);
+        if (!out->size) {
+            jsonrpc_output_refill(out);
+        }
+
+        retval = stream_send(rpc->stream, out->data, out->size);
         if (retval >= 0) {
             rpc->backlog -= retval;
-            ofpbuf_pull(buf, retval);
-            if (!buf->size) {
-                list_remove(&buf->list_node);
-                ofpbuf_delete(buf);
+            out->data += retval;
+            out->size -= retval;
+            if (!out->size && !out->serializer) {
+                list_remove(&out->list_node);
+                jsonrpc_output_delete(out);
             }
         } else {
             if (retval != -EAGAIN) {
@@ -171,7 +214,8 @@ jsonrpc_get_status(const struct jsonrpc *rpc)
 }
 
 /* Returns the number of bytes buffered by 'rpc' to be written to the
- * underlying stream.  Always returns 0 if 'rpc' has encountered an error or if
+ * underlying stream, including the parts of large messages that have not been
+ * serialized yet.  Always returns 0 if 'rpc' has encountered an error or if
  * the remote end closed the connection. */
 size_t
 jsonrpc_get_backlog(const struct jsonrpc *rpc)
@@ -226,6 +270,103 @@ jsonrpc_log_msg(const struct jsonrpc *rpc, const char *title,
     }
 }
 
+/* Appends a new entry to 'rpc''s output queue for a message whose serialized
+ * form is 'length' bytes long, and returns it for the caller to fill in. */
+static struct jsonrpc_output *
+jsonrpc_output_create(struct jsonrpc *rpc, size_t length)
+{
+    struct jsonrpc_output *out = xzalloc(sizeof *out);
+
+    ds_init(&out->chunk);
+    list_push_back(&rpc->output, &out->list_node);
+    rpc->backlog += length;
+    return out;
+}
+
+/* Appends the 'length' bytes in 's', which must have been obtained from
+ * malloc(), to 'rpc''s output queue, taking ownership of 's'. */
+static void
+jsonrpc_queue(struct jsonrpc *rpc, char *s, size_t length)
+{
+    struct jsonrpc_output *out = jsonrpc_output_create(rpc, length);
+
+    out->text = s;
+    out->data = s;
+    out->size = length;
+}
+
+/* Appends the text in 'shared' to 'rpc''s output queue, which takes a new
+ * reference to it. */
+static void
+jsonrpc_queue_shared(struct jsonrpc *rpc, struct jsonrpc_shared *shared)
+{
+    struct jsonrpc_output *out = jsonrpc_output_create(rpc, shared->length);
+    unsigned int orig;
+
+    out->shared = shared;
+    atomic_add(&shared->ref_cnt, 1, &orig);
+    out->data = shared->text;
+    out->size = shared->length;
+}
+
+/* Appends 'json' to 'rpc''s output queue, taking ownership of 'json'.
+ *
+ * A message that serializes to no more than JSONRPC_CHUNK_SIZE bytes is queued
+ * as text right away.  A longer one is serialized incrementally, as 'rpc'
+ * sends it, so that its serialized form never has to be in memory in its
+ * entirety alongside 'json'. */
+static void
+jsonrpc_queue_json(struct jsonrpc *rpc, struct json *json)
+{
+    struct json_stream_serializer *serializer;
+    struct jsonrpc_output *out;
+    struct ds chunk;
+
+    serializer = json_stream_serializer_create(json);
+    ds_init(&chunk);
+    if (json_stream_serializer_next(serializer, &chunk, JSONRPC_CHUNK_SIZE)) {
+        size_t length = chunk.length;
+
+        json_stream_serializer_destroy(serializer);
+        jsonrpc_queue(rpc, ds_steal_cstr(&chunk), length);
+        return;
+    }
+
+    out = jsonrpc_output_create(rpc, json_serialized_length(json));
+    out->chunk = chunk;
+    out->serializer = serializer;
+    out->data = out->chunk.string;
+    out->size = out->chunk.length;
+}
+
+/* Replaces the text in 'out', which must all have been sent, by the next chunk
+ * of its serialized message. */
+static void
+jsonrpc_output_refill(struct jsonrpc_output *out)
+{
+    ovs_assert(out->serializer);
+
+    ds_clear(&out->chunk);
+    if (json_stream_serializer_next(out->serializer, &out->chunk,
+                                    JSONRPC_CHUNK_SIZE)) {
+        json_stream_serializer_destroy(out->serializer);
+        out->serializer = NULL;
+    }
+    out->data = out->chunk.string;
+    out->size = out->chunk.length;
+}
+
+/* Frees 'out', which has been removed from a jsonrpc's output queue. */
+static void
+jsonrpc_output_delete(struct jsonrpc_output *out)
+{
+    free(out->text);
+    jsonrpc_shared_unref(out->shared);
+    ds_destroy(&out->chunk);
+    json_stream_serializer_destroy(out->serializer);
+    free(out);
+}
+
 /* Schedules 'msg' to be sent on 'rpc' and returns 'rpc''s status (as with
  * jsonrpc_get_status()).
  *
@@ -238,10 +379,8 @@ jsonrpc_log_msg(const struct jsonrpc *rpc, const char *title,
 int
 jsonrpc_send(struct jsonrpc *rpc, struct jsonrpc_msg *msg)
 {
-    struct ofpbuf *buf;
     struct json *json;
-    size_t length;
-    char *s;
+    size_t backlog;
 
     if (rpc->status) {
         jsonrpc_msg_destroy(msg);
@@ -251,17 +390,96 @@ jsonrpc_send(struct jsonrpc *rpc, struct jsonrpc_msg *msg)
     jsonrpc_log_msg(rpc, "send", msg);
 
     json = jsonrpc_msg_to_json(msg);
-    s = json_to_string(json, 0);
-    length = strlen(s);
-    json_destroy(json);
 
-    buf = xmalloc(sizeof *buf);
-    ofpbuf_use(buf, s, length);
-    buf->size = length;
-    list_push_back(&rpc->output, &buf->list_node);
-    rpc->backlog += length;
+    backlog = rpc->backlog;
+    jsonrpc_queue_json(rpc, json);
+
+    if (!backlog) {
+        jsonrpc_run(rpc);
+    }
+    return rpc->status;
+}
+
+/* Returns a new jsonrpc_shared that holds 'json' serialized as text.  The
+ * caller owns the only reference to it and must eventually release it with
+ * jsonrpc_shared_unref(). */
+struct jsonrpc_shared *
+jsonrpc_shared_create(const struct json *json)
+{
+    struct jsonrpc_shared *shared = xmalloc(sizeof *shared);
+
+    atomic_init(&shared->ref_cnt, 1);
+    shared->text = json_to_string(json, 0);
+    shared->length = strlen(shared->text);
+    return shared;
+}
+
+/* Releases a reference to 'shared', freeing it if that was the last one. */
+void
+jsonrpc_shared_unref(struct jsonrpc_shared *shared)
+{
+    if (shared) {
+        unsigned int orig;
+
+        atomic_sub(&shared->ref_cnt, 1, &orig);
+        if (orig == 1) {
+            free(shared->text);
+            free(shared);
+        }
+    }
+}
+
+/* Schedules a notification with the given 'method' to be sent on 'rpc', whose
+ * parameters are the elements of 'params', a JSON array, followed by the value
+ * serialized in 'shared'.  The message is the same as the one that
+ * jsonrpc_send() would send for a notification created by
+ * jsonrpc_create_notify() with those parameters, but 'rpc' only keeps a
+ * reference to 'shared' instead of serializing it again, so that sending the
+ * same large value over many connections costs little more than sending it
+ * once.
+ *
+ * Always takes ownership of 'params', but not of the caller's reference to
+ * 'shared'.  Returns 'rpc''s status, as jsonrpc_send() does. */
+int
+jsonrpc_send_shared_notify(struct jsonrpc *rpc, const char *method,
+                           struct json *params, struct jsonrpc_shared *shared)
+{
+    const struct json_array *array = json_array(params);
+    struct json *method_json;
+    size_t backlog;
+    struct ds s;
+    size_t i;
+
+    if (rpc->status) {
+        json_destroy(params);
+        return rpc->status;
+    }
+
+    /* Everything up to 'shared'. */
+    ds_init(&s);
+    ds_put_cstr(&s, "{\"id\":null,\"method\":");
+    method_json = json_string_create(method);
+    json_to_ds(method_json, 0, &s);
+    json_destroy(method_json);
+    ds_put_cstr(&s, ",\"params\":[");
+    for (i = 0; i < array->n; i++) {
+        json_to_ds(array->elems[i], 0, &s);
+        ds_put_char(&s, ',');
+    }
+    json_destroy(params);
+
+    if (VLOG_IS_DBG_ENABLED()) {
+        VLOG_DBG("%s: send notification, method=\"%s\", params=[%s%s]",
+                 rpc->name, method, strchr(ds_cstr(&s), '[') + 1,
+                 shared->text);
+    }
 
-    if (rpc->backlog == length) {
+    backlog = rpc->backlog;
+    jsonrpc_queue(rpc, s.string, s.length);
+    jsonrpc_queue_shared(rpc, shared);
+    jsonrpc_queue(rpc, xstrdup("]}"), 2);
+
+    if (!backlog) {
         jsonrpc_run(rpc);
     }
     return rpc->status;
@@ -493,7 +711,10 @@ jsonrpc_cleanup(struct jsonrpc *rpc)
     jsonrpc_msg_destroy(rpc->received);
     rpc->received = NULL;
 
-    ofpbuf_list_delete(&rpc->output);
+    while (!list_is_empty(&rpc->output)) {
+        jsonrpc_output_delete(CONTAINER_OF(list_pop_front(&rpc->output),
+                                           struct jsonrpc_output, list_node));
+    }
     rpc->backlog = 0;
 }
 
@@ -1012,6 +1233,21 @@ jsonrpc_session_send(struct jsonrpc_session *s, struct jsonrpc_msg *msg)
     }
 }
 
+/* Like jsonrpc_send_shared_notify(), for a session.  Always takes ownership of
+ * 'params', regardless of success. */
+int
+jsonrpc_session_send_shared_notify(struct jsonrpc_session *s,
+                                   const char *method, struct json *params,
+                                   struct jsonrpc_shared *shared)
+{
+    if (s->rpc) {
+        return jsonrpc_send_shared_notify(s->rpc, method, params, shared);
+    } else {
+        json_destroy(params);
+        return ENOTCONN;
+    }
+}
+
 struct jsonrpc_msg *
 jsonrpc_session_recv(struct jsonrpc_session *s)
 {
@@ -26,6 +26,7 @@
 
 struct json;
 struct jsonrpc_msg;
+struct jsonrpc_shared;
 struct pstream;
 struct reconnect_stats;
 struct stream;
@@ -54,6 +55,8 @@ unsigned int jsonrpc_get_received_bytes(const struct jsonrpc *);
 const char *jsonrpc_get_name(const struct jsonrpc *);
 
 int jsonrpc_send(struct jsonrpc *, struct jsonrpc_msg *);
+int jsonrpc_send_shared_notify(struct jsonrpc *, const char *method,
+                               struct json *params, struct jsonrpc_shared *);
 int jsonrpc_recv(struct jsonrpc *, struct jsonrpc_msg **);
 void jsonrpc_recv_wait(struct jsonrpc *);
 
@@ -95,6 +98,10 @@ void jsonrpc_msg_destroy(struct jsonrpc_msg *);
 
 char *jsonrpc_msg_from_json(struct json *, struct jsonrpc_msg **);
 struct json *jsonrpc_msg_to_json(struct jsonrpc_msg *);
+
+/* Serialized JSON for sending over many connections. */
+struct jsonrpc_shared *jsonrpc_shared_create(const struct json *);
+void jsonrpc_shared_unref(struct jsonrpc_shared *);
 
 /* A JSON-RPC session with reconnection. */
 
@@ -110,6 +117,9 @@ size_t jsonrpc_session_get_backlog(const struct jsonrpc_session *);
 const char *jsonrpc_session_get_name(const struct jsonrpc_session *);
 
 int jsonrpc_session_send(struct jsonrpc_session *, struct jsonrpc_msg *);
+int jsonrpc_session_send_shared_notify(struct jsonrpc_session *,
+                                       const char *method, struct json *params,
+                                       struct jsonrpc_shared *);
 struct jsonrpc_msg *jsonrpc_session_recv(struct jsonrpc_session *);
 void jsonrpc_session_recv_wait(struct jsonrpc_session *);
 
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2008, 2009, 2010, 2011, 2012 Nicira, Inc.
+ * Copyright (c) 2008, 2009, 2010, 2011, 2012, 2013 Nicira, Inc.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -24,6 +24,8 @@
 #include "coverage.h"
 #include "hash.h"
 #include "list.h"
+#include "ovs-rcu.h"
+#include "ovs-thread.h"
 #include "poll-loop.h"
 #include "tag.h"
 #include "timeval.h"
@@ -54,12 +56,6 @@ mac_table_hash(const struct mac_learning *ml, const uint8_t mac[ETH_ADDR_LEN],
     return hash_3words(mac1, mac2 | (vlan << 16), ml->secret);
 }
 
-static struct mac_entry *
-mac_entry_from_lru_node(struct list *list)
-{
-    return CONTAINER_OF(list, struct mac_entry, lru_node);
-}
-
 /* Returns a tag that represents that 'mac' is on an unknown port in 'vlan'.
  * (When we learn where 'mac' is in 'vlan', this allows flows that were
  * flooded to be revalidated.) */
@@ -76,7 +72,7 @@ mac_entry_lookup(const struct mac_learning *ml,
 {
     struct mac_entry *e;
 
-    HMAP_FOR_EACH_WITH_HASH (e, hmap_node, mac_table_hash(ml, mac, vlan),
+    CMAP_FOR_EACH_WITH_HASH (e, cmap_node, mac_table_hash(ml, mac, vlan),
                              &ml->table) {
         if (e->vlan == vlan && eth_addr_equals(e->mac, mac)) {
             return e;
@@ -85,21 +81,107 @@ mac_entry_lookup(const struct mac_learning *ml,
     return NULL;
 }
 
-/* If the LRU list is not empty, stores the least-recently-used entry in '*e'
- * and returns true.  Otherwise, if the LRU list is empty, stores NULL in '*e'
- * and return false. */
+/* Returns the wheel list in 'ml' for entries that expire at time 't'. */
+static struct list *
+wheel_slot(const struct mac_learning *ml, time_t t)
+{
+    return &ml->wheel[(unsigned long long int) t % ml->n_slots];
+}
+
+/* Moves 'e' to the wheel list for its current expiration time, if it is not
+ * already there.  Returns true if 'e' moved, false otherwise. */
 static bool
-get_lru(struct mac_learning *ml, struct mac_entry **e)
+wheel_refile(struct mac_learning *ml, struct mac_entry *e, struct list *slot)
+    OVS_MUST_HOLD(ml->mutex)
 {
-    if (!list_is_empty(&ml->lrus)) {
-        *e = mac_entry_from_lru_node(ml->lrus.next);
+    struct list *target = wheel_slot(ml, e->expires);
+
+    if (target != slot) {
+        list_remove(&e->wheel_node);
+        list_push_back(target, &e->wheel_node);
         return true;
-    } else {
-        *e = NULL;
-        return false;
+    }
+    return false;
+}
+
+/* Allocates 'ml->wheel' for the current 'ml->idle_time' and files every entry
+ * in 'entries' (linked through 'wheel_node') into it. */
+static void
+wheel_init(struct mac_learning *ml, struct list *entries)
+    OVS_MUST_HOLD(ml->mutex)
+{
+    struct mac_entry *e, *next;
+    unsigned int i;
+
+    ml->n_slots = ml->idle_time + 1;
+    ml->wheel = xmalloc(ml->n_slots * sizeof *ml->wheel);
+    for (i = 0; i < ml->n_slots; i++) {
+        list_init(&ml->wheel[i]);
+    }
+    ml->wheel_time = time_now();
+
+    LIST_FOR_EACH_SAFE (e, next, wheel_node, entries) {
+        list_remove(&e->wheel_node);
+        list_push_back(wheel_slot(ml, e->expires), &e->wheel_node);
     }
 }
 
+static void
+mac_entry_free(struct mac_entry *e)
+{
+    free(e);
+}
+
+static void
+mac_learning_expire__(struct mac_learning *ml, struct mac_entry *e)
+    OVS_MUST_HOLD(ml->mutex)
+{
+    cmap_remove(&ml->table, &e->cmap_node,
+                mac_table_hash(ml, e->mac, e->vlan));
+    list_remove(&e->wheel_node);
+    ovsrcu_postpone(mac_entry_free, e);
+}
+
+/* Returns the least-recently-used entry in 'ml', or NULL if 'ml' is empty.
+ *
+ * Scans the wheel forward from the current time, re-filing refreshed entries
+ * along the way, so the cost is amortized across the entries' lifetimes in
+ * the same way as for mac_learning_run(). */
+static struct mac_entry *
+get_lru(struct mac_learning *ml)
+    OVS_MUST_HOLD(ml->mutex)
+{
+    unsigned int i;
+
+    if (cmap_is_empty(&ml->table)) {
+        return NULL;
+    }
+
+    for (i = 1; i <= ml->n_slots; i++) {
+        time_t t = ml->wheel_time + i;
+        struct list *slot = wheel_slot(ml, t);
+        struct mac_entry *e, *next;
+
+        LIST_FOR_EACH_SAFE (e, next, wheel_node, slot) {
+            if (e->expires <= t) {
+                return e;
+            }
+            wheel_refile(ml, e, slot);
+        }
+    }
+
+    /* Every entry was refreshed into a slot that the scan had already passed.
+     * This can only happen if mac_learning_run() has not kept up with the
+     * clock, so just take any entry. */
+    for (i = 0; i < ml->n_slots; i++) {
+        if (!list_is_empty(&ml->wheel[i])) {
+            return CONTAINER_OF(ml->wheel[i].next, struct mac_entry,
+                                wheel_node);
+        }
+    }
+    NOT_REACHED();
+}
+
 static unsigned int
 normalize_idle_time(unsigned int idle_time)
 {
@@ -115,16 +197,21 @@ struct mac_learning *
 mac_learning_create(unsigned int idle_time)
 {
     struct mac_learning *ml;
+    struct list empty;
 
     ml = xmalloc(sizeof *ml);
-    list_init(&ml->lrus);
-    hmap_init(&ml->table);
+    cmap_init(&ml->table);
     ml->secret = random_uint32();
     ml->flood_vlans = NULL;
     ml->idle_time = normalize_idle_time(idle_time);
     ml->max_entries = MAC_DEFAULT_MAX;
-    tag_set_init(&ml->tags);
     ml->ref_cnt = 1;
+
+    xpthread_mutex_init(&ml->mutex, NULL);
+    tag_set_init(&ml->tags);
+    list_init(&empty);
+    wheel_init(ml, &empty);
+    ml->seqno = 0;
     return ml;
 }
 
@@ -149,13 +236,15 @@ mac_learning_unref(struct mac_learning *ml)
 
     ovs_assert(ml->ref_cnt > 0);
     if (!--ml->ref_cnt) {
-        struct mac_entry *e, *next;
+        struct cmap_cursor cursor;
+        struct mac_entry *e;
 
-        HMAP_FOR_EACH_SAFE (e, next, hmap_node, &ml->table) {
-            hmap_remove(&ml->table, &e->hmap_node);
-            free(e);
+        MAC_LEARNING_FOR_EACH (e, &cursor, ml) {
+            ovsrcu_postpone(mac_entry_free, e);
         }
-        hmap_destroy(&ml->table);
+        cmap_destroy(&ml->table);
+        free(ml->wheel);
+        pthread_mutex_destroy(&ml->mutex);
 
         bitmap_free(ml->flood_vlans);
         free(ml);
@@ -184,14 +273,26 @@ mac_learning_set_idle_time(struct mac_learning *ml, unsigned int idle_time)
 {
     idle_time = normalize_idle_time(idle_time);
     if (idle_time != ml->idle_time) {
-        struct mac_entry *e;
+        struct mac_entry *e, *next;
+        struct list entries;
+        unsigned int i;
         int delta;
 
+        xpthread_mutex_lock(&ml->mutex);
         delta = (int) idle_time - (int) ml->idle_time;
-        LIST_FOR_EACH (e, lru_node, &ml->lrus) {
-            e->expires += delta;
+        list_init(&entries);
+        for (i = 0; i < ml->n_slots; i++) {
+            LIST_FOR_EACH_SAFE (e, next, wheel_node, &ml->wheel[i]) {
+                list_remove(&e->wheel_node);
+                list_push_back(&entries, &e->wheel_node);
+                e->expires += delta;
+            }
         }
+        free(ml->wheel);
+
         ml->idle_time = idle_time;
+        wheel_init(ml, &entries);
+        xpthread_mutex_unlock(&ml->mutex);
     }
 }
 
@@ -230,35 +331,46 @@ mac_learning_may_learn(const struct mac_learning *ml,
  * mac_entry_is_new()), then the caller must pass the new entry to
  * mac_learning_changed().  The caller must also initialize the new entry's
  * 'port' member.  Otherwise calling those functions is at the caller's
- * discretion. */
+ * discretion.
+ *
+ * Refreshing an existing entry, the common case, takes no locks and writes to
+ * the entry at most once per second. */
 struct mac_entry *
 mac_learning_insert(struct mac_learning *ml,
                     const uint8_t src_mac[ETH_ADDR_LEN], uint16_t vlan)
 {
+    time_t expires = time_now() + ml->idle_time;
     struct mac_entry *e;
 
     e = mac_entry_lookup(ml, src_mac, vlan);
     if (!e) {
-        uint32_t hash = mac_table_hash(ml, src_mac, vlan);
-
-        if (hmap_count(&ml->table) >= ml->max_entries) {
-            get_lru(ml, &e);
-            mac_learning_expire(ml, e);
+        xpthread_mutex_lock(&ml->mutex);
+        e = mac_entry_lookup(ml, src_mac, vlan);
+        if (!e) {
+            if (cmap_count(&ml->table) >= ml->max_entries) {
+                mac_learning_expire__(ml, get_lru(ml));
+            }
+
+            e = xmalloc(sizeof *e);
+            memcpy(e->mac, src_mac, ETH_ADDR_LEN);
+            e->vlan = vlan;
+            e->tag = 0;
+            e->grat_arp_lock = TIME_MIN;
+            e->port.p = NULL;
+            e->seqno = ++ml->seqno;
+            e->expires = expires;
+            list_push_back(wheel_slot(ml, expires), &e->wheel_node);
+            cmap_insert(&ml->table, &e->cmap_node,
+                        mac_table_hash(ml, src_mac, vlan));
         }
-
-        e = xmalloc(sizeof *e);
-        hmap_insert(&ml->table, &e->hmap_node, hash);
-        memcpy(e->mac, src_mac, ETH_ADDR_LEN);
-        e->vlan = vlan;
-        e->tag = 0;
-        e->grat_arp_lock = TIME_MIN;
-    } else {
-        list_remove(&e->lru_node);
+        xpthread_mutex_unlock(&ml->mutex);
     }
 
-    /* Mark 'e' as recently used. */
-    list_push_back(&ml->lrus, &e->lru_node);
-    e->expires = time_now() + ml->idle_time;
+    /* Mark 'e' as recently used.  mac_learning_run() or get_lru() will move
+     * it to the proper place in the wheel when they come across it. */
+    if (e->expires != expires) {
+        e->expires = expires;
+    }
 
     return e;
 }
@@ -278,8 +390,11 @@ mac_learning_changed(struct mac_learning *ml, struct mac_entry *e)
 
     COVERAGE_INC(mac_learning_learned);
 
+    xpthread_mutex_lock(&ml->mutex);
     e->tag = tag_create_random();
+    e->seqno = ++ml->seqno;
     tag_set_add(&ml->tags, tag);
+    xpthread_mutex_unlock(&ml->mutex);
 }
 
 /* Looks up MAC 'dst' for VLAN 'vlan' in 'ml' and returns the associated MAC
@@ -302,7 +417,11 @@ mac_learning_lookup(const struct mac_learning *ml,
     } else {
         struct mac_entry *e = mac_entry_lookup(ml, dst, vlan);
 
-        ovs_assert(e == NULL || e->tag != 0);
+        if (e && !e->tag) {
+            /* Another thread just learned 'e' and has not yet called
+             * mac_learning_changed().  Treat it as still unknown. */
+            e = NULL;
+        }
         if (tag) {
             /* Tag either the learned port or the lack thereof. */
             *tag |= e ? e->tag : make_unknown_mac_tag(ml, dst, vlan);
@@ -315,9 +434,9 @@ mac_learning_lookup(const struct mac_learning *ml,
 void
 mac_learning_expire(struct mac_learning *ml, struct mac_entry *e)
 {
-    hmap_remove(&ml->table, &e->hmap_node);
-    list_remove(&e->lru_node);
-    free(e);
+    xpthread_mutex_lock(&ml->mutex);
+    mac_learning_expire__(ml, e);
+    xpthread_mutex_unlock(&ml->mutex);
 }
 
 /* Expires all the mac-learning entries in 'ml'.  If not NULL, the tags in 'ml'
@@ -327,45 +446,87 @@ mac_learning_expire(struct mac_learning *ml, struct mac_entry *e)
 void
 mac_learning_flush(struct mac_learning *ml, struct tag_set *tags)
 {
-    struct mac_entry *e;
-    while (get_lru(ml, &e)){
-        if (tags) {
-            tag_set_add(tags, e->tag);
+    unsigned int i;
+
+    xpthread_mutex_lock(&ml->mutex);
+    for (i = 0; i < ml->n_slots; i++) {
+        struct mac_entry *e, *next;
+
+        LIST_FOR_EACH_SAFE (e, next, wheel_node, &ml->wheel[i]) {
+            if (tags) {
+                tag_set_add(tags, e->tag);
+            }
+            mac_learning_expire__(ml, e);
         }
-        mac_learning_expire(ml, e);
     }
-    hmap_shrink(&ml->table);
+    xpthread_mutex_unlock(&ml->mutex);
 }
 
 void
 mac_learning_run(struct mac_learning *ml, struct tag_set *set)
 {
-    struct mac_entry *e;
+    time_t now = time_now();
+    unsigned int n;
 
+    xpthread_mutex_lock(&ml->mutex);
     if (set) {
         tag_set_union(set, &ml->tags);
     }
     tag_set_init(&ml->tags);
 
-    while (get_lru(ml, &e)
-           && (hmap_count(&ml->table) > ml->max_entries
-               || time_now() >= e->expires)) {
+    /* Visit the wheel lists for every second since the last run.  If we fell
+     * more than a full turn behind, one pass over the whole wheel suffices. */
+    for (n = 0; ml->wheel_time < now && n < ml->n_slots; n++) {
+        struct list *slot = wheel_slot(ml, ++ml->wheel_time);
+        struct mac_entry *e, *next;
+
+        LIST_FOR_EACH_SAFE (e, next, wheel_node, slot) {
+            if (now >= e->expires) {
+                COVERAGE_INC(mac_learning_expired);
+                if (set) {
+                    tag_set_add(set, e->tag);
+                }
+                mac_learning_expire__(ml, e);
+            } else {
+                wheel_refile(ml, e, slot);
+            }
+        }
+    }
+    ml->wheel_time = now;
+
+    while (cmap_count(&ml->table) > ml->max_entries) {
+        struct mac_entry *e = get_lru(ml);
+
         COVERAGE_INC(mac_learning_expired);
         if (set) {
             tag_set_add(set, e->tag);
         }
-        mac_learning_expire(ml, e);
+        mac_learning_expire__(ml, e);
     }
+    xpthread_mutex_unlock(&ml->mutex);
 }
 
 void
 mac_learning_wait(struct mac_learning *ml)
 {
-    if (hmap_count(&ml->table) > ml->max_entries
+    xpthread_mutex_lock(&ml->mutex);
+    if (cmap_count(&ml->table) > ml->max_entries
         || !tag_set_is_empty(&ml->tags)) {
         poll_immediate_wake();
-    } else if (!list_is_empty(&ml->lrus)) {
-        struct mac_entry *e = mac_entry_from_lru_node(ml->lrus.next);
-        poll_timer_wait_until(e->expires * 1000LL);
+    } else if (!cmap_is_empty(&ml->table)) {
+        unsigned int i;
+
+        /* Wake up for the first second with anything filed in the wheel.
+         * The entries there might have been refreshed since, in which case
+         * mac_learning_run() just re-files them. */
+        for (i = 1; i <= ml->n_slots; i++) {
+            time_t t = ml->wheel_time + i;
+
+            if (!list_is_empty(wheel_slot(ml, t))) {
+                poll_timer_wait_until(t * 1000LL);
+                break;
+            }
+        }
     }
+    xpthread_mutex_unlock(&ml->mutex);
 }
@@ -17,8 +17,9 @@
 #ifndef MAC_LEARNING_H
 #define MAC_LEARNING_H 1
 
+#include <pthread.h>
 #include <time.h>
-#include "hmap.h"
+#include "cmap.h"
 #include "list.h"
 #include "packets.h"
 #include "tag.h"
@@ -36,12 +37,17 @@ struct mac_learning;
  * relearning based on a reflection from a bond slave. */
 #define MAC_GRAT_ARP_LOCK_TIME 5
 
-/* A MAC learning table entry. */
+/* A MAC learning table entry.
+ *
+ * Entries are freed with ovsrcu_postpone(), so a pointer obtained from
+ * mac_learning_lookup() or mac_learning_insert() remains valid until the
+ * calling thread next quiesces, even if the entry expires in the meantime. */
 struct mac_entry {
-    struct hmap_node hmap_node; /* Node in a mac_learning hmap. */
-    struct list lru_node;       /* Element in 'lrus' list. */
+    struct cmap_node cmap_node; /* Node in a mac_learning cmap. */
+    struct list wheel_node;     /* Element in one of 'wheel''s lists. */
     time_t expires;             /* Expiration time. */
     time_t grat_arp_lock;       /* Gratuitous ARP lock expiration time. */
+    unsigned long long int seqno; /* mac_learning 'seqno' at last change. */
     uint8_t mac[ETH_ADDR_LEN];  /* Known MAC address. */
     uint16_t vlan;              /* VLAN tag. */
     tag_type tag;               /* Tag for this learning entry. */
@@ -76,19 +82,53 @@ static inline bool mac_entry_is_grat_arp_locked(const struct mac_entry *mac)
     return time_now() < mac->grat_arp_lock;
 }
 
-/* MAC learning table. */
+/* MAC learning table.
+ *
+ *
+ * Thread-safety
+ * =============
+ *
+ * mac_learning_lookup() and mac_learning_insert() of an already-learned MAC
+ * do not take any lock, so any number of threads may translate packets
+ * against the same table in parallel.  Everything that modifies the table
+ * (learning a new MAC, mac_learning_changed(), expiration, and
+ * configuration) serializes on 'mutex' internally.
+ *
+ *
+ * Aging
+ * =====
+ *
+ * Refreshing an entry only updates its 'expires', without touching any shared
+ * list.  Instead of an LRU list, entries are filed in a timing wheel with one
+ * list per second of 'idle_time'.  mac_learning_run() visits only the lists
+ * for the seconds that have elapsed since it last ran, expiring the entries
+ * that are really due and re-filing the ones that were refreshed since they
+ * were filed.  Each entry is thus visited about once per 'idle_time', however
+ * often it is refreshed. */
 struct mac_learning {
-    struct hmap table;          /* Learning table. */
-    struct list lrus;           /* In-use entries, least recently used at the
-                                   front, most recently used at the back. */
+    struct cmap table;          /* Contains "struct mac_entry"s. */
     uint32_t secret;            /* Secret for randomizing hash table. */
     unsigned long *flood_vlans; /* Bitmap of learning disabled VLANs. */
     unsigned int idle_time;     /* Max age before deleting an entry. */
     size_t max_entries;         /* Max number of learned MACs. */
-    struct tag_set tags;        /* Tags which have changed. */
     int ref_cnt;
+
+    pthread_mutex_t mutex;      /* Serializes writers. */
+    struct tag_set tags;        /* Tags which have changed. */
+    struct list *wheel;         /* 'n_slots' lists of entries by expiration. */
+    unsigned int n_slots;       /* 'idle_time' + 1. */
+    time_t wheel_time;          /* Last second processed in 'wheel'. */
+    unsigned long long int seqno; /* Incremented for each learning change. */
 };
 
+/* Iterates E over every entry in ML, using CURSOR (a "struct cmap_cursor *").
+ *
+ * Safe against concurrent lookups and refreshes.  The caller may expire the
+ * entry it is visiting, but an iteration concurrent with the learning of new
+ * MACs may skip or repeat entries (see "Iteration" in cmap.h). */
+#define MAC_LEARNING_FOR_EACH(E, CURSOR, ML) \
+    CMAP_FOR_EACH (E, cmap_node, CURSOR, &(ML)->table)
+
 /* Basics. */
 struct mac_learning *mac_learning_create(unsigned int idle_time);
 struct mac_learning *mac_learning_ref(const struct mac_learning *);
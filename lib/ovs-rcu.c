@@ -0,0 +1,396 @@
+/*
+ * Copyright (c) 2013 Nicira, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+#include "ovs-rcu.h"
+#include <time.h>
+#include "list.h"
+#include "ovs-thread.h"
+#include "timeval.h"
+#include "util.h"
+#include "vlog.h"
+
+VLOG_DEFINE_THIS_MODULE(ovs_rcu);
+
+struct ovsrcu_cb {
+    void (*function)(void *aux);
+    void *aux;
+};
+
+struct ovsrcu_cbset {
+    struct list list_node;
+    struct ovsrcu_cb cbs[16];
+    int n_cbs;
+};
+
+/* Per-thread RCU state.
+ *
+ * A thread is active, and therefore in 'ovsrcu_threads', from its first use of
+ * RCU until ovsrcu_quiesce_start() or until it exits.  While it is active,
+ * 'seqno' is the value of 'global_seqno' at its most recent quiescent
+ * state. */
+struct ovsrcu_perthread {
+    struct list list_node;      /* In 'ovsrcu_threads'. */
+    atomic_uint64_t seqno;
+    struct ovsrcu_cbset *cbset; /* Callbacks postponed by this thread. */
+    bool active;                /* In 'ovsrcu_threads'? */
+};
+
+/* Incremented by each ovsrcu_synchronize() to mark the beginning of a new
+ * grace period. */
+static atomic_uint64_t global_seqno = ATOMIC_VAR_INIT(1);
+
+/* Active threads. */
+static pthread_mutex_t ovsrcu_threads_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct list ovsrcu_threads = LIST_INITIALIZER(&ovsrcu_threads);
+
+/* Callback sets flushed by their threads, waiting for a grace period. */
+static pthread_mutex_t flushed_cbsets_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t flushed_cbsets_cond = PTHREAD_COND_INITIALIZER;
+static struct list flushed_cbsets = LIST_INITIALIZER(&flushed_cbsets);
+
+static pthread_key_t perthread_key;
+DEFINE_PER_THREAD_DATA(struct ovsrcu_perthread *, ovsrcu_perthread_var, NULL);
+
+static void ovsrcu_init_module(void);
+static void ovsrcu_flush_cbset(struct ovsrcu_perthread *);
+static void ovsrcu_call_postponed(struct list *cbsets);
+static void ovsrcu_unregister__(struct ovsrcu_perthread *);
+static void ovsrcu_start_postpone_thread(void);
+
+static struct ovsrcu_perthread *
+ovsrcu_perthread_get(void)
+{
+    struct ovsrcu_perthread **perthreadp = ovsrcu_perthread_var_get();
+
+    if (OVS_UNLIKELY(!*perthreadp)) {
+        struct ovsrcu_perthread *perthread;
+
+        ovsrcu_init_module();
+
+        perthread = xmalloc(sizeof *perthread);
+        atomic_init(&perthread->seqno, 0);
+        perthread->cbset = NULL;
+        perthread->active = false;
+
+        /* The key's destructor makes the thread quiescent when it exits. */
+        pthread_setspecific(perthread_key, perthread);
+        *perthreadp = perthread;
+    }
+    return *perthreadp;
+}
+
+/* Indicates the beginning of a quiescent state.  See "Details" near the top of
+ * ovs-rcu.h.
+ *
+ * Quiescent states don't stack or nest, so this always ends a quiescent state
+ * even if ovsrcu_quiesce_start() was called multiple times in a row. */
+void
+ovsrcu_quiesce_end(void)
+{
+    struct ovsrcu_perthread *perthread = ovsrcu_perthread_get();
+
+    if (!perthread->active) {
+        uint64_t seqno;
+
+        xpthread_mutex_lock(&ovsrcu_threads_mutex);
+        atomic_read(&global_seqno, &seqno);
+        atomic_store(&perthread->seqno, seqno);
+        list_push_back(&ovsrcu_threads, &perthread->list_node);
+        perthread->active = true;
+        xpthread_mutex_unlock(&ovsrcu_threads_mutex);
+    }
+}
+
+/* Moves all of the flushed callback sets to the end of 'cbsets'. */
+static void
+ovsrcu_take_flushed(struct list *cbsets)
+{
+    xpthread_mutex_lock(&flushed_cbsets_mutex);
+    list_splice(cbsets, flushed_cbsets.next, &flushed_cbsets);
+    xpthread_mutex_unlock(&flushed_cbsets_mutex);
+}
+
+static void
+ovsrcu_quiesced(void)
+{
+    struct ovsrcu_perthread *perthread = ovsrcu_perthread_get();
+
+    if (!single_threaded()) {
+        if (perthread->cbset) {
+            ovsrcu_flush_cbset(perthread);
+        }
+        ovsrcu_start_postpone_thread();
+    } else {
+        /* With only one thread, the current thread is the only one that can
+         * hold references, and it is quiescent, so we may call the postponed
+         * callbacks right away. */
+        struct list cbsets;
+
+        list_init(&cbsets);
+        ovsrcu_take_flushed(&cbsets);
+        if (perthread->cbset) {
+            list_push_back(&cbsets, &perthread->cbset->list_node);
+            perthread->cbset = NULL;
+        }
+        ovsrcu_call_postponed(&cbsets);
+    }
+}
+
+/* Indicates the beginning of a quiescent state.  See "Details" near the top of
+ * ovs-rcu.h. */
+void
+ovsrcu_quiesce_start(void)
+{
+    struct ovsrcu_perthread *perthread = ovsrcu_perthread_get();
+
+    if (perthread->active) {
+        ovsrcu_unregister__(perthread);
+    }
+    ovsrcu_quiesced();
+}
+
+/* Indicates a momentary quiescent state.  See "Details" near the top of
+ * ovs-rcu.h. */
+void
+ovsrcu_quiesce(void)
+{
+    struct ovsrcu_perthread *perthread = ovsrcu_perthread_get();
+    uint64_t seqno;
+
+    if (perthread->active) {
+        atomic_read_explicit(&global_seqno, &seqno, memory_order_acquire);
+        atomic_store_explicit(&perthread->seqno, seqno, memory_order_release);
+    } else {
+        ovsrcu_quiesce_end();
+    }
+    ovsrcu_quiesced();
+}
+
+/* Returns true if the current thread is quiescent. */
+bool
+ovsrcu_is_quiescent(void)
+{
+    return !ovsrcu_perthread_get()->active;
+}
+
+/* Waits until every thread that was active when this function was called has
+ * passed through a quiescent state.  The caller is quiescent while it waits.
+ *
+ * This can block for a relatively long time, so it should not be called from
+ * the main thread of a daemon.  Use ovsrcu_postpone() instead, when
+ * possible. */
+void
+ovsrcu_synchronize(void)
+{
+    long long int warn_msec;
+    uint64_t target;
+    bool was_quiescent;
+
+    if (single_threaded()) {
+        return;
+    }
+
+    was_quiescent = ovsrcu_is_quiescent();
+    ovsrcu_quiesce_start();
+
+    atomic_add(&global_seqno, 1, &target);
+    target++;
+
+    warn_msec = time_msec() + 1000;
+    for (;;) {
+        struct ovsrcu_perthread *perthread;
+        struct timespec delay;
+        bool done = true;
+
+        xpthread_mutex_lock(&ovsrcu_threads_mutex);
+        LIST_FOR_EACH (perthread, list_node, &ovsrcu_threads) {
+            uint64_t seqno;
+
+            atomic_read_explicit(&perthread->seqno, &seqno,
+                                 memory_order_acquire);
+            if (seqno < target) {
+                done = false;
+                break;
+            }
+        }
+        xpthread_mutex_unlock(&ovsrcu_threads_mutex);
+
+        if (done) {
+            break;
+        }
+
+        if (time_msec() >= warn_msec) {
+            VLOG_WARN("still waiting for threads to quiesce after %lld ms",
+                      time_msec() - warn_msec + 1000);
+            warn_msec += 10000;
+        }
+
+        delay.tv_sec = 0;
+        delay.tv_nsec = 1000 * 1000;
+        nanosleep(&delay, NULL);
+    }
+
+    if (!was_quiescent) {
+        ovsrcu_quiesce_end();
+    }
+}
+
+/* Registers 'function' to be called, passing 'aux' as argument, after the
+ * next grace period.
+ *
+ * This function is more conveniently called through the ovsrcu_postpone()
+ * macro, which provides a type-safe way to allow 'function''s parameter to be
+ * any pointer type. */
+void
+ovsrcu_postpone__(void (*function)(void *aux), void *aux)
+{
+    struct ovsrcu_perthread *perthread = ovsrcu_perthread_get();
+    struct ovsrcu_cbset *cbset;
+    struct ovsrcu_cb *cb;
+
+    cbset = perthread->cbset;
+    if (!cbset) {
+        cbset = perthread->cbset = xmalloc(sizeof *perthread->cbset);
+        cbset->n_cbs = 0;
+    }
+
+    cb = &cbset->cbs[cbset->n_cbs++];
+    cb->function = function;
+    cb->aux = aux;
+
+    if (cbset->n_cbs >= ARRAY_SIZE(cbset->cbs)) {
+        ovsrcu_flush_cbset(perthread);
+    }
+}
+
+static void
+ovsrcu_call_postponed(struct list *cbsets)
+{
+    struct ovsrcu_cbset *cbset, *next_cbset;
+
+    LIST_FOR_EACH_SAFE (cbset, next_cbset, list_node, cbsets) {
+        struct ovsrcu_cb *cb;
+
+        for (cb = cbset->cbs; cb < &cbset->cbs[cbset->n_cbs]; cb++) {
+            cb->function(cb->aux);
+        }
+        list_remove(&cbset->list_node);
+        free(cbset);
+    }
+}
+
+/* The helper thread that calls postponed callbacks once the process has
+ * multiple threads. */
+static void * NO_RETURN
+ovsrcu_postpone_thread(void *arg OVS_UNUSED)
+{
+    pthread_detach(pthread_self());
+
+    for (;;) {
+        struct list cbsets;
+
+        /* This thread never holds RCU-protected pointers, so it stays
+         * quiescent.  This also flushes anything that the callbacks called
+         * below postponed in turn.
+         *
+         * This uses pthread_cond_wait() directly because
+         * xpthread_cond_wait() would try to flush callbacks into
+         * 'flushed_cbsets' while we hold 'flushed_cbsets_mutex'. */
+        ovsrcu_quiesce_start();
+
+        xpthread_mutex_lock(&flushed_cbsets_mutex);
+        while (list_is_empty(&flushed_cbsets)) {
+            int error = pthread_cond_wait(&flushed_cbsets_cond,
+                                          &flushed_cbsets_mutex);
+            if (error) {
+                ovs_abort(error, "pthread_cond_wait failed");
+            }
+        }
+        xpthread_mutex_unlock(&flushed_cbsets_mutex);
+
+        list_init(&cbsets);
+        ovsrcu_take_flushed(&cbsets);
+
+        ovsrcu_synchronize();
+        ovsrcu_call_postponed(&cbsets);
+    }
+}
+
+/* Starts the helper thread that calls postponed callbacks, if it is not
+ * already running.  Only needed once the process is multithreaded. */
+static void
+ovsrcu_start_postpone_thread(void)
+{
+    static struct ovsthread_once once = OVSTHREAD_ONCE_INITIALIZER;
+
+    if (ovsthread_once_start(&once)) {
+        xpthread_create(NULL, NULL, ovsrcu_postpone_thread, NULL);
+        ovsthread_once_done(&once);
+    }
+}
+
+static void
+ovsrcu_flush_cbset(struct ovsrcu_perthread *perthread)
+{
+    struct ovsrcu_cbset *cbset = perthread->cbset;
+
+    if (!single_threaded()) {
+        ovsrcu_start_postpone_thread();
+    }
+
+    xpthread_mutex_lock(&flushed_cbsets_mutex);
+    list_push_back(&flushed_cbsets, &cbset->list_node);
+    xpthread_cond_signal(&flushed_cbsets_cond);
+    xpthread_mutex_unlock(&flushed_cbsets_mutex);
+
+    perthread->cbset = NULL;
+}
+
+static void
+ovsrcu_unregister__(struct ovsrcu_perthread *perthread)
+{
+    xpthread_mutex_lock(&ovsrcu_threads_mutex);
+    list_remove(&perthread->list_node);
+    perthread->active = false;
+    xpthread_mutex_unlock(&ovsrcu_threads_mutex);
+}
+
+/* Called when a thread exits. */
+static void
+ovsrcu_thread_exit_cb(void *perthread_)
+{
+    struct ovsrcu_perthread *perthread = perthread_;
+
+    if (perthread->active) {
+        ovsrcu_unregister__(perthread);
+    }
+    if (perthread->cbset) {
+        ovsrcu_flush_cbset(perthread);
+    }
+    free(perthread);
+}
+
+static void
+ovsrcu_init_module(void)
+{
+    static struct ovsthread_once once = OVSTHREAD_ONCE_INITIALIZER;
+
+    if (ovsthread_once_start(&once)) {
+        xpthread_key_create(&perthread_key, ovsrcu_thread_exit_cb);
+        ovsthread_once_done(&once);
+    }
+}
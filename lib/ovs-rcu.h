@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2013 Nicira, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OVS_RCU_H
+#define OVS_RCU_H 1
+
+/* Read-Copy-Update (RCU)
+ * ======================
+ *
+ * Introduction
+ * ------------
+ *
+ * Atomic pointer access makes it pretty easy to implement lock-free
+ * algorithms.  There is one big problem, though: when a writer updates a
+ * pointer to point to a new data structure, some thread might be reading the
+ * old version, and there's no convenient way to free the old version when all
+ * threads are done with the old version.
+ *
+ * The function ovsrcu_postpone() solves that problem.  The function pointer
+ * passed in as its argument is called only after all threads are done with
+ * old versions of data structures.  The function callback frees an old
+ * version of data no longer in use.  This technique is called "read-copy-
+ * update", or RCU for short.
+ *
+ *
+ * Details
+ * -------
+ *
+ * A "quiescent state" is a time at which a thread holds no pointers to memory
+ * that is managed by RCU; that is, when the thread is known not to reference
+ * memory that might be an old version of some object freed via RCU.  For
+ * example, poll_block() includes a quiescent state, as does
+ * xpthread_cond_wait().
+ *
+ * The following functions manage the recognition of quiescent states:
+ *
+ *     void ovsrcu_quiesce(void)
+ *
+ *         Recognizes a momentary quiescent state in the current thread.
+ *
+ *     void ovsrcu_quiesce_start(void)
+ *     void ovsrcu_quiesce_end(void)
+ *
+ *         Brackets a time period during which the current thread is
+ *         quiescent.
+ *
+ * A newly created thread is initially active, not quiescent.  When a thread
+ * exits, it becomes permanently quiescent.
+ *
+ * When a quiescent state has occurred in every thread, we say that a "grace
+ * period" has occurred.  Following a grace period, all of the callbacks
+ * postponed before the start of the grace period may be invoked.  OVS takes
+ * care of this automatically through the RCU mechanism: while a process still
+ * has only a single thread, it invokes the postponed callbacks directly from
+ * ovsrcu_quiesce() and ovsrcu_quiesce_start(); after additional threads have
+ * been created, it creates an extra helper thread to invoke callbacks.
+ *
+ * A thread that holds pointers to RCU-protected memory for a long time
+ * without passing through a quiescent state delays freeing of all memory
+ * postponed with ovsrcu_postpone() in every thread, so long-running loops in
+ * threads that do not call poll_block() should call ovsrcu_quiesce()
+ * periodically.
+ *
+ *
+ * Use
+ * ---
+ *
+ * Use OVSRCU_TYPE(TYPE) to declare a pointer to RCU-protected data, e.g. the
+ * following declares an RCU-protected "struct flow *" named flowp:
+ *
+ *     OVSRCU_TYPE(struct flow *) flowp;
+ *
+ * Use ovsrcu_get(TYPE, VAR) to read an RCU-protected pointer, e.g. to read the
+ * pointer variable declared above:
+ *
+ *     struct flow *flow = ovsrcu_get(struct flow *, &flowp);
+ *
+ * If the pointer variable is currently being written by a thread that is
+ * also reading it, or if it is protected by a lock that the reader holds,
+ * then ovsrcu_get_protected() is a cheaper alternative.
+ *
+ * Use ovsrcu_set() to write an RCU-protected pointer and ovsrcu_postpone() to
+ * free the previous data.  ovsrcu_init() can be used on (newly created) RCU-
+ * protected pointer that is not yet visible to readers.  If more than one
+ * thread can write the pointer, then some form of external synchronization,
+ * e.g. a mutex, is needed to prevent writers from interfering with one
+ * another.  For example, to write the pointer variable declared above while
+ * safely freeing the old value:
+ *
+ *     static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+ *
+ *     OVSRCU_TYPE(struct flow *) flowp;
+ *
+ *     void
+ *     change_flow(struct flow *new_flow)
+ *     {
+ *         xpthread_mutex_lock(&mutex);
+ *         ovsrcu_postpone(free,
+ *                         ovsrcu_get_protected(struct flow *, &flowp));
+ *         ovsrcu_set(&flowp, new_flow);
+ *         xpthread_mutex_unlock(&mutex);
+ *     }
+ */
+
+#include "compiler.h"
+#include "ovs-atomic.h"
+
+/* Use OVSRCU_TYPE(TYPE) to declare a pointer to RCU-protected data, e.g.
+ *
+ *     OVSRCU_TYPE(struct flow *) flowp;
+ *
+ * ovs-atomic.h has no atomic pointer types, so the pointer is stored in an
+ * atomic_uintptr_t and ovsrcu_get() casts it back to TYPE. */
+#define OVSRCU_TYPE(TYPE) struct { atomic_uintptr_t p; }
+#define OVSRCU_TYPE_INITIALIZER(VALUE) \
+    { ATOMIC_VAR_INIT((uintptr_t) (VALUE)) }
+
+static inline void *
+ovsrcu_get__(const atomic_uintptr_t *p_, memory_order order)
+{
+    atomic_uintptr_t *p = CONST_CAST(atomic_uintptr_t *, p_);
+    uintptr_t value;
+
+    atomic_read_explicit(p, &value, order);
+    return (void *) value;
+}
+
+#define ovsrcu_get(TYPE, VAR) \
+    ((TYPE) ovsrcu_get__(&(VAR)->p, memory_order_consume))
+#define ovsrcu_get_protected(TYPE, VAR) \
+    ((TYPE) ovsrcu_get__(&(VAR)->p, memory_order_relaxed))
+
+static inline void
+ovsrcu_set__(atomic_uintptr_t *p, const void *value, memory_order order)
+{
+    atomic_store_explicit(p, (uintptr_t) value, order);
+}
+
+/* Writes VALUE to the RCU-protected pointer whose address is VAR.
+ *
+ * Users require external synchronization (e.g. a mutex).  See "Use" above
+ * for an example. */
+#define ovsrcu_set(VAR, VALUE) \
+    ovsrcu_set__(&(VAR)->p, VALUE, memory_order_release)
+
+/* Initializes the RCU-protected pointer whose address is VAR to VALUE.  Use
+ * only when no reader can yet see VAR. */
+#define ovsrcu_init(VAR, VALUE) \
+    ovsrcu_set__(&(VAR)->p, VALUE, memory_order_relaxed)
+
+/* Calls FUNCTION passing ARG as its pointer-type argument following the next
+ * grace period.  See "Use" above for example.  */
+void ovsrcu_postpone__(void (*function)(void *aux), void *aux);
+#define ovsrcu_postpone(FUNCTION, ARG)                          \
+    ((void) sizeof((FUNCTION)(ARG), 1),                         \
+     (void) sizeof(*(ARG)),                                     \
+     ovsrcu_postpone__((void (*)(void *))(FUNCTION), ARG))
+
+/* Quiescent states. */
+void ovsrcu_quiesce_start(void);
+void ovsrcu_quiesce_end(void);
+void ovsrcu_quiesce(void);
+bool ovsrcu_is_quiescent(void);
+
+/* Synchronization.  Waits for all non-quiescent threads to quiesce at least
+ * once.  This can block for a relatively long time. */
+void ovsrcu_synchronize(void);
+
+#endif /* ovs-rcu.h */
@@ -21,6 +21,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include "compiler.h"
+#include "ovs-rcu.h"
 #include "poll-loop.h"
 #include "socket-util.h"
 #include "util.h"
@@ -93,22 +94,64 @@ XPTHREAD_TRY_FUNC1(pthread_rwlock_trywrlock, pthread_rwlock_t *);
 XPTHREAD_FUNC2(pthread_cond_init, pthread_cond_t *, pthread_condattr_t *);
 XPTHREAD_FUNC1(pthread_cond_signal, pthread_cond_t *);
 XPTHREAD_FUNC1(pthread_cond_broadcast, pthread_cond_t *);
-XPTHREAD_FUNC2(pthread_cond_wait, pthread_cond_t *, pthread_mutex_t *);
 
 typedef void destructor_func(void *);
 XPTHREAD_FUNC2(pthread_key_create, pthread_key_t *, destructor_func *);
 
+XPTHREAD_FUNC2(pthread_join, pthread_t, void **);
+
+/* Waits on 'cond', which must be signaled while 'mutex' is held.  The calling
+ * thread is quiescent (see ovs-rcu.h) while it waits. */
+void
+xpthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex)
+{
+    int error;
+
+    ovsrcu_quiesce_start();
+    error = pthread_cond_wait(cond, mutex);
+    ovsrcu_quiesce_end();
+
+    if (OVS_UNLIKELY(error)) {
+        ovs_abort(error, "pthread_cond_wait failed");
+    }
+}
+
+struct ovsthread_aux {
+    void *(*start)(void *);
+    void *arg;
+};
+
+static void *
+ovsthread_wrapper(void *aux_)
+{
+    struct ovsthread_aux *auxp = aux_;
+    struct ovsthread_aux aux;
+
+    aux = *auxp;
+    free(auxp);
+
+    ovsrcu_quiesce_end();
+    return aux.start(aux.arg);
+}
+
 void
 xpthread_create(pthread_t *threadp, pthread_attr_t *attr,
                 void *(*start)(void *), void *arg)
 {
+    struct ovsthread_aux *aux;
     pthread_t thread;
     int error;
 
     forbid_forking("multiple threads exist");
     multithreaded = true;
+    ovsrcu_quiesce_end();
 
-    error = pthread_create(threadp ? threadp : &thread, attr, start, arg);
+    aux = xmalloc(sizeof *aux);
+    aux->start = start;
+    aux->arg = arg;
+
+    error = pthread_create(threadp ? threadp : &thread, attr,
+                           ovsthread_wrapper, aux);
     if (error) {
         ovs_abort(error, "pthread_create failed");
     }
@@ -143,6 +186,14 @@ void
     }
 }
 
+/* Returns true if the process has not yet created any threads (beyond the
+ * initial thread). */
+bool
+single_threaded(void)
+{
+    return !multithreaded;
+}
+
 /* Forks the current process (checking that this is allowed).  Aborts with
  * VLOG_FATAL if fork() returns an error, and otherwise returns the value
  * returned by fork().  */
@@ -179,4 +230,20 @@ may_fork(void)
 {
     return !must_not_fork;
 }
+
+/* Returns the total number of cores available to the system, or 0 if the
+ * number cannot be determined. */
+int
+count_cpu_cores(void)
+{
+    static struct ovsthread_once once = OVSTHREAD_ONCE_INITIALIZER;
+    static long int n_cores;
+
+    if (ovsthread_once_start(&once)) {
+        n_cores = sysconf(_SC_NPROCESSORS_ONLN);
+        ovsthread_once_done(&once);
+    }
+
+    return n_cores > 0 ? n_cores : 0;
+}
 #endif
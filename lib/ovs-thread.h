@@ -94,6 +94,7 @@ void xpthread_cond_wait(pthread_cond_t *, pthread_mutex_t *mutex)
 void xpthread_key_create(pthread_key_t *, void (*destructor)(void *));
 
 void xpthread_create(pthread_t *, pthread_attr_t *, void *(*)(void *), void *);
+void xpthread_join(pthread_t, void **);
 
 /* Per-thread data.
  *
@@ -374,6 +375,8 @@ ovsthread_once_start(struct ovsthread_once *once)
     ((ONCE)->done ? false : ({ OVS_ACQUIRE(ONCE); true; }))
 #endif
 
+bool single_threaded(void);
+
 void assert_single_threaded(const char *where);
 #define assert_single_threaded() assert_single_threaded(SOURCE_LOCATOR)
 
@@ -383,4 +386,6 @@ pid_t xfork(const char *where);
 void forbid_forking(const char *reason);
 bool may_fork(void);
 
+int count_cpu_cores(void);
+
 #endif /* ovs-thread.h */
@@ -39,6 +39,19 @@ wrap_json(const char *name, struct json *wrapped)
     return json_array_create_2(json_string_create(name), wrapped);
 }
 
+/* Returns a new string atom, with a single reference, whose contents are a
+ * copy of 's'. */
+struct ovsdb_atom_string *
+ovsdb_atom_string_create(const char *s)
+{
+    size_t len = strlen(s);
+    struct ovsdb_atom_string *as = xmalloc(sizeof *as + len + 1);
+
+    atomic_init(&as->n_refs, 1);
+    memcpy(as->string, s, len + 1);
+    return as;
+}
+
 /* Initializes 'atom' with the default value of the given 'type'.
  *
  * The default value for an atom is as defined in ovsdb/SPECS:
@@ -73,7 +86,7 @@ ovsdb_atom_init_default(union ovsdb_atom *atom, enum ovsdb_atomic_type type)
         break;
 
     case OVSDB_TYPE_STRING:
-        atom->string = xmemdup("", 1);
+        atom->s = ovsdb_atom_string_create("");
         break;
 
     case OVSDB_TYPE_UUID:
@@ -135,7 +148,7 @@ ovsdb_atom_is_default(const union ovsdb_atom *atom,
         return atom->boolean == false;
 
     case OVSDB_TYPE_STRING:
-        return atom->string[0] == '\0';
+        return atom->s->string[0] == '\0';
 
     case OVSDB_TYPE_UUID:
         return uuid_is_zero(&atom->uuid);
@@ -171,7 +184,7 @@ ovsdb_atom_clone(union ovsdb_atom *new, const union ovsdb_atom *old,
         break;
 
     case OVSDB_TYPE_STRING:
-        new->string = xstrdup(old->string);
+        new->s = ovsdb_atom_string_ref(old->s);
         break;
 
     case OVSDB_TYPE_UUID:
@@ -213,7 +226,7 @@ ovsdb_atom_hash(const union ovsdb_atom *atom, enum ovsdb_atomic_type type,
         return hash_boolean(atom->boolean, basis);
 
     case OVSDB_TYPE_STRING:
-        return hash_string(atom->string, basis);
+        return hash_string(atom->s->string, basis);
 
     case OVSDB_TYPE_UUID:
         return hash_int(uuid_hash(&atom->uuid), basis);
@@ -245,7 +258,7 @@ ovsdb_atom_compare_3way(const union ovsdb_atom *a,
         return a->boolean - b->boolean;
 
     case OVSDB_TYPE_STRING:
-        return strcmp(a->string, b->string);
+        return a->s == b->s ? 0 : strcmp(a->s->string, b->s->string);
 
     case OVSDB_TYPE_UUID:
         return uuid_compare_3way(&a->uuid, &b->uuid);
@@ -384,7 +397,7 @@ ovsdb_atom_from_json__(union ovsdb_atom *atom,
 
     case OVSDB_TYPE_STRING:
         if (json->type == JSON_STRING) {
-            atom->string = xstrdup(json->u.string);
+            atom->s = ovsdb_atom_string_create(json->u.string);
             return NULL;
         }
         break;
@@ -455,7 +468,7 @@ ovsdb_atom_to_json(const union ovsdb_atom *atom, enum ovsdb_atomic_type type)
         return json_boolean_create(atom->boolean);
 
     case OVSDB_TYPE_STRING:
-        return json_string_create(atom->string);
+        return json_string_create(atom->s->string);
 
     case OVSDB_TYPE_UUID:
         return wrap_json("uuid", json_string_create_nocopy(
@@ -467,6 +480,49 @@ ovsdb_atom_to_json(const union ovsdb_atom *atom, enum ovsdb_atomic_type type)
     }
 }
 
+/* Appends to 'out' the same text as json_to_ds(ovsdb_atom_to_json(atom, type),
+ * 0, out), without building the intermediate "struct json". */
+void
+ovsdb_atom_to_json_ds(const union ovsdb_atom *atom,
+                      enum ovsdb_atomic_type type, struct ds *out)
+{
+    struct json json;
+
+    switch (type) {
+    case OVSDB_TYPE_VOID:
+        NOT_REACHED();
+
+    case OVSDB_TYPE_INTEGER:
+        json.type = JSON_INTEGER;
+        json.u.integer = atom->integer;
+        json_to_ds(&json, 0, out);
+        break;
+
+    case OVSDB_TYPE_REAL:
+        json.type = JSON_REAL;
+        json.u.real = atom->real;
+        json_to_ds(&json, 0, out);
+        break;
+
+    case OVSDB_TYPE_BOOLEAN:
+        ds_put_cstr(out, atom->boolean ? "true" : "false");
+        break;
+
+    case OVSDB_TYPE_STRING:
+        json_string_escape(atom->s->string, out);
+        break;
+
+    case OVSDB_TYPE_UUID:
+        ds_put_format(out, "[\"uuid\",\""UUID_FMT"\"]",
+                      UUID_ARGS(&atom->uuid));
+        break;
+
+    case OVSDB_N_TYPES:
+    default:
+        NOT_REACHED();
+    }
+}
+
 /* Returns strlen(json_to_string(ovsdb_atom_to_json(atom, type), 0)). */
 size_t
 ovsdb_atom_json_length(const union ovsdb_atom *atom,
@@ -494,7 +550,7 @@ ovsdb_atom_json_length(const union ovsdb_atom *atom,
 
     case OVSDB_TYPE_STRING:
         json.type = JSON_STRING;
-        json.u.string = atom->string;
+        json.u.string = atom->s->string;
         break;
 
     case OVSDB_TYPE_UUID:
@@ -558,18 +614,21 @@ ovsdb_atom_from_string__(union ovsdb_atom *atom,
                            "use \"\" to represent the empty string");
         } else if (*s == '"') {
             size_t s_len = strlen(s);
+            char *unescaped;
 
             if (s_len < 2 || s[s_len - 1] != '"') {
                 return xasprintf("%s: missing quote at end of "
                                  "quoted string", s);
             } else if (!json_string_unescape(s + 1, s_len - 2,
-                                             &atom->string)) {
-                char *error = xasprintf("%s: %s", s, atom->string);
-                free(atom->string);
+                                             &unescaped)) {
+                char *error = xasprintf("%s: %s", s, unescaped);
+                free(unescaped);
                 return error;
             }
+            atom->s = ovsdb_atom_string_create(unescaped);
+            free(unescaped);
         } else {
-            atom->string = xstrdup(s);
+            atom->s = ovsdb_atom_string_create(s);
         }
         break;
 
@@ -686,14 +745,14 @@ ovsdb_atom_to_string(const union ovsdb_atom *atom, enum ovsdb_atomic_type type,
         break;
 
     case OVSDB_TYPE_STRING:
-        if (string_needs_quotes(atom->string)) {
+        if (string_needs_quotes(atom->s->string)) {
             struct json json;
 
             json.type = JSON_STRING;
-            json.u.string = atom->string;
+            json.u.string = atom->s->string;
             json_to_ds(&json, 0, out);
         } else {
-            ds_put_cstr(out, atom->string);
+            ds_put_cstr(out, atom->s->string);
         }
         break;
 
@@ -715,7 +774,7 @@ ovsdb_atom_to_bare(const union ovsdb_atom *atom, enum ovsdb_atomic_type type,
                    struct ds *out)
 {
     if (type == OVSDB_TYPE_STRING) {
-        ds_put_cstr(out, atom->string);
+        ds_put_cstr(out, atom->s->string);
     } else {
         ovsdb_atom_to_string(atom, type, out);
     }
@@ -842,7 +901,7 @@ ovsdb_atom_check_constraints(const union ovsdb_atom *atom,
         return NULL;
 
     case OVSDB_TYPE_STRING:
-        return check_string_constraints(atom->string, &base->u.string);
+        return check_string_constraints(atom->s->string, &base->u.string);
 
     case OVSDB_TYPE_UUID:
         return NULL;
@@ -1349,6 +1408,42 @@ ovsdb_datum_to_json(const struct ovsdb_datum *datum,
     }
 }
 
+/* Appends to 'out' the same text as json_to_ds(ovsdb_datum_to_json(datum,
+ * type), 0, out), without building the intermediate "struct json"s.  This
+ * saves a great deal of memory and time when 'datum' is large. */
+void
+ovsdb_datum_to_json_ds(const struct ovsdb_datum *datum,
+                       const struct ovsdb_type *type, struct ds *out)
+{
+    size_t i;
+
+    if (ovsdb_type_is_map(type)) {
+        ds_put_cstr(out, "[\"map\",[");
+        for (i = 0; i < datum->n; i++) {
+            if (i) {
+                ds_put_char(out, ',');
+            }
+            ds_put_char(out, '[');
+            ovsdb_atom_to_json_ds(&datum->keys[i], type->key.type, out);
+            ds_put_char(out, ',');
+            ovsdb_atom_to_json_ds(&datum->values[i], type->value.type, out);
+            ds_put_char(out, ']');
+        }
+        ds_put_cstr(out, "]]");
+    } else if (datum->n == 1) {
+        ovsdb_atom_to_json_ds(&datum->keys[0], type->key.type, out);
+    } else {
+        ds_put_cstr(out, "[\"set\",[");
+        for (i = 0; i < datum->n; i++) {
+            if (i) {
+                ds_put_char(out, ',');
+            }
+            ovsdb_atom_to_json_ds(&datum->keys[i], type->key.type, out);
+        }
+        ds_put_cstr(out, "]]");
+    }
+}
+
 /* Returns strlen(json_to_string(ovsdb_datum_to_json(datum, type), 0)). */
 size_t
 ovsdb_datum_json_length(const struct ovsdb_datum *datum,
@@ -1621,7 +1716,7 @@ ovsdb_datum_to_bare(const struct ovsdb_datum *datum,
 void
 ovsdb_datum_from_smap(struct ovsdb_datum *datum, struct smap *smap)
 {
-    struct smap_node *node, *next;
+    struct smap_node *node;
     size_t i;
 
     datum->n = smap_count(smap);
@@ -1629,9 +1724,9 @@ ovsdb_datum_from_smap(struct ovsdb_datum *datum, struct smap *smap)
     datum->values = xmalloc(datum->n * sizeof *datum->values);
 
     i = 0;
-    SMAP_FOR_EACH_SAFE (node, next, smap) {
-        smap_steal(smap, node,
-                   &datum->keys[i].string, &datum->values[i].string);
+    SMAP_FOR_EACH (node, smap) {
+        datum->keys[i].s = ovsdb_atom_string_create(node->key);
+        datum->values[i].s = ovsdb_atom_string_create(node->value);
         i++;
     }
     ovs_assert(i == datum->n);
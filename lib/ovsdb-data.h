@@ -18,6 +18,7 @@
 
 #include <stdlib.h>
 #include "compiler.h"
+#include "ovs-atomic.h"
 #include "ovsdb-types.h"
 #include "shash.h"
 
@@ -25,12 +26,54 @@ struct ds;
 struct ovsdb_symbol_table;
 struct smap;
 
+/* A reference-counted string, the value of an atom of type
+ * OVSDB_TYPE_STRING.
+ *
+ * Copying a string atom with ovsdb_atom_clone() only takes another reference,
+ * so that copies of a datum or a row (e.g. the copies of rows that a
+ * transaction modifies) share their strings with the original instead of
+ * allocating and copying each of them.  A string atom is therefore immutable
+ * once created. */
+struct ovsdb_atom_string {
+    atomic_uint n_refs;
+    char string[];              /* Null-terminated. */
+};
+
+struct ovsdb_atom_string *ovsdb_atom_string_create(const char *);
+
+/* Returns a new reference to 's'. */
+static inline struct ovsdb_atom_string *
+ovsdb_atom_string_ref(const struct ovsdb_atom_string *s_)
+{
+    struct ovsdb_atom_string *s = CONST_CAST(struct ovsdb_atom_string *, s_);
+    unsigned int orig;
+
+    atomic_add(&s->n_refs, 1, &orig);
+    ovs_assert(orig > 0);
+    return s;
+}
+
+/* Drops a reference to 's', freeing it if that was the last one. */
+static inline void
+ovsdb_atom_string_unref(struct ovsdb_atom_string *s)
+{
+    if (s) {
+        unsigned int orig;
+
+        atomic_sub(&s->n_refs, 1, &orig);
+        ovs_assert(orig > 0);
+        if (orig == 1) {
+            free(s);
+        }
+    }
+}
+
 /* One value of an atomic type (given by enum ovs_atomic_type). */
 union ovsdb_atom {
     int64_t integer;
     double real;
     bool boolean;
-    char *string;
+    struct ovsdb_atom_string *s;
     struct uuid uuid;
 };
 
@@ -61,7 +104,7 @@ static inline void
 ovsdb_atom_destroy(union ovsdb_atom *atom, enum ovsdb_atomic_type type)
 {
     if (type == OVSDB_TYPE_STRING) {
-        free(atom->string);
+        ovsdb_atom_string_unref(atom->s);
     }
 }
 
@@ -88,6 +131,8 @@ struct ovsdb_error *ovsdb_atom_from_json(union ovsdb_atom *,
     WARN_UNUSED_RESULT;
 struct json *ovsdb_atom_to_json(const union ovsdb_atom *,
                                 enum ovsdb_atomic_type);
+void ovsdb_atom_to_json_ds(const union ovsdb_atom *, enum ovsdb_atomic_type,
+                           struct ds *);
 size_t ovsdb_atom_json_length(const union ovsdb_atom *,
                               enum ovsdb_atomic_type);
 
@@ -165,6 +210,8 @@ struct ovsdb_error *ovsdb_datum_from_json(struct ovsdb_datum *,
     WARN_UNUSED_RESULT;
 struct json *ovsdb_datum_to_json(const struct ovsdb_datum *,
                                  const struct ovsdb_type *);
+void ovsdb_datum_to_json_ds(const struct ovsdb_datum *,
+                            const struct ovsdb_type *, struct ds *);
 size_t ovsdb_datum_json_length(const struct ovsdb_datum *,
                                const struct ovsdb_type *);
 
@@ -36,6 +36,11 @@ struct ovsdb_idl_row {
     unsigned long int *prereqs; /* Bitmap of columns to verify in "old". */
     unsigned long int *written; /* Bitmap of columns from "new" to write. */
     struct hmap_node txn_node;  /* Node in ovsdb_idl_txn's list. */
+
+    /* Change tracking (see "Tracking changes" in ovsdb-idl.h). */
+    unsigned int change_seqno[OVSDB_IDL_CHANGE_MAX];
+    struct list track_node;     /* In ovsdb_idl_table's 'track_list'. */
+    unsigned long int *updated; /* Bitmap of tracked columns modified. */
 };
 
 struct ovsdb_idl_column {
@@ -61,6 +66,7 @@ struct ovsdb_idl_table {
     bool need_table;         /* Monitor table even if no columns? */
     struct shash columns;    /* Contains "const struct ovsdb_idl_column *"s. */
     struct hmap rows;        /* Contains "struct ovsdb_idl_row"s. */
+    struct list track_list;  /* Tracked rows (ovsdb_idl_row.track_node). */
     struct ovsdb_idl *idl;   /* Containing idl. */
 };
 
@@ -69,6 +69,13 @@ struct ovsdb_idl {
     struct json *monitor_request_id;
     unsigned int last_monitor_request_seqno;
     unsigned int change_seqno;
+
+    /* Catching up after reconnecting.  As long as the server supports the
+     * "monitor_cond_since" request, the IDL remembers the ID of the last
+     * transaction that it has seen, so that after reconnecting the server
+     * can send it just the changes since then. */
+    bool use_monitor_since;     /* Server supports "monitor_cond_since"? */
+    struct uuid last_txn_id;    /* Last transaction seen, zero if none. */
     bool verify_write_only;
 
     /* Database locking. */
@@ -117,6 +124,10 @@ static struct vlog_rate_limit semantic_rl = VLOG_RATE_LIMIT_INIT(1, 5);
 static void ovsdb_idl_clear(struct ovsdb_idl *);
 static void ovsdb_idl_send_monitor_request(struct ovsdb_idl *);
 static void ovsdb_idl_parse_update(struct ovsdb_idl *, const struct json *);
+static void ovsdb_idl_parse_monitor_reply(struct ovsdb_idl *,
+                                          const struct json *result);
+static void ovsdb_idl_set_last_txn_id(struct ovsdb_idl *,
+                                      const struct json *);
 static struct ovsdb_error *ovsdb_idl_parse_update__(struct ovsdb_idl *,
                                                     const struct json *);
 static bool ovsdb_idl_process_update(struct ovsdb_idl_table *,
@@ -139,6 +150,13 @@ static void ovsdb_idl_row_unparse(struct ovsdb_idl_row *);
 static void ovsdb_idl_row_clear_old(struct ovsdb_idl_row *);
 static void ovsdb_idl_row_clear_new(struct ovsdb_idl_row *);
 
+static bool ovsdb_idl_track_is_set(const struct ovsdb_idl_table *);
+static void ovsdb_idl_row_track_change(struct ovsdb_idl_row *,
+                                       enum ovsdb_idl_change);
+static void ovsdb_idl_row_track_change__(struct ovsdb_idl_row *,
+                                         enum ovsdb_idl_change,
+                                         unsigned int seqno);
+
 static void ovsdb_idl_txn_abort_all(struct ovsdb_idl *);
 static bool ovsdb_idl_txn_process_reply(struct ovsdb_idl *,
                                         const struct jsonrpc_msg *msg);
@@ -203,9 +221,12 @@ ovsdb_idl_create(const char *remote, const struct ovsdb_idl_class *class,
             shash_add_assert(&table->columns, column->name, column);
         }
         hmap_init(&table->rows);
+        list_init(&table->track_list);
         table->idl = idl;
     }
     idl->last_monitor_request_seqno = UINT_MAX;
+    idl->use_monitor_since = true;
+    uuid_zero(&idl->last_txn_id);
     hmap_init(&idl->outstanding_txns);
 
     return idl;
@@ -220,6 +241,7 @@ ovsdb_idl_destroy(struct ovsdb_idl *idl)
 
         ovs_assert(!idl->txn);
         ovsdb_idl_clear(idl);
+        ovsdb_idl_track_clear(idl);
         jsonrpc_session_close(idl->session);
 
         for (i = 0; i < idl->class->n_tables; i++) {
@@ -244,19 +266,32 @@ ovsdb_idl_clear(struct ovsdb_idl *idl)
     bool changed = false;
     size_t i;
 
+    for (i = 0; i < idl->class->n_tables; i++) {
+        if (!hmap_is_empty(&idl->tables[i].rows)) {
+            changed = true;
+            break;
+        }
+    }
+    if (!changed) {
+        return;
+    }
+
+    /* Increment the seqno first, so that the deletions tracked below carry the
+     * seqno at which the client can see them. */
+    idl->change_seqno++;
+
     for (i = 0; i < idl->class->n_tables; i++) {
         struct ovsdb_idl_table *table = &idl->tables[i];
         struct ovsdb_idl_row *row, *next_row;
 
-        if (hmap_is_empty(&table->rows)) {
-            continue;
-        }
-
-        changed = true;
         HMAP_FOR_EACH_SAFE (row, next_row, hmap_node, &table->rows) {
             struct ovsdb_idl_arc *arc, *next_arc;
 
             if (!ovsdb_idl_row_is_orphan(row)) {
+                if (ovsdb_idl_track_is_set(table)) {
+                    ovsdb_idl_row_track_change__(row, OVSDB_IDL_CHANGE_DELETE,
+                                                 idl->change_seqno);
+                }
                 ovsdb_idl_row_unparse(row);
             }
             LIST_FOR_EACH_SAFE (arc, next_arc, src_node, &row->src_arcs) {
@@ -268,10 +303,6 @@ ovsdb_idl_clear(struct ovsdb_idl *idl)
             ovsdb_idl_row_destroy(row);
         }
     }
-
-    if (changed) {
-        idl->change_seqno++;
-    }
 }
 
 /* Processes a batch of messages from the database server on 'idl'.  This may
@@ -292,6 +323,10 @@ ovsdb_idl_run(struct ovsdb_idl *idl)
         if (idl->last_monitor_request_seqno != seqno) {
             idl->last_monitor_request_seqno = seqno;
             ovsdb_idl_txn_abort_all(idl);
+
+            /* This may be a different server, or the same one upgraded, so
+             * find out again whether it supports "monitor_cond_since". */
+            idl->use_monitor_since = true;
             ovsdb_idl_send_monitor_request(idl);
             if (idl->lock_name) {
                 ovsdb_idl_send_lock_request(idl);
@@ -311,6 +346,14 @@ ovsdb_idl_run(struct ovsdb_idl *idl)
             && msg->params->u.array.elems[0]->type == JSON_NULL) {
             /* Database contents changed. */
             ovsdb_idl_parse_update(idl, msg->params->u.array.elems[1]);
+        } else if (msg->type == JSONRPC_NOTIFY
+                   && !strcmp(msg->method, "update3")
+                   && msg->params->type == JSON_ARRAY
+                   && msg->params->u.array.n == 3
+                   && msg->params->u.array.elems[0]->type == JSON_NULL) {
+            /* Database contents changed, as of a new transaction ID. */
+            ovsdb_idl_parse_update(idl, msg->params->u.array.elems[2]);
+            ovsdb_idl_set_last_txn_id(idl, msg->params->u.array.elems[1]);
         } else if (msg->type == JSONRPC_REPLY
                    && idl->monitor_request_id
                    && json_equal(idl->monitor_request_id, msg->id)) {
@@ -318,8 +361,29 @@ ovsdb_idl_run(struct ovsdb_idl *idl)
             idl->change_seqno++;
             json_destroy(idl->monitor_request_id);
             idl->monitor_request_id = NULL;
-            ovsdb_idl_clear(idl);
-            ovsdb_idl_parse_update(idl, msg->result);
+            ovsdb_idl_parse_monitor_reply(idl, msg->result);
+        } else if (msg->type == JSONRPC_ERROR
+                   && idl->monitor_request_id
+                   && json_equal(idl->monitor_request_id, msg->id)
+                   && idl->use_monitor_since) {
+            if (msg->error->type == JSON_STRING
+                && !strcmp(json_string(msg->error), "unknown method")) {
+                /* The server does not support "monitor_cond_since".  Fall
+                 * back to a plain "monitor" request for this session. */
+                idl->use_monitor_since = false;
+                ovsdb_idl_send_monitor_request(idl);
+            } else {
+                /* Some other, possibly transient, error.  Try again after
+                 * reconnecting. */
+                char *s = json_to_string(msg->error, 0);
+                VLOG_WARN("%s: \"monitor_cond_since\" request failed (%s)",
+                          jsonrpc_session_get_name(idl->session), s);
+                free(s);
+
+                json_destroy(idl->monitor_request_id);
+                idl->monitor_request_id = NULL;
+                jsonrpc_session_force_reconnect(idl->session);
+            }
         } else if (msg->type == JSONRPC_REPLY
                    && idl->lock_request_id
                    && json_equal(idl->lock_request_id, msg->id)) {
@@ -535,6 +599,48 @@ ovsdb_idl_omit(struct ovsdb_idl *idl, const struct ovsdb_idl_column *column)
 {
     *ovsdb_idl_get_mode(idl, column) = 0;
 }
+
+/* Turns on OVSDB_IDL_TRACK for 'column' in 'idl', first turning on
+ * OVSDB_IDL_MONITOR and OVSDB_IDL_ALERT (as with ovsdb_idl_add_column()) if
+ * 'column' does not already have OVSDB_IDL_ALERT.  See "Tracking changes" in
+ * ovsdb-idl.h for details.
+ *
+ * This function should be called between ovsdb_idl_create() and the first call
+ * to ovsdb_idl_run().
+ */
+void
+ovsdb_idl_track_add_column(struct ovsdb_idl *idl,
+                           const struct ovsdb_idl_column *column)
+{
+    if (!(*ovsdb_idl_get_mode(idl, column) & OVSDB_IDL_ALERT)) {
+        ovsdb_idl_add_column(idl, column);
+    }
+    *ovsdb_idl_get_mode(idl, column) |= OVSDB_IDL_TRACK;
+}
+
+/* Turns on OVSDB_IDL_TRACK for every column in 'idl' that has
+ * OVSDB_IDL_ALERT.  Call this after any calls to ovsdb_idl_omit_alert() and
+ * ovsdb_idl_omit(), to avoid tracking the columns that they omit.
+ *
+ * This function should be called between ovsdb_idl_create() and the first call
+ * to ovsdb_idl_run().
+ */
+void
+ovsdb_idl_track_add_all(struct ovsdb_idl *idl)
+{
+    size_t i, j;
+
+    ovs_assert(!idl->change_seqno);
+    for (i = 0; i < idl->class->n_tables; i++) {
+        struct ovsdb_idl_table *table = &idl->tables[i];
+
+        for (j = 0; j < table->class->n_columns; j++) {
+            if (table->modes[j] & OVSDB_IDL_ALERT) {
+                table->modes[j] |= OVSDB_IDL_TRACK;
+            }
+        }
+    }
+}
 
 static void
 ovsdb_idl_send_monitor_request(struct ovsdb_idl *idl)
@@ -569,14 +675,70 @@ ovsdb_idl_send_monitor_request(struct ovsdb_idl *idl)
     }
 
     json_destroy(idl->monitor_request_id);
-    msg = jsonrpc_create_request(
-        "monitor",
-        json_array_create_3(json_string_create(idl->class->database),
-                            json_null_create(), monitor_requests),
-        &idl->monitor_request_id);
+    if (idl->use_monitor_since) {
+        char last_txn_id[UUID_LEN + 1];
+        struct json *params;
+
+        snprintf(last_txn_id, sizeof last_txn_id,
+                 UUID_FMT, UUID_ARGS(&idl->last_txn_id));
+        params = json_array_create_3(json_string_create(idl->class->database),
+                                     json_null_create(), monitor_requests);
+        json_array_add(params, json_string_create(last_txn_id));
+        msg = jsonrpc_create_request("monitor_cond_since", params,
+                                     &idl->monitor_request_id);
+    } else {
+        msg = jsonrpc_create_request(
+            "monitor",
+            json_array_create_3(json_string_create(idl->class->database),
+                                json_null_create(), monitor_requests),
+            &idl->monitor_request_id);
+    }
     jsonrpc_session_send(idl->session, msg);
 }
 
+/* Processes 'result', the result of our "monitor" or "monitor_cond_since"
+ * request. */
+static void
+ovsdb_idl_parse_monitor_reply(struct ovsdb_idl *idl, const struct json *result)
+{
+    if (!idl->use_monitor_since) {
+        ovsdb_idl_clear(idl);
+        ovsdb_idl_parse_update(idl, result);
+    } else if (result->type == JSON_ARRAY
+               && result->u.array.n == 3
+               && result->u.array.elems[0]->type == JSON_TRUE) {
+        /* The server sent only what changed since 'last_txn_id'. */
+        ovsdb_idl_parse_update(idl, result->u.array.elems[2]);
+        ovsdb_idl_set_last_txn_id(idl, result->u.array.elems[1]);
+    } else if (result->type == JSON_ARRAY
+               && result->u.array.n == 3
+               && result->u.array.elems[0]->type == JSON_FALSE) {
+        /* The server sent the whole database. */
+        ovsdb_idl_clear(idl);
+        ovsdb_idl_parse_update(idl, result->u.array.elems[2]);
+        ovsdb_idl_set_last_txn_id(idl, result->u.array.elems[1]);
+    } else {
+        /* An error, e.g. a syntax error in our request.  Start over from
+         * scratch with the next reconnection. */
+        uuid_zero(&idl->last_txn_id);
+        ovsdb_idl_clear(idl);
+        ovsdb_idl_parse_update(idl, result);
+    }
+}
+
+/* Sets the ID of the last transaction seen by 'idl' to 'txn_id', which should
+ * be a JSON string holding a UUID. */
+static void
+ovsdb_idl_set_last_txn_id(struct ovsdb_idl *idl, const struct json *txn_id)
+{
+    if (txn_id->type != JSON_STRING
+        || !uuid_from_string(&idl->last_txn_id, json_string(txn_id))) {
+        VLOG_WARN_RL(&syntax_rl, "%s: bad transaction ID in update",
+                     jsonrpc_session_get_name(idl->session));
+        uuid_zero(&idl->last_txn_id);
+    }
+}
+
 static void
 ovsdb_idl_parse_update(struct ovsdb_idl *idl, const struct json *table_updates)
 {
@@ -737,9 +899,14 @@ ovsdb_idl_process_update(struct ovsdb_idl_table *table,
 }
 
 /* Returns true if a column with mode OVSDB_IDL_MODE_RW changed, false
- * otherwise. */
+ * otherwise.
+ *
+ * 'change' says whether 'row' is being inserted or modified.  In the latter
+ * case, modified columns that are being tracked are recorded in
+ * row->updated. */
 static bool
-ovsdb_idl_row_update(struct ovsdb_idl_row *row, const struct json *row_json)
+ovsdb_idl_row_update(struct ovsdb_idl_row *row, const struct json *row_json,
+                     enum ovsdb_idl_change change)
 {
     struct ovsdb_idl_table *table = row->table;
     struct shash_node *node;
@@ -768,6 +935,14 @@ ovsdb_idl_row_update(struct ovsdb_idl_row *row, const struct json *row_json)
                 if (table->modes[column_idx] & OVSDB_IDL_ALERT) {
                     changed = true;
                 }
+                if (change == OVSDB_IDL_CHANGE_MODIFY
+                    && table->modes[column_idx] & OVSDB_IDL_TRACK) {
+                    if (!row->updated) {
+                        row->updated = bitmap_allocate(table->class->n_columns);
+                    }
+                    bitmap_set1(row->updated, column_idx);
+                    ovsdb_idl_row_track_change(row, OVSDB_IDL_CHANGE_MODIFY);
+                }
             } else {
                 /* Didn't really change but the OVSDB monitor protocol always
                  * includes every value in a row. */
@@ -936,6 +1111,7 @@ ovsdb_idl_row_create__(const struct ovsdb_idl_table_class *class)
     list_init(&row->src_arcs);
     list_init(&row->dst_arcs);
     hmap_node_nullify(&row->txn_node);
+    list_init(&row->track_node);
     return row;
 }
 
@@ -955,7 +1131,13 @@ ovsdb_idl_row_destroy(struct ovsdb_idl_row *row)
     if (row) {
         ovsdb_idl_row_clear_old(row);
         hmap_remove(&row->table->rows, &row->hmap_node);
-        free(row);
+        if (list_is_empty(&row->track_node)) {
+            free(row);
+        } else {
+            /* Keep the row around so that the client can see that it was
+             * deleted.  ovsdb_idl_track_clear() will free it. */
+            hmap_node_nullify(&row->hmap_node);
+        }
     }
 }
 
@@ -970,8 +1152,11 @@ ovsdb_idl_insert_row(struct ovsdb_idl_row *row, const struct json *row_json)
     for (i = 0; i < class->n_columns; i++) {
         ovsdb_datum_init_default(&row->old[i], &class->columns[i].type);
     }
-    ovsdb_idl_row_update(row, row_json);
+    ovsdb_idl_row_update(row, row_json, OVSDB_IDL_CHANGE_INSERT);
     ovsdb_idl_row_parse(row);
+    if (ovsdb_idl_track_is_set(row->table)) {
+        ovsdb_idl_row_track_change(row, OVSDB_IDL_CHANGE_INSERT);
+    }
 
     ovsdb_idl_row_reparse_backrefs(row);
 }
@@ -979,6 +1164,9 @@ ovsdb_idl_insert_row(struct ovsdb_idl_row *row, const struct json *row_json)
 static void
 ovsdb_idl_delete_row(struct ovsdb_idl_row *row)
 {
+    if (ovsdb_idl_track_is_set(row->table)) {
+        ovsdb_idl_row_track_change(row, OVSDB_IDL_CHANGE_DELETE);
+    }
     ovsdb_idl_row_unparse(row);
     ovsdb_idl_row_clear_arcs(row, true);
     ovsdb_idl_row_clear_old(row);
@@ -998,7 +1186,7 @@ ovsdb_idl_modify_row(struct ovsdb_idl_row *row, const struct json *row_json)
 
     ovsdb_idl_row_unparse(row);
     ovsdb_idl_row_clear_arcs(row, true);
-    changed = ovsdb_idl_row_update(row, row_json);
+    changed = ovsdb_idl_row_update(row, row_json, OVSDB_IDL_CHANGE_MODIFY);
     ovsdb_idl_row_parse(row);
 
     return changed;
@@ -1128,6 +1316,124 @@ ovsdb_idl_next_row(const struct ovsdb_idl_row *row)
     return next_real_row(table, hmap_next(&table->rows, &row->hmap_node));
 }
 
+/* Returns true if any column in 'table' has OVSDB_IDL_TRACK. */
+static bool
+ovsdb_idl_track_is_set(const struct ovsdb_idl_table *table)
+{
+    size_t i;
+
+    for (i = 0; i < table->class->n_columns; i++) {
+        if (table->modes[i] & OVSDB_IDL_TRACK) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Records that 'row' went through 'change' and adds it to its table's list of
+ * tracked rows, if it is not already there.  The caller must not call this
+ * unless ovsdb_idl_track_is_set() is true for 'row''s table. */
+static void
+ovsdb_idl_row_track_change(struct ovsdb_idl_row *row,
+                           enum ovsdb_idl_change change)
+{
+    /* The caller increments the IDL's seqno after processing the change. */
+    ovsdb_idl_row_track_change__(row, change,
+                                 row->table->idl->change_seqno + 1);
+}
+
+/* Like ovsdb_idl_row_track_change(), but records 'seqno' as the seqno of the
+ * change. */
+static void
+ovsdb_idl_row_track_change__(struct ovsdb_idl_row *row,
+                             enum ovsdb_idl_change change, unsigned int seqno)
+{
+    row->change_seqno[change] = seqno;
+    if (list_is_empty(&row->track_node)) {
+        list_push_back(&row->table->track_list, &row->track_node);
+    }
+}
+
+/* Returns the first row in 'table_class''s table in 'idl' that has changed
+ * since the last call to ovsdb_idl_track_clear(), or a null pointer if there
+ * is none.  Unlike ovsdb_idl_first_row(), this may return deleted rows.
+ *
+ * Rows are returned in the order in which they first changed. */
+const struct ovsdb_idl_row *
+ovsdb_idl_track_get_first(const struct ovsdb_idl *idl,
+                          const struct ovsdb_idl_table_class *table_class)
+{
+    struct ovsdb_idl_table *table
+        = ovsdb_idl_table_from_class(idl, table_class);
+
+    if (list_is_empty(&table->track_list)) {
+        return NULL;
+    }
+    return CONTAINER_OF(list_front(&table->track_list),
+                        struct ovsdb_idl_row, track_node);
+}
+
+/* Returns the tracked row following 'row' within its table, or a null pointer
+ * if 'row' is the last tracked row in its table. */
+const struct ovsdb_idl_row *
+ovsdb_idl_track_get_next(const struct ovsdb_idl_row *row)
+{
+    if (row->track_node.next == &row->table->track_list) {
+        return NULL;
+    }
+    return CONTAINER_OF(row->track_node.next, struct ovsdb_idl_row,
+                        track_node);
+}
+
+/* Returns true if 'column' in tracked row 'row' was modified since the last
+ * call to ovsdb_idl_track_clear(), false otherwise.  Always returns false for
+ * columns that do not have OVSDB_IDL_TRACK.  Columns of rows that were
+ * inserted are not reported as modified unless they changed again later. */
+bool
+ovsdb_idl_track_is_updated(const struct ovsdb_idl_row *row,
+                           const struct ovsdb_idl_column *column)
+{
+    size_t column_idx = column - row->table->class->columns;
+
+    return row->updated && bitmap_is_set(row->updated, column_idx);
+}
+
+/* Returns the value that ovsdb_idl_get_seqno() returned just after 'row' most
+ * recently went through 'change', or 0 if 'row' has not gone through 'change'
+ * since the last call to ovsdb_idl_track_clear(). */
+unsigned int
+ovsdb_idl_row_get_seqno(const struct ovsdb_idl_row *row,
+                        enum ovsdb_idl_change change)
+{
+    return row->change_seqno[change];
+}
+
+/* Forgets all of the changes tracked in 'idl' so far, freeing the rows that
+ * were deleted.  A client that tracks changes should call this after it
+ * processes them; otherwise, the tracked changes accumulate indefinitely. */
+void
+ovsdb_idl_track_clear(struct ovsdb_idl *idl)
+{
+    size_t i;
+
+    for (i = 0; i < idl->class->n_tables; i++) {
+        struct ovsdb_idl_table *table = &idl->tables[i];
+        struct ovsdb_idl_row *row, *next;
+
+        LIST_FOR_EACH_SAFE (row, next, track_node, &table->track_list) {
+            list_remove(&row->track_node);
+            list_init(&row->track_node);
+            memset(row->change_seqno, 0, sizeof row->change_seqno);
+            free(row->updated);
+            row->updated = NULL;
+            if (hmap_node_is_null(&row->hmap_node)) {
+                /* Already removed from 'table' by ovsdb_idl_row_destroy(). */
+                free(row);
+            }
+        }
+    }
+}
+
 /* Reads and returns the value of 'column' within 'row'.  If an ongoing
  * transaction has changed 'column''s value, the modified value is returned.
  *
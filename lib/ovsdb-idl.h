@@ -73,7 +73,8 @@ int ovsdb_idl_get_last_error(const struct ovsdb_idl *);
  * If OVSDB_IDL_MONITOR is set, then the column is replicated.  Its value will
  * reflect the value in the database.  If OVSDB_IDL_ALERT is also set, then the
  * value returned by ovsdb_idl_get_seqno() will change when the column's value
- * changes.
+ * changes.  If OVSDB_IDL_TRACK is also set, then the IDL additionally records
+ * which rows changed (see "Tracking changes" below).
  *
  * The possible mode combinations are:
  *
@@ -91,6 +92,7 @@ int ovsdb_idl_get_last_error(const struct ovsdb_idl *);
  */
 #define OVSDB_IDL_MONITOR (1 << 0) /* Monitor this column? */
 #define OVSDB_IDL_ALERT   (1 << 1) /* Alert client when column updated? */
+#define OVSDB_IDL_TRACK   (1 << 2) /* Track changes to this column? */
 
 void ovsdb_idl_add_column(struct ovsdb_idl *, const struct ovsdb_idl_column *);
 void ovsdb_idl_add_table(struct ovsdb_idl *,
@@ -116,6 +118,54 @@ const struct ovsdb_datum *ovsdb_idl_get(const struct ovsdb_idl_row *,
                                         enum ovsdb_atomic_type value_type);
 
 bool ovsdb_idl_row_is_synthetic(const struct ovsdb_idl_row *);
+
+/* Tracking changes.
+ *
+ * ovsdb_idl_get_seqno() only tells a client that something in the replica
+ * changed.  A client that wants to process only what changed, instead of
+ * walking every row of every table, can ask the IDL to track changes to
+ * selected columns with ovsdb_idl_track_add_column() or
+ * ovsdb_idl_track_add_all().  Then, for each table that has any tracked
+ * column, the IDL remembers every row that was inserted or deleted, or that
+ * had a tracked column modified, until the client calls
+ * ovsdb_idl_track_clear().
+ *
+ * The usual pattern is:
+ *
+ *     ovsdb_idl_run(idl);
+ *     if (ovsdb_idl_get_seqno(idl) != seqno) {
+ *         FOR_EACH_TRACKED row in each interesting table:
+ *             process insertion, modification, or deletion of the row;
+ *         ovsdb_idl_track_clear(idl);
+ *     }
+ *
+ * ovsdb_idl_row_get_seqno() reports which kinds of change a tracked row went
+ * through, as the value of ovsdb_idl_get_seqno() just after the change, or 0
+ * if the row did not go through that kind of change since the last call to
+ * ovsdb_idl_track_clear().  A row may be both inserted and deleted, in which
+ * case it is no longer in the database.  Of a deleted row, only the UUID is
+ * meaningful: its columns have already been freed. */
+
+enum ovsdb_idl_change {
+    OVSDB_IDL_CHANGE_INSERT,
+    OVSDB_IDL_CHANGE_MODIFY,
+    OVSDB_IDL_CHANGE_DELETE,
+    OVSDB_IDL_CHANGE_MAX
+};
+
+void ovsdb_idl_track_add_column(struct ovsdb_idl *,
+                                const struct ovsdb_idl_column *);
+void ovsdb_idl_track_add_all(struct ovsdb_idl *);
+void ovsdb_idl_track_clear(struct ovsdb_idl *);
+
+const struct ovsdb_idl_row *ovsdb_idl_track_get_first(
+    const struct ovsdb_idl *, const struct ovsdb_idl_table_class *);
+const struct ovsdb_idl_row *ovsdb_idl_track_get_next(
+    const struct ovsdb_idl_row *);
+bool ovsdb_idl_track_is_updated(const struct ovsdb_idl_row *,
+                                const struct ovsdb_idl_column *);
+unsigned int ovsdb_idl_row_get_seqno(const struct ovsdb_idl_row *,
+                                     enum ovsdb_idl_change);
 
 /* Transactions.
  *
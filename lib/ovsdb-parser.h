@@ -38,7 +38,7 @@ BUILD_ASSERT_DECL(JSON_ARRAY >= 0 && JSON_ARRAY < 10);
 BUILD_ASSERT_DECL(JSON_INTEGER >= 0 && JSON_INTEGER < 10);
 BUILD_ASSERT_DECL(JSON_REAL >= 0 && JSON_REAL < 10);
 BUILD_ASSERT_DECL(JSON_STRING >= 0 && JSON_STRING < 10);
-BUILD_ASSERT_DECL(JSON_N_TYPES == 8);
+BUILD_ASSERT_DECL(JSON_N_TYPES == 9);
 
 enum ovsdb_parser_types {
     OP_NULL = 1 << JSON_NULL,             /* null */
@@ -25,6 +25,7 @@
 #include "dynamic-string.h"
 #include "fatal-signal.h"
 #include "list.h"
+#include "ovs-rcu.h"
 #include "ovs-thread.h"
 #include "socket-util.h"
 #include "timeval.h"
@@ -226,8 +227,11 @@ poll_block(void)
         COVERAGE_INC(poll_zero_timeout);
     }
 
+    /* Blocking is a quiescent state for RCU purposes (see ovs-rcu.h). */
+    ovsrcu_quiesce_start();
     retval = time_poll(loop->pollfds, loop->n_waiters,
                        loop->timeout_when, &elapsed);
+    ovsrcu_quiesce_end();
     if (retval < 0) {
         static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
         VLOG_ERR_RL(&rl, "poll: %s", ovs_strerror(-retval));
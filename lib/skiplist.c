@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2013 Nicira, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+#include "skiplist.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "random.h"
+#include "util.h"
+
+/* Maximum number of levels.  With a 1/4 chance of promotion to each next
+ * level, this is plenty for any skiplist that fits in memory. */
+#define SKIPLIST_MAX_LEVELS 16
+
+struct skiplist_node {
+    const void *data;
+    int height;                         /* Number of elements in 'forward'. */
+    struct skiplist_node *forward[];    /* Next node at each level. */
+};
+
+struct skiplist {
+    struct skiplist_node *header;       /* Sentinel with maximum height. */
+    skiplist_comparator *cmp;
+    const void *aux;
+    int level;                          /* Current maximum height in use. */
+    size_t n;                           /* Number of elements. */
+};
+
+static struct skiplist_node *
+skiplist_node_create(int height, const void *data)
+{
+    struct skiplist_node *node;
+
+    node = xmalloc(sizeof *node + height * sizeof node->forward[0]);
+    node->data = data;
+    node->height = height;
+    memset(node->forward, 0, height * sizeof node->forward[0]);
+    return node;
+}
+
+/* Returns a random height for a new node: 1 with probability 3/4, 2 with
+ * probability 3/16, and so on. */
+static int
+skiplist_random_height(void)
+{
+    uint32_t bits = random_uint32();
+    int height = 1;
+
+    while (height < SKIPLIST_MAX_LEVELS && (bits & 3) == 0) {
+        bits >>= 2;
+        height++;
+    }
+    return height;
+}
+
+/* Creates and returns a new, empty skiplist that orders its elements with
+ * 'cmp', passing 'aux' as its third argument. */
+struct skiplist *
+skiplist_create(skiplist_comparator *cmp, const void *aux)
+{
+    struct skiplist *sl;
+
+    sl = xmalloc(sizeof *sl);
+    sl->header = skiplist_node_create(SKIPLIST_MAX_LEVELS, NULL);
+    sl->cmp = cmp;
+    sl->aux = aux;
+    sl->level = 1;
+    sl->n = 0;
+    return sl;
+}
+
+/* Frees 'sl' and all of its nodes, but not the data that they point to. */
+void
+skiplist_destroy(struct skiplist *sl)
+{
+    if (sl) {
+        struct skiplist_node *node, *next;
+
+        for (node = sl->header; node; node = next) {
+            next = node->forward[0];
+            free(node);
+        }
+        free(sl);
+    }
+}
+
+/* Returns the number of elements in 'sl'. */
+size_t
+skiplist_count(const struct skiplist *sl)
+{
+    return sl->n;
+}
+
+/* Stores in 'update[i]', for each level 'i', the last node at that level whose
+ * data orders before 'key' according to 'cmp' (or the header).  Returns the
+ * node that follows 'update[0]', that is, the first node whose data does not
+ * order before 'key', or NULL if there is none. */
+static struct skiplist_node *
+skiplist_search(const struct skiplist *sl, const void *key,
+                skiplist_comparator *cmp,
+                struct skiplist_node *update[SKIPLIST_MAX_LEVELS])
+{
+    struct skiplist_node *x = sl->header;
+    int i;
+
+    for (i = sl->level - 1; i >= 0; i--) {
+        while (x->forward[i] && cmp(x->forward[i]->data, key, sl->aux) < 0) {
+            x = x->forward[i];
+        }
+        if (update) {
+            update[i] = x;
+        }
+    }
+    return x->forward[0];
+}
+
+/* Inserts 'data' into 'sl'.  'data' must not already be in 'sl'. */
+void
+skiplist_insert(struct skiplist *sl, const void *data)
+{
+    struct skiplist_node *update[SKIPLIST_MAX_LEVELS];
+    struct skiplist_node *node;
+    int height, i;
+
+    skiplist_search(sl, data, sl->cmp, update);
+
+    height = skiplist_random_height();
+    for (i = sl->level; i < height; i++) {
+        update[i] = sl->header;
+    }
+    sl->level = MAX(sl->level, height);
+
+    node = skiplist_node_create(height, data);
+    for (i = 0; i < height; i++) {
+        node->forward[i] = update[i]->forward[i];
+        update[i]->forward[i] = node;
+    }
+    sl->n++;
+}
+
+/* Removes the element equal to 'data' from 'sl'.  Returns true if one was
+ * found and removed, false otherwise. */
+bool
+skiplist_delete(struct skiplist *sl, const void *data)
+{
+    struct skiplist_node *update[SKIPLIST_MAX_LEVELS];
+    struct skiplist_node *node;
+    int i;
+
+    node = skiplist_search(sl, data, sl->cmp, update);
+    if (!node || sl->cmp(node->data, data, sl->aux)) {
+        return false;
+    }
+
+    for (i = 0; i < node->height; i++) {
+        update[i]->forward[i] = node->forward[i];
+    }
+    free(node);
+
+    while (sl->level > 1 && !sl->header->forward[sl->level - 1]) {
+        sl->level--;
+    }
+    sl->n--;
+    return true;
+}
+
+/* Returns the element in 'sl' equal to 'data', or NULL if there is none. */
+void *
+skiplist_find(const struct skiplist *sl, const void *data)
+{
+    struct skiplist_node *node = skiplist_search(sl, data, sl->cmp, NULL);
+
+    return (node && !sl->cmp(node->data, data, sl->aux)
+            ? CONST_CAST(void *, node->data)
+            : NULL);
+}
+
+/* Returns the first node in 'sl' whose data does not order before 'key'
+ * according to 'key_cmp', or NULL if there is none. */
+struct skiplist_node *
+skiplist_lower_bound(const struct skiplist *sl, const void *key,
+                     skiplist_comparator *key_cmp)
+{
+    return skiplist_search(sl, key, key_cmp, NULL);
+}
+
+/* Returns the node with the least element in 'sl', or NULL if 'sl' is
+ * empty. */
+struct skiplist_node *
+skiplist_first(const struct skiplist *sl)
+{
+    return sl->header->forward[0];
+}
+
+/* Returns the node that follows 'node' in ascending order, or NULL if 'node'
+ * is the last one. */
+struct skiplist_node *
+skiplist_next(const struct skiplist_node *node)
+{
+    return node->forward[0];
+}
+
+/* Returns the data that 'node' points to. */
+void *
+skiplist_node_data(const struct skiplist_node *node)
+{
+    return CONST_CAST(void *, node->data);
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2013 Nicira, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SKIPLIST_H
+#define SKIPLIST_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Skiplist
+ * ========
+ *
+ * An ordered collection of pointers, with O(log n) expected time insertion,
+ * deletion, and search and O(1) iteration to the next element in order.
+ *
+ * The skiplist does not own the data that it points to and never
+ * dereferences it except through the comparison function supplied by the
+ * client.  Elements must be distinct according to that function.
+ */
+
+/* Compares 'a' and 'b', returning a negative value if 'a' orders before 'b', a
+ * positive value if 'a' orders after 'b', and 0 if they are equal.  'aux' is
+ * the auxiliary data passed to skiplist_create(). */
+typedef int skiplist_comparator(const void *a, const void *b, const void *aux);
+
+struct skiplist_node;
+
+struct skiplist *skiplist_create(skiplist_comparator *, const void *aux);
+void skiplist_destroy(struct skiplist *);
+
+size_t skiplist_count(const struct skiplist *);
+
+void skiplist_insert(struct skiplist *, const void *data);
+bool skiplist_delete(struct skiplist *, const void *data);
+
+/* Search.
+ *
+ * skiplist_lower_bound() returns the first node whose data is not less than
+ * 'key', according to 'key_cmp', which is passed a node's data as its first
+ * argument and 'key' as its second.  'key_cmp' must be consistent with the
+ * skiplist's own comparison function, that is, it must return a negative
+ * value for some prefix of the skiplist's elements (possibly none of them)
+ * and a nonnegative value for the rest.  'key' need not have the same type as
+ * the elements. */
+void *skiplist_find(const struct skiplist *, const void *data);
+struct skiplist_node *skiplist_lower_bound(const struct skiplist *,
+                                           const void *key,
+                                           skiplist_comparator *key_cmp);
+
+/* Iteration in ascending order. */
+struct skiplist_node *skiplist_first(const struct skiplist *);
+struct skiplist_node *skiplist_next(const struct skiplist_node *);
+void *skiplist_node_data(const struct skiplist_node *);
+
+/* Iterates DATA, a pointer variable, over the elements of SKIPLIST in
+ * ascending order, using NODE ("struct skiplist_node *") as a cursor.  The
+ * current element must not be deleted from SKIPLIST during the iteration. */
+#define SKIPLIST_FOR_EACH(DATA, NODE, SKIPLIST)                         \
+    for ((NODE) = skiplist_first(SKIPLIST);                             \
+         (NODE) ? ((DATA) = skiplist_node_data(NODE), 1) : 0;           \
+         (NODE) = skiplist_next(NODE))
+
+#endif /* skiplist.h */
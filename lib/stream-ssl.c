@@ -29,6 +29,7 @@
 #include <openssl/ssl.h>
 #include <openssl/x509v3.h>
 #include <poll.h>
+#include <pthread.h>
 #include <sys/fcntl.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -37,6 +38,8 @@
 #include "entropy.h"
 #include "ofpbuf.h"
 #include "openflow/openflow.h"
+#include "ovs-atomic.h"
+#include "ovs-thread.h"
 #include "packets.h"
 #include "poll-loop.h"
 #include "shash.h"
@@ -137,6 +140,14 @@ struct ssl_stream
 /* SSL context created by ssl_init(). */
 static SSL_CTX *ctx;
 
+/* Sessions may run in any thread (ovsdb-server hands them to its session
+ * threads), but OpenSSL does not protect an SSL_CTX against being changed
+ * while SSL objects created from it are in use.  So the stream_ssl_set_*()
+ * functions, and the CA certificate bootstrap, take this lock for writing
+ * while they change 'ctx' or the configuration below, and each call into
+ * OpenSSL on behalf of a session takes it for reading. */
+static pthread_rwlock_t ssl_config_rwlock = PTHREAD_RWLOCK_INITIALIZER;
+
 struct ssl_config_file {
     bool read;                  /* Whether the file was successfully read. */
     char *file_name;            /* Configured file name, if any. */
@@ -162,7 +173,7 @@ static bool bootstrap_ca_cert;
 
 /* Session number.  Used in debug logging messages to uniquely identify a
  * session. */
-static unsigned int next_session_nr;
+static atomic_uint next_session_nr = ATOMIC_VAR_INIT(0);
 
 /* Who knows what can trigger various SSL errors, so let's throttle them down
  * quite a bit. */
@@ -210,10 +221,13 @@ new_ssl_stream(const char *name, int fd, enum session_type type,
     struct sockaddr_in local;
     socklen_t local_len = sizeof local;
     struct ssl_stream *sslv;
+    unsigned int session_nr;
     SSL *ssl = NULL;
     int on = 1;
     int retval;
 
+    xpthread_rwlock_rdlock(&ssl_config_rwlock);
+
     /* Check for all the needful configuration. */
     retval = 0;
     if (!private_key.read) {
@@ -266,6 +280,7 @@ new_ssl_stream(const char *name, int fd, enum session_type type,
     if (!verify_peer_cert || (bootstrap_ca_cert && type == CLIENT)) {
         SSL_set_verify(ssl, SSL_VERIFY_NONE, NULL);
     }
+    xpthread_rwlock_unlock(&ssl_config_rwlock);
 
     /* Create and return the ssl_stream. */
     sslv = xmalloc(sizeof *sslv);
@@ -280,7 +295,8 @@ new_ssl_stream(const char *name, int fd, enum session_type type,
     sslv->ssl = ssl;
     sslv->txbuf = NULL;
     sslv->rx_want = sslv->tx_want = SSL_NOTHING;
-    sslv->session_nr = next_session_nr++;
+    atomic_add(&next_session_nr, 1, &session_nr);
+    sslv->session_nr = session_nr;
     sslv->n_head = 0;
 
     if (VLOG_IS_DBG_ENABLED()) {
@@ -295,6 +311,7 @@ error:
     if (ssl) {
         SSL_free(ssl);
     }
+    xpthread_rwlock_unlock(&ssl_config_rwlock);
     close(fd);
     return retval;
 }
@@ -328,6 +345,7 @@ ssl_open(const char *name, char *suffix, struct stream **streamp, uint8_t dscp)
     }
 }
 
+/* The caller must hold 'ssl_config_rwlock' for writing. */
 static int
 do_ca_cert_bootstrap(struct stream *stream)
 {
@@ -424,6 +442,35 @@ do_ca_cert_bootstrap(struct stream *stream)
     return EPROTO;
 }
 
+/* Finishes connecting 'stream' after a successful SSL handshake.  The caller
+ * must hold 'ssl_config_rwlock', for writing if 'bootstrap_ca_cert' is
+ * true. */
+static int
+ssl_connect_done(struct stream *stream)
+{
+    struct ssl_stream *sslv = ssl_stream_cast(stream);
+
+    if (bootstrap_ca_cert) {
+        return do_ca_cert_bootstrap(stream);
+    } else if (verify_peer_cert
+               && ((SSL_get_verify_mode(sslv->ssl)
+                   & (SSL_VERIFY_NONE | SSL_VERIFY_PEER))
+                   != SSL_VERIFY_PEER)) {
+        /* Two or more SSL connections completed at the same time while we
+         * were in bootstrap mode.  Only one of these can finish the
+         * bootstrap successfully.  The other one(s) must be rejected
+         * because they were not verified against the bootstrapped CA
+         * certificate.  (Alternatively we could verify them against the CA
+         * certificate, but that's more trouble than it's worth.  These
+         * connections will succeed the next time they retry, assuming that
+         * they have a certificate against the correct CA.) */
+        VLOG_INFO("rejecting SSL connection during bootstrap race window");
+        return EPROTO;
+    } else {
+        return 0;
+    }
+}
+
 static int
 ssl_connect(struct stream *stream)
 {
@@ -447,8 +494,10 @@ ssl_connect(struct stream *stream)
                                 MSG_PEEK);
         }
 
+        xpthread_rwlock_rdlock(&ssl_config_rwlock);
         retval = (sslv->type == CLIENT
                    ? SSL_connect(sslv->ssl) : SSL_accept(sslv->ssl));
+        xpthread_rwlock_unlock(&ssl_config_rwlock);
         if (retval != 1) {
             int error = SSL_get_error(sslv->ssl, retval);
             if (retval < 0 && ssl_wants_io(error)) {
@@ -463,24 +512,18 @@ ssl_connect(struct stream *stream)
                                       THIS_MODULE, stream_get_name(stream));
                 return EPROTO;
             }
-        } else if (bootstrap_ca_cert) {
-            return do_ca_cert_bootstrap(stream);
-        } else if (verify_peer_cert
-                   && ((SSL_get_verify_mode(sslv->ssl)
-                       & (SSL_VERIFY_NONE | SSL_VERIFY_PEER))
-                       != SSL_VERIFY_PEER)) {
-            /* Two or more SSL connections completed at the same time while we
-             * were in bootstrap mode.  Only one of these can finish the
-             * bootstrap successfully.  The other one(s) must be rejected
-             * because they were not verified against the bootstrapped CA
-             * certificate.  (Alternatively we could verify them against the CA
-             * certificate, but that's more trouble than it's worth.  These
-             * connections will succeed the next time they retry, assuming that
-             * they have a certificate against the correct CA.) */
-            VLOG_INFO("rejecting SSL connection during bootstrap race window");
-            return EPROTO;
         } else {
-            return 0;
+            xpthread_rwlock_rdlock(&ssl_config_rwlock);
+            if (bootstrap_ca_cert) {
+                /* Bootstrapping changes 'ctx', so it needs the lock for
+                 * writing.  Another session may finish the bootstrap while we
+                 * wait for it, which ssl_connect_done() also handles. */
+                xpthread_rwlock_unlock(&ssl_config_rwlock);
+                xpthread_rwlock_wrlock(&ssl_config_rwlock);
+            }
+            retval = ssl_connect_done(stream);
+            xpthread_rwlock_unlock(&ssl_config_rwlock);
+            return retval;
         }
     }
 
@@ -498,6 +541,7 @@ ssl_close(struct stream *stream)
      * SSL connection isn't renegotiating, etc.  That has to be good enough,
      * since we don't have any way to continue the close operation in the
      * background. */
+    xpthread_rwlock_rdlock(&ssl_config_rwlock);
     SSL_shutdown(sslv->ssl);
 
     /* SSL_shutdown() might have signaled an error, in which case we need to
@@ -506,6 +550,7 @@ ssl_close(struct stream *stream)
     ERR_clear_error();
 
     SSL_free(sslv->ssl);
+    xpthread_rwlock_unlock(&ssl_config_rwlock);
     close(sslv->fd);
     free(sslv);
 }
@@ -600,7 +645,9 @@ ssl_recv(struct stream *stream, void *buffer, size_t n)
     ovs_assert(n > 0);
 
     old_state = SSL_get_state(sslv->ssl);
+    xpthread_rwlock_rdlock(&ssl_config_rwlock);
     ret = SSL_read(sslv->ssl, buffer, n);
+    xpthread_rwlock_unlock(&ssl_config_rwlock);
     if (old_state != SSL_get_state(sslv->ssl)) {
         sslv->tx_want = SSL_NOTHING;
     }
@@ -633,7 +680,11 @@ ssl_do_tx(struct stream *stream)
 
     for (;;) {
         int old_state = SSL_get_state(sslv->ssl);
-        int ret = SSL_write(sslv->ssl, sslv->txbuf->data, sslv->txbuf->size);
+        int ret;
+
+        xpthread_rwlock_rdlock(&ssl_config_rwlock);
+        ret = SSL_write(sslv->ssl, sslv->txbuf->data, sslv->txbuf->size);
+        xpthread_rwlock_unlock(&ssl_config_rwlock);
         if (old_state != SSL_get_state(sslv->ssl)) {
             sslv->rx_want = SSL_NOTHING;
         }
@@ -892,19 +943,63 @@ ssl_wants_io(int ssl_error)
 static int
 ssl_init(void)
 {
-    static int init_status = -1;
-    if (init_status < 0) {
+    static struct ovsthread_once once = OVSTHREAD_ONCE_INITIALIZER;
+    static int init_status;
+
+    if (ovsthread_once_start(&once)) {
         init_status = do_ssl_init();
         ovs_assert(init_status >= 0);
+        ovsthread_once_done(&once);
     }
     return init_status;
 }
 
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+/* OpenSSL before 1.1.0 is only safe to use from more than one thread if the
+ * application supplies locking and thread ID callbacks.  Later versions do
+ * their own locking and ignore these. */
+static pthread_mutex_t *ssl_locks;
+
+static void
+ssl_locking_cb(int mode, int type, const char *file OVS_UNUSED,
+               int line OVS_UNUSED)
+{
+    if (mode & CRYPTO_LOCK) {
+        xpthread_mutex_lock(&ssl_locks[type]);
+    } else {
+        xpthread_mutex_unlock(&ssl_locks[type]);
+    }
+}
+
+static unsigned long
+ssl_thread_id_cb(void)
+{
+    return (unsigned long) pthread_self();
+}
+
+static void
+ssl_init_locks(void)
+{
+    int n = CRYPTO_num_locks();
+    int i;
+
+    ssl_locks = xmalloc(n * sizeof *ssl_locks);
+    for (i = 0; i < n; i++) {
+        xpthread_mutex_init(&ssl_locks[i], NULL);
+    }
+    CRYPTO_set_id_callback(ssl_thread_id_cb);
+    CRYPTO_set_locking_callback(ssl_locking_cb);
+}
+#endif
+
 static int
 do_ssl_init(void)
 {
     SSL_METHOD *method;
 
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+    ssl_init_locks();
+#endif
     SSL_library_init();
     SSL_load_error_strings();
 
@@ -975,18 +1070,25 @@ tmp_dh_callback(SSL *ssl OVS_UNUSED, int is_export OVS_UNUSED, int keylength)
         {2048, NULL, get_dh2048},
         {4096, NULL, get_dh4096},
     };
+    static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 
     struct dh *dh;
 
     for (dh = dh_table; dh < &dh_table[ARRAY_SIZE(dh_table)]; dh++) {
         if (dh->keylength == keylength) {
+            DH *params;
+
+            /* Handshakes in different threads can get here at once. */
+            xpthread_mutex_lock(&mutex);
             if (!dh->dh) {
                 dh->dh = dh->constructor();
                 if (!dh->dh) {
                     out_of_memory();
                 }
             }
-            return dh->dh;
+            params = dh->dh;
+            xpthread_mutex_unlock(&mutex);
+            return params;
         }
     }
     VLOG_ERR_RL(&rl, "no Diffie-Hellman parameters for key length %d",
@@ -998,7 +1100,14 @@ tmp_dh_callback(SSL *ssl OVS_UNUSED, int is_export OVS_UNUSED, int keylength)
 bool
 stream_ssl_is_configured(void)
 {
-    return private_key.file_name || certificate.file_name || ca_cert.file_name;
+    bool configured;
+
+    xpthread_rwlock_rdlock(&ssl_config_rwlock);
+    configured = (private_key.file_name || certificate.file_name
+                  || ca_cert.file_name);
+    xpthread_rwlock_unlock(&ssl_config_rwlock);
+
+    return configured;
 }
 
 static bool
@@ -1048,9 +1157,11 @@ stream_ssl_set_private_key_file__(const char *file_name)
 void
 stream_ssl_set_private_key_file(const char *file_name)
 {
+    xpthread_rwlock_wrlock(&ssl_config_rwlock);
     if (update_ssl_config(&private_key, file_name)) {
         stream_ssl_set_private_key_file__(file_name);
     }
+    xpthread_rwlock_unlock(&ssl_config_rwlock);
 }
 
 static void
@@ -1067,9 +1178,11 @@ stream_ssl_set_certificate_file__(const char *file_name)
 void
 stream_ssl_set_certificate_file(const char *file_name)
 {
+    xpthread_rwlock_wrlock(&ssl_config_rwlock);
     if (update_ssl_config(&certificate, file_name)) {
         stream_ssl_set_certificate_file__(file_name);
     }
+    xpthread_rwlock_unlock(&ssl_config_rwlock);
 }
 
 /* Sets the private key and certificate files in one operation.  Use this
@@ -1098,11 +1211,13 @@ void
 stream_ssl_set_key_and_cert(const char *private_key_file,
                             const char *certificate_file)
 {
+    xpthread_rwlock_wrlock(&ssl_config_rwlock);
     if (update_ssl_config(&private_key, private_key_file)
         || update_ssl_config(&certificate, certificate_file)) {
         stream_ssl_set_certificate_file__(certificate_file);
         stream_ssl_set_private_key_file__(private_key_file);
     }
+    xpthread_rwlock_unlock(&ssl_config_rwlock);
 }
 
 /* Reads the X509 certificate or certificates in file 'file_name'.  On success,
@@ -1184,12 +1299,14 @@ stream_ssl_set_peer_ca_cert_file(const char *file_name)
     }
 
     if (!read_cert_file(file_name, &certs, &n_certs)) {
+        xpthread_rwlock_wrlock(&ssl_config_rwlock);
         for (i = 0; i < n_certs; i++) {
             if (SSL_CTX_add_extra_chain_cert(ctx, certs[i]) != 1) {
                 VLOG_ERR("SSL_CTX_add_extra_chain_cert: %s",
                          ERR_error_string(ERR_get_error(), NULL));
             }
         }
+        xpthread_rwlock_unlock(&ssl_config_rwlock);
         free(certs);
     }
 }
@@ -1222,6 +1339,7 @@ log_ca_cert(const char *file_name, X509 *cert)
     ds_destroy(&fp);
 }
 
+/* The caller must hold 'ssl_config_rwlock' for writing. */
 static void
 stream_ssl_set_ca_cert_file__(const char *file_name,
                               bool bootstrap, bool force)
@@ -1279,7 +1397,9 @@ stream_ssl_set_ca_cert_file__(const char *file_name,
 void
 stream_ssl_set_ca_cert_file(const char *file_name, bool bootstrap)
 {
+    xpthread_rwlock_wrlock(&ssl_config_rwlock);
     stream_ssl_set_ca_cert_file__(file_name, bootstrap, false);
+    xpthread_rwlock_unlock(&ssl_config_rwlock);
 }
 
 /* SSL protocol logging. */
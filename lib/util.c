@@ -125,6 +125,44 @@ xmemdup(const void *p_, size_t size)
     return p;
 }
 
+/* Allocates and returns 'size' bytes of memory aligned on a cache line
+ * boundary, so that the block does not share a cache line with other data.
+ * The memory must be freed with free_cacheline(), not free().
+ *
+ * The pointer returned by malloc() is stored just before the aligned block so
+ * that free_cacheline() can recover it. */
+void *
+xmalloc_cacheline(size_t size)
+{
+    void **payload;
+    void *base;
+
+    base = xmalloc(CACHE_LINE_SIZE + sizeof(void *) + size);
+    payload = (void **) ROUND_UP((uintptr_t) base + sizeof(void *),
+                                 CACHE_LINE_SIZE);
+    payload[-1] = base;
+    return payload;
+}
+
+/* Like xmalloc_cacheline() but clears the allocated memory. */
+void *
+xzalloc_cacheline(size_t size)
+{
+    void *p = xmalloc_cacheline(size);
+    memset(p, 0, size);
+    return p;
+}
+
+/* Frees a memory block allocated with xmalloc_cacheline() or
+ * xzalloc_cacheline(). */
+void
+free_cacheline(void *p)
+{
+    if (p) {
+        free(((void **) p)[-1]);
+    }
+}
+
 char *
 xmemdup0(const char *p_, size_t length)
 {
@@ -46,6 +46,8 @@
 #include "vlog.h"
 
 COVERAGE_DEFINE(xlate_actions);
+COVERAGE_DEFINE(xlate_cache_hit);
+COVERAGE_DEFINE(xlate_cache_miss);
 
 VLOG_DEFINE_THIS_MODULE(ofproto_dpif_xlate);
 
@@ -53,6 +55,11 @@ VLOG_DEFINE_THIS_MODULE(ofproto_dpif_xlate);
  * flow translation. */
 #define MAX_RESUBMIT_RECURSION 64
 
+/* Maximum number of translations in a bridge's translation cache, and maximum
+ * number of rules that a cached translation may resubmit to. */
+#define XLATE_CACHE_MAX_ENTRIES 65536
+#define XLATE_CACHE_MAX_RULES 8
+
 struct xbridge {
     struct hmap_node hmap_node;   /* Node in global 'xbridges' map. */
     struct ofproto_dpif *ofproto; /* Key in global 'xbridges' map. */
@@ -71,6 +78,9 @@ struct xbridge {
     bool has_netflow;             /* Bridge runs netflow? */
     bool has_in_band;             /* Bridge has in band control? */
     bool forward_bpdu;            /* Bridge forwards STP BPDUs? */
+
+    struct hmap xcache;           /* Contains "struct xcache_actions"s. */
+    size_t n_xcache;              /* Number of cached translations. */
 };
 
 struct xbundle {
@@ -154,6 +164,12 @@ struct xlate_ctx {
     odp_port_t sflow_odp_port;  /* Output port for composing sFlow action. */
     uint16_t user_cookie_offset;/* Used for user_action_cookie fixup. */
     bool exit;                  /* No further actions should be processed. */
+
+    /* Translation cache.  'cacheable' becomes false if translation does
+     * something that a cached translation could not repeat. */
+    bool cacheable;
+    struct rule_dpif *resubmit_rules[XLATE_CACHE_MAX_RULES];
+    size_t n_resubmit_rules;
 };
 
 /* A controller may use OFPP_NONE as the ingress port to indicate that
@@ -184,6 +200,7 @@ static void compose_output_action(struct xlate_ctx *, ofp_port_t ofp_port);
 static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
 
 static struct xbridge *xbridge_lookup(const struct ofproto_dpif *);
+static void xlate_cache_flush__(struct xbridge *);
 static struct xbundle *xbundle_lookup(const struct ofbundle *);
 static struct xport *xport_lookup(struct ofport_dpif *);
 static struct xport *get_ofp_port(const struct xbridge *, ofp_port_t ofp_port);
@@ -205,6 +222,7 @@ xlate_ofproto_set(struct ofproto_dpif *ofproto, const char *name,
         hmap_insert(&xbridges, &xbridge->hmap_node, hash_pointer(ofproto, 0));
         hmap_init(&xbridge->xports);
         list_init(&xbridge->xbundles);
+        hmap_init(&xbridge->xcache);
     }
 
     if (xbridge->ml != ml) {
@@ -256,6 +274,9 @@ xlate_remove_ofproto(struct ofproto_dpif *ofproto)
         xlate_bundle_remove(xbundle->ofbundle);
     }
 
+    xlate_cache_flush__(xbridge);
+    hmap_destroy(&xbridge->xcache);
+
     hmap_remove(&xbridges, &xbridge->hmap_node);
     free(xbridge->name);
     free(xbridge);
@@ -1288,6 +1309,7 @@ compose_output_action__(struct xlate_ctx *ctx, ofp_port_t ofp_port,
             netdev_vport_inc_tx(xport->netdev, ctx->xin->resubmit_stats);
             netdev_vport_inc_rx(peer->netdev, ctx->xin->resubmit_stats);
         }
+        ctx->cacheable = false;
 
         return;
     }
@@ -1321,6 +1343,7 @@ compose_output_action__(struct xlate_ctx *ctx, ofp_port_t ofp_port,
         if (ctx->xin->resubmit_stats) {
             netdev_vport_inc_tx(xport->netdev, ctx->xin->resubmit_stats);
         }
+        ctx->cacheable = false;
         out_port = odp_port;
         commit_odp_tunnel_action(flow, &ctx->base_flow,
                                  &ctx->xout->odp_actions);
@@ -1388,6 +1411,13 @@ ctx_rule_hooks(struct xlate_ctx *ctx, struct rule_dpif *rule,
     if (rule && ctx->xin->resubmit_stats) {
         rule_credit_stats(rule, ctx->xin->resubmit_stats);
     }
+    if (rule && ctx->cacheable) {
+        if (ctx->n_resubmit_rules < XLATE_CACHE_MAX_RULES) {
+            ctx->resubmit_rules[ctx->n_resubmit_rules++] = rule;
+        } else {
+            ctx->cacheable = false;
+        }
+    }
     return rule;
 }
 
@@ -2180,6 +2210,7 @@ xlate_in_init(struct xlate_in *xin, struct ofproto_dpif *ofproto,
     xin->resubmit_hook = NULL;
     xin->report_hook = NULL;
     xin->resubmit_stats = NULL;
+    xin->use_cache = false;
 }
 
 void
@@ -2227,6 +2258,170 @@ xlate_out_copy(struct xlate_out *dst, const struct xlate_out *src)
                src->odp_actions.size);
 }
 
+/* Translation cache.
+ *
+ * Many flow misses reach rules whose translation depends only on a few
+ * fields of the flow, e.g. "in_port" and "dl_dst", and many rules have
+ * identical actions, which ofproto shares among them.  The translation cache
+ * remembers the xlate_out of each translation that had no side effects,
+ * indexed first by the address of the actions that it translated and then by
+ * the input flow, masked with the wildcards that translation produced.  A
+ * later flow miss that reaches the same actions with a flow that agrees on
+ * those fields reuses the cached translation instead of interpreting the
+ * actions again.
+ *
+ * The cache holds pointers to actions and rules without owning them, so it
+ * is valid only as long as the flow table and the switch configuration do not
+ * change.  The client must call xlate_cache_flush() whenever it revalidates
+ * its facets and must not set 'use_cache' in struct xlate_in while
+ * revalidation is pending. */
+
+/* Translations cached for a single sequence of actions. */
+struct xcache_actions {
+    struct hmap_node hmap_node;   /* In struct xbridge's 'xcache'. */
+    const struct ofpact *ofpacts; /* The translated actions. */
+    struct classifier cls;        /* Contains "struct xcache_entry"s. */
+};
+
+/* A cached translation. */
+struct xcache_entry {
+    struct cls_rule cr;         /* In struct xcache_actions's 'cls'. */
+    struct xlate_out xout;      /* The translation. */
+
+    /* Rules reached through resubmits, to credit with statistics. */
+    struct rule_dpif *rules[XLATE_CACHE_MAX_RULES];
+    size_t n_rules;
+};
+
+static void
+xcache_entry_destroy(struct xcache_entry *entry)
+{
+    cls_rule_destroy(&entry->cr);
+    xlate_out_uninit(&entry->xout);
+    free(entry);
+}
+
+static void
+xlate_cache_flush__(struct xbridge *xbridge)
+{
+    struct xcache_actions *xa, *next_xa;
+
+    HMAP_FOR_EACH_SAFE (xa, next_xa, hmap_node, &xbridge->xcache) {
+        struct xcache_entry *entry, *next_entry;
+        struct cls_cursor cursor;
+
+        cls_cursor_init(&cursor, &xa->cls, NULL);
+        CLS_CURSOR_FOR_EACH_SAFE (entry, next_entry, cr, &cursor) {
+            classifier_remove(&xa->cls, &entry->cr);
+            xcache_entry_destroy(entry);
+        }
+        classifier_destroy(&xa->cls);
+        hmap_remove(&xbridge->xcache, &xa->hmap_node);
+        free(xa);
+    }
+    xbridge->n_xcache = 0;
+}
+
+/* Discards all of the translations cached for 'ofproto'. */
+void
+xlate_cache_flush(struct ofproto_dpif *ofproto)
+{
+    struct xbridge *xbridge = xbridge_lookup(ofproto);
+
+    if (xbridge) {
+        xlate_cache_flush__(xbridge);
+    }
+}
+
+/* Looks up a cached translation of 'ofpacts' for 'ctx''s flow.  If there is
+ * one, copies it into 'ctx''s xlate_out, credits statistics to the rules that
+ * it resubmitted to, and returns true.  Otherwise, returns false. */
+static bool
+xlate_cache_lookup(struct xlate_ctx *ctx, struct xbridge *xbridge,
+                   const struct ofpact *ofpacts)
+{
+    struct xcache_actions *xa;
+
+    HMAP_FOR_EACH_IN_BUCKET (xa, hmap_node, hash_pointer(ofpacts, 0),
+                             &xbridge->xcache) {
+        if (xa->ofpacts == ofpacts) {
+            const struct xcache_entry *entry;
+            struct xlate_out *xout = ctx->xout;
+            struct cls_rule *cr;
+            size_t i;
+
+            cr = classifier_lookup(&xa->cls, &ctx->xin->flow, NULL);
+            if (!cr) {
+                break;
+            }
+            entry = CONTAINER_OF(cr, struct xcache_entry, cr);
+
+            xout->wc = entry->xout.wc;
+            xout->tags = entry->xout.tags;
+            xout->nf_output_iface = entry->xout.nf_output_iface;
+            xout->mirrors = entry->xout.mirrors;
+            ofpbuf_put(&xout->odp_actions, entry->xout.odp_actions.data,
+                       entry->xout.odp_actions.size);
+
+            if (ctx->xin->resubmit_stats) {
+                for (i = 0; i < entry->n_rules; i++) {
+                    rule_credit_stats(entry->rules[i],
+                                      ctx->xin->resubmit_stats);
+                }
+            }
+
+            COVERAGE_INC(xlate_cache_hit);
+            return true;
+        }
+    }
+    COVERAGE_INC(xlate_cache_miss);
+    return false;
+}
+
+/* Adds the translation in 'ctx' of 'ofpacts' for 'flow', the flow before
+ * translation, to 'xbridge''s translation cache. */
+static void
+xlate_cache_insert(const struct xlate_ctx *ctx, struct xbridge *xbridge,
+                   const struct ofpact *ofpacts, const struct flow *flow)
+{
+    uint32_t hash = hash_pointer(ofpacts, 0);
+    struct xcache_entry *entry;
+    struct xcache_actions *xa;
+    struct cls_rule *displaced;
+    struct match match;
+
+    if (xbridge->n_xcache >= XLATE_CACHE_MAX_ENTRIES) {
+        xlate_cache_flush__(xbridge);
+    }
+
+    HMAP_FOR_EACH_IN_BUCKET (xa, hmap_node, hash, &xbridge->xcache) {
+        if (xa->ofpacts == ofpacts) {
+            goto found;
+        }
+    }
+    xa = xmalloc(sizeof *xa);
+    xa->ofpacts = ofpacts;
+    classifier_init(&xa->cls);
+    hmap_insert(&xbridge->xcache, &xa->hmap_node, hash);
+
+found:
+    entry = xmalloc(sizeof *entry);
+    match_init(&match, flow, &ctx->xout->wc);
+    cls_rule_init(&entry->cr, &match, 0);
+    xlate_out_copy(&entry->xout, ctx->xout);
+    memcpy(entry->rules, ctx->resubmit_rules,
+           ctx->n_resubmit_rules * sizeof *entry->rules);
+    entry->n_rules = ctx->n_resubmit_rules;
+
+    displaced = classifier_replace(&xa->cls, &entry->cr);
+    if (displaced) {
+        xcache_entry_destroy(CONTAINER_OF(displaced, struct xcache_entry,
+                                          cr));
+    } else {
+        xbridge->n_xcache++;
+    }
+}
+
 static bool
 actions_output_to_local_port(const struct xlate_ctx *ctx)
 {
@@ -2259,8 +2454,10 @@ xlate_actions(struct xlate_in *xin, struct xlate_out *xout)
 
     enum slow_path_reason special;
     const struct ofpact *ofpacts;
+    struct xbridge *xbridge;
     struct xport *in_port;
     struct flow orig_flow;
+    struct flow cache_flow;
     struct xlate_ctx ctx;
     size_t ofpacts_len;
 
@@ -2300,10 +2497,11 @@ xlate_actions(struct xlate_in *xin, struct xlate_out *xout)
                     sizeof ctx.xout->odp_actions_stub);
     ofpbuf_reserve(&ctx.xout->odp_actions, NL_A_U32_SIZE);
 
-    ctx.xbridge = xbridge_lookup(xin->ofproto);
-    if (!ctx.xbridge) {
+    xbridge = xbridge_lookup(xin->ofproto);
+    if (!xbridge) {
         return;
     }
+    ctx.xbridge = xbridge;
 
     ctx.rule = xin->rule;
 
@@ -2340,6 +2538,16 @@ xlate_actions(struct xlate_in *xin, struct xlate_out *xout)
         NOT_REACHED();
     }
 
+    ctx.cacheable = (xin->use_cache && !xin->ofpacts
+                     && !xin->resubmit_hook && !xin->report_hook);
+    ctx.n_resubmit_rules = 0;
+    if (ctx.cacheable) {
+        if (xlate_cache_lookup(&ctx, xbridge, ofpacts)) {
+            return;
+        }
+        cache_flow = *flow;
+    }
+
     ofpbuf_use_stub(&ctx.stack, ctx.init_stack, sizeof ctx.init_stack);
 
     if (mbridge_has_mirrors(ctx.xbridge->mbridge) || hit_resubmit_limit) {
@@ -2435,4 +2643,10 @@ xlate_actions(struct xlate_in *xin, struct xlate_out *xout)
      * use non-header fields as part of the cache. */
     memset(&wc->masks.metadata, 0, sizeof wc->masks.metadata);
     memset(&wc->masks.regs, 0, sizeof wc->masks.regs);
+
+    if (ctx.cacheable && !ctx.max_resubmit_trigger && !ctx.xout->slow
+        && !ctx.xout->has_learn && !ctx.xout->has_normal
+        && !ctx.xout->has_fin_timeout) {
+        xlate_cache_insert(&ctx, xbridge, ofpacts, &cache_flow);
+    }
 }
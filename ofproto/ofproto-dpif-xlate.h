@@ -109,6 +109,16 @@ struct xlate_in {
      * This is normally null so the client has to set it manually after
      * calling xlate_in_init(). */
     const struct dpif_flow_stats *resubmit_stats;
+
+    /* If true, xlate_actions() may reuse a cached translation of 'rule''s
+     * actions instead of translating them, and it may cache this
+     * translation, if it has no side effects.  In return, the caller must not
+     * use 'flow' after translation and must ensure that the cache is fresh,
+     * as described in ofproto-dpif-xlate.c.
+     *
+     * This is normally false so the client has to set it manually after
+     * calling xlate_in_init(). */
+    bool use_cache;
 };
 
 void xlate_ofproto_set(struct ofproto_dpif *, const char *name,
@@ -141,4 +151,6 @@ void xlate_out_uninit(struct xlate_out *);
 void xlate_actions_for_side_effects(struct xlate_in *);
 void xlate_out_copy(struct xlate_out *dst, const struct xlate_out *src);
 
+void xlate_cache_flush(struct ofproto_dpif *);
+
 #endif /* ofproto-dpif-xlate.h */
@@ -463,6 +463,8 @@ struct dpif_backer {
 static struct shash all_dpif_backers = SHASH_INITIALIZER(&all_dpif_backers);
 
 static void drop_key_clear(struct dpif_backer *);
+static bool backer_may_use_xlate_cache(const struct dpif_backer *);
+static void backer_flush_xlate_cache(struct dpif_backer *);
 static struct ofport_dpif *
 odp_port_to_ofport(const struct dpif_backer *, odp_port_t odp_port);
 static void update_moving_averages(struct dpif_backer *backer);
@@ -769,6 +771,13 @@ type_run(const char *type)
             drop_key_clear(backer);
         }
 
+        /* Discard translations cached under the old configuration.  Do this
+         * before clearing the revalidation flags, which allows misses to use
+         * the cache again, and again after revalidating, because
+         * run_fast_rl() may handle misses, and cache their translations,
+         * before every bridge is reconfigured. */
+        backer_flush_xlate_cache(backer);
+
         /* Clear the revalidation flags. */
         tag_set_init(&backer->revalidate_set);
         backer->need_revalidate = 0;
@@ -820,6 +829,7 @@ type_run(const char *type)
                 }
             }
         }
+        backer_flush_xlate_cache(backer);
     }
 
     if (!backer->recv_set_enable) {
@@ -1520,9 +1530,18 @@ static void
 get_memory_usage(const struct ofproto *ofproto_, struct simap *usage)
 {
     const struct ofproto_dpif *ofproto = ofproto_dpif_cast(ofproto_);
+    const struct oftable *table;
     struct cls_cursor cursor;
     size_t n_subfacets = 0;
     struct facet *facet;
+    size_t n_rules = 0;
+
+    OFPROTO_FOR_EACH_TABLE (table, &ofproto->up) {
+        n_rules += classifier_count(&table->cls);
+    }
+    simap_increase(usage, "rule-kB",
+                   DIV_ROUND_UP(n_rules * (sizeof(struct rule_dpif)
+                                           - sizeof(struct rule)), 1024));
 
     simap_increase(usage, "facets", classifier_count(&ofproto->facets));
 
@@ -2266,10 +2285,11 @@ bundle_flush_macs(struct ofbundle *bundle, bool all_ofprotos)
 {
     struct ofproto_dpif *ofproto = bundle->ofproto;
     struct mac_learning *ml = ofproto->ml;
-    struct mac_entry *mac, *next_mac;
+    struct cmap_cursor cursor;
+    struct mac_entry *mac;
 
     ofproto->backer->need_revalidate = REV_RECONFIGURE;
-    LIST_FOR_EACH_SAFE (mac, next_mac, lru_node, &ml->lrus) {
+    MAC_LEARNING_FOR_EACH (mac, &cursor, ml) {
         if (mac->port.p == bundle) {
             if (all_ofprotos) {
                 struct ofproto_dpif *o;
@@ -2630,10 +2650,11 @@ bundle_send_learning_packets(struct ofbundle *bundle)
 {
     struct ofproto_dpif *ofproto = bundle->ofproto;
     int error, n_packets, n_errors;
+    struct cmap_cursor cursor;
     struct mac_entry *e;
 
     error = n_packets = n_errors = 0;
-    LIST_FOR_EACH (e, lru_node, &ofproto->ml->lrus) {
+    MAC_LEARNING_FOR_EACH (e, &cursor, ofproto->ml) {
         if (e->port.p != bundle) {
             struct ofpbuf *learning_packet;
             struct ofport_dpif *port;
@@ -3513,6 +3534,7 @@ handle_flow_miss(struct flow_miss *miss, struct flow_miss_op *ops,
                       NULL);
         xin.resubmit_stats = stats;
         xin.may_learn = true;
+        xin.use_cache = backer_may_use_xlate_cache(ofproto->backer);
         xlate_actions(&xin, &xout);
         flow_wildcards_or(&xout.wc, &xout.wc, &wc);
 
@@ -3549,6 +3571,28 @@ drop_key_lookup(const struct dpif_backer *backer, const struct nlattr *key,
     return NULL;
 }
 
+/* Returns true if flow misses on 'backer' may use the translation cache,
+ * false if pending revalidation may have made it stale. */
+static bool
+backer_may_use_xlate_cache(const struct dpif_backer *backer)
+{
+    return (!backer->need_revalidate
+            && tag_set_is_empty(&backer->revalidate_set));
+}
+
+/* Discards the translations cached for each bridge that uses 'backer'. */
+static void
+backer_flush_xlate_cache(struct dpif_backer *backer)
+{
+    struct ofproto_dpif *ofproto;
+
+    HMAP_FOR_EACH (ofproto, all_ofproto_dpifs_node, &all_ofproto_dpifs) {
+        if (ofproto->backer == backer) {
+            xlate_cache_flush(ofproto);
+        }
+    }
+}
+
 static void
 drop_key_clear(struct dpif_backer *backer)
 {
@@ -5691,13 +5735,32 @@ ofbundle_get_a_port(const struct ofbundle *bundle)
                         bundle_node);
 }
 
+/* qsort() comparison function for sorting MAC entries from least to most
+ * recently used. */
+static int
+compare_mac_entries_by_use(const void *a_, const void *b_)
+{
+    const struct mac_entry *const *ap = a_;
+    const struct mac_entry *const *bp = b_;
+    const struct mac_entry *a = *ap;
+    const struct mac_entry *b = *bp;
+
+    return (a->expires != b->expires
+            ? (a->expires < b->expires ? -1 : 1)
+            : a->seqno < b->seqno ? -1 : a->seqno > b->seqno);
+}
+
 static void
 ofproto_unixctl_fdb_show(struct unixctl_conn *conn, int argc OVS_UNUSED,
                          const char *argv[], void *aux OVS_UNUSED)
 {
     struct ds ds = DS_EMPTY_INITIALIZER;
     const struct ofproto_dpif *ofproto;
-    const struct mac_entry *e;
+    struct mac_entry **entries;
+    size_t n_entries, allocated_entries;
+    struct cmap_cursor cursor;
+    struct mac_entry *e;
+    size_t i;
 
     ofproto = ofproto_dpif_lookup(argv[1]);
     if (!ofproto) {
@@ -5705,17 +5768,32 @@ ofproto_unixctl_fdb_show(struct unixctl_conn *conn, int argc OVS_UNUSED,
         return;
     }
 
+    /* The MAC learning table does not keep its entries in LRU order, so sort
+     * them to present the oldest first. */
+    entries = NULL;
+    n_entries = allocated_entries = 0;
+    MAC_LEARNING_FOR_EACH (e, &cursor, ofproto->ml) {
+        if (n_entries >= allocated_entries) {
+            entries = x2nrealloc(entries, &allocated_entries, sizeof *entries);
+        }
+        entries[n_entries++] = e;
+    }
+    qsort(entries, n_entries, sizeof *entries, compare_mac_entries_by_use);
+
     ds_put_cstr(&ds, " port  VLAN  MAC                Age\n");
-    LIST_FOR_EACH (e, lru_node, &ofproto->ml->lrus) {
-        struct ofbundle *bundle = e->port.p;
+    for (i = 0; i < n_entries; i++) {
+        struct ofbundle *bundle = entries[i]->port.p;
         char name[OFP_MAX_PORT_NAME_LEN];
 
+        e = entries[i];
+
         ofputil_port_to_string(ofbundle_get_a_port(bundle)->up.ofp_port,
                                name, sizeof name);
         ds_put_format(&ds, "%5s  %4d  "ETH_ADDR_FMT"  %3d\n",
                       name, e->vlan, ETH_ADDR_ARGS(e->mac),
                       mac_entry_age(ofproto->ml, e));
     }
+    free(entries);
     unixctl_command_reply(conn, ds_cstr(&ds));
     ds_destroy(&ds);
 }
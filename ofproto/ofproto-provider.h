@@ -72,6 +72,7 @@ struct ofproto {
     int n_tables;
 
     struct hindex cookies;      /* Rules indexed on their cookie values. */
+    struct hmap rule_actions;   /* Actions shared among rules, see ofproto.c. */
 
     /* Optimisation for flow expiry.
      * These flows should all be present in tables. */
@@ -223,20 +224,23 @@ struct rule {
     uint16_t idle_timeout;       /* In seconds from ->used. */
     uint8_t table_id;            /* Index in ofproto's 'tables' array. */
     bool send_flow_removed;      /* Send a flow removed message? */
+    bool evictable;              /* If false, prevents eviction. */
+    uint8_t monitor_flags;       /* Bitmap of "enum nx_flow_monitor_flags". */
 
     /* Eviction groups. */
-    bool evictable;              /* If false, prevents eviction. */
     struct heap_node evg_node;   /* In eviction_group's "rules" heap. */
     struct eviction_group *eviction_group; /* NULL if not in any group. */
 
-    struct ofpact *ofpacts;      /* Sequence of "struct ofpacts". */
+    /* Sequence of "struct ofpacts".  Rules in the same ofproto that have
+     * identical actions share a single read-only copy of them, so
+     * implementations must not modify 'ofpacts' in place. */
+    struct ofpact *ofpacts;
     unsigned int ofpacts_len;    /* Size of 'ofpacts', in bytes. */
 
     uint32_t meter_id;           /* Non-zero OF meter_id, or zero. */
     struct list meter_list_node; /* In owning meter's 'rules' list. */
 
     /* Flow monitors. */
-    enum nx_flow_monitor_flags monitor_flags;
     uint64_t add_seqno;         /* Sequence number when added. */
     uint64_t modify_seqno;      /* Sequence number when changed. */
 
@@ -21,6 +21,8 @@
 #include <inttypes.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "bitmap.h"
 #include "byte-order.h"
 #include "classifier.h"
@@ -48,6 +50,7 @@
 #include "random.h"
 #include "shash.h"
 #include "simap.h"
+#include "socket-util.h"
 #include "sset.h"
 #include "timeval.h"
 #include "unaligned.h"
@@ -190,6 +193,25 @@ static void update_port(struct ofproto *, const char *devname);
 static int init_ports(struct ofproto *);
 static void reinit_ports(struct ofproto *);
 
+/* Shared rule actions.
+ *
+ * Large flow tables often contain many rules with identical actions, e.g.
+ * "output:1" or "resubmit(,1)", so instead of giving each rule a private copy,
+ * an ofproto keeps one reference-counted copy of each distinct sequence of
+ * actions in its 'rule_actions' hmap and points each rule's 'ofpacts' into
+ * the copy.  The copies are read-only. */
+struct rule_actions {
+    struct hmap_node hmap_node; /* In struct ofproto's 'rule_actions'. */
+    unsigned int n_refs;        /* Number of rules or operations using it. */
+    unsigned int ofpacts_len;   /* Size of 'ofpacts', in bytes. */
+    uint64_t ofpacts[];         /* "struct ofpact"s, suitably aligned. */
+};
+
+static struct ofpact *rule_actions_ref(struct ofproto *,
+                                       const struct ofpact *,
+                                       size_t ofpacts_len);
+static void rule_actions_unref(struct ofproto *, const struct ofpact *);
+
 /* rule. */
 static void ofproto_rule_destroy__(struct rule *);
 static void ofproto_rule_send_removed(struct rule *, uint8_t reason);
@@ -429,6 +451,7 @@ ofproto_create(const char *datapath_name, const char *datapath_type,
     ofproto->tables = NULL;
     ofproto->n_tables = 0;
     hindex_init(&ofproto->cookies);
+    hmap_init(&ofproto->rule_actions);
     list_init(&ofproto->expirable);
     ofproto->connmgr = connmgr_create(ofproto, datapath_name, datapath_name);
     ofproto->state = S_OPENFLOW;
@@ -1113,6 +1136,9 @@ ofproto_destroy__(struct ofproto *ofproto)
 
     hmap_destroy(&ofproto->deletions);
 
+    ovs_assert(hmap_is_empty(&ofproto->rule_actions));
+    hmap_destroy(&ofproto->rule_actions);
+
     free(ofproto->vlan_bitmap);
 
     ofproto->ofproto_class->dealloc(ofproto);
@@ -1376,18 +1402,37 @@ ofproto_is_alive(const struct ofproto *p)
 void
 ofproto_get_memory_usage(const struct ofproto *ofproto, struct simap *usage)
 {
+    const struct rule_actions *actions;
     const struct oftable *table;
     unsigned int n_rules;
+    size_t rule_bytes;
 
     simap_increase(usage, "ports", hmap_count(&ofproto->ports));
     simap_increase(usage, "ops",
                    ofproto->n_pending + hmap_count(&ofproto->deletions));
 
+    /* The implementation adds the size of its own per-rule data, beyond
+     * "struct rule", to "rule-kB". */
     n_rules = 0;
+    rule_bytes = 0;
     OFPROTO_FOR_EACH_TABLE (table, ofproto) {
-        n_rules += classifier_count(&table->cls);
+        struct cls_cursor cursor;
+        struct rule *rule;
+
+        cls_cursor_init(&cursor, &table->cls, NULL);
+        CLS_CURSOR_FOR_EACH (rule, cr, &cursor) {
+            rule_bytes += (sizeof *rule
+                           + miniflow_heap_size(&rule->cr.match.flow)
+                           + miniflow_heap_size(&rule->cr.match.mask.masks));
+            n_rules++;
+        }
+    }
+    HMAP_FOR_EACH (actions, hmap_node, &ofproto->rule_actions) {
+        rule_bytes += sizeof *actions + actions->ofpacts_len;
     }
     simap_increase(usage, "rules", n_rules);
+    simap_increase(usage, "rule-actions", hmap_count(&ofproto->rule_actions));
+    simap_increase(usage, "rule-kB", DIV_ROUND_UP(rule_bytes, 1024));
 
     if (ofproto->ofproto_class->get_memory_usage) {
         ofproto->ofproto_class->get_memory_usage(ofproto, usage);
@@ -1836,6 +1881,7 @@ ofport_install(struct ofproto *p,
     ofport->pp = *pp;
     ofport->ofp_port = pp->port_no;
     ofport->created = time_msec();
+    ofport->mtu = 0;
 
     /* Add port to 'p'. */
     hmap_insert(&p->ports, &ofport->hmap_node,
@@ -2140,7 +2186,12 @@ update_mtu(struct ofproto *p, struct ofport *port)
         return;
     }
 
-    /* For non-internal port find new min mtu. */
+    /* For non-internal port find new min mtu.  update_port() calls this for
+     * every port whenever the datapath's set of ports changes, so don't scan
+     * all of the ports unless this one's MTU actually changed. */
+    if (dev_mtu == port->mtu) {
+        return;
+    }
     old_min = p->min_mtu;
     port->mtu = dev_mtu;
     p->min_mtu = find_min_mtu(p);
@@ -2159,12 +2210,63 @@ update_mtu(struct ofproto *p, struct ofport *port)
     }
 }
 
+static struct rule_actions *
+rule_actions_cast(const struct ofpact *ofpacts)
+{
+    return CONTAINER_OF((const uint64_t *) ofpacts, struct rule_actions,
+                        ofpacts);
+}
+
+/* Returns a shared copy of the 'ofpacts_len' bytes of actions in 'ofpacts',
+ * creating it if 'ofproto' does not already have one.  The caller must
+ * eventually release the copy with rule_actions_unref(). */
+static struct ofpact *
+rule_actions_ref(struct ofproto *ofproto,
+                 const struct ofpact *ofpacts, size_t ofpacts_len)
+{
+    uint32_t hash = hash_bytes(ofpacts, ofpacts_len, 0);
+    struct rule_actions *actions;
+
+    HMAP_FOR_EACH_WITH_HASH (actions, hmap_node, hash,
+                             &ofproto->rule_actions) {
+        if (ofpacts_equal(ofpacts, ofpacts_len,
+                          (const struct ofpact *) actions->ofpacts,
+                          actions->ofpacts_len)) {
+            actions->n_refs++;
+            return (struct ofpact *) actions->ofpacts;
+        }
+    }
+
+    actions = xmalloc(sizeof *actions + ofpacts_len);
+    actions->n_refs = 1;
+    actions->ofpacts_len = ofpacts_len;
+    memcpy(actions->ofpacts, ofpacts, ofpacts_len);
+    hmap_insert(&ofproto->rule_actions, &actions->hmap_node, hash);
+    return (struct ofpact *) actions->ofpacts;
+}
+
+/* Releases a reference to 'ofpacts', which must have been obtained from
+ * rule_actions_ref() on 'ofproto'.  Does nothing if 'ofpacts' is null. */
+static void
+rule_actions_unref(struct ofproto *ofproto, const struct ofpact *ofpacts)
+{
+    if (ofpacts) {
+        struct rule_actions *actions = rule_actions_cast(ofpacts);
+
+        ovs_assert(actions->n_refs > 0);
+        if (!--actions->n_refs) {
+            hmap_remove(&ofproto->rule_actions, &actions->hmap_node);
+            free(actions);
+        }
+    }
+}
+
 static void
 ofproto_rule_destroy__(struct rule *rule)
 {
     if (rule) {
         cls_rule_destroy(&rule->cr);
-        free(rule->ofpacts);
+        rule_actions_unref(rule->ofproto, rule->ofpacts);
         rule->ofproto->ofproto_class->rule_dealloc(rule);
     }
 }
@@ -3373,7 +3475,7 @@ add_flow(struct ofproto *ofproto, struct ofconn *ofconn,
     rule->send_flow_removed = (fm->flags & OFPFF_SEND_FLOW_REM) != 0;
     /* FIXME: Implement OF 1.3 flags OFPFF13_NO_PKT_COUNTS
        and OFPFF13_NO_BYT_COUNTS */
-    rule->ofpacts = xmemdup(fm->ofpacts, fm->ofpacts_len);
+    rule->ofpacts = rule_actions_ref(ofproto, fm->ofpacts, fm->ofpacts_len);
     rule->ofpacts_len = fm->ofpacts_len;
     rule->meter_id = find_meter(rule->ofpacts, rule->ofpacts_len);
     list_init(&rule->meter_list_node);
@@ -3488,7 +3590,8 @@ modify_flows__(struct ofproto *ofproto, struct ofconn *ofconn,
             op->ofpacts = rule->ofpacts;
             op->ofpacts_len = rule->ofpacts_len;
             op->meter_id = rule->meter_id;
-            rule->ofpacts = xmemdup(fm->ofpacts, fm->ofpacts_len);
+            rule->ofpacts = rule_actions_ref(ofproto, fm->ofpacts,
+                                             fm->ofpacts_len);
             rule->ofpacts_len = fm->ofpacts_len;
             rule->meter_id = find_meter(rule->ofpacts, rule->ofpacts_len);
             rule->ofproto->ofproto_class->rule_modify_actions(rule);
@@ -4841,7 +4944,7 @@ ofopgroup_complete(struct ofopgroup *group)
             } else {
                 ofproto_rule_change_cookie(ofproto, rule, op->flow_cookie);
                 if (op->ofpacts) {
-                    free(rule->ofpacts);
+                    rule_actions_unref(ofproto, rule->ofpacts);
                     rule->ofpacts = op->ofpacts;
                     rule->ofpacts_len = op->ofpacts_len;
                     op->ofpacts = NULL;
@@ -4923,7 +5026,7 @@ ofoperation_destroy(struct ofoperation *op)
         hmap_remove(&group->ofproto->deletions, &op->hmap_node);
     }
     list_remove(&op->group_node);
-    free(op->ofpacts);
+    rule_actions_unref(group->ofproto, op->ofpacts);
     free(op);
 }
 
@@ -5458,6 +5561,482 @@ ofproto_unixctl_list(struct unixctl_conn *conn, int argc OVS_UNUSED,
     ds_destroy(&results);
 }
 
+/* Flow table snapshots.
+ *
+ * "ofproto/save-flows" writes the OpenFlow flows in a switch to a file and
+ * "ofproto/restore-flows" adds them back, e.g. after ovs-vswitchd restarts
+ * with other_config:flow-restore-wait set.  Restoring adds each flow to its
+ * table directly, which is much faster than formatting, parsing, and sending
+ * a flow_mod for every flow through an OpenFlow connection.
+ *
+ * A snapshot consists of a struct snapshot_header followed by 'n_rules'
+ * records.  Each record is a struct snapshot_rule followed by the rule's match
+ * in NXM format and then the rule's "struct ofpact"s, each padded out to a
+ * multiple of 8 bytes.  The ofpacts are stored in their in-memory format,
+ * except that field references are stored as field IDs instead of pointers.
+ * The format may change from one version to the next, so only the version of
+ * Open vSwitch that saved a snapshot may restore it. */
+
+#define SNAPSHOT_MAGIC "OVSFLOW1"
+
+struct snapshot_header {
+    char magic[8];              /* SNAPSHOT_MAGIC. */
+    char version[24];           /* VERSION, null-padded. */
+    ovs_be32 n_rules;           /* Number of records that follow. */
+    uint8_t pad[4];
+};
+BUILD_ASSERT_DECL(sizeof(struct snapshot_header) == 40);
+
+struct snapshot_rule {
+    ovs_be64 cookie;
+    ovs_be16 priority;
+    ovs_be16 idle_timeout;
+    ovs_be16 hard_timeout;
+    ovs_be16 flags;             /* OFPFF_SEND_FLOW_REM or 0. */
+    ovs_be16 match_len;         /* Length of NXM match, excluding padding. */
+    uint8_t table_id;
+    uint8_t pad;
+    ovs_be32 ofpacts_len;       /* Length of ofpacts, excluding padding. */
+};
+BUILD_ASSERT_DECL(sizeof(struct snapshot_rule) == 24);
+
+/* The minimum length of each type of "struct ofpact", indexed by type. */
+static const size_t snapshot_ofpact_min_len[N_OFPACTS] = {
+#define DEFINE_OFPACT(ENUM, STRUCT, MEMBER) OFPACT_##ENUM##_RAW_SIZE,
+    OFPACTS
+#undef DEFINE_OFPACT
+};
+
+/* Converts 'sf' to snapshot form, in which 'sf->field' holds the field's MFF_*
+ * ID plus 1 (or 0 for a null field) instead of a pointer, if 'save' is true,
+ * otherwise converts it back.  Returns false if 'sf' is in snapshot form and
+ * does not refer to a valid field. */
+static bool
+snapshot_convert_subfield(struct mf_subfield *sf, bool save)
+{
+    uintptr_t id;
+
+    if (save) {
+        id = sf->field ? sf->field->id + 1 : 0;
+        sf->field = (const struct mf_field *) id;
+    } else {
+        id = (uintptr_t) sf->field;
+        if (id > MFF_N_IDS) {
+            return false;
+        }
+        sf->field = id ? mf_from_id(id - 1) : NULL;
+    }
+    return true;
+}
+
+/* Converts the field references in 'a' to snapshot form if 'save' is true,
+ * otherwise converts them back.  Field references have to be converted
+ * because a "struct mf_field" need not have the same address in the process
+ * that restores a snapshot as in the one that saved it.
+ *
+ * When 'save' is false, also checks that the variable-length data in 'a' fits
+ * within 'a->len', which must be at least the minimum length for 'a''s type.
+ * Returns false if a check fails, true otherwise. */
+static bool
+snapshot_convert_ofpact(struct ofpact *a, bool save)
+{
+    size_t extra = a->len - snapshot_ofpact_min_len[a->type];
+
+    switch (a->type) {
+    case OFPACT_OUTPUT_REG:
+        return snapshot_convert_subfield(&ofpact_get_OUTPUT_REG(a)->src, save);
+
+    case OFPACT_BUNDLE: {
+        struct ofpact_bundle *bundle = ofpact_get_BUNDLE(a);
+
+        return ((save || bundle->n_slaves <= extra / sizeof *bundle->slaves)
+                && snapshot_convert_subfield(&bundle->dst, save));
+    }
+
+    case OFPACT_REG_MOVE: {
+        struct ofpact_reg_move *move = ofpact_get_REG_MOVE(a);
+
+        return (snapshot_convert_subfield(&move->src, save)
+                && snapshot_convert_subfield(&move->dst, save));
+    }
+
+    case OFPACT_REG_LOAD:
+        return snapshot_convert_subfield(&ofpact_get_REG_LOAD(a)->dst, save);
+
+    case OFPACT_STACK_PUSH:
+    case OFPACT_STACK_POP:
+        return snapshot_convert_subfield(
+            &ofpact_get_STACK_PUSH(a)->subfield, save);
+
+    case OFPACT_DEC_TTL: {
+        struct ofpact_cnt_ids *ids = ofpact_get_DEC_TTL(a);
+
+        return save || ids->n_controllers <= extra / sizeof *ids->cnt_ids;
+    }
+
+    case OFPACT_LEARN: {
+        struct ofpact_learn *learn = ofpact_get_LEARN(a);
+        unsigned int i;
+
+        if (!save && learn->n_specs > extra / sizeof *learn->specs) {
+            return false;
+        }
+        for (i = 0; i < learn->n_specs; i++) {
+            struct ofpact_learn_spec *spec = &learn->specs[i];
+
+            if (!snapshot_convert_subfield(&spec->src, save)
+                || !snapshot_convert_subfield(&spec->dst, save)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    case OFPACT_MULTIPATH:
+        return snapshot_convert_subfield(&ofpact_get_MULTIPATH(a)->dst, save);
+
+    case OFPACT_NOTE:
+        return save || ofpact_get_NOTE(a)->length <= extra;
+
+    case OFPACT_OUTPUT:
+    case OFPACT_CONTROLLER:
+    case OFPACT_ENQUEUE:
+    case OFPACT_SET_VLAN_VID:
+    case OFPACT_SET_VLAN_PCP:
+    case OFPACT_STRIP_VLAN:
+    case OFPACT_PUSH_VLAN:
+    case OFPACT_SET_ETH_SRC:
+    case OFPACT_SET_ETH_DST:
+    case OFPACT_SET_IPV4_SRC:
+    case OFPACT_SET_IPV4_DST:
+    case OFPACT_SET_IPV4_DSCP:
+    case OFPACT_SET_L4_SRC_PORT:
+    case OFPACT_SET_L4_DST_PORT:
+    case OFPACT_SET_MPLS_TTL:
+    case OFPACT_DEC_MPLS_TTL:
+    case OFPACT_PUSH_MPLS:
+    case OFPACT_POP_MPLS:
+    case OFPACT_SET_TUNNEL:
+    case OFPACT_SET_QUEUE:
+    case OFPACT_POP_QUEUE:
+    case OFPACT_FIN_TIMEOUT:
+    case OFPACT_RESUBMIT:
+    case OFPACT_EXIT:
+    case OFPACT_SAMPLE:
+    case OFPACT_METER:
+    case OFPACT_CLEAR_ACTIONS:
+    case OFPACT_WRITE_METADATA:
+    case OFPACT_GOTO_TABLE:
+        return true;
+    }
+
+    return false;
+}
+
+static void
+snapshot_put_rule(struct ofpbuf *buf, const struct rule *rule)
+{
+    struct snapshot_rule *sr;
+    struct ofpact *ofpacts, *a;
+    struct match match;
+    int match_len;
+
+    sr = ofpbuf_put_zeros(buf, sizeof *sr);
+    sr->cookie = rule->flow_cookie;
+    sr->priority = htons(rule->cr.priority);
+    sr->idle_timeout = htons(rule->idle_timeout);
+    sr->hard_timeout = htons(rule->hard_timeout);
+    sr->flags = htons(rule->send_flow_removed ? OFPFF_SEND_FLOW_REM : 0);
+    sr->table_id = rule->table_id;
+    sr->ofpacts_len = htonl(rule->ofpacts_len);
+
+    minimatch_expand(&rule->cr.match, &match);
+    match_len = nx_put_match(buf, &match, htonll(0), htonll(0));
+    sr = buf->data;
+    sr->match_len = htons(match_len);
+
+    ofpacts = ofpbuf_put(buf, rule->ofpacts, rule->ofpacts_len);
+    OFPACT_FOR_EACH (a, ofpacts, rule->ofpacts_len) {
+        snapshot_convert_ofpact(a, true);
+    }
+    ofpbuf_put_zeros(buf, (ROUND_UP(rule->ofpacts_len, OFPACT_ALIGNTO)
+                           - rule->ofpacts_len));
+}
+
+/* Saves the flows in 'ofproto', except hidden ones, to 'file_name',
+ * replacing it atomically if it already exists, and stores the number of
+ * flows saved in '*n_rulesp'.  Returns NULL if successful, otherwise a
+ * malloc()'d error message. */
+static char * WARN_UNUSED_RESULT
+ofproto_save_flows(struct ofproto *ofproto, const char *file_name,
+                   size_t *n_rulesp)
+{
+    struct snapshot_header hdr;
+    struct oftable *table;
+    struct ofpbuf buf;
+    char *tmp_name;
+    size_t n_rules;
+    char *error;
+    FILE *file;
+
+    tmp_name = xasprintf("%s.tmp", file_name);
+    file = fopen(tmp_name, "wb");
+    if (!file) {
+        error = xasprintf("%s: open failed (%s)", tmp_name,
+                          ovs_strerror(errno));
+        free(tmp_name);
+        return error;
+    }
+
+    /* Write a placeholder header, to fill in once we know 'n_rules'. */
+    memset(&hdr, 0, sizeof hdr);
+    memcpy(hdr.magic, SNAPSHOT_MAGIC, sizeof hdr.magic);
+    ovs_strlcpy(hdr.version, VERSION, sizeof hdr.version);
+    fwrite(&hdr, sizeof hdr, 1, file);
+
+    n_rules = 0;
+    ofpbuf_init(&buf, 1024);
+    OFPROTO_FOR_EACH_TABLE (table, ofproto) {
+        struct cls_cursor cursor;
+        struct rule *rule;
+
+        if (table->flags & OFTABLE_HIDDEN) {
+            continue;
+        }
+
+        cls_cursor_init(&cursor, &table->cls, NULL);
+        CLS_CURSOR_FOR_EACH (rule, cr, &cursor) {
+            if (!ofproto_rule_is_hidden(rule)) {
+                ofpbuf_clear(&buf);
+                snapshot_put_rule(&buf, rule);
+                fwrite(buf.data, buf.size, 1, file);
+                n_rules++;
+            }
+        }
+    }
+    ofpbuf_uninit(&buf);
+
+    hdr.n_rules = htonl(n_rules);
+    if (!fseek(file, 0, SEEK_SET)) {
+        fwrite(&hdr, sizeof hdr, 1, file);
+    }
+
+    /* Make sure that the new snapshot is on disk before it replaces the old
+     * one, so that a crash cannot leave a truncated snapshot behind. */
+    if (fflush(file) || ferror(file) || fsync(fileno(file))) {
+        error = xasprintf("%s: write failed (%s)", tmp_name,
+                          ovs_strerror(errno));
+        fclose(file);
+    } else if (fclose(file)) {
+        error = xasprintf("%s: write failed (%s)", tmp_name,
+                          ovs_strerror(errno));
+    } else if (rename(tmp_name, file_name)) {
+        error = xasprintf("%s: rename to %s failed (%s)", tmp_name,
+                          file_name, ovs_strerror(errno));
+    } else {
+        fsync_parent_dir(file_name);
+        *n_rulesp = n_rules;
+        free(tmp_name);
+        return NULL;
+    }
+    unlink(tmp_name);
+    free(tmp_name);
+    return error;
+}
+
+/* Checks that the 'ofpacts_len' bytes of 'ofpacts', read from a snapshot, hold
+ * a well-formed sequence of "struct ofpact"s, each of a known type and long
+ * enough for that type, and converts their field references back from
+ * snapshot form.  Returns true if successful, false if the ofpacts are not
+ * valid. */
+static bool
+snapshot_restore_ofpacts(struct ofpact *ofpacts, size_t ofpacts_len)
+{
+    size_t ofs = 0;
+
+    while (ofs < ofpacts_len) {
+        struct ofpact *a = (struct ofpact *) ((uint8_t *) ofpacts + ofs);
+
+        if (ofpacts_len - ofs < sizeof *a
+            || (unsigned int) a->type >= N_OFPACTS
+            || a->len < snapshot_ofpact_min_len[a->type]
+            || a->len > ofpacts_len - ofs
+            || !snapshot_convert_ofpact(a, false)) {
+            return false;
+        }
+        ofs += ROUND_UP(a->len, OFPACT_ALIGNTO);
+    }
+    return true;
+}
+
+/* Reads the snapshot in 'buf' and adds its flows to 'ofproto', storing the
+ * number of flows added in '*n_rulesp'.  Returns NULL if successful,
+ * otherwise a malloc()'d error message. */
+static char * WARN_UNUSED_RESULT
+snapshot_restore(struct ofproto *ofproto, struct ofpbuf *buf,
+                 size_t *n_rulesp)
+{
+    const struct snapshot_header *hdr;
+    size_t n_rules;
+    size_t i;
+
+    hdr = ofpbuf_try_pull(buf, sizeof *hdr);
+    if (!hdr || memcmp(hdr->magic, SNAPSHOT_MAGIC, sizeof hdr->magic)) {
+        return xstrdup("not a flow snapshot");
+    } else if (strncmp(hdr->version, VERSION, sizeof hdr->version)) {
+        return xasprintf("snapshot saved by Open vSwitch %.*s cannot be "
+                         "restored by version %s",
+                         (int) sizeof hdr->version, hdr->version, VERSION);
+    }
+
+    n_rules = ntohl(hdr->n_rules);
+    for (i = 0; i < n_rules; i++) {
+        const struct snapshot_rule *sr;
+        struct ofputil_flow_mod fm;
+        size_t ofpacts_len;
+        int error;
+
+        memset(&fm, 0, sizeof fm);
+        sr = ofpbuf_try_pull(buf, sizeof *sr);
+        if (!sr) {
+            return xasprintf("flow %zu: snapshot truncated", i);
+        }
+        error = nx_pull_match(buf, ntohs(sr->match_len), &fm.match,
+                              NULL, NULL);
+        if (error) {
+            return xasprintf("flow %zu: bad match (%s)",
+                             i, ofperr_to_string(error));
+        }
+
+        ofpacts_len = ntohl(sr->ofpacts_len);
+        fm.ofpacts = ofpbuf_try_pull(buf, ROUND_UP(ofpacts_len,
+                                                   OFPACT_ALIGNTO));
+        if (!fm.ofpacts) {
+            return xasprintf("flow %zu: snapshot truncated", i);
+        } else if (!snapshot_restore_ofpacts(fm.ofpacts, ofpacts_len)) {
+            return xasprintf("flow %zu: bad actions", i);
+        }
+        fm.ofpacts_len = ofpacts_len;
+
+        fm.priority = ntohs(sr->priority);
+        fm.new_cookie = sr->cookie;
+        fm.table_id = sr->table_id;
+        fm.command = OFPFC_ADD;
+        fm.idle_timeout = ntohs(sr->idle_timeout);
+        fm.hard_timeout = ntohs(sr->hard_timeout);
+        fm.buffer_id = UINT32_MAX;
+        fm.out_port = OFPP_ANY;
+        fm.flags = ntohs(sr->flags);
+
+        error = add_flow(ofproto, NULL, &fm, NULL);
+        if (error) {
+            return xasprintf("flow %zu: %s", i,
+                             (error == OFPROTO_POSTPONE
+                              ? "flow table busy"
+                              : ofperr_to_string(error)));
+        }
+    }
+    if (buf->size) {
+        return xstrdup("extra data at end of snapshot");
+    }
+
+    *n_rulesp = n_rules;
+    return NULL;
+}
+
+/* Adds the flows in the snapshot in 'file_name' to 'ofproto', storing the
+ * number of flows added in '*n_rulesp'.  Returns NULL if successful,
+ * otherwise a malloc()'d error message.  On failure, some of the flows might
+ * have been added. */
+static char * WARN_UNUSED_RESULT
+ofproto_restore_flows(struct ofproto *ofproto, const char *file_name,
+                      size_t *n_rulesp)
+{
+    struct ofpbuf buf;
+    struct stat s;
+    char *error;
+    FILE *file;
+
+    *n_rulesp = 0;
+    file = fopen(file_name, "rb");
+    if (!file) {
+        return xasprintf("%s: open failed (%s)", file_name,
+                         ovs_strerror(errno));
+    }
+
+    ofpbuf_init(&buf, 0);
+    if (fstat(fileno(file), &s)) {
+        error = xasprintf("%s: stat failed (%s)", file_name,
+                          ovs_strerror(errno));
+    } else if (s.st_size
+               && fread(ofpbuf_put_uninit(&buf, s.st_size), s.st_size, 1,
+                        file) != 1) {
+        error = xasprintf("%s: read failed (%s)", file_name,
+                          ferror(file) ? ovs_strerror(errno) : "end of file");
+    } else {
+        error = snapshot_restore(ofproto, &buf, n_rulesp);
+        if (error) {
+            char *s = xasprintf("%s: %s", file_name, error);
+            free(error);
+            error = s;
+        }
+    }
+    ofpbuf_uninit(&buf);
+    fclose(file);
+
+    return error;
+}
+
+static void
+ofproto_unixctl_save_flows(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                           const char *argv[], void *aux OVS_UNUSED)
+{
+    struct ofproto *ofproto;
+    size_t n_rules;
+    char *error;
+
+    ofproto = ofproto_lookup(argv[1]);
+    if (!ofproto) {
+        unixctl_command_reply_error(conn, "no such bridge");
+        return;
+    }
+
+    error = ofproto_save_flows(ofproto, argv[2], &n_rules);
+    if (error) {
+        unixctl_command_reply_error(conn, error);
+        free(error);
+    } else {
+        char *reply = xasprintf("saved %zu flows", n_rules);
+        unixctl_command_reply(conn, reply);
+        free(reply);
+    }
+}
+
+static void
+ofproto_unixctl_restore_flows(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                              const char *argv[], void *aux OVS_UNUSED)
+{
+    struct ofproto *ofproto;
+    size_t n_rules;
+    char *error;
+
+    ofproto = ofproto_lookup(argv[1]);
+    if (!ofproto) {
+        unixctl_command_reply_error(conn, "no such bridge");
+        return;
+    }
+
+    error = ofproto_restore_flows(ofproto, argv[2], &n_rules);
+    if (error) {
+        unixctl_command_reply_error(conn, error);
+        free(error);
+    } else {
+        char *reply = xasprintf("restored %zu flows", n_rules);
+        unixctl_command_reply(conn, reply);
+        free(reply);
+    }
+}
+
 static void
 ofproto_unixctl_init(void)
 {
@@ -5469,6 +6048,10 @@ ofproto_unixctl_init(void)
 
     unixctl_command_register("ofproto/list", "", 0, 0,
                              ofproto_unixctl_list, NULL);
+    unixctl_command_register("ofproto/save-flows", "bridge file", 2, 2,
+                             ofproto_unixctl_save_flows, NULL);
+    unixctl_command_register("ofproto/restore-flows", "bridge file", 2, 2,
+                             ofproto_unixctl_restore_flows, NULL);
 }
 
 /* Linux VLAN device support (e.g. "eth0.10" for VLAN 10.)
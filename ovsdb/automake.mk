@@ -1,6 +1,8 @@
 # libovsdb
 noinst_LIBRARIES += ovsdb/libovsdb.a
 ovsdb_libovsdb_a_SOURCES = \
+	ovsdb/binary.c \
+	ovsdb/binary.h \
 	ovsdb/column.c \
 	ovsdb/column.h \
 	ovsdb/condition.c \
@@ -19,6 +21,8 @@ ovsdb_libovsdb_a_SOURCES = \
 	ovsdb/ovsdb.h \
 	ovsdb/query.c \
 	ovsdb/query.h \
+	ovsdb/replication.c \
+	ovsdb/replication.h \
 	ovsdb/row.c \
 	ovsdb/row.h \
 	ovsdb/server.c \
@@ -0,0 +1,691 @@
+/* Copyright (c) 2013 Nicira, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include "binary.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "json.h"
+#include "ofpbuf.h"
+#include "shash.h"
+#include "util.h"
+#include "uuid.h"
+
+/* Each encoded value begins with one of these type bytes.  Counts and lengths
+ * are unsigned base-128 varints, least significant group first. */
+enum binary_type {
+    BIN_NULL,                   /* null. */
+    BIN_FALSE,                  /* false. */
+    BIN_TRUE,                   /* true. */
+    BIN_INTEGER,                /* Zigzag-encoded varint. */
+    BIN_REAL,                   /* IEEE 754 double, 8 bytes, big-endian. */
+    BIN_STRING,                 /* Length, then that many bytes. */
+    BIN_ARRAY,                  /* Count, then that many values. */
+    BIN_OBJECT,                 /* Count, then that many (name, value)
+                                 * pairs, where each name is encoded as a
+                                 * BIN_STRING or BIN_UUID. */
+    BIN_UUID,                   /* String that contains a UUID in canonical
+                                 * form, as 16 bytes, big-endian. */
+    BIN_UUID_ATOM,              /* ["uuid", <uuid>], as 16 bytes. */
+    BIN_SET,                    /* ["set", [<value>...]]: count, then that
+                                 * many values. */
+    BIN_MAP                     /* ["map", [[<key>, <value>]...]]: count,
+                                 * then that many (key, value) pairs. */
+};
+
+/* Maximum nesting depth accepted by the decoder, as for the JSON parser. */
+#define BINARY_MAX_HEIGHT 1000
+
+/* Encoding. */
+
+/* Appends 'n' uninitialized bytes to 'b' and returns the first of them.  Grows
+ * 'b' geometrically, since encoding appends a few bytes at a time. */
+static void *
+put_uninit(struct ofpbuf *b, size_t n)
+{
+    if (ofpbuf_tailroom(b) < n) {
+        ofpbuf_prealloc_tailroom(b, MAX(n, b->size));
+    }
+    return ofpbuf_put_uninit(b, n);
+}
+
+static void
+put_bytes(struct ofpbuf *b, const void *p, size_t n)
+{
+    memcpy(put_uninit(b, n), p, n);
+}
+
+/* Appends 'type' followed by 'x' as a varint to 'b'. */
+static void
+put_header(struct ofpbuf *b, enum binary_type type, uint64_t x)
+{
+    uint8_t buf[11];
+    size_t n = 0;
+
+    buf[n++] = type;
+    while (x >= 0x80) {
+        buf[n++] = (x & 0x7f) | 0x80;
+        x >>= 7;
+    }
+    buf[n++] = x;
+    put_bytes(b, buf, n);
+}
+
+static void
+put_type(struct ofpbuf *b, enum binary_type type)
+{
+    *(uint8_t *) put_uninit(b, 1) = type;
+}
+
+static void
+put_be64__(uint8_t *p, uint64_t x)
+{
+    int i;
+
+    for (i = 7; i >= 0; i--) {
+        p[i] = x;
+        x >>= 8;
+    }
+}
+
+/* Appends 'type' followed by 'x' as 8 big-endian bytes to 'b'. */
+static void
+put_be64(struct ofpbuf *b, enum binary_type type, uint64_t x)
+{
+    uint8_t *p = put_uninit(b, 9);
+
+    p[0] = type;
+    put_be64__(p + 1, x);
+}
+
+/* Appends 'type' followed by 'uuid' as 16 big-endian bytes to 'b'. */
+static void
+put_uuid(struct ofpbuf *b, enum binary_type type, const struct uuid *uuid)
+{
+    uint8_t *p = put_uninit(b, 17);
+
+    p[0] = type;
+    put_be64__(p + 1, ((uint64_t) uuid->parts[0] << 32) | uuid->parts[1]);
+    put_be64__(p + 9, ((uint64_t) uuid->parts[2] << 32) | uuid->parts[3]);
+}
+
+/* Returns true if 's' is a UUID in the canonical form that UUID_FMT
+ * produces, storing the UUID in '*uuid', false otherwise.  Only strings in
+ * canonical form can be encoded as BIN_UUID, because decoding always
+ * reproduces that form.
+ *
+ * This is equivalent to uuid_from_string() followed by a check for
+ * upper-case hex digits, but it is called for every string in a database, so
+ * it makes a single pass over 's' and gives up as early as possible. */
+static bool
+string_is_canonical_uuid(const char *s, struct uuid *uuid)
+{
+    uint64_t hi = 0, lo = 0;
+    int i;
+
+    for (i = 0; i < UUID_LEN; i++) {
+        int c = s[i];
+
+        if (i == 8 || i == 13 || i == 18 || i == 23) {
+            if (c != '-') {
+                return false;
+            }
+            continue;
+        } else if (c >= '0' && c <= '9') {
+            c -= '0';
+        } else if (c >= 'a' && c <= 'f') {
+            c -= 'a' - 10;
+        } else {
+            return false;
+        }
+
+        if (i < 19) {
+            hi = (hi << 4) | c;
+        } else {
+            lo = (lo << 4) | c;
+        }
+    }
+    if (s[UUID_LEN] != '\0') {
+        return false;
+    }
+
+    uuid->parts[0] = hi >> 32;
+    uuid->parts[1] = hi;
+    uuid->parts[2] = lo >> 32;
+    uuid->parts[3] = lo;
+    return true;
+}
+
+static void
+put_string(struct ofpbuf *b, const char *s)
+{
+    struct uuid uuid;
+
+    if (string_is_canonical_uuid(s, &uuid)) {
+        put_uuid(b, BIN_UUID, &uuid);
+    } else {
+        size_t length = strlen(s);
+
+        put_header(b, BIN_STRING, length);
+        put_bytes(b, s, length);
+    }
+}
+
+/* Returns the type with which to encode 'json', which must be an array, if
+ * it has the form of an OVSDB "uuid", "set", or "map", otherwise
+ * BIN_ARRAY. */
+static enum binary_type
+classify_array(const struct json *json)
+{
+    const struct json_array *array = &json->u.array;
+    const struct json *tag, *value;
+
+    if (array->n != 2 || array->elems[0]->type != JSON_STRING) {
+        return BIN_ARRAY;
+    }
+
+    tag = array->elems[0];
+    value = array->elems[1];
+    if (!strcmp(tag->u.string, "uuid")) {
+        struct uuid uuid;
+
+        return (value->type == JSON_STRING
+                && string_is_canonical_uuid(value->u.string, &uuid)
+                ? BIN_UUID_ATOM : BIN_ARRAY);
+    } else if (!strcmp(tag->u.string, "set")) {
+        return value->type == JSON_ARRAY ? BIN_SET : BIN_ARRAY;
+    } else if (!strcmp(tag->u.string, "map")) {
+        size_t i;
+
+        if (value->type != JSON_ARRAY) {
+            return BIN_ARRAY;
+        }
+        for (i = 0; i < value->u.array.n; i++) {
+            const struct json *pair = value->u.array.elems[i];
+
+            if (pair->type != JSON_ARRAY || pair->u.array.n != 2) {
+                return BIN_ARRAY;
+            }
+        }
+        return BIN_MAP;
+    } else {
+        return BIN_ARRAY;
+    }
+}
+
+static void put_value(struct ofpbuf *, const struct json *);
+
+static void
+put_array(struct ofpbuf *b, const struct json *json)
+{
+    enum binary_type type = classify_array(json);
+    const struct json_array *array = &json->u.array;
+    size_t i;
+
+    if (type == BIN_UUID_ATOM) {
+        struct uuid uuid;
+
+        string_is_canonical_uuid(array->elems[1]->u.string, &uuid);
+        put_uuid(b, BIN_UUID_ATOM, &uuid);
+    } else if (type == BIN_SET) {
+        array = &array->elems[1]->u.array;
+        put_header(b, BIN_SET, array->n);
+        for (i = 0; i < array->n; i++) {
+            put_value(b, array->elems[i]);
+        }
+    } else if (type == BIN_MAP) {
+        array = &array->elems[1]->u.array;
+        put_header(b, BIN_MAP, array->n);
+        for (i = 0; i < array->n; i++) {
+            const struct json_array *pair = &array->elems[i]->u.array;
+
+            put_value(b, pair->elems[0]);
+            put_value(b, pair->elems[1]);
+        }
+    } else {
+        put_header(b, BIN_ARRAY, array->n);
+        for (i = 0; i < array->n; i++) {
+            put_value(b, array->elems[i]);
+        }
+    }
+}
+
+static void
+put_value(struct ofpbuf *b, const struct json *json)
+{
+    struct shash_node *node;
+    uint64_t bits;
+
+    switch (json->type) {
+    case JSON_NULL:
+        put_type(b, BIN_NULL);
+        break;
+
+    case JSON_FALSE:
+        put_type(b, BIN_FALSE);
+        break;
+
+    case JSON_TRUE:
+        put_type(b, BIN_TRUE);
+        break;
+
+    case JSON_INTEGER:
+        bits = json->u.integer;
+        put_header(b, BIN_INTEGER, (bits << 1) ^ -(bits >> 63));
+        break;
+
+    case JSON_REAL:
+        BUILD_ASSERT_DECL(sizeof json->u.real == sizeof bits);
+        memcpy(&bits, &json->u.real, sizeof bits);
+        put_be64(b, BIN_REAL, bits);
+        break;
+
+    case JSON_STRING:
+        put_string(b, json->u.string);
+        break;
+
+    case JSON_ARRAY:
+        put_array(b, json);
+        break;
+
+    case JSON_OBJECT:
+        put_header(b, BIN_OBJECT, shash_count(json->u.object));
+        SHASH_FOR_EACH (node, json->u.object) {
+            put_string(b, node->name);
+            put_value(b, node->data);
+        }
+        break;
+
+    case JSON_SERIALIZED_OBJECT: {
+        struct json *parsed = json_from_string(json->u.string);
+        put_value(b, parsed);
+        json_destroy(parsed);
+        break;
+    }
+
+    case JSON_N_TYPES:
+    default:
+        NOT_REACHED();
+    }
+}
+
+/* Appends the binary encoding of 'json' to 'b'. */
+void
+ovsdb_json_to_binary(const struct json *json, struct ofpbuf *b)
+{
+    put_value(b, json);
+}
+
+/* Decoding. */
+
+struct binary_reader {
+    const uint8_t *p;           /* Next byte to decode. */
+    const uint8_t *end;         /* End of input. */
+    const uint8_t *start;       /* Start of input, for error messages. */
+    int height;                 /* Current nesting depth. */
+    char *error;                /* Error message, if any. */
+};
+
+static void
+reader_error(struct binary_reader *r, const char *message)
+{
+    if (!r->error) {
+        r->error = xasprintf("%s at byte offset %td",
+                             message, r->p - r->start);
+    }
+}
+
+static bool
+get_bytes(struct binary_reader *r, size_t n, const uint8_t **bytesp)
+{
+    if (r->end - r->p < n) {
+        reader_error(r, "unexpected end of input");
+        return false;
+    }
+    *bytesp = r->p;
+    r->p += n;
+    return true;
+}
+
+static bool
+get_varint(struct binary_reader *r, uint64_t *xp)
+{
+    uint64_t x = 0;
+    int shift;
+
+    for (shift = 0; shift < 64; shift += 7) {
+        const uint8_t *byte;
+
+        if (!get_bytes(r, 1, &byte)) {
+            return false;
+        }
+        x |= (uint64_t) (*byte & 0x7f) << shift;
+        if (!(*byte & 0x80)) {
+            *xp = x;
+            return true;
+        }
+    }
+    reader_error(r, "varint too long");
+    return false;
+}
+
+/* Reads a count of items, each of which occupies at least 'min_size' bytes,
+ * rejecting counts that could not possibly fit in the remaining input so that
+ * corrupted input cannot cause huge allocations. */
+static bool
+get_count(struct binary_reader *r, size_t min_size, size_t *np)
+{
+    uint64_t n;
+
+    if (!get_varint(r, &n)) {
+        return false;
+    } else if (n > (r->end - r->p) / min_size) {
+        reader_error(r, "count exceeds remaining input");
+        return false;
+    }
+    *np = n;
+    return true;
+}
+
+static bool
+get_be64(struct binary_reader *r, uint64_t *xp)
+{
+    const uint8_t *p;
+    uint64_t x;
+    int i;
+
+    if (!get_bytes(r, 8, &p)) {
+        return false;
+    }
+    x = 0;
+    for (i = 0; i < 8; i++) {
+        x = (x << 8) | p[i];
+    }
+    *xp = x;
+    return true;
+}
+
+static bool
+get_uuid(struct binary_reader *r, struct uuid *uuid)
+{
+    uint64_t hi, lo;
+
+    if (!get_be64(r, &hi) || !get_be64(r, &lo)) {
+        return false;
+    }
+    uuid->parts[0] = hi >> 32;
+    uuid->parts[1] = hi;
+    uuid->parts[2] = lo >> 32;
+    uuid->parts[3] = lo;
+    return true;
+}
+
+/* Returns 'uuid' formatted as if by UUID_FMT, in a new string.  This is much
+ * faster than xasprintf(), which matters because many database files consist
+ * mostly of UUIDs. */
+static char *
+uuid_to_string(const struct uuid *uuid)
+{
+    static const char hex[] = "0123456789abcdef";
+    char *s = xmalloc(UUID_LEN + 1);
+    char *p = s;
+    int i, j;
+
+    for (i = 0; i < 4; i++) {
+        for (j = 28; j >= 0; j -= 4) {
+            *p++ = hex[(uuid->parts[i] >> j) & 15];
+            if (p - s == 8 || p - s == 13 || p - s == 18 || p - s == 23) {
+                *p++ = '-';
+            }
+        }
+    }
+    *p = '\0';
+    return s;
+}
+
+/* Reads a string encoded as BIN_STRING or BIN_UUID and returns it as a new
+ * null-terminated string, or returns NULL on error. */
+static char *
+get_string(struct binary_reader *r)
+{
+    const uint8_t *type;
+
+    if (!get_bytes(r, 1, &type)) {
+        return NULL;
+    }
+    if (*type == BIN_STRING) {
+        const uint8_t *s;
+        size_t length;
+
+        if (!get_count(r, 1, &length) || !get_bytes(r, length, &s)) {
+            return NULL;
+        }
+        if (memchr(s, '\0', length)) {
+            reader_error(r, "string contains null byte");
+            return NULL;
+        }
+        return xmemdup0((const char *) s, length);
+    } else if (*type == BIN_UUID) {
+        struct uuid uuid;
+
+        return get_uuid(r, &uuid) ? uuid_to_string(&uuid) : NULL;
+    } else {
+        r->p--;
+        reader_error(r, "expected string");
+        return NULL;
+    }
+}
+
+static struct json *get_value(struct binary_reader *);
+
+/* Reads 'n' values and returns them in a new array, or NULL on error. */
+static struct json *
+get_values(struct binary_reader *r, size_t n)
+{
+    struct json **elems = xmalloc(n * sizeof *elems);
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        elems[i] = get_value(r);
+        if (!elems[i]) {
+            while (i-- > 0) {
+                json_destroy(elems[i]);
+            }
+            free(elems);
+            return NULL;
+        }
+    }
+    return json_array_create(elems, n);
+}
+
+static struct json *
+get_object(struct binary_reader *r, size_t n)
+{
+    struct json *object = json_object_create();
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        struct json *value;
+        char *name;
+
+        name = get_string(r);
+        if (!name) {
+            goto error;
+        }
+        if (shash_find(object->u.object, name)) {
+            reader_error(r, "duplicate object member name");
+            free(name);
+            goto error;
+        }
+        value = get_value(r);
+        if (!value) {
+            free(name);
+            goto error;
+        }
+        shash_add_nocopy(object->u.object, name, value);
+    }
+    return object;
+
+error:
+    json_destroy(object);
+    return NULL;
+}
+
+static struct json *
+get_compound(struct binary_reader *r, enum binary_type type)
+{
+    struct json *json;
+    struct uuid uuid;
+    size_t n, i;
+
+    switch (type) {
+    case BIN_ARRAY:
+        return get_count(r, 1, &n) ? get_values(r, n) : NULL;
+
+    case BIN_OBJECT:
+        return get_count(r, 2, &n) ? get_object(r, n) : NULL;
+
+    case BIN_UUID_ATOM:
+        if (!get_uuid(r, &uuid)) {
+            return NULL;
+        }
+        return json_array_create_2(
+            json_string_create("uuid"),
+            json_string_create_nocopy(uuid_to_string(&uuid)));
+
+    case BIN_SET:
+        if (!get_count(r, 1, &n) || !(json = get_values(r, n))) {
+            return NULL;
+        }
+        return json_array_create_2(json_string_create("set"), json);
+
+    case BIN_MAP:
+        if (!get_count(r, 2, &n) || !(json = get_values(r, 2 * n))) {
+            return NULL;
+        }
+        /* Regroup the flat list of keys and values into pairs. */
+        for (i = 0; i < n; i++) {
+            struct json **elems = json->u.array.elems;
+
+            elems[i] = json_array_create_2(elems[2 * i], elems[2 * i + 1]);
+        }
+        json->u.array.n = n;
+        return json_array_create_2(json_string_create("map"), json);
+
+    case BIN_NULL:
+    case BIN_FALSE:
+    case BIN_TRUE:
+    case BIN_INTEGER:
+    case BIN_REAL:
+    case BIN_STRING:
+    case BIN_UUID:
+    default:
+        NOT_REACHED();
+    }
+}
+
+static struct json *
+get_value(struct binary_reader *r)
+{
+    const uint8_t *type;
+    struct json *json;
+    uint64_t bits;
+    double real;
+    char *s;
+
+    if (!get_bytes(r, 1, &type)) {
+        return NULL;
+    }
+
+    switch (*type) {
+    case BIN_NULL:
+        return json_null_create();
+
+    case BIN_FALSE:
+        return json_boolean_create(false);
+
+    case BIN_TRUE:
+        return json_boolean_create(true);
+
+    case BIN_INTEGER:
+        if (!get_varint(r, &bits)) {
+            return NULL;
+        }
+        return json_integer_create((bits >> 1) ^ -(bits & 1));
+
+    case BIN_REAL:
+        if (!get_be64(r, &bits)) {
+            return NULL;
+        }
+        memcpy(&real, &bits, sizeof real);
+        return json_real_create(real);
+
+    case BIN_STRING:
+    case BIN_UUID:
+        r->p--;
+        s = get_string(r);
+        return s ? json_string_create_nocopy(s) : NULL;
+
+    case BIN_ARRAY:
+    case BIN_OBJECT:
+    case BIN_UUID_ATOM:
+    case BIN_SET:
+    case BIN_MAP:
+        if (r->height >= BINARY_MAX_HEIGHT) {
+            reader_error(r, "input exceeds maximum nesting depth");
+            return NULL;
+        }
+        r->height++;
+        json = get_compound(r, *type);
+        r->height--;
+        return json;
+
+    default:
+        r->p--;
+        reader_error(r, "unknown value type");
+        return NULL;
+    }
+}
+
+/* Decodes the 'size' bytes in 'data' as a single binary-encoded value and
+ * returns it as JSON.
+ *
+ * On error, returns a JSON string that describes the error, as
+ * json_parser_finish() does, instead.  (A value that is itself a string is
+ * therefore ambiguous, but OVSDB log records are always arrays or
+ * objects.) */
+struct json *
+ovsdb_json_from_binary(const void *data, size_t size)
+{
+    struct binary_reader r;
+    struct json *json;
+
+    r.start = r.p = data;
+    r.end = r.p + size;
+    r.height = 0;
+    r.error = NULL;
+
+    json = get_value(&r);
+    if (json && r.p != r.end) {
+        json_destroy(json);
+        json = NULL;
+        reader_error(&r, "trailing garbage");
+    }
+    return json ? json : json_string_create_nocopy(r.error);
+}
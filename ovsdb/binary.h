@@ -0,0 +1,36 @@
+/* Copyright (c) 2013 Nicira, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OVSDB_BINARY_H
+#define OVSDB_BINARY_H 1
+
+#include <stddef.h>
+
+struct json;
+struct ofpbuf;
+
+/* Binary encoding of OVSDB log records.
+ *
+ * This is a compact, typed, length-prefixed encoding of the JSON values that
+ * make up OVSDB log records.  Every JSON value can be encoded and decoded
+ * again without loss.  UUIDs and the "uuid", "set", and "map" forms of
+ * <value> from the OVSDB specification have their own encodings, so that
+ * the ovsdb_datum values that dominate most database files take much less
+ * space than their JSON text, and take much less time to read back in. */
+
+void ovsdb_json_to_binary(const struct json *, struct ofpbuf *);
+struct json *ovsdb_json_from_binary(const void *, size_t);
+
+#endif /* ovsdb/binary.h */
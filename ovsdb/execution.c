@@ -26,6 +26,7 @@
 #include "ovsdb-error.h"
 #include "ovsdb-parser.h"
 #include "ovsdb.h"
+#include "poll-loop.h"
 #include "query.h"
 #include "row.h"
 #include "server.h"
@@ -60,25 +61,29 @@ static ovsdb_operation_executor ovsdb_execute_abort;
 static ovsdb_operation_executor ovsdb_execute_comment;
 static ovsdb_operation_executor ovsdb_execute_assert;
 
+/* Returns the executor for the operation named 'name', or NULL if there is no
+ * such operation.  Stores in '*read_only' whether the operation only reads
+ * the database, so that it is allowed on a read-only database. */
 static ovsdb_operation_executor *
-lookup_executor(const char *name)
+lookup_executor(const char *name, bool *read_only)
 {
     struct ovsdb_operation {
         const char *name;
+        bool read_only;
         ovsdb_operation_executor *executor;
     };
 
     static const struct ovsdb_operation operations[] = {
-        { "insert", ovsdb_execute_insert },
-        { "select", ovsdb_execute_select },
-        { "update", ovsdb_execute_update },
-        { "mutate", ovsdb_execute_mutate },
-        { "delete", ovsdb_execute_delete },
-        { "wait", ovsdb_execute_wait },
-        { "commit", ovsdb_execute_commit },
-        { "abort", ovsdb_execute_abort },
-        { "comment", ovsdb_execute_comment },
-        { "assert", ovsdb_execute_assert },
+        { "insert", false, ovsdb_execute_insert },
+        { "select", true, ovsdb_execute_select },
+        { "update", false, ovsdb_execute_update },
+        { "mutate", false, ovsdb_execute_mutate },
+        { "delete", false, ovsdb_execute_delete },
+        { "wait", true, ovsdb_execute_wait },
+        { "commit", true, ovsdb_execute_commit },
+        { "abort", true, ovsdb_execute_abort },
+        { "comment", true, ovsdb_execute_comment },
+        { "assert", true, ovsdb_execute_assert },
     };
 
     size_t i;
@@ -86,16 +91,37 @@ lookup_executor(const char *name)
     for (i = 0; i < ARRAY_SIZE(operations); i++) {
         const struct ovsdb_operation *c = &operations[i];
         if (!strcmp(c->name, name)) {
+            *read_only = c->read_only;
             return c->executor;
         }
     }
     return NULL;
 }
 
+static struct ovsdb_error *
+ovsdb_execute_wait_durable(struct ovsdb *db, uint64_t seqno)
+{
+    struct ovsdb_error *error;
+
+    while (!ovsdb_is_durable(db, seqno, &error)) {
+        ovsdb_durable_wait(db, seqno);
+        poll_block();
+    }
+    return error;
+}
+
+/* Executes the transaction in 'params' against 'db' and returns its results.
+ *
+ * A transaction that requests durability might not be on disk yet when this
+ * function returns.  If 'durable_seqno' is nonnull, then this function stores
+ * in it the number of the durable commit that the caller must wait for, using
+ * ovsdb_is_durable(), before reporting the results (or 0 if there is nothing
+ * to wait for).  If 'durable_seqno' is null, this function waits itself. */
 struct json *
 ovsdb_execute(struct ovsdb *db, const struct ovsdb_session *session,
               const struct json *params,
-              long long int elapsed_msec, long long int *timeout_msec)
+              long long int elapsed_msec, long long int *timeout_msec,
+              uint64_t *durable_seqno)
 {
     struct ovsdb_execution x;
     struct ovsdb_error *error;
@@ -103,6 +129,10 @@ ovsdb_execute(struct ovsdb *db, const struct ovsdb_session *session,
     size_t n_operations;
     size_t i;
 
+    if (durable_seqno) {
+        *durable_seqno = 0;
+    }
+
     if (params->type != JSON_ARRAY
         || !params->u.array.n
         || params->u.array.elems[0]->type != JSON_STRING
@@ -137,6 +167,7 @@ ovsdb_execute(struct ovsdb *db, const struct ovsdb_session *session,
         struct ovsdb_parser parser;
         struct json *result;
         const struct json *op;
+        bool refused = false;
 
         /* Parse and execute operation. */
         ovsdb_parser_init(&parser, operation,
@@ -145,8 +176,16 @@ ovsdb_execute(struct ovsdb *db, const struct ovsdb_session *session,
         result = json_object_create();
         if (op) {
             const char *op_name = json_string(op);
-            ovsdb_operation_executor *executor = lookup_executor(op_name);
-            if (executor) {
+            ovsdb_operation_executor *executor;
+            bool read_only;
+
+            executor = lookup_executor(op_name, &read_only);
+            if (executor && !read_only && db->read_only) {
+                error = ovsdb_error("not allowed", "%s operation not allowed "
+                                    "because database %s is a read-only "
+                                    "replica", op_name, db->schema->name);
+                refused = true;
+            } else if (executor) {
                 error = executor(&x, &parser, result);
             } else {
                 ovsdb_parser_raise_error(&parser, "No operation \"%s\"",
@@ -156,9 +195,14 @@ ovsdb_execute(struct ovsdb *db, const struct ovsdb_session *session,
             ovs_assert(ovsdb_parser_has_error(&parser));
         }
 
-        /* A parse error overrides any other error.
+        /* A parse error overrides any other error, except for a refused
+         * operation, whose members were never parsed.
          * An error overrides any other result. */
         parse_error = ovsdb_parser_finish(&parser);
+        if (refused) {
+            ovsdb_error_destroy(parse_error);
+            parse_error = NULL;
+        }
         if (parse_error) {
             ovsdb_error_destroy(error);
             error = parse_error;
@@ -187,6 +231,15 @@ ovsdb_execute(struct ovsdb *db, const struct ovsdb_session *session,
 
     if (!error) {
         error = ovsdb_txn_commit(x.txn, x.durable);
+        if (!error && x.durable) {
+            /* If the transaction turned out to be a no-op, then this waits
+             * for the most recent durable commit, which is harmless. */
+            if (durable_seqno) {
+                *durable_seqno = db->durable_seqno;
+            } else {
+                error = ovsdb_execute_wait_durable(db, db->durable_seqno);
+            }
+        }
         if (error) {
             json_array_add(results, ovsdb_error_to_json(error));
         }
@@ -378,8 +431,8 @@ ovsdb_execute_select(struct ovsdb_execution *x, struct ovsdb_parser *parser,
     if (!error) {
         struct ovsdb_row_set rows = OVSDB_ROW_SET_INITIALIZER;
 
-        ovsdb_query_distinct(table, &condition, &columns, &rows);
-        ovsdb_row_set_sort(&rows, &sort);
+        ovsdb_query_distinct_sorted(table, &condition, &columns, &sort,
+                                    &rows);
         json_object_put(result, "rows",
                         ovsdb_row_set_to_json(&rows, &columns));
 
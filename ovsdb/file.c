@@ -25,9 +25,13 @@
 #include "column.h"
 #include "log.h"
 #include "json.h"
+#include "latch.h"
 #include "lockfile.h"
+#include "ovs-rcu.h"
+#include "ovs-thread.h"
 #include "ovsdb.h"
 #include "ovsdb-error.h"
+#include "poll-loop.h"
 #include "row.h"
 #include "socket-util.h"
 #include "table.h"
@@ -46,6 +50,10 @@ VLOG_DEFINE_THIS_MODULE(ovsdb_file);
  * compacting fails. */
 #define COMPACT_RETRY_MSEC      (60 * 1000)      /* 1 minute. */
 
+/* Compact the database, regardless of COMPACT_MIN_MSEC, once its log grows to
+ * this many times its size just after the last compaction. */
+#define COMPACT_GROWTH_RATIO    4
+
 /* A transaction being converted to JSON for writing to a file. */
 struct ovsdb_file_txn {
     struct json *json;          /* JSON for the whole transaction. */
@@ -58,18 +66,24 @@ static void ovsdb_file_txn_add_row(struct ovsdb_file_txn *,
                                    const struct ovsdb_row *old,
                                    const struct ovsdb_row *new,
                                    const unsigned long int *changed);
+static struct json *ovsdb_file_txn_annotate(struct json *,
+                                            const char *comment);
 static struct ovsdb_error *ovsdb_file_txn_commit(struct json *,
                                                  const char *comment,
                                                  bool durable,
                                                  struct ovsdb_log *);
+static struct ovsdb_error *ovsdb_file_txn_write(struct json *, bool durable,
+                                                struct ovsdb_log *);
 
 static struct ovsdb_error *ovsdb_file_open__(const char *file_name,
                                              const struct ovsdb_schema *,
                                              bool read_only, struct ovsdb **,
                                              struct ovsdb_file **);
-static struct ovsdb_error *ovsdb_file_txn_from_json(
-    struct ovsdb *, const struct json *, bool converting,
-    long long int *date, struct ovsdb_txn **);
+static struct ovsdb_error *ovsdb_file_replay(struct ovsdb *,
+                                             struct ovsdb_log *,
+                                             bool converting,
+                                             long long int *oldest_commit,
+                                             unsigned int *n_transactions);
 static struct ovsdb_error *ovsdb_file_create(struct ovsdb *,
                                              struct ovsdb_log *,
                                              const char *file_name,
@@ -189,7 +203,6 @@ ovsdb_file_open__(const char *file_name,
     struct ovsdb_schema *schema = NULL;
     struct ovsdb_error *error;
     struct ovsdb_log *log;
-    struct json *json;
     struct ovsdb *db = NULL;
 
     /* In read-only mode there is no ovsdb_file so 'filep' must be null. */
@@ -206,29 +219,8 @@ ovsdb_file_open__(const char *file_name,
 
     oldest_commit = LLONG_MAX;
     n_transactions = 0;
-    while ((error = ovsdb_log_read(log, &json)) == NULL && json) {
-        struct ovsdb_txn *txn;
-        long long int date;
-
-        error = ovsdb_file_txn_from_json(db, json, alternate_schema != NULL,
-                                         &date, &txn);
-        json_destroy(json);
-        if (error) {
-            ovsdb_log_unread(log);
-            break;
-        }
-
-        n_transactions++;
-        if (date < oldest_commit) {
-            oldest_commit = date;
-        }
-
-        error = ovsdb_txn_commit(txn, false);
-        if (error) {
-            ovsdb_log_unread(log);
-            break;
-        }
-    }
+    error = ovsdb_file_replay(db, log, alternate_schema != NULL,
+                              &oldest_commit, &n_transactions);
     if (error) {
         /* Log error but otherwise ignore it.  Probably the database just got
          * truncated due to power failure etc. and we should use its current
@@ -268,21 +260,80 @@ error:
     return error;
 }
 
+/* A column value within an ovsdb_replay_row. */
+struct ovsdb_replay_column {
+    const struct ovsdb_column *column;
+    struct ovsdb_datum datum;
+};
+
+/* A row within an ovsdb_replay_txn. */
+struct ovsdb_replay_row {
+    struct ovsdb_table *table;
+    struct uuid uuid;
+    bool delete;                         /* True to delete the row. */
+    struct ovsdb_replay_column *columns; /* Columns to insert or modify. */
+    size_t n_columns;
+};
+
+/* A transaction read from a database file and checked against the database's
+ * schema, but not yet applied to the database.
+ *
+ * Converting a log record into an ovsdb_replay_txn only looks at the schema,
+ * not at the data in the database, so it may be done in any thread, in any
+ * order.  Applying an ovsdb_replay_txn to the database must be done in the
+ * order of the records in the log. */
+struct ovsdb_replay_txn {
+    struct ovsdb_replay_row *rows;
+    size_t n_rows, allocated_rows;
+    long long int date;         /* Commit time, LLONG_MAX if unknown. */
+};
+
+static void
+ovsdb_replay_txn_init(struct ovsdb_replay_txn *rt)
+{
+    rt->rows = NULL;
+    rt->n_rows = rt->allocated_rows = 0;
+    rt->date = LLONG_MAX;
+}
+
+static void
+ovsdb_replay_txn_destroy(struct ovsdb_replay_txn *rt)
+{
+    size_t i, j;
+
+    for (i = 0; i < rt->n_rows; i++) {
+        struct ovsdb_replay_row *rr = &rt->rows[i];
+
+        for (j = 0; j < rr->n_columns; j++) {
+            struct ovsdb_replay_column *rc = &rr->columns[j];
+
+            ovsdb_datum_destroy(&rc->datum, &rc->column->type);
+        }
+        free(rr->columns);
+    }
+    free(rt->rows);
+    ovsdb_replay_txn_init(rt);
+}
+
 static struct ovsdb_error *
-ovsdb_file_update_row_from_json(struct ovsdb_row *row, bool converting,
-                                const struct json *json)
+ovsdb_replay_row_from_json(struct ovsdb_replay_row *rr, bool converting,
+                           const struct json *json)
 {
-    struct ovsdb_table_schema *schema = row->table->schema;
-    struct ovsdb_error *error;
+    struct ovsdb_table_schema *schema = rr->table->schema;
     struct shash_node *node;
 
-    if (json->type != JSON_OBJECT) {
+    if (json->type == JSON_NULL) {
+        rr->delete = true;
+        return NULL;
+    } else if (json->type != JSON_OBJECT) {
         return ovsdb_syntax_error(json, NULL, "row must be JSON object");
     }
 
+    rr->columns = xmalloc(shash_count(json_object(json)) * sizeof *rr->columns);
     SHASH_FOR_EACH (node, json_object(json)) {
         const char *column_name = node->name;
         const struct ovsdb_column *column;
+        struct ovsdb_error *error;
         struct ovsdb_datum datum;
 
         column = ovsdb_table_schema_get_column(schema, column_name);
@@ -299,50 +350,18 @@ ovsdb_file_update_row_from_json(struct ovsdb_row *row, bool converting,
         if (error) {
             return error;
         }
-        ovsdb_datum_swap(&row->fields[column->index], &datum);
-        ovsdb_datum_destroy(&datum, &column->type);
+        rr->columns[rr->n_columns].column = column;
+        ovsdb_datum_swap(&rr->columns[rr->n_columns].datum, &datum);
+        rr->n_columns++;
     }
 
     return NULL;
 }
 
 static struct ovsdb_error *
-ovsdb_file_txn_row_from_json(struct ovsdb_txn *txn, struct ovsdb_table *table,
-                             bool converting,
-                             const struct uuid *row_uuid, struct json *json)
-{
-    const struct ovsdb_row *row = ovsdb_table_get_row(table, row_uuid);
-    if (json->type == JSON_NULL) {
-        if (!row) {
-            return ovsdb_syntax_error(NULL, NULL, "transaction deletes "
-                                      "row "UUID_FMT" that does not exist",
-                                      UUID_ARGS(row_uuid));
-        }
-        ovsdb_txn_row_delete(txn, row);
-        return NULL;
-    } else if (row) {
-        return ovsdb_file_update_row_from_json(ovsdb_txn_row_modify(txn, row),
-                                               converting, json);
-    } else {
-        struct ovsdb_error *error;
-        struct ovsdb_row *new;
-
-        new = ovsdb_row_create(table);
-        *ovsdb_row_get_uuid_rw(new) = *row_uuid;
-        error = ovsdb_file_update_row_from_json(new, converting, json);
-        if (error) {
-            ovsdb_row_destroy(new);
-        } else {
-            ovsdb_txn_row_insert(txn, new);
-        }
-        return error;
-    }
-}
-
-static struct ovsdb_error *
-ovsdb_file_txn_table_from_json(struct ovsdb_txn *txn,
-                               struct ovsdb_table *table,
-                               bool converting, struct json *json)
+ovsdb_replay_table_from_json(struct ovsdb_replay_txn *rt,
+                             struct ovsdb_table *table,
+                             bool converting, const struct json *json)
 {
     struct shash_node *node;
 
@@ -352,7 +371,7 @@ ovsdb_file_txn_table_from_json(struct ovsdb_txn *txn,
 
     SHASH_FOR_EACH (node, json->u.object) {
         const char *uuid_string = node->name;
-        struct json *txn_row_json = node->data;
+        struct ovsdb_replay_row *rr;
         struct ovsdb_error *error;
         struct uuid row_uuid;
 
@@ -361,8 +380,18 @@ ovsdb_file_txn_table_from_json(struct ovsdb_txn *txn,
                                       uuid_string);
         }
 
-        error = ovsdb_file_txn_row_from_json(txn, table, converting,
-                                             &row_uuid, txn_row_json);
+        if (rt->n_rows >= rt->allocated_rows) {
+            rt->rows = x2nrealloc(rt->rows, &rt->allocated_rows,
+                                  sizeof *rt->rows);
+        }
+        rr = &rt->rows[rt->n_rows++];
+        rr->table = table;
+        rr->uuid = row_uuid;
+        rr->delete = false;
+        rr->columns = NULL;
+        rr->n_columns = 0;
+
+        error = ovsdb_replay_row_from_json(rr, converting, node->data);
         if (error) {
             return error;
         }
@@ -371,33 +400,27 @@ ovsdb_file_txn_table_from_json(struct ovsdb_txn *txn,
     return NULL;
 }
 
-/* Converts 'json' to an ovsdb_txn for 'db', storing the new transaction in
- * '*txnp'.  Returns NULL if successful, otherwise an error.
+/* Converts 'json', a transaction read from a log for 'db', into 'rt', which
+ * the caller must already have initialized.  Returns NULL if successful,
+ * otherwise an error, in which case 'rt' is left empty.
  *
  * If 'converting' is true, then unknown table and column names are ignored
  * (which can ease upgrading and downgrading schemas); otherwise, they are
  * treated as errors.
  *
- * If successful, the date associated with the transaction, as the number of
- * milliseconds since the epoch, is stored in '*date'.  If the transaction does
- * not include a date, LLONG_MAX is stored. */
+ * This function only reads 'db''s schema, which does not change while the
+ * database is being read, so it is safe to call from any thread. */
 static struct ovsdb_error *
-ovsdb_file_txn_from_json(struct ovsdb *db, const struct json *json,
-                         bool converting, long long int *date,
-                         struct ovsdb_txn **txnp)
+ovsdb_replay_txn_from_json(const struct ovsdb *db, const struct json *json,
+                           bool converting, struct ovsdb_replay_txn *rt)
 {
     struct ovsdb_error *error;
     struct shash_node *node;
-    struct ovsdb_txn *txn;
-
-    *txnp = NULL;
-    *date = LLONG_MAX;
 
     if (json->type != JSON_OBJECT) {
         return ovsdb_syntax_error(json, NULL, "object expected");
     }
 
-    txn = ovsdb_txn_create(db);
     SHASH_FOR_EACH (node, json->u.object) {
         const char *table_name = node->name;
         struct json *node_json = node->data;
@@ -407,7 +430,7 @@ ovsdb_file_txn_from_json(struct ovsdb *db, const struct json *json,
         if (!table) {
             if (!strcmp(table_name, "_date")
                 && node_json->type == JSON_INTEGER) {
-                *date = json_integer(node_json);
+                rt->date = json_integer(node_json);
                 continue;
             } else if (!strcmp(table_name, "_comment") || converting) {
                 continue;
@@ -418,24 +441,380 @@ ovsdb_file_txn_from_json(struct ovsdb *db, const struct json *json,
             goto error;
         }
 
-        error = ovsdb_file_txn_table_from_json(txn, table, converting,
-                                               node_json);
+        error = ovsdb_replay_table_from_json(rt, table, converting,
+                                             node_json);
         if (error) {
             goto error;
         }
     }
-    *txnp = txn;
     return NULL;
 
 error:
-    ovsdb_txn_abort(txn);
+    ovsdb_replay_txn_destroy(rt);
+    return error;
+}
+
+/* Parses 'record', read from 'log' for 'db', into 'rt', which the caller
+ * must already have initialized.  Safe to call from any thread. */
+static struct ovsdb_error *
+ovsdb_replay_txn_parse(const struct ovsdb *db, const struct ovsdb_log *log,
+                       const struct ovsdb_log_record *record, bool converting,
+                       struct ovsdb_replay_txn *rt)
+{
+    struct ovsdb_error *error;
+    struct json *json;
+
+    error = ovsdb_log_parse_record(log, record, &json);
+    if (!error) {
+        error = ovsdb_replay_txn_from_json(db, json, converting, rt);
+        json_destroy(json);
+    }
+    return error;
+}
+
+/* Moves the column values in 'rr' into 'row', leaving the values that 'row'
+ * had before in 'rr', so that ovsdb_replay_txn_destroy() frees them. */
+static void
+ovsdb_replay_row_swap(struct ovsdb_replay_row *rr, struct ovsdb_row *row)
+{
+    size_t i;
+
+    for (i = 0; i < rr->n_columns; i++) {
+        struct ovsdb_replay_column *rc = &rr->columns[i];
+
+        ovsdb_datum_swap(&row->fields[rc->column->index], &rc->datum);
+    }
+}
+
+/* Applies 'rt' to 'db' and commits it.  This must be done in the thread that
+ * owns 'db', in log order. */
+static struct ovsdb_error *
+ovsdb_replay_txn_apply(struct ovsdb *db, struct ovsdb_replay_txn *rt)
+{
+    struct ovsdb_txn *txn;
+    size_t i;
+
+    txn = ovsdb_txn_create(db);
+    for (i = 0; i < rt->n_rows; i++) {
+        struct ovsdb_replay_row *rr = &rt->rows[i];
+        const struct ovsdb_row *row;
+
+        row = ovsdb_table_get_row(rr->table, &rr->uuid);
+        if (rr->delete) {
+            if (!row) {
+                ovsdb_txn_abort(txn);
+                return ovsdb_syntax_error(NULL, NULL, "transaction deletes "
+                                          "row "UUID_FMT" that does not exist",
+                                          UUID_ARGS(&rr->uuid));
+            }
+            ovsdb_txn_row_delete(txn, row);
+        } else if (row) {
+            ovsdb_replay_row_swap(rr, ovsdb_txn_row_modify(txn, row));
+        } else {
+            struct ovsdb_row *new = ovsdb_row_create(rr->table);
+
+            *ovsdb_row_get_uuid_rw(new) = rr->uuid;
+            ovsdb_replay_row_swap(rr, new);
+            ovsdb_txn_row_insert(txn, new);
+        }
+    }
+
+    return ovsdb_txn_commit(txn, false);
+}
+
+/* Number of threads to use for parsing log records when reading a database,
+ * or 0 to read databases sequentially in the calling thread. */
+static unsigned int n_replay_threads;
+
+/* Number of log records that may be read ahead of the oldest record not yet
+ * applied to the database, bounding memory use during a parallel replay. */
+#define REPLAY_WINDOW 64
+
+/* A log record within the window of a parallel replay. */
+struct ovsdb_replay_slot {
+    struct ovsdb_log_record *record; /* Owned by the slot. */
+    bool parsed;                     /* Parsing is complete? */
+    struct ovsdb_error *error;       /* Parsing error, if any. */
+    struct ovsdb_replay_txn txn;     /* Parsed transaction. */
+};
+
+/* A parallel replay of a database log.
+ *
+ * A reader thread reads records from the log and checks their SHA-1 hashes, a
+ * pool of parser threads converts them into ovsdb_replay_txns, and the thread
+ * that opened the database applies those to the database in log order.  All
+ * three stages overlap. */
+struct ovsdb_replay {
+    struct ovsdb *db;
+    /* Only the reader thread reads records from 'log'.  Parser threads pass
+     * it to ovsdb_log_parse_record(), which reads only its name, which does
+     * not change while the log is open. */
+    struct ovsdb_log *log;
+    bool converting;
+
+    pthread_t reader;
+    pthread_t *parsers;
+    size_t n_parsers;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;        /* Broadcast on any change below. */
+
+    /* Protected by 'mutex'.  Record number 'i' is in slots[i % REPLAY_WINDOW]
+     * from when it is read until it is applied. */
+    struct ovsdb_replay_slot slots[REPLAY_WINDOW];
+    uint64_t n_read;            /* Number of records read. */
+    uint64_t n_claimed;         /* Number of records claimed by parsers. */
+    uint64_t n_applied;         /* Number of records applied. */
+    bool read_done;             /* Reader reached end of file or an error. */
+    struct ovsdb_error *read_error; /* Error that stopped the reader. */
+    bool exiting;               /* True to make all threads exit. */
+};
+
+static void *
+ovsdb_replay_reader_main(void *r_)
+{
+    struct ovsdb_replay *r = r_;
+
+    ovsrcu_quiesce_start();
+
+    xpthread_mutex_lock(&r->mutex);
+    while (!r->exiting) {
+        struct ovsdb_log_record *record;
+        struct ovsdb_replay_slot *slot;
+        struct ovsdb_error *error;
+
+        if (r->n_read >= r->n_applied + REPLAY_WINDOW) {
+            xpthread_cond_wait(&r->cond, &r->mutex);
+            continue;
+        }
+
+        xpthread_mutex_unlock(&r->mutex);
+        error = ovsdb_log_read_record(r->log, &record);
+        xpthread_mutex_lock(&r->mutex);
+
+        if (error || !record) {
+            r->read_error = error;
+            r->read_done = true;
+            xpthread_cond_broadcast(&r->cond);
+            break;
+        }
+
+        slot = &r->slots[r->n_read++ % REPLAY_WINDOW];
+        slot->record = record;
+        xpthread_cond_broadcast(&r->cond);
+    }
+    xpthread_mutex_unlock(&r->mutex);
+
+    return NULL;
+}
+
+static void *
+ovsdb_replay_parser_main(void *r_)
+{
+    struct ovsdb_replay *r = r_;
+
+    ovsrcu_quiesce_start();
+
+    xpthread_mutex_lock(&r->mutex);
+    while (!r->exiting) {
+        struct ovsdb_replay_slot *slot;
+        struct ovsdb_error *error;
+
+        if (r->n_claimed >= r->n_read) {
+            if (r->read_done) {
+                break;
+            }
+            xpthread_cond_wait(&r->cond, &r->mutex);
+            continue;
+        }
+
+        slot = &r->slots[r->n_claimed++ % REPLAY_WINDOW];
+        xpthread_mutex_unlock(&r->mutex);
+        error = ovsdb_replay_txn_parse(r->db, r->log, slot->record,
+                                       r->converting, &slot->txn);
+        xpthread_mutex_lock(&r->mutex);
+
+        slot->error = error;
+        slot->parsed = true;
+        xpthread_cond_broadcast(&r->cond);
+    }
+    xpthread_mutex_unlock(&r->mutex);
+
+    return NULL;
+}
+
+/* Reads the transactions in 'log' and applies them to 'db' using a parallel
+ * replay with 'n_parsers' parser threads.  Returns the first error, if any,
+ * and rewinds 'log' to the record that caused it, just like the sequential
+ * loop in ovsdb_file_replay(). */
+static struct ovsdb_error *
+ovsdb_file_replay_parallel(struct ovsdb *db, struct ovsdb_log *log,
+                           bool converting, size_t n_parsers,
+                           long long int *oldest_commit,
+                           unsigned int *n_transactions)
+{
+    struct ovsdb_log_record *bad_record = NULL;
+    struct ovsdb_error *error = NULL;
+    struct ovsdb_replay r;
+    size_t i;
+
+    memset(&r, 0, sizeof r);
+    r.db = db;
+    r.log = log;
+    r.converting = converting;
+    for (i = 0; i < REPLAY_WINDOW; i++) {
+        ovsdb_replay_txn_init(&r.slots[i].txn);
+    }
+    xpthread_mutex_init(&r.mutex, NULL);
+    xpthread_cond_init(&r.cond, NULL);
+
+    xpthread_create(&r.reader, NULL, ovsdb_replay_reader_main, &r);
+    r.n_parsers = n_parsers;
+    r.parsers = xmalloc(n_parsers * sizeof *r.parsers);
+    for (i = 0; i < n_parsers; i++) {
+        xpthread_create(&r.parsers[i], NULL, ovsdb_replay_parser_main, &r);
+    }
+
+    xpthread_mutex_lock(&r.mutex);
+    for (;;) {
+        struct ovsdb_replay_slot *slot = &r.slots[r.n_applied % REPLAY_WINDOW];
+
+        if (r.n_applied >= r.n_read) {
+            if (r.read_done) {
+                error = r.read_error;
+                r.read_error = NULL;
+                break;
+            }
+            xpthread_cond_wait(&r.cond, &r.mutex);
+            continue;
+        } else if (!slot->parsed) {
+            xpthread_cond_wait(&r.cond, &r.mutex);
+            continue;
+        }
+        xpthread_mutex_unlock(&r.mutex);
+
+        error = slot->error;
+        slot->error = NULL;
+        if (!error) {
+            error = ovsdb_replay_txn_apply(db, &slot->txn);
+        }
+        if (!error) {
+            (*n_transactions)++;
+            *oldest_commit = MIN(*oldest_commit, slot->txn.date);
+        }
+        ovsdb_replay_txn_destroy(&slot->txn);
+
+        xpthread_mutex_lock(&r.mutex);
+        if (error) {
+            bad_record = slot->record;
+        } else {
+            ovsdb_log_record_destroy(slot->record);
+        }
+        slot->record = NULL;
+        slot->parsed = false;
+        if (error) {
+            break;
+        }
+        r.n_applied++;
+        xpthread_cond_broadcast(&r.cond);
+    }
+    r.exiting = true;
+    xpthread_cond_broadcast(&r.cond);
+    xpthread_mutex_unlock(&r.mutex);
+
+    xpthread_join(r.reader, NULL);
+    for (i = 0; i < n_parsers; i++) {
+        xpthread_join(r.parsers[i], NULL);
+    }
+    free(r.parsers);
+
+    /* Discard whatever was read or parsed beyond the record that failed. */
+    for (i = 0; i < REPLAY_WINDOW; i++) {
+        struct ovsdb_replay_slot *slot = &r.slots[i];
+
+        ovsdb_log_record_destroy(slot->record);
+        ovsdb_error_destroy(slot->error);
+        ovsdb_replay_txn_destroy(&slot->txn);
+    }
+    ovsdb_error_destroy(r.read_error);
+    pthread_cond_destroy(&r.cond);
+    pthread_mutex_destroy(&r.mutex);
+
+    if (bad_record) {
+        ovsdb_log_unread_record(log, bad_record);
+        ovsdb_log_record_destroy(bad_record);
+    }
     return error;
 }
 
+/* Reads the transactions in 'log', which has been opened for 'db' and whose
+ * schema record has already been read, and applies them to 'db'.  Stops at the
+ * first error, rewinding 'log' so that a later write overwrites the record
+ * that caused it, and returns the error.
+ *
+ * Adds the number of transactions applied to '*n_transactions' and lowers
+ * '*oldest_commit' to the earliest commit time among them. */
+static struct ovsdb_error *
+ovsdb_file_replay(struct ovsdb *db, struct ovsdb_log *log, bool converting,
+                  long long int *oldest_commit, unsigned int *n_transactions)
+{
+    struct ovsdb_error *error;
+
+    if (n_replay_threads) {
+        return ovsdb_file_replay_parallel(db, log, converting,
+                                          n_replay_threads, oldest_commit,
+                                          n_transactions);
+    }
+
+    for (;;) {
+        struct ovsdb_log_record *record;
+        struct ovsdb_replay_txn rt;
+
+        error = ovsdb_log_read_record(log, &record);
+        if (error || !record) {
+            return error;
+        }
+
+        ovsdb_replay_txn_init(&rt);
+        error = ovsdb_replay_txn_parse(db, log, record, converting, &rt);
+        if (!error) {
+            error = ovsdb_replay_txn_apply(db, &rt);
+        }
+        if (!error) {
+            (*n_transactions)++;
+            *oldest_commit = MIN(*oldest_commit, rt.date);
+        } else {
+            ovsdb_log_unread_record(log, record);
+        }
+        ovsdb_replay_txn_destroy(&rt);
+        ovsdb_log_record_destroy(record);
+
+        if (error) {
+            return error;
+        }
+    }
+}
+
+/* Sets the number of threads that ovsdb_file_open() and related functions use
+ * to parse the log records in a database file to 'n'.  With the default of 0,
+ * each record is read, parsed, and applied in turn in the calling thread.
+ * Otherwise, one more thread reads records, while the calling thread applies
+ * them to the database.
+ *
+ * Threads cannot be used in a process that later calls functions that require
+ * it to be single-threaded, such as process_start().  A process that sets 'n'
+ * nonzero should also call fatal_signal_init() beforehand, since it cannot do
+ * that lazily once it has more than one thread. */
+void
+ovsdb_file_set_replay_threads(unsigned int n)
+{
+    n_replay_threads = n;
+}
+
 static struct ovsdb_error *
 ovsdb_file_save_copy__(const char *file_name, int locking,
                        const char *comment, const struct ovsdb *db,
-                       struct ovsdb_log **logp)
+                       enum ovsdb_log_format format, struct ovsdb_log **logp)
 {
     const struct shash_node *node;
     struct ovsdb_file_txn ftxn;
@@ -447,6 +826,7 @@ ovsdb_file_save_copy__(const char *file_name, int locking,
     if (error) {
         return error;
     }
+    ovsdb_log_set_format(log, format);
 
     /* Write schema. */
     json = ovsdb_schema_to_json(db->schema);
@@ -484,16 +864,18 @@ exit:
     return error;
 }
 
-/* Saves a snapshot of 'db''s current contents as 'file_name'.  If 'comment' is
- * nonnull, then it is added along with the data contents and can be viewed
- * with "ovsdb-tool show-log".
+/* Saves a snapshot of 'db''s current contents as 'file_name', with records in
+ * the given 'format'.  If 'comment' is nonnull, then it is added along with
+ * the data contents and can be viewed with "ovsdb-tool show-log".
  *
  * 'locking' is passed along to ovsdb_log_open() untouched. */
 struct ovsdb_error *
 ovsdb_file_save_copy(const char *file_name, int locking,
-                     const char *comment, const struct ovsdb *db)
+                     const char *comment, const struct ovsdb *db,
+                     enum ovsdb_log_format format)
 {
-    return ovsdb_file_save_copy__(file_name, locking, comment, db, NULL);
+    return ovsdb_file_save_copy__(file_name, locking, comment, db, format,
+                                  NULL);
 }
 
 /* Opens database 'file_name', reads its schema, and closes it.  On success,
@@ -506,6 +888,24 @@ ovsdb_file_read_schema(const char *file_name, struct ovsdb_schema **schemap)
     ovs_assert(schemap != NULL);
     return ovsdb_file_open_log(file_name, OVSDB_LOG_READ_ONLY, NULL, schemap);
 }
+
+/* Opens database 'file_name', reads its schema record, and closes it.  On
+ * success, stores the format of the database's records into '*formatp' and
+ * returns NULL.  On failure, returns an ovsdb_error (which the caller must
+ * destroy). */
+struct ovsdb_error *
+ovsdb_file_read_format(const char *file_name, enum ovsdb_log_format *formatp)
+{
+    struct ovsdb_error *error;
+    struct ovsdb_log *log;
+
+    error = ovsdb_file_open_log(file_name, OVSDB_LOG_READ_ONLY, &log, NULL);
+    if (!error) {
+        *formatp = ovsdb_log_get_format(log);
+        ovsdb_log_close(log);
+    }
+    return error;
+}
 
 /* Replica implementation. */
 
@@ -517,10 +917,51 @@ struct ovsdb_file {
     long long int oldest_commit;
     long long int next_compact;
     unsigned int n_transactions;
+
+    /* Durable commits.  Commits numbered up to 'durable_seqno' are known to
+     * be on disk regardless of the state of 'log', either because they were
+     * committed synchronously or because 'log' replaced the log to which they
+     * were written when the database was compacted. */
+    bool async_commit;
+    uint64_t durable_seqno;
+
+    /* Compaction. */
+    off_t snapshot_size;        /* Size of log after the last compaction. */
+    struct ovsdb_file_compaction *compaction; /* Background compaction. */
+};
+
+/* An online compaction of an ovsdb_file, which writes a snapshot of the
+ * database to a temporary file and then renames it over the database file.
+ *
+ * The main thread takes the snapshot by recording which rows the database
+ * contains and pinning its tables (see ovsdb_table_pin()), which keeps later
+ * transactions from freeing those rows.  Everything else, converting the rows
+ * to JSON and serializing, writing, and syncing the snapshot, may happen in a
+ * separate thread.  Transactions committed in the meantime still go to the
+ * old log, and they are also kept in 'tail' to be appended to the new log
+ * just before it replaces the old one. */
+struct ovsdb_file_compaction {
+    char *comment;              /* Comment for log and snapshot. */
+    char *tmp_name;             /* Name of temporary file. */
+    struct lockfile *tmp_lock;  /* Lock on 'tmp_name'. */
+    struct ovsdb_log *new_log;  /* Log for 'tmp_name'. */
+    struct json *schema;        /* Schema to write to 'new_log'. */
+    struct ovsdb *db;           /* Database with pinned tables, if any. */
+    const struct ovsdb_row **rows; /* Rows to write to 'new_log', by table. */
+    size_t n_rows;
+    struct json *tail;          /* Array of later transactions. */
+
+    /* Background compaction only. */
+    pthread_t thread;
+    struct latch done;          /* Set by 'thread' when it finishes. */
+    struct ovsdb_error *error;  /* Result of writing snapshot. */
 };
 
 static const struct ovsdb_replica_class ovsdb_file_class;
 
+static void ovsdb_file_compaction_destroy(struct ovsdb_file_compaction *);
+static struct ovsdb_error *ovsdb_file_compact_finish(struct ovsdb_file *);
+
 static struct ovsdb_error *
 ovsdb_file_create(struct ovsdb *db, struct ovsdb_log *log,
                   const char *file_name,
@@ -552,6 +993,10 @@ ovsdb_file_create(struct ovsdb *db, struct ovsdb_log *log,
     file->oldest_commit = MIN(oldest_commit, now);
     file->next_compact = file->oldest_commit + COMPACT_MIN_MSEC;
     file->n_transactions = n_transactions;
+    file->async_commit = false;
+    file->durable_seqno = db->durable_seqno;
+    file->snapshot_size = ovsdb_log_get_offset(log);
+    file->compaction = NULL;
     ovsdb_add_replica(db, &file->replica);
 
     *filep = file;
@@ -586,129 +1031,426 @@ ovsdb_file_commit(struct ovsdb_replica *replica,
 
     ovsdb_file_txn_init(&ftxn);
     ovsdb_txn_for_each_change(txn, ovsdb_file_change_cb, &ftxn);
+    if (ftxn.json) {
+        struct json *json;
+
+        /* With asynchronous commits, leave the fsync() to the log's commit
+         * thread, which can group it with those for other durable commits. */
+        json = ovsdb_file_txn_annotate(ftxn.json, ovsdb_txn_get_comment(txn));
+        if (file->compaction) {
+            json_array_add(file->compaction->tail, json_clone(json));
+        }
+        error = ovsdb_file_txn_write(json, durable && !file->async_commit,
+                                     file->log);
+        if (error) {
+            return error;
+        }
+        file->n_transactions++;
+    }
+    if (durable) {
+        if (file->async_commit) {
+            ovsdb_log_commit_start(file->log, file->db->durable_seqno);
+        } else {
+            file->durable_seqno = file->db->durable_seqno;
+        }
+    }
     if (!ftxn.json) {
-        /* Nothing to commit. */
         return NULL;
     }
 
-    error = ovsdb_file_txn_commit(ftxn.json, ovsdb_txn_get_comment(txn),
-                                  durable, file->log);
-    if (error) {
-        return error;
-    }
-    file->n_transactions++;
-
     /* If it has been at least COMPACT_MIN_MSEC ms since the last time we
      * compacted (or at least COMPACT_RETRY_MSEC ms since the last time we
-     * tried), and if there are at least 100 transactions in the database, and
-     * if the database is at least 10 MB, then compact the database. */
-    if (time_msec() >= file->next_compact
+     * tried), or if the log has grown to COMPACT_GROWTH_RATIO times its size
+     * just after the last compaction, and if there are at least 100
+     * transactions in the database, and if the database is at least 10 MB,
+     * then compact the database. */
+    if (!file->compaction
         && file->n_transactions >= 100
-        && ovsdb_log_get_offset(file->log) >= 10 * 1024 * 1024)
+        && ovsdb_log_get_offset(file->log) >= 10 * 1024 * 1024
+        && (time_msec() >= file->next_compact
+            || (ovsdb_log_get_offset(file->log)
+                >= COMPACT_GROWTH_RATIO * file->snapshot_size)))
     {
-        error = ovsdb_file_compact(file);
-        if (error) {
-            char *s = ovsdb_error_to_string(error);
-            ovsdb_error_destroy(error);
-            VLOG_WARN("%s: compacting database failed (%s), retrying in "
-                      "%d seconds",
-                      file->file_name, s, COMPACT_RETRY_MSEC / 1000);
-            free(s);
-
-            file->next_compact = time_msec() + COMPACT_RETRY_MSEC;
-        }
+        /* Failures are logged, so the error can be ignored. */
+        error = (file->async_commit
+                 ? ovsdb_file_compact_start(file)
+                 : ovsdb_file_compact(file));
+        ovsdb_error_destroy(error);
     }
 
     return NULL;
 }
 
-struct ovsdb_error *
-ovsdb_file_compact(struct ovsdb_file *file)
+/* Logs 'error', which occurred while compacting 'file', and arranges to try
+ * again later. */
+static void
+ovsdb_file_compact_failed(struct ovsdb_file *file,
+                          const struct ovsdb_error *error)
+{
+    char *s = ovsdb_error_to_string(error);
+    VLOG_WARN("%s: compacting database failed (%s), retrying in "
+              "%d seconds",
+              file->file_name, s, COMPACT_RETRY_MSEC / 1000);
+    free(s);
+
+    /* Also keep the log growth trigger from retrying immediately. */
+    file->next_compact = time_msec() + COMPACT_RETRY_MSEC;
+    file->snapshot_size = ovsdb_log_get_offset(file->log);
+}
+
+static struct ovsdb_error *
+ovsdb_file_compaction_create(struct ovsdb_file *file,
+                             struct ovsdb_file_compaction **cp)
 {
-    struct ovsdb_log *new_log = NULL;
-    struct lockfile *tmp_lock = NULL;
+    struct ovsdb_file_compaction *c;
+    const struct shash_node *node;
     struct ovsdb_error *error;
-    char *tmp_name = NULL;
-    char *comment = NULL;
+    size_t n_rows;
     int retval;
 
-    comment = xasprintf("compacting database online "
-                        "(%.3f seconds old, %u transactions, %llu bytes)",
-                        (time_msec() - file->oldest_commit) / 1000.0,
-                        file->n_transactions,
-                        (unsigned long long) ovsdb_log_get_offset(file->log));
-    VLOG_INFO("%s: %s", file->file_name, comment);
-
-    /* Commit the old version, so that we can be assured that we'll eventually
-     * have either the old or the new version. */
-    error = ovsdb_log_commit(file->log);
-    if (error) {
-        goto exit;
-    }
+    c = xzalloc(sizeof *c);
+    c->comment = xasprintf("compacting database online "
+                           "(%.3f seconds old, %u transactions, %llu bytes)",
+                           (time_msec() - file->oldest_commit) / 1000.0,
+                           file->n_transactions,
+                           (unsigned long long) ovsdb_log_get_offset(
+                               file->log));
+    VLOG_INFO("%s: %s", file->file_name, c->comment);
 
     /* Lock temporary file. */
-    tmp_name = xasprintf("%s.tmp", file->file_name);
-    retval = lockfile_lock(tmp_name, &tmp_lock);
+    c->tmp_name = xasprintf("%s.tmp", file->file_name);
+    retval = lockfile_lock(c->tmp_name, &c->tmp_lock);
     if (retval) {
-        error = ovsdb_io_error(retval, "could not get lock on %s", tmp_name);
-        goto exit;
+        error = ovsdb_io_error(retval, "could not get lock on %s",
+                               c->tmp_name);
+        goto error;
     }
 
     /* Remove temporary file.  (It might not exist.) */
-    if (unlink(tmp_name) < 0 && errno != ENOENT) {
-        error = ovsdb_io_error(errno, "failed to remove %s", tmp_name);
-        goto exit;
+    if (unlink(c->tmp_name) < 0 && errno != ENOENT) {
+        error = ovsdb_io_error(errno, "failed to remove %s", c->tmp_name);
+        goto error;
     }
 
-    /* Save a copy. */
-    error = ovsdb_file_save_copy__(tmp_name, false, comment, file->db,
-                                   &new_log);
+    error = ovsdb_log_open(c->tmp_name, OVSDB_LOG_CREATE, false, &c->new_log);
     if (error) {
-        goto exit;
+        goto error;
+    }
+    ovsdb_log_set_format(c->new_log, ovsdb_log_get_format(file->log));
+
+    /* Take the snapshot. */
+    c->schema = ovsdb_schema_to_json(file->db->schema);
+    n_rows = 0;
+    SHASH_FOR_EACH (node, &file->db->tables) {
+        const struct ovsdb_table *table = node->data;
+
+        n_rows += hmap_count(&table->rows);
+    }
+    c->rows = xmalloc(n_rows * sizeof *c->rows);
+    SHASH_FOR_EACH (node, &file->db->tables) {
+        struct ovsdb_table *table = node->data;
+        const struct ovsdb_row *row;
+
+        HMAP_FOR_EACH (row, hmap_node, &table->rows) {
+            c->rows[c->n_rows++] = row;
+        }
+        ovsdb_table_pin(table);
+    }
+    c->db = file->db;
+    c->tail = json_array_create_empty();
+
+    *cp = c;
+    return NULL;
+
+error:
+    ovsdb_file_compact_failed(file, error);
+    ovsdb_file_compaction_destroy(c);
+    *cp = NULL;
+    return error;
+}
+
+/* Writes the snapshot in 'c' to its new log and syncs it to disk.  This only
+ * reads the columns of the pinned rows in the snapshot and does not touch the
+ * ovsdb_file, so it is safe to call from a thread other than the one that owns
+ * them. */
+static struct ovsdb_error *
+ovsdb_file_compaction_write(struct ovsdb_file_compaction *c)
+{
+    struct ovsdb_file_txn ftxn;
+    struct ovsdb_error *error;
+    struct json *data;
+    size_t i;
+
+    ovsdb_file_txn_init(&ftxn);
+    for (i = 0; i < c->n_rows; i++) {
+        ovsdb_file_txn_add_row(&ftxn, NULL, c->rows[i], NULL);
+    }
+    data = ovsdb_file_txn_annotate(ftxn.json, c->comment);
+
+    error = ovsdb_log_write(c->new_log, c->schema);
+    if (!error) {
+        error = ovsdb_log_write(c->new_log, data);
+    }
+    if (!error) {
+        error = ovsdb_log_commit(c->new_log);
+    }
+
+    json_destroy(c->schema);
+    c->schema = NULL;
+    json_destroy(data);
+
+    return error;
+}
+
+static void *
+ovsdb_file_compaction_main(void *c_)
+{
+    struct ovsdb_file_compaction *c = c_;
+
+    /* This thread never touches memory protected by RCU. */
+    ovsrcu_quiesce_start();
+
+    c->error = ovsdb_file_compaction_write(c);
+    latch_set(&c->done);
+    return NULL;
+}
+
+static void
+ovsdb_file_compaction_destroy(struct ovsdb_file_compaction *c)
+{
+    if (c) {
+        if (c->new_log) {
+            ovsdb_log_close(c->new_log);
+            unlink(c->tmp_name);
+        }
+        if (c->db) {
+            struct shash_node *node;
+
+            SHASH_FOR_EACH (node, &c->db->tables) {
+                ovsdb_table_unpin(node->data);
+            }
+        }
+        lockfile_unlock(c->tmp_lock);
+        free(c->tmp_name);
+        free(c->comment);
+        json_destroy(c->schema);
+        free(c->rows);
+        json_destroy(c->tail);
+        free(c);
+    }
+}
+
+/* Completes compaction 'c' of 'file', whose snapshot has been written with
+ * result 'error', by appending the transactions committed since the snapshot
+ * was taken and replacing the database file by the new one.  Destroys 'c'. */
+static struct ovsdb_error *
+ovsdb_file_compaction_finish(struct ovsdb_file *file,
+                             struct ovsdb_file_compaction *c,
+                             struct ovsdb_error *error)
+{
+    if (!error) {
+        const struct json_array *tail = json_array(c->tail);
+        size_t i;
+
+        for (i = 0; !error && i < tail->n; i++) {
+            error = ovsdb_log_write(c->new_log, tail->elems[i]);
+        }
+        if (!error && tail->n) {
+            error = ovsdb_log_commit(c->new_log);
+        }
     }
 
     /* Replace original by temporary. */
-    if (rename(tmp_name, file->file_name)) {
+    if (!error && rename(c->tmp_name, file->file_name)) {
         error = ovsdb_io_error(errno, "failed to rename \"%s\" to \"%s\"",
-                               tmp_name, file->file_name);
-        goto exit;
+                               c->tmp_name, file->file_name);
     }
-    fsync_parent_dir(file->file_name);
 
-exit:
     if (!error) {
+        fsync_parent_dir(file->file_name);
+
         ovsdb_log_close(file->log);
-        file->log = new_log;
+        file->log = c->new_log;
+        c->new_log = NULL;
+        file->durable_seqno = file->db->durable_seqno;
         file->oldest_commit = time_msec();
         file->next_compact = file->oldest_commit + COMPACT_MIN_MSEC;
-        file->n_transactions = 1;
+        file->n_transactions = 1 + json_array(c->tail)->n;
+        file->snapshot_size = ovsdb_log_get_offset(file->log);
     } else {
-        ovsdb_log_close(new_log);
-        if (tmp_lock) {
-            unlink(tmp_name);
-        }
+        ovsdb_file_compact_failed(file, error);
     }
-
-    lockfile_unlock(tmp_lock);
-    free(tmp_name);
-    free(comment);
+    ovsdb_file_compaction_destroy(c);
 
     return error;
 }
 
+/* Compacts 'file' in-place, synchronously.  If a background compaction of
+ * 'file' is in progress, waits for it to finish instead. */
+struct ovsdb_error *
+ovsdb_file_compact(struct ovsdb_file *file)
+{
+    struct ovsdb_file_compaction *c;
+    struct ovsdb_error *error;
+
+    if (file->compaction) {
+        xpthread_join(file->compaction->thread, NULL);
+        return ovsdb_file_compact_finish(file);
+    }
+
+    error = ovsdb_file_compaction_create(file, &c);
+    if (error) {
+        return error;
+    }
+    return ovsdb_file_compaction_finish(file, c,
+                                        ovsdb_file_compaction_write(c));
+}
+
+/* Starts compacting 'file' in-place in a background thread, unless a
+ * compaction is already in progress.  The caller must call
+ * ovsdb_file_compact_run() from its main loop to complete the compaction.
+ * Returns an error if the compaction could not be started.
+ *
+ * Like ovsdb_file_enable_async_commit(), this is only for processes that are
+ * ready to become multithreaded. */
+struct ovsdb_error *
+ovsdb_file_compact_start(struct ovsdb_file *file)
+{
+    struct ovsdb_file_compaction *c;
+    struct ovsdb_error *error;
+
+    if (file->compaction) {
+        return NULL;
+    }
+
+    error = ovsdb_file_compaction_create(file, &c);
+    if (error) {
+        return error;
+    }
+
+    latch_init(&c->done);
+    file->compaction = c;
+    xpthread_create(&c->thread, NULL, ovsdb_file_compaction_main, c);
+    return NULL;
+}
+
+/* Returns true if a background compaction of 'file' is in progress. */
+bool
+ovsdb_file_compact_is_running(const struct ovsdb_file *file)
+{
+    return file->compaction != NULL;
+}
+
+/* Completes the background compaction of 'file' started by
+ * ovsdb_file_compact_start(), if it has written its snapshot.  Returns true if
+ * it completed, storing its result in '*errorp' (NULL on success, otherwise an
+ * error that the caller must free).  Otherwise, returns false and stores NULL
+ * in '*errorp'. */
+bool
+ovsdb_file_compact_run(struct ovsdb_file *file, struct ovsdb_error **errorp)
+{
+    *errorp = NULL;
+    if (!file->compaction || !latch_is_set(&file->compaction->done)) {
+        return false;
+    }
+
+    xpthread_join(file->compaction->thread, NULL);
+    *errorp = ovsdb_file_compact_finish(file);
+    return true;
+}
+
+void
+ovsdb_file_compact_wait(const struct ovsdb_file *file)
+{
+    if (file->compaction) {
+        latch_wait(&file->compaction->done);
+    }
+}
+
+/* Completes 'file''s background compaction, whose thread has exited. */
+static struct ovsdb_error *
+ovsdb_file_compact_finish(struct ovsdb_file *file)
+{
+    struct ovsdb_file_compaction *c = file->compaction;
+
+    file->compaction = NULL;
+    latch_destroy(&c->done);
+    return ovsdb_file_compaction_finish(file, c, c->error);
+}
+
 static void
 ovsdb_file_destroy(struct ovsdb_replica *replica)
 {
     struct ovsdb_file *file = ovsdb_file_cast(replica);
 
+    if (file->compaction) {
+        struct ovsdb_file_compaction *c = file->compaction;
+
+        xpthread_join(c->thread, NULL);
+        latch_destroy(&c->done);
+        ovsdb_error_destroy(c->error);
+        ovsdb_file_compaction_destroy(c);
+    }
     ovsdb_log_close(file->log);
     free(file->file_name);
     free(file);
 }
 
+/* Makes durable transactions committed to 'file' from now on finish in the
+ * background, grouping their fsync() calls together.  The caller must then use
+ * ovsdb_is_durable() to find out when each one is actually durable.
+ *
+ * Unlike a synchronous durable commit, which fails without changing the
+ * database if fsync() fails, a transaction committed this way is already
+ * visible in memory by the time fsync() fails.  ovsdb_is_durable() reports the
+ * failure for the transactions covered by that fsync() only.
+ *
+ * This starts a thread the first time a durable transaction is committed, so
+ * it should only be used by a process that is ready to become
+ * multithreaded. */
+void
+ovsdb_file_enable_async_commit(struct ovsdb_file *file)
+{
+    file->async_commit = true;
+}
+
+static bool
+ovsdb_file_is_durable(struct ovsdb_replica *replica, uint64_t seqno,
+                      struct ovsdb_error **errorp)
+{
+    struct ovsdb_file *file = ovsdb_file_cast(replica);
+
+    if (seqno <= file->durable_seqno) {
+        *errorp = NULL;
+        return true;
+    } else if (ovsdb_log_commit_is_done(file->log, seqno, errorp)) {
+        if (*errorp) {
+            *errorp = ovsdb_wrap_error(*errorp,
+                                       "committing transaction failed");
+        }
+        return true;
+    } else {
+        return false;
+    }
+}
+
+static void
+ovsdb_file_durable_wait(struct ovsdb_replica *replica, uint64_t seqno)
+{
+    struct ovsdb_file *file = ovsdb_file_cast(replica);
+
+    if (seqno <= file->durable_seqno) {
+        poll_immediate_wake();
+    } else {
+        ovsdb_log_commit_wait(file->log, seqno);
+    }
+}
+
 static const struct ovsdb_replica_class ovsdb_file_class = {
     ovsdb_file_commit,
-    ovsdb_file_destroy
+    ovsdb_file_destroy,
+    ovsdb_file_is_durable,
+    ovsdb_file_durable_wait
 };
 
 static void
@@ -775,12 +1517,11 @@ ovsdb_file_txn_add_row(struct ovsdb_file_txn *ftxn,
     }
 }
 
-static struct ovsdb_error *
-ovsdb_file_txn_commit(struct json *json, const char *comment,
-                      bool durable, struct ovsdb_log *log)
+/* Adds 'comment' (if nonnull) and the current time to 'json', the JSON for a
+ * transaction (or null for an empty transaction), and returns it. */
+static struct json *
+ovsdb_file_txn_annotate(struct json *json, const char *comment)
 {
-    struct ovsdb_error *error;
-
     if (!json) {
         json = json_object_create();
     }
@@ -788,6 +1529,23 @@ ovsdb_file_txn_commit(struct json *json, const char *comment,
         json_object_put_string(json, "_comment", comment);
     }
     json_object_put(json, "_date", json_integer_create(time_wall()));
+    return json;
+}
+
+static struct ovsdb_error *
+ovsdb_file_txn_commit(struct json *json, const char *comment,
+                      bool durable, struct ovsdb_log *log)
+{
+    return ovsdb_file_txn_write(ovsdb_file_txn_annotate(json, comment),
+                                durable, log);
+}
+
+/* Writes 'json', an annotated transaction, to 'log' and destroys it.  If
+ * 'durable' is true, also commits it to disk. */
+static struct ovsdb_error *
+ovsdb_file_txn_write(struct json *json, bool durable, struct ovsdb_log *log)
+{
+    struct ovsdb_error *error;
 
     error = ovsdb_log_write(log, json);
     json_destroy(json);
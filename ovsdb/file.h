@@ -35,13 +35,26 @@ struct ovsdb_error *ovsdb_file_open_as_schema(const char *file_name,
 
 struct ovsdb_error *ovsdb_file_save_copy(const char *file_name, int locking,
                                          const char *comment,
-                                         const struct ovsdb *)
+                                         const struct ovsdb *,
+                                         enum ovsdb_log_format)
     WARN_UNUSED_RESULT;
 
 struct ovsdb_error *ovsdb_file_compact(struct ovsdb_file *);
+struct ovsdb_error *ovsdb_file_compact_start(struct ovsdb_file *)
+    WARN_UNUSED_RESULT;
+bool ovsdb_file_compact_is_running(const struct ovsdb_file *);
+bool ovsdb_file_compact_run(struct ovsdb_file *, struct ovsdb_error **);
+void ovsdb_file_compact_wait(const struct ovsdb_file *);
+
+void ovsdb_file_enable_async_commit(struct ovsdb_file *);
+
+void ovsdb_file_set_replay_threads(unsigned int);
 
 struct ovsdb_error *ovsdb_file_read_schema(const char *file_name,
                                            struct ovsdb_schema **)
     WARN_UNUSED_RESULT;
+struct ovsdb_error *ovsdb_file_read_format(const char *file_name,
+                                           enum ovsdb_log_format *)
+    WARN_UNUSED_RESULT;
 
 #endif /* ovsdb/file.h */
@@ -21,12 +21,17 @@
 
 #include "bitmap.h"
 #include "column.h"
+#include "condition.h"
 #include "dynamic-string.h"
+#include "hash.h"
 #include "json.h"
 #include "jsonrpc.h"
+#include "latch.h"
+#include "ovs-thread.h"
 #include "ovsdb-error.h"
 #include "ovsdb-parser.h"
 #include "ovsdb.h"
+#include "poll-loop.h"
 #include "reconnect.h"
 #include "row.h"
 #include "server.h"
@@ -36,6 +41,7 @@
 #include "timeval.h"
 #include "transaction.h"
 #include "trigger.h"
+#include "uuid.h"
 #include "vlog.h"
 
 VLOG_DEFINE_THIS_MODULE(ovsdb_jsonrpc_server);
@@ -46,6 +52,14 @@ struct ovsdb_jsonrpc_session;
 /* Message rate-limiting. */
 static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
 
+/* Transaction history. */
+static struct ovsdb_jsonrpc_history *ovsdb_jsonrpc_history_find(
+    const struct ovsdb *);
+static void ovsdb_jsonrpc_history_create(struct ovsdb *);
+static void ovsdb_jsonrpc_history_add_monitor(struct ovsdb_jsonrpc_history *);
+static void ovsdb_jsonrpc_history_remove_monitor(
+    struct ovsdb_jsonrpc_history *);
+
 /* Sessions. */
 static struct ovsdb_jsonrpc_session *ovsdb_jsonrpc_session_create(
     struct ovsdb_jsonrpc_remote *, struct jsonrpc_session *);
@@ -57,6 +71,8 @@ static void ovsdb_jsonrpc_session_close_all(struct ovsdb_jsonrpc_remote *);
 static void ovsdb_jsonrpc_session_reconnect_all(struct ovsdb_jsonrpc_remote *);
 static void ovsdb_jsonrpc_session_set_all_options(
     struct ovsdb_jsonrpc_remote *, const struct ovsdb_jsonrpc_options *);
+static void ovsdb_jsonrpc_session_acquire(struct ovsdb_jsonrpc_session *);
+static void ovsdb_jsonrpc_session_release(struct ovsdb_jsonrpc_session *);
 static bool ovsdb_jsonrpc_session_get_status(
     const struct ovsdb_jsonrpc_remote *,
     struct ovsdb_jsonrpc_remote_status *);
@@ -75,8 +91,20 @@ static void ovsdb_jsonrpc_trigger_complete_done(
     struct ovsdb_jsonrpc_session *);
 
 /* Monitors. */
+enum ovsdb_jsonrpc_monitor_version {
+    OVSDB_MONITOR_V1,           /* "monitor": "update" notifications. */
+    OVSDB_MONITOR_COND,         /* "monitor_cond": adds "where". */
+    OVSDB_MONITOR_COND_SINCE    /* "monitor_cond_since": adds txn IDs,
+                                 * "update3" notifications. */
+};
+
 static struct json *ovsdb_jsonrpc_monitor_create(
-    struct ovsdb_jsonrpc_session *, struct ovsdb *, struct json *params);
+    struct ovsdb_jsonrpc_session *, struct ovsdb *, struct json *params,
+    enum ovsdb_jsonrpc_monitor_version);
+static struct jsonrpc_msg *ovsdb_jsonrpc_monitor_cond_change(
+    struct ovsdb_jsonrpc_session *,
+    struct json *params,
+    const struct json *request_id);
 static struct jsonrpc_msg *ovsdb_jsonrpc_monitor_cancel(
     struct ovsdb_jsonrpc_session *,
     struct json_array *params,
@@ -84,6 +112,9 @@ static struct jsonrpc_msg *ovsdb_jsonrpc_monitor_cancel(
 static void ovsdb_jsonrpc_monitor_remove_all(struct ovsdb_jsonrpc_session *);
 static size_t ovsdb_jsonrpc_monitor_json_length_all(
     struct ovsdb_jsonrpc_session *);
+static void ovsdb_jsonrpc_monitor_flush_all(struct ovsdb_jsonrpc_session *);
+static bool ovsdb_jsonrpc_monitor_has_pending(
+    const struct ovsdb_jsonrpc_session *);
 
 /* JSON-RPC database server. */
 
@@ -91,8 +122,32 @@ struct ovsdb_jsonrpc_server {
     struct ovsdb_server up;
     unsigned int n_sessions, max_sessions;
     struct shash remotes;      /* Contains "struct ovsdb_jsonrpc_remote *"s. */
+
+    /* Worker threads, started along with the first session. */
+    size_t n_threads;           /* Number of workers to start. */
+    struct ovsdb_jsonrpc_worker *workers; /* Array of 'n_threads' workers. */
+    struct latch wake;          /* Set by workers for the main thread. */
+};
+
+/* A thread that does the network side of some of a server's sessions: it runs
+ * their jsonrpc_sessions, which sends and receives data (including SSL
+ * handshakes) and parses and serializes JSON, and hands received messages to
+ * the main thread.  The main thread still does everything that involves a
+ * database, so transactions and monitors need no locking. */
+struct ovsdb_jsonrpc_worker {
+    struct ovsdb_jsonrpc_server *server;
+    pthread_t thread;
+    struct latch wake;          /* Set to make the worker check its sessions. */
+
+    pthread_mutex_t mutex;      /* Protects the members below. */
+    struct list sessions;       /* Contains "struct ovsdb_jsonrpc_session"s. */
+    size_t n_sessions;          /* Number of elements in 'sessions'. */
+    bool exiting;               /* Set to make the worker exit. */
 };
 
+static void ovsdb_jsonrpc_server_start_workers(struct ovsdb_jsonrpc_server *);
+static void ovsdb_jsonrpc_server_stop_workers(struct ovsdb_jsonrpc_server *);
+
 /* A configured remote.  This is either a passive stream listener plus a list
  * of the currently connected sessions, or a list of exactly one active
  * session. */
@@ -120,9 +175,28 @@ ovsdb_jsonrpc_server_create(void)
     ovsdb_server_init(&server->up);
     server->max_sessions = 64;
     shash_init(&server->remotes);
+    latch_init(&server->wake);
     return server;
 }
 
+/* Sets the number of worker threads that 'svr' uses to do network I/O and
+ * JSON processing for its sessions to 'n_threads'.  With 0 threads, the
+ * default, the thread that calls ovsdb_jsonrpc_server_run() does all of the
+ * work.  This must be called before 'svr' has any sessions.
+ *
+ * Workers run sessions of every kind, SSL included: stream-ssl serializes its
+ * own reconfiguration against SSL I/O in other threads.  The thread that calls
+ * ovsdb_jsonrpc_server_run() still composes each monitor update and
+ * serializes it once for all of the monitors that share it; the workers only
+ * send that text. */
+void
+ovsdb_jsonrpc_server_set_threads(struct ovsdb_jsonrpc_server *svr,
+                                 size_t n_threads)
+{
+    ovs_assert(!svr->workers);
+    svr->n_threads = n_threads;
+}
+
 /* Adds 'db' to the set of databases served out by 'svr'.  Returns true if
  * successful, false if 'db''s name is the same as some database already in
  * 'server'. */
@@ -139,7 +213,13 @@ ovsdb_jsonrpc_server_add_db(struct ovsdb_jsonrpc_server *svr, struct ovsdb *db)
      * with 'db''s name. */
     ovsdb_jsonrpc_server_reconnect(svr);
 
-    return ovsdb_server_add_db(&svr->up, db);
+    if (!ovsdb_server_add_db(&svr->up, db)) {
+        return false;
+    }
+    if (!ovsdb_jsonrpc_history_find(db)) {
+        ovsdb_jsonrpc_history_create(db);
+    }
+    return true;
 }
 
 /* Removes 'db' from the set of databases served out by 'svr'.  Returns
@@ -168,6 +248,8 @@ ovsdb_jsonrpc_server_destroy(struct ovsdb_jsonrpc_server *svr)
         ovsdb_jsonrpc_server_del_remote(node);
     }
     shash_destroy(&svr->remotes);
+    ovsdb_jsonrpc_server_stop_workers(svr);
+    latch_destroy(&svr->wake);
     ovsdb_server_destroy(&svr->up);
     free(svr);
 }
@@ -302,6 +384,7 @@ ovsdb_jsonrpc_server_run(struct ovsdb_jsonrpc_server *svr)
 {
     struct shash_node *node;
 
+    latch_poll(&svr->wake);
     SHASH_FOR_EACH (node, &svr->remotes) {
         struct ovsdb_jsonrpc_remote *remote = node->data;
 
@@ -331,6 +414,9 @@ ovsdb_jsonrpc_server_wait(struct ovsdb_jsonrpc_server *svr)
 {
     struct shash_node *node;
 
+    if (svr->workers) {
+        latch_wait(&svr->wake);
+    }
     SHASH_FOR_EACH (node, &svr->remotes) {
         struct ovsdb_jsonrpc_remote *remote = node->data;
 
@@ -373,9 +459,24 @@ struct ovsdb_jsonrpc_session {
     /* Monitors. */
     struct hmap monitors;       /* Hmap of "struct ovsdb_jsonrpc_monitor"s. */
 
-    /* Network connectivity. */
+    /* Network connectivity.
+     *
+     * If 'worker' is nonnull, then it runs 'js' and receives messages from
+     * it, and the main thread must hold 'mutex' to use 'js'.  'mutex' is
+     * recursive, so that functions that use 'js' can simply acquire it
+     * whether or not their caller already did. */
     struct jsonrpc_session *js;  /* JSON-RPC session. */
     unsigned int js_seqno;       /* Last jsonrpc_session_get_seqno() value. */
+    pthread_mutex_t mutex;
+    bool wake_worker;            /* Worker should look at 'js' again. */
+
+    /* Worker thread, if any. */
+    struct ovsdb_jsonrpc_worker *worker;
+    struct list worker_node;     /* In 'worker''s 'sessions' list. */
+    struct jsonrpc_msg *received; /* Message for the main thread, if any. */
+    unsigned int received_seqno; /* 'js''s seqno when 'received' arrived. */
+    unsigned int worker_seqno;   /* 'js''s seqno as last seen by 'worker'. */
+    size_t worker_backlog;       /* 'js''s backlog as last seen by 'worker'. */
 };
 
 static void ovsdb_jsonrpc_session_close(struct ovsdb_jsonrpc_session *);
@@ -389,15 +490,19 @@ static void ovsdb_jsonrpc_session_got_request(struct ovsdb_jsonrpc_session *,
                                              struct jsonrpc_msg *);
 static void ovsdb_jsonrpc_session_got_notify(struct ovsdb_jsonrpc_session *,
                                              struct jsonrpc_msg *);
+static void ovsdb_jsonrpc_session_send(struct ovsdb_jsonrpc_session *,
+                                       struct jsonrpc_msg *);
 
 static struct ovsdb_jsonrpc_session *
 ovsdb_jsonrpc_session_create(struct ovsdb_jsonrpc_remote *remote,
                              struct jsonrpc_session *js)
 {
+    struct ovsdb_jsonrpc_server *svr = remote->server;
     struct ovsdb_jsonrpc_session *s;
+    pthread_mutexattr_t attr;
 
     s = xzalloc(sizeof *s);
-    ovsdb_session_init(&s->up, &remote->server->up);
+    ovsdb_session_init(&s->up, &svr->up);
     s->remote = remote;
     list_push_back(&remote->sessions, &s->node);
     hmap_init(&s->triggers);
@@ -407,7 +512,37 @@ ovsdb_jsonrpc_session_create(struct ovsdb_jsonrpc_remote *remote,
     s->js = js;
     s->js_seqno = jsonrpc_session_get_seqno(js);
 
-    remote->server->n_sessions++;
+    xpthread_mutexattr_init(&attr);
+    xpthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    xpthread_mutex_init(&s->mutex, &attr);
+    xpthread_mutexattr_destroy(&attr);
+
+    svr->n_sessions++;
+
+    if (svr->n_threads) {
+        struct ovsdb_jsonrpc_worker *w;
+        size_t i;
+
+        /* Give 's' to the worker with the fewest sessions.  The counts are
+         * only changed by this thread, so reading them unlocked is fine. */
+        if (!svr->workers) {
+            ovsdb_jsonrpc_server_start_workers(svr);
+        }
+        w = &svr->workers[0];
+        for (i = 1; i < svr->n_threads; i++) {
+            if (svr->workers[i].n_sessions < w->n_sessions) {
+                w = &svr->workers[i];
+            }
+        }
+
+        s->worker = w;
+        s->worker_seqno = s->js_seqno;
+        xpthread_mutex_lock(&w->mutex);
+        list_push_back(&w->sessions, &s->worker_node);
+        w->n_sessions++;
+        xpthread_mutex_unlock(&w->mutex);
+        latch_set(&w->wake);
+    }
 
     return s;
 }
@@ -415,6 +550,19 @@ ovsdb_jsonrpc_session_create(struct ovsdb_jsonrpc_remote *remote,
 static void
 ovsdb_jsonrpc_session_close(struct ovsdb_jsonrpc_session *s)
 {
+    /* Take 's' back from its worker, so that nothing below has to worry about
+     * other threads. */
+    if (s->worker) {
+        struct ovsdb_jsonrpc_worker *w = s->worker;
+
+        xpthread_mutex_lock(&w->mutex);
+        list_remove(&s->worker_node);
+        w->n_sessions--;
+        xpthread_mutex_unlock(&w->mutex);
+        s->worker = NULL;
+    }
+    jsonrpc_msg_destroy(s->received);
+
     ovsdb_jsonrpc_monitor_remove_all(s);
     ovsdb_jsonrpc_session_unlock_all(s);
     ovsdb_jsonrpc_trigger_complete_all(s);
@@ -423,18 +571,70 @@ ovsdb_jsonrpc_session_close(struct ovsdb_jsonrpc_session *s)
     hmap_destroy(&s->triggers);
 
     jsonrpc_session_close(s->js);
+    pthread_mutex_destroy(&s->mutex);
     list_remove(&s->node);
     s->remote->server->n_sessions--;
     ovsdb_session_destroy(&s->up);
     free(s);
 }
 
+/* Allows the calling thread to use 's->js'.  Every call must be paired with a
+ * call to ovsdb_jsonrpc_session_release(). */
+static void
+ovsdb_jsonrpc_session_acquire(struct ovsdb_jsonrpc_session *s)
+{
+    xpthread_mutex_lock(&s->mutex);
+}
+
+/* Releases 's->js', which the caller acquired with
+ * ovsdb_jsonrpc_session_acquire(), and lets 's''s worker, if any, know if the
+ * caller sent any messages that it needs to finish sending. */
+static void
+ovsdb_jsonrpc_session_release(struct ovsdb_jsonrpc_session *s)
+{
+    if (s->wake_worker) {
+        s->wake_worker = false;
+        if (s->worker) {
+            latch_set(&s->worker->wake);
+        }
+    }
+    xpthread_mutex_unlock(&s->mutex);
+}
+
+/* Returns the next message received from 's''s client, if any.  The caller
+ * must have acquired 's'. */
+static struct jsonrpc_msg *
+ovsdb_jsonrpc_session_recv(struct ovsdb_jsonrpc_session *s)
+{
+    struct jsonrpc_msg *msg;
+
+    if (!s->worker) {
+        return jsonrpc_session_recv(s->js);
+    }
+
+    msg = s->received;
+    if (msg) {
+        s->received = NULL;
+        s->wake_worker = true;
+        if (s->received_seqno != s->js_seqno) {
+            /* Received on a connection that has since been dropped. */
+            jsonrpc_msg_destroy(msg);
+            msg = NULL;
+        }
+    }
+    return msg;
+}
+
 static int
 ovsdb_jsonrpc_session_run(struct ovsdb_jsonrpc_session *s)
 {
     size_t backlog;
+    int error;
 
-    jsonrpc_session_run(s->js);
+    ovsdb_jsonrpc_session_acquire(s);
+    if (!s->worker) {
+        jsonrpc_session_run(s->js);
+    }
     if (s->js_seqno != jsonrpc_session_get_seqno(s->js)) {
         s->js_seqno = jsonrpc_session_get_seqno(s->js);
         ovsdb_jsonrpc_trigger_complete_all(s);
@@ -442,11 +642,17 @@ ovsdb_jsonrpc_session_run(struct ovsdb_jsonrpc_session *s)
         ovsdb_jsonrpc_session_unlock_all(s);
     }
 
+    /* Once the client has caught up, send it the monitor updates that were
+     * held back while it was behind. */
+    if (!jsonrpc_session_get_backlog(s->js)) {
+        ovsdb_jsonrpc_monitor_flush_all(s);
+    }
+
     ovsdb_jsonrpc_trigger_complete_done(s);
 
     backlog = jsonrpc_session_get_backlog(s->js);
     if (!backlog) {
-        struct jsonrpc_msg *msg = jsonrpc_session_recv(s->js);
+        struct jsonrpc_msg *msg = ovsdb_jsonrpc_session_recv(s);
         if (msg) {
             if (msg->type == JSONRPC_REQUEST) {
                 ovsdb_jsonrpc_session_got_request(s, msg);
@@ -457,6 +663,7 @@ ovsdb_jsonrpc_session_run(struct ovsdb_jsonrpc_session *s)
                           jsonrpc_session_get_name(s->js),
                           jsonrpc_msg_type_to_string(msg->type));
                 jsonrpc_session_force_reconnect(s->js);
+                s->wake_worker = true;
                 jsonrpc_msg_destroy(msg);
             }
         }
@@ -487,6 +694,7 @@ ovsdb_jsonrpc_session_run(struct ovsdb_jsonrpc_session *s)
                       jsonrpc_session_get_name(s->js),
                       backlog - s->reply_backlog, monitor_length);
             jsonrpc_session_force_reconnect(s->js);
+            s->wake_worker = true;
         } else {
             /* The backlog is not unreasonably big.  Only check again after it
              * becomes much bigger. */
@@ -494,16 +702,36 @@ ovsdb_jsonrpc_session_run(struct ovsdb_jsonrpc_session *s)
                                            monitor_length);
         }
     }
-    return jsonrpc_session_is_alive(s->js) ? 0 : ETIMEDOUT;
+    error = jsonrpc_session_is_alive(s->js) ? 0 : ETIMEDOUT;
+    ovsdb_jsonrpc_session_release(s);
+
+    return error;
+}
+
+/* Sends 'msg' to the client of 's'.  Any monitor updates held back for the
+ * client go out first, so that the client sees the effects of a transaction
+ * before it sees the reply to it. */
+static void
+ovsdb_jsonrpc_session_send(struct ovsdb_jsonrpc_session *s,
+                           struct jsonrpc_msg *msg)
+{
+    ovsdb_jsonrpc_session_acquire(s);
+    ovsdb_jsonrpc_monitor_flush_all(s);
+    jsonrpc_session_send(s->js, msg);
+    s->wake_worker = true;
+    ovsdb_jsonrpc_session_release(s);
 }
 
 static void
 ovsdb_jsonrpc_session_set_options(struct ovsdb_jsonrpc_session *session,
                                   const struct ovsdb_jsonrpc_options *options)
 {
+    ovsdb_jsonrpc_session_acquire(session);
     jsonrpc_session_set_max_backoff(session->js, options->max_backoff);
     jsonrpc_session_set_probe_interval(session->js, options->probe_interval);
     jsonrpc_session_set_dscp(session->js, options->dscp);
+    session->wake_worker = true;
+    ovsdb_jsonrpc_session_release(session);
 }
 
 static void
@@ -522,10 +750,21 @@ ovsdb_jsonrpc_session_run_all(struct ovsdb_jsonrpc_remote *remote)
 static void
 ovsdb_jsonrpc_session_wait(struct ovsdb_jsonrpc_session *s)
 {
-    jsonrpc_session_wait(s->js);
+    ovsdb_jsonrpc_session_acquire(s);
+    if (!s->worker) {
+        jsonrpc_session_wait(s->js);
+    }
     if (!jsonrpc_session_get_backlog(s->js)) {
-        jsonrpc_session_recv_wait(s->js);
+        if (ovsdb_jsonrpc_monitor_has_pending(s)) {
+            poll_immediate_wake();
+        }
+        if (!s->worker) {
+            jsonrpc_session_recv_wait(s->js);
+        } else if (s->received) {
+            poll_immediate_wake();
+        }
     }
+    ovsdb_jsonrpc_session_release(s);
 }
 
 static void
@@ -542,9 +781,14 @@ static void
 ovsdb_jsonrpc_session_get_memory_usage(const struct ovsdb_jsonrpc_session *s,
                                        struct simap *usage)
 {
+    struct ovsdb_jsonrpc_session *s_ = CONST_CAST(struct ovsdb_jsonrpc_session *,
+                                                  s);
+
     simap_increase(usage, "triggers", hmap_count(&s->triggers));
     simap_increase(usage, "monitors", hmap_count(&s->monitors));
+    ovsdb_jsonrpc_session_acquire(s_);
     simap_increase(usage, "backlog", jsonrpc_session_get_backlog(s->js));
+    ovsdb_jsonrpc_session_release(s_);
 }
 
 static void
@@ -577,8 +821,15 @@ ovsdb_jsonrpc_session_reconnect_all(struct ovsdb_jsonrpc_remote *remote)
     struct ovsdb_jsonrpc_session *s, *next;
 
     LIST_FOR_EACH_SAFE (s, next, node, &remote->sessions) {
+        bool alive;
+
+        ovsdb_jsonrpc_session_acquire(s);
         jsonrpc_session_force_reconnect(s->js);
-        if (!jsonrpc_session_is_alive(s->js)) {
+        s->wake_worker = true;
+        alive = jsonrpc_session_is_alive(s->js);
+        ovsdb_jsonrpc_session_release(s);
+
+        if (!alive) {
             ovsdb_jsonrpc_session_close(s);
         }
     }
@@ -618,7 +869,7 @@ static bool
 ovsdb_jsonrpc_session_get_status(const struct ovsdb_jsonrpc_remote *remote,
                                  struct ovsdb_jsonrpc_remote_status *status)
 {
-    const struct ovsdb_jsonrpc_session *s;
+    struct ovsdb_jsonrpc_session *s;
     const struct jsonrpc_session *js;
     struct ovsdb_lock_waiter *waiter;
     struct reconnect_stats rstats;
@@ -634,6 +885,7 @@ ovsdb_jsonrpc_session_get_status(const struct ovsdb_jsonrpc_remote *remote,
     s = CONTAINER_OF(remote->sessions.next, struct ovsdb_jsonrpc_session, node);
     js = s->js;
 
+    ovsdb_jsonrpc_session_acquire(s);
     status->is_connected = jsonrpc_session_is_connected(js);
     status->last_error = jsonrpc_session_get_status(js);
 
@@ -643,6 +895,7 @@ ovsdb_jsonrpc_session_get_status(const struct ovsdb_jsonrpc_remote *remote,
         ? UINT_MAX : rstats.msec_since_connect / 1000;
     status->sec_since_disconnect = rstats.msec_since_disconnect == UINT_MAX
         ? UINT_MAX : rstats.msec_since_disconnect / 1000;
+    ovsdb_jsonrpc_session_release(s);
 
     ds_init(&locks_held);
     ds_init(&locks_waiting);
@@ -667,6 +920,132 @@ ovsdb_jsonrpc_session_get_status(const struct ovsdb_jsonrpc_remote *remote,
     return true;
 }
 
+/* JSON-RPC session worker threads. */
+
+/* Runs the network side of 's' on behalf of its worker.  Returns true if the
+ * main thread needs to look at 's', false otherwise. */
+static bool
+ovsdb_jsonrpc_worker_run_session(struct ovsdb_jsonrpc_session *s)
+{
+    unsigned int seqno;
+    size_t backlog;
+    bool changed;
+
+    jsonrpc_session_run(s->js);
+
+    backlog = jsonrpc_session_get_backlog(s->js);
+    seqno = jsonrpc_session_get_seqno(s->js);
+    changed = (seqno != s->worker_seqno
+               || (!backlog && s->worker_backlog)
+               || !jsonrpc_session_is_alive(s->js));
+    s->worker_seqno = seqno;
+    s->worker_backlog = backlog;
+
+    /* Like the main thread does without workers, only receive a request once
+     * the replies to earlier ones have been sent. */
+    if (!backlog && !s->received) {
+        s->received = jsonrpc_session_recv(s->js);
+        if (s->received) {
+            s->received_seqno = seqno;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+static void
+ovsdb_jsonrpc_worker_wait_session(struct ovsdb_jsonrpc_session *s)
+{
+    jsonrpc_session_wait(s->js);
+    if (!jsonrpc_session_get_backlog(s->js) && !s->received) {
+        jsonrpc_session_recv_wait(s->js);
+    }
+}
+
+static void *
+ovsdb_jsonrpc_worker_main(void *w_)
+{
+    struct ovsdb_jsonrpc_worker *w = w_;
+
+    for (;;) {
+        struct ovsdb_jsonrpc_session *s;
+        bool changed = false;
+        bool exiting;
+
+        latch_poll(&w->wake);
+
+        xpthread_mutex_lock(&w->mutex);
+        exiting = w->exiting;
+        LIST_FOR_EACH (s, worker_node, &w->sessions) {
+            xpthread_mutex_lock(&s->mutex);
+            if (ovsdb_jsonrpc_worker_run_session(s)) {
+                changed = true;
+            }
+            ovsdb_jsonrpc_worker_wait_session(s);
+            xpthread_mutex_unlock(&s->mutex);
+        }
+        xpthread_mutex_unlock(&w->mutex);
+
+        if (changed) {
+            latch_set(&w->server->wake);
+        }
+        if (exiting) {
+            break;
+        }
+
+        latch_wait(&w->wake);
+        poll_block();
+    }
+
+    return NULL;
+}
+
+static void
+ovsdb_jsonrpc_server_start_workers(struct ovsdb_jsonrpc_server *svr)
+{
+    size_t i;
+
+    svr->workers = xcalloc(svr->n_threads, sizeof *svr->workers);
+    for (i = 0; i < svr->n_threads; i++) {
+        struct ovsdb_jsonrpc_worker *w = &svr->workers[i];
+
+        w->server = svr;
+        latch_init(&w->wake);
+        xpthread_mutex_init(&w->mutex, NULL);
+        list_init(&w->sessions);
+        w->n_sessions = 0;
+        w->exiting = false;
+        xpthread_create(&w->thread, NULL, ovsdb_jsonrpc_worker_main, w);
+    }
+}
+
+/* Stops 'svr''s worker threads, which must not have any sessions left. */
+static void
+ovsdb_jsonrpc_server_stop_workers(struct ovsdb_jsonrpc_server *svr)
+{
+    size_t i;
+
+    if (!svr->workers) {
+        return;
+    }
+
+    for (i = 0; i < svr->n_threads; i++) {
+        struct ovsdb_jsonrpc_worker *w = &svr->workers[i];
+
+        xpthread_mutex_lock(&w->mutex);
+        ovs_assert(list_is_empty(&w->sessions));
+        w->exiting = true;
+        xpthread_mutex_unlock(&w->mutex);
+        latch_set(&w->wake);
+
+        xpthread_join(w->thread, NULL);
+        pthread_mutex_destroy(&w->mutex);
+        latch_destroy(&w->wake);
+    }
+    free(svr->workers);
+    svr->workers = NULL;
+}
+
 /* Examines 'request' to determine the database to which it relates, and then
  * searches 's' to find that database:
  *
@@ -740,7 +1119,7 @@ ovsdb_jsonrpc_session_notify(struct ovsdb_session *session,
 
     s = CONTAINER_OF(session, struct ovsdb_jsonrpc_session, up);
     params = json_array_create_1(json_string_create(lock_name));
-    jsonrpc_session_send(s->js, jsonrpc_create_notify(method, params));
+    ovsdb_jsonrpc_session_send(s, jsonrpc_create_notify(method, params));
 }
 
 static struct jsonrpc_msg *
@@ -871,13 +1250,26 @@ ovsdb_jsonrpc_session_got_request(struct ovsdb_jsonrpc_session *s,
         if (!reply) {
             reply = execute_transaction(s, db, request);
         }
-    } else if (!strcmp(request->method, "monitor")) {
+    } else if (!strcmp(request->method, "monitor")
+               || !strcmp(request->method, "monitor_cond")
+               || !strcmp(request->method, "monitor_cond_since")) {
         struct ovsdb *db = ovsdb_jsonrpc_lookup_db(s, request, &reply);
         if (!reply) {
+            enum ovsdb_jsonrpc_monitor_version version;
+
+            version = (!strcmp(request->method, "monitor")
+                       ? OVSDB_MONITOR_V1
+                       : !strcmp(request->method, "monitor_cond")
+                       ? OVSDB_MONITOR_COND
+                       : OVSDB_MONITOR_COND_SINCE);
             reply = jsonrpc_create_reply(
-                ovsdb_jsonrpc_monitor_create(s, db, request->params),
+                ovsdb_jsonrpc_monitor_create(s, db, request->params,
+                                             version),
                 request->id);
         }
+    } else if (!strcmp(request->method, "monitor_cond_change")) {
+        reply = ovsdb_jsonrpc_monitor_cond_change(s, request->params,
+                                                  request->id);
     } else if (!strcmp(request->method, "monitor_cancel")) {
         reply = ovsdb_jsonrpc_monitor_cancel(s, json_array(request->params),
                                              request->id);
@@ -915,7 +1307,7 @@ ovsdb_jsonrpc_session_got_request(struct ovsdb_jsonrpc_session *s,
 
     if (reply) {
         jsonrpc_msg_destroy(request);
-        jsonrpc_session_send(s->js, reply);
+        ovsdb_jsonrpc_session_send(s, reply);
     }
 }
 
@@ -970,7 +1362,7 @@ ovsdb_jsonrpc_trigger_create(struct ovsdb_jsonrpc_session *s, struct ovsdb *db,
 
         msg = jsonrpc_create_error(json_string_create("duplicate request ID"),
                                    id);
-        jsonrpc_session_send(s->js, msg);
+        ovsdb_jsonrpc_session_send(s, msg);
         json_destroy(id);
         json_destroy(params);
         return;
@@ -1010,6 +1402,7 @@ ovsdb_jsonrpc_trigger_complete(struct ovsdb_jsonrpc_trigger *t)
 
     s = CONTAINER_OF(t->trigger.session, struct ovsdb_jsonrpc_session, up);
 
+    ovsdb_jsonrpc_session_acquire(s);
     if (jsonrpc_session_is_connected(s->js)) {
         struct jsonrpc_msg *reply;
         struct json *result;
@@ -1021,8 +1414,9 @@ ovsdb_jsonrpc_trigger_complete(struct ovsdb_jsonrpc_trigger *t)
             reply = jsonrpc_create_error(json_string_create("canceled"),
                                          t->id);
         }
-        jsonrpc_session_send(s->js, reply);
+        ovsdb_jsonrpc_session_send(s, reply);
     }
+    ovsdb_jsonrpc_session_release(s);
 
     json_destroy(t->id);
     ovsdb_trigger_destroy(&t->trigger);
@@ -1078,22 +1472,109 @@ struct ovsdb_jsonrpc_monitor_table {
     size_t n_columns;
 };
 
-/* A collection of tables being monitored. */
-struct ovsdb_jsonrpc_monitor {
+/* A collection of tables being monitored, shared by all of the monitors on
+ * 'db' whose requests select exactly the same tables, columns, and kinds of
+ * changes.  The group composes and serializes each update only once, however
+ * many monitors and clients it serves. */
+struct ovsdb_jsonrpc_monitor_group {
+    struct ovsdb_replica replica;
+    struct ovsdb *db;
+    struct shash tables;     /* Holds "struct ovsdb_jsonrpc_monitor_table"s. */
+    uint32_t hash;           /* Hash of 'tables', to speed up finding groups. */
+    struct list monitors;    /* Contains "struct ovsdb_jsonrpc_monitor"s. */
+    struct ovsdb_jsonrpc_history *history; /* 'db''s transaction history. */
+};
+
+/* A copy of a change to a row made by a committed transaction. */
+struct ovsdb_jsonrpc_history_row {
+    struct ovsdb_row *old;      /* Old row, NULL if inserted. */
+    struct ovsdb_row *new;      /* New row, NULL if deleted. */
+    unsigned long int *changed; /* Changed columns, NULL unless modified. */
+};
+
+/* A transaction committed to a database. */
+struct ovsdb_jsonrpc_history_txn {
+    struct list node;           /* In "struct ovsdb_jsonrpc_history"'s txns. */
+    struct uuid txn_id;
+    struct ovsdb_jsonrpc_history_row *rows;
+    size_t n_rows;
+};
+
+/* The most recent transactions committed to a database, so that a monitor
+ * client that reconnects can be sent only the changes that it missed.
+ *
+ * Each transaction is identified by a random UUID that is sent to monitor
+ * clients in "update3" notifications.  'base_txn_id' identifies the state of
+ * the database before the first transaction in 'txns', which is the state when
+ * recording began until the history begins to drop old transactions.
+ *
+ * Recording costs a copy of every changed row, so the history only records
+ * while some client uses "monitor_cond_since", and for HISTORY_IDLE_MSEC
+ * after the last one goes away, so that it can catch up when it reconnects. */
+struct ovsdb_jsonrpc_history {
     struct ovsdb_replica replica;
-    struct ovsdb_jsonrpc_session *session;
     struct ovsdb *db;
+    bool recording;             /* Recording transactions? */
+    size_t n_monitors;          /* Number of "monitor_cond_since" monitors. */
+    long long int idle_since;   /* When 'n_monitors' last dropped to 0. */
+    struct uuid base_txn_id;    /* State before the first of 'txns'. */
+    struct uuid last_txn_id;    /* State after the last of 'txns'. */
+    struct list txns;           /* "struct ovsdb_jsonrpc_history_txn"s. */
+    size_t n_txns;              /* Number of elements in 'txns'. */
+    size_t n_rows;              /* Sum of 'n_rows' over 'txns'. */
+};
+
+/* A change to a row that a monitor has not yet sent to its client. */
+struct ovsdb_jsonrpc_monitor_row {
+    struct hmap_node hmap_node; /* In monitor's "pending", hashed on 'uuid'. */
+    const struct ovsdb_jsonrpc_monitor_table *mt;
+    struct uuid uuid;
+    struct json *old;           /* Old column values, NULL if row is new. */
+    struct json *new;           /* New column values, NULL if row deleted. */
+};
+
+/* A monitor requested by a client. */
+struct ovsdb_jsonrpc_monitor {
+    struct ovsdb_jsonrpc_session *session;
     struct hmap_node node;      /* In ovsdb_jsonrpc_session's "monitors". */
+    struct ovsdb_jsonrpc_monitor_group *group;
+    struct list group_node;     /* In 'group''s "monitors". */
 
     struct json *monitor_id;
-    struct shash tables;     /* Holds "struct ovsdb_jsonrpc_monitor_table"s. */
+    enum ovsdb_jsonrpc_monitor_version version;
+
+    /* Maps from the name of a table in 'group' to the "struct
+     * ovsdb_condition" that selects the rows of that table to report to the
+     * client.  All of the rows of a table without a condition are reported.
+     * A monitor without any conditions shares each update with the rest of
+     * its group; one with conditions composes its own. */
+    struct shash conditions;
+
+    /* Changes not yet sent because the client was not keeping up with them.
+     * Holds at most one "struct ovsdb_jsonrpc_monitor_row" per row, merging
+     * later changes into earlier ones, so its size is bounded by the size of
+     * the monitored data no matter how far behind the client falls. */
+    struct hmap pending;
 };
 
 static const struct ovsdb_replica_class ovsdb_jsonrpc_replica_class;
 
 struct ovsdb_jsonrpc_monitor *ovsdb_jsonrpc_monitor_find(
     struct ovsdb_jsonrpc_session *, const struct json *monitor_id);
-static void ovsdb_jsonrpc_monitor_destroy(struct ovsdb_replica *);
+static void ovsdb_jsonrpc_monitor_destroy(struct ovsdb_jsonrpc_monitor *);
+static void ovsdb_jsonrpc_monitor_tables_destroy(struct shash *);
+static void ovsdb_jsonrpc_monitor_conditions_destroy(struct shash *);
+static bool ovsdb_jsonrpc_monitor_catch_up(struct ovsdb_jsonrpc_monitor *,
+                                           const struct uuid *last_txn_id);
+static struct json *ovsdb_jsonrpc_monitor_take_pending(
+    struct ovsdb_jsonrpc_monitor *);
+static struct ovsdb_jsonrpc_monitor_group *ovsdb_jsonrpc_monitor_group_get(
+    struct ovsdb *, struct shash *tables);
+static void ovsdb_jsonrpc_monitor_defer(
+    struct ovsdb_jsonrpc_monitor *, const struct ovsdb_jsonrpc_monitor_table *,
+    const struct uuid *, const struct json *old, const struct json *new);
+static void ovsdb_jsonrpc_monitor_defer_update(struct ovsdb_jsonrpc_monitor *,
+                                               const struct json *update);
 static struct json *ovsdb_jsonrpc_monitor_get_initial(
     const struct ovsdb_jsonrpc_monitor *);
 static size_t ovsdb_jsonrpc_monitor_json_length(
@@ -1150,14 +1631,37 @@ compare_ovsdb_jsonrpc_monitor_column(const void *a_, const void *b_)
     return a->column < b->column ? -1 : a->column > b->column;
 }
 
+/* Parses 'where', an array of <condition>s on table 'ts', and adds the
+ * resulting condition to 'conditions' under the table's name.  An empty array
+ * selects every row, so nothing is added for one. */
+static struct ovsdb_error * WARN_UNUSED_RESULT
+ovsdb_jsonrpc_parse_monitor_condition(const struct ovsdb_table_schema *ts,
+                                      const struct json *where,
+                                      struct shash *conditions)
+{
+    struct ovsdb_condition *cond;
+    struct ovsdb_error *error;
+
+    cond = xmalloc(sizeof *cond);
+    error = ovsdb_condition_from_json(ts, where, NULL, cond);
+    if (error || !cond->n_clauses) {
+        ovsdb_condition_destroy(cond);
+        free(cond);
+        return error;
+    }
+    shash_add(conditions, ts->name, cond);
+    return NULL;
+}
+
 static struct ovsdb_error * WARN_UNUSED_RESULT
 ovsdb_jsonrpc_parse_monitor_request(struct ovsdb_jsonrpc_monitor_table *mt,
                                     const struct json *monitor_request,
-                                    size_t *allocated_columns)
+                                    size_t *allocated_columns,
+                                    struct shash *conditions)
 {
     const struct ovsdb_table_schema *ts = mt->table->schema;
     enum ovsdb_jsonrpc_monitor_selection select;
-    const struct json *columns, *select_json;
+    const struct json *columns, *select_json, *where;
     struct ovsdb_parser parser;
     struct ovsdb_error *error;
 
@@ -1165,11 +1669,25 @@ ovsdb_jsonrpc_parse_monitor_request(struct ovsdb_jsonrpc_monitor_table *mt,
     columns = ovsdb_parser_member(&parser, "columns", OP_ARRAY | OP_OPTIONAL);
     select_json = ovsdb_parser_member(&parser, "select",
                                       OP_OBJECT | OP_OPTIONAL);
+    where = (conditions
+             ? ovsdb_parser_member(&parser, "where", OP_ARRAY | OP_OPTIONAL)
+             : NULL);
     error = ovsdb_parser_finish(&parser);
     if (error) {
         return error;
     }
 
+    if (where) {
+        if (shash_find(conditions, ts->name)) {
+            return ovsdb_syntax_error(where, NULL, "table %s has more than "
+                                      "one \"where\" condition", ts->name);
+        }
+        error = ovsdb_jsonrpc_parse_monitor_condition(ts, where, conditions);
+        if (error) {
+            return error;
+        }
+    }
+
     if (select_json) {
         select = 0;
         ovsdb_parser_init(&parser, select_json, "table %s select", ts->name);
@@ -1237,15 +1755,22 @@ ovsdb_jsonrpc_parse_monitor_request(struct ovsdb_jsonrpc_monitor_table *mt,
 
 static struct json *
 ovsdb_jsonrpc_monitor_create(struct ovsdb_jsonrpc_session *s, struct ovsdb *db,
-                             struct json *params)
+                             struct json *params,
+                             enum ovsdb_jsonrpc_monitor_version version)
 {
-    struct ovsdb_jsonrpc_monitor *m = NULL;
+    bool conditional = version != OVSDB_MONITOR_V1;
+    struct ovsdb_jsonrpc_monitor *m;
     struct json *monitor_id, *monitor_requests;
     struct ovsdb_error *error = NULL;
     struct shash_node *node;
+    struct shash tables, conditions;
+    struct uuid last_txn_id;
     struct json *json;
 
-    if (json_array(params)->n != 3) {
+    shash_init(&tables);
+    shash_init(&conditions);
+    if (json_array(params)->n
+        != (version == OVSDB_MONITOR_COND_SINCE ? 4 : 3)) {
         error = ovsdb_syntax_error(params, NULL, "invalid parameters");
         goto error;
     }
@@ -1256,21 +1781,22 @@ ovsdb_jsonrpc_monitor_create(struct ovsdb_jsonrpc_session *s, struct ovsdb *db,
                                    "monitor-requests must be object");
         goto error;
     }
+    if (version == OVSDB_MONITOR_COND_SINCE) {
+        const struct json *last_txn_json = params->u.array.elems[3];
+
+        if (last_txn_json->type != JSON_STRING
+            || !uuid_from_string(&last_txn_id, json_string(last_txn_json))) {
+            error = ovsdb_syntax_error(last_txn_json, NULL,
+                                       "last-txn-id must be a UUID");
+            goto error;
+        }
+    }
 
     if (ovsdb_jsonrpc_monitor_find(s, monitor_id)) {
         error = ovsdb_syntax_error(monitor_id, NULL, "duplicate monitor ID");
         goto error;
     }
 
-    m = xzalloc(sizeof *m);
-    ovsdb_replica_init(&m->replica, &ovsdb_jsonrpc_replica_class);
-    ovsdb_add_replica(db, &m->replica);
-    m->session = s;
-    m->db = db;
-    hmap_insert(&s->monitors, &m->node, json_hash(monitor_id, 0));
-    m->monitor_id = json_clone(monitor_id);
-    shash_init(&m->tables);
-
     SHASH_FOR_EACH (node, json_object(monitor_requests)) {
         const struct ovsdb_table *table;
         struct ovsdb_jsonrpc_monitor_table *mt;
@@ -1278,7 +1804,7 @@ ovsdb_jsonrpc_monitor_create(struct ovsdb_jsonrpc_session *s, struct ovsdb *db,
         const struct json *mr_value;
         size_t i;
 
-        table = ovsdb_get_table(m->db, node->name);
+        table = ovsdb_get_table(db, node->name);
         if (!table) {
             error = ovsdb_syntax_error(NULL, NULL,
                                        "no table named %s", node->name);
@@ -1287,7 +1813,7 @@ ovsdb_jsonrpc_monitor_create(struct ovsdb_jsonrpc_session *s, struct ovsdb *db,
 
         mt = xzalloc(sizeof *mt);
         mt->table = table;
-        shash_add(&m->tables, table->schema->name, mt);
+        shash_add(&tables, table->schema->name, mt);
 
         /* Parse columns. */
         mr_value = node->data;
@@ -1297,14 +1823,16 @@ ovsdb_jsonrpc_monitor_create(struct ovsdb_jsonrpc_session *s, struct ovsdb *db,
 
             for (i = 0; i < array->n; i++) {
                 error = ovsdb_jsonrpc_parse_monitor_request(
-                    mt, array->elems[i], &allocated_columns);
+                    mt, array->elems[i], &allocated_columns,
+                    conditional ? &conditions : NULL);
                 if (error) {
                     goto error;
                 }
             }
         } else {
             error = ovsdb_jsonrpc_parse_monitor_request(
-                mt, mr_value, &allocated_columns);
+                mt, mr_value, &allocated_columns,
+                conditional ? &conditions : NULL);
             if (error) {
                 goto error;
             }
@@ -1323,18 +1851,226 @@ ovsdb_jsonrpc_monitor_create(struct ovsdb_jsonrpc_session *s, struct ovsdb *db,
         }
     }
 
+    m = xzalloc(sizeof *m);
+    m->session = s;
+    hmap_insert(&s->monitors, &m->node, json_hash(monitor_id, 0));
+    m->group = ovsdb_jsonrpc_monitor_group_get(db, &tables);
+    list_push_back(&m->group->monitors, &m->group_node);
+    m->monitor_id = json_clone(monitor_id);
+    m->version = version;
+    shash_init(&m->conditions);
+    shash_swap(&m->conditions, &conditions);
+    hmap_init(&m->pending);
+
+    if (version == OVSDB_MONITOR_COND_SINCE) {
+        /* If the client's view of the database is recent enough, send it
+         * only what changed since then instead of everything. */
+        char txn_id[UUID_LEN + 1];
+        bool found;
+
+        ovsdb_jsonrpc_history_add_monitor(m->group->history);
+        found = ovsdb_jsonrpc_monitor_catch_up(m, &last_txn_id);
+
+        snprintf(txn_id, sizeof txn_id, UUID_FMT,
+                 UUID_ARGS(&m->group->history->last_txn_id));
+        return json_array_create_3(
+            json_boolean_create(found), json_string_create(txn_id),
+            (found
+             ? ovsdb_jsonrpc_monitor_take_pending(m)
+             : ovsdb_jsonrpc_monitor_get_initial(m)));
+    }
     return ovsdb_jsonrpc_monitor_get_initial(m);
 
 error:
-    if (m) {
-        ovsdb_remove_replica(m->db, &m->replica);
-    }
+    ovsdb_jsonrpc_monitor_tables_destroy(&tables);
+    ovsdb_jsonrpc_monitor_conditions_destroy(&conditions);
 
     json = ovsdb_error_to_json(error);
     ovsdb_error_destroy(error);
     return json;
 }
 
+/* Returns a JSON object that holds the values in 'row' of each of the columns
+ * in 'mt' that are selected for changes of the given 'type'. */
+static struct json *
+ovsdb_jsonrpc_monitor_row_to_json(const struct ovsdb_jsonrpc_monitor_table *mt,
+                                  const struct ovsdb_row *row,
+                                  enum ovsdb_jsonrpc_monitor_selection type)
+{
+    struct json *json = json_object_create();
+    size_t i;
+
+    for (i = 0; i < mt->n_columns; i++) {
+        const struct ovsdb_jsonrpc_monitor_column *c = &mt->columns[i];
+        const struct ovsdb_column *column = c->column;
+
+        if (type & c->select) {
+            json_object_put(json, column->name,
+                            ovsdb_datum_to_json(&row->fields[column->index],
+                                                &column->type));
+        }
+    }
+    return json;
+}
+
+/* Returns the JSON that reports 'row' to a client as part of the initial
+ * contents of a monitor on 'mt', that is, {"new": {<columns>}}.
+ *
+ * The initial contents of a monitor can be as big as the whole database, so
+ * instead of building a tree of "struct json"s for each row, this serializes
+ * the row's data directly into a JSON_SERIALIZED_OBJECT. */
+static struct json *
+ovsdb_jsonrpc_monitor_initial_row_json(
+    const struct ovsdb_jsonrpc_monitor_table *mt, const struct ovsdb_row *row)
+{
+    struct ds ds = DS_EMPTY_INITIALIZER;
+    size_t n = 0;
+    size_t i;
+
+    ds_put_cstr(&ds, "{\"new\":{");
+    for (i = 0; i < mt->n_columns; i++) {
+        const struct ovsdb_jsonrpc_monitor_column *c = &mt->columns[i];
+        const struct ovsdb_column *column = c->column;
+
+        if (c->select & OJMS_INITIAL) {
+            if (n++) {
+                ds_put_char(&ds, ',');
+            }
+            json_string_escape(column->name, &ds);
+            ds_put_char(&ds, ':');
+            ovsdb_datum_to_json_ds(&row->fields[column->index],
+                                   &column->type, &ds);
+        }
+    }
+    ds_put_cstr(&ds, "}}");
+
+    return json_serialized_object_create_nocopy(ds_steal_cstr(&ds));
+}
+
+/* Replaces the conditions for the tables in 'm' named in 'new_conditions' by
+ * the ones there, destroying the old ones.  Rows of those tables that come
+ * into view are reported to the client as if they were inserted, and those
+ * that drop out of view as if they were deleted. */
+static void
+ovsdb_jsonrpc_monitor_set_conditions(struct ovsdb_jsonrpc_monitor *m,
+                                     const struct shash *tables,
+                                     struct shash *new_conditions)
+{
+    struct shash_node *node;
+
+    SHASH_FOR_EACH (node, tables) {
+        const struct ovsdb_jsonrpc_monitor_table *mt;
+        struct ovsdb_condition *old_cond, *new_cond;
+        const struct ovsdb_row *row;
+
+        mt = shash_find_data(&m->group->tables, node->name);
+        old_cond = shash_find_and_delete(&m->conditions, node->name);
+        new_cond = shash_find_and_delete(new_conditions, node->name);
+        HMAP_FOR_EACH (row, hmap_node, &mt->table->rows) {
+            bool was_visible = !old_cond || ovsdb_condition_evaluate(row,
+                                                                     old_cond);
+            bool is_visible = !new_cond || ovsdb_condition_evaluate(row,
+                                                                    new_cond);
+
+            if (was_visible && !is_visible && mt->select & OJMS_DELETE) {
+                struct json *old;
+
+                old = ovsdb_jsonrpc_monitor_row_to_json(mt, row, OJMS_DELETE);
+                ovsdb_jsonrpc_monitor_defer(m, mt, ovsdb_row_get_uuid(row),
+                                            old, NULL);
+                json_destroy(old);
+            } else if (!was_visible && is_visible
+                       && mt->select & OJMS_INSERT) {
+                struct json *new;
+
+                new = ovsdb_jsonrpc_monitor_row_to_json(mt, row, OJMS_INSERT);
+                ovsdb_jsonrpc_monitor_defer(m, mt, ovsdb_row_get_uuid(row),
+                                            NULL, new);
+                json_destroy(new);
+            }
+        }
+
+        if (old_cond) {
+            ovsdb_condition_destroy(old_cond);
+            free(old_cond);
+        }
+        if (new_cond) {
+            shash_add(&m->conditions, node->name, new_cond);
+        }
+    }
+}
+
+static struct jsonrpc_msg *
+ovsdb_jsonrpc_monitor_cond_change(struct ovsdb_jsonrpc_session *s,
+                                  struct json *params,
+                                  const struct json *request_id)
+{
+    struct ovsdb_jsonrpc_monitor *m;
+    struct shash tables, conditions;
+    struct ovsdb_error *error;
+    struct jsonrpc_msg *reply;
+    struct shash_node *node;
+    struct json *requests;
+
+    if (json_array(params)->n != 2) {
+        return jsonrpc_create_error(json_string_create("invalid parameters"),
+                                    request_id);
+    }
+
+    m = ovsdb_jsonrpc_monitor_find(s, params->u.array.elems[0]);
+    if (!m) {
+        return jsonrpc_create_error(json_string_create("unknown monitor"),
+                                    request_id);
+    }
+
+    /* Parse all of the new conditions before changing any of them. */
+    shash_init(&tables);
+    shash_init(&conditions);
+    requests = params->u.array.elems[1];
+    if (requests->type != JSON_OBJECT) {
+        error = ovsdb_syntax_error(requests, NULL,
+                                   "monitor-cond-change-requests must be "
+                                   "object");
+        goto error;
+    }
+    SHASH_FOR_EACH (node, json_object(requests)) {
+        const struct ovsdb_jsonrpc_monitor_table *mt;
+        const struct json *where;
+        struct ovsdb_parser parser;
+
+        mt = shash_find_data(&m->group->tables, node->name);
+        if (!mt) {
+            error = ovsdb_syntax_error(NULL, NULL, "table %s is not monitored",
+                                       node->name);
+            goto error;
+        }
+
+        ovsdb_parser_init(&parser, node->data, "table %s", node->name);
+        where = ovsdb_parser_member(&parser, "where", OP_ARRAY);
+        error = ovsdb_parser_finish(&parser);
+        if (!error) {
+            error = ovsdb_jsonrpc_parse_monitor_condition(mt->table->schema,
+                                                          where, &conditions);
+        }
+        if (error) {
+            goto error;
+        }
+        shash_add(&tables, node->name, NULL);
+    }
+
+    ovsdb_jsonrpc_monitor_set_conditions(m, &tables, &conditions);
+    shash_destroy(&tables);
+    shash_destroy(&conditions);
+    return jsonrpc_create_reply(json_object_create(), request_id);
+
+error:
+    shash_destroy(&tables);
+    ovsdb_jsonrpc_monitor_conditions_destroy(&conditions);
+    reply = jsonrpc_create_reply(ovsdb_error_to_json(error), request_id);
+    ovsdb_error_destroy(error);
+    return reply;
+}
+
 static struct jsonrpc_msg *
 ovsdb_jsonrpc_monitor_cancel(struct ovsdb_jsonrpc_session *s,
                              struct json_array *params,
@@ -1351,7 +2087,7 @@ ovsdb_jsonrpc_monitor_cancel(struct ovsdb_jsonrpc_session *s,
             return jsonrpc_create_error(json_string_create("unknown monitor"),
                                         request_id);
         } else {
-            ovsdb_remove_replica(m->db, &m->replica);
+            ovsdb_jsonrpc_monitor_destroy(m);
             return jsonrpc_create_reply(json_object_create(), request_id);
         }
     }
@@ -1363,7 +2099,7 @@ ovsdb_jsonrpc_monitor_remove_all(struct ovsdb_jsonrpc_session *s)
     struct ovsdb_jsonrpc_monitor *m, *next;
 
     HMAP_FOR_EACH_SAFE (m, next, node, &s->monitors) {
-        ovsdb_remove_replica(m->db, &m->replica);
+        ovsdb_jsonrpc_monitor_destroy(m);
     }
 }
 
@@ -1383,16 +2119,17 @@ ovsdb_jsonrpc_monitor_json_length_all(struct ovsdb_jsonrpc_session *s)
     return length;
 }
 
-static struct ovsdb_jsonrpc_monitor *
-ovsdb_jsonrpc_monitor_cast(struct ovsdb_replica *replica)
+static struct ovsdb_jsonrpc_monitor_group *
+ovsdb_jsonrpc_monitor_group_cast(struct ovsdb_replica *replica)
 {
     ovs_assert(replica->class == &ovsdb_jsonrpc_replica_class);
-    return CONTAINER_OF(replica, struct ovsdb_jsonrpc_monitor, replica);
+    return CONTAINER_OF(replica, struct ovsdb_jsonrpc_monitor_group, replica);
 }
 
 struct ovsdb_jsonrpc_monitor_aux {
     bool initial;               /* Sending initial contents of table? */
-    const struct ovsdb_jsonrpc_monitor *monitor;
+    const struct shash *tables; /* Tables being monitored. */
+    const struct shash *conditions; /* Conditions on rows, if nonnull. */
     struct json *json;          /* JSON for the whole transaction. */
 
     /* Current table.  */
@@ -1425,7 +2162,6 @@ ovsdb_jsonrpc_monitor_change_cb(const struct ovsdb_row *old,
                                 void *aux_)
 {
     struct ovsdb_jsonrpc_monitor_aux *aux = aux_;
-    const struct ovsdb_jsonrpc_monitor *m = aux->monitor;
     struct ovsdb_table *table = new ? new->table : old->table;
     enum ovsdb_jsonrpc_monitor_selection type;
     struct json *old_json, *new_json;
@@ -1434,7 +2170,7 @@ ovsdb_jsonrpc_monitor_change_cb(const struct ovsdb_row *old,
     size_t i;
 
     if (!aux->mt || table != aux->mt->table) {
-        aux->mt = shash_find_data(&m->tables, table->schema->name);
+        aux->mt = shash_find_data(aux->tables, table->schema->name);
         aux->table_json = NULL;
         if (!aux->mt) {
             /* We don't care about rows in this table at all.  Tell the caller
@@ -1443,7 +2179,26 @@ ovsdb_jsonrpc_monitor_change_cb(const struct ovsdb_row *old,
         }
     }
 
-    type = (aux->initial ? OJMS_INITIAL
+    if (aux->conditions) {
+        const struct ovsdb_condition *cond;
+
+        /* From the client's point of view, a row that comes into view is
+         * inserted and one that drops out of view is deleted. */
+        cond = shash_find_data(aux->conditions, table->schema->name);
+        if (cond) {
+            if (old && !ovsdb_condition_evaluate(old, cond)) {
+                old = NULL;
+            }
+            if (new && !ovsdb_condition_evaluate(new, cond)) {
+                new = NULL;
+            }
+            if (!old && !new) {
+                return true;
+            }
+        }
+    }
+
+    type = (aux->initial ? OJMS_INITIAL
             : !old ? OJMS_INSERT
             : !new ? OJMS_DELETE
             : OJMS_MODIFY);
@@ -1458,11 +2213,32 @@ ovsdb_jsonrpc_monitor_change_cb(const struct ovsdb_row *old,
         return true;
     }
 
+    /* Create JSON object for transaction overall. */
+    if (!aux->json) {
+        aux->json = json_object_create();
+    }
+
+    /* Create JSON object for transaction on this table. */
+    if (!aux->table_json) {
+        aux->table_json = json_object_create();
+        json_object_put(aux->json, aux->mt->table->schema->name,
+                        aux->table_json);
+    }
+
+    /* Add JSON row to JSON table. */
+    snprintf(uuid, sizeof uuid,
+             UUID_FMT, UUID_ARGS(ovsdb_row_get_uuid(new ? new : old)));
+    if (type == OJMS_INITIAL) {
+        row_json = ovsdb_jsonrpc_monitor_initial_row_json(aux->mt, new);
+        json_object_put(aux->table_json, uuid, row_json);
+        return true;
+    }
+
     old_json = new_json = NULL;
     if (type & (OJMS_DELETE | OJMS_MODIFY)) {
         old_json = json_object_create();
     }
-    if (type & (OJMS_INITIAL | OJMS_INSERT | OJMS_MODIFY)) {
+    if (type & (OJMS_INSERT | OJMS_MODIFY)) {
         new_json = json_object_create();
     }
     for (i = 0; i < aux->mt->n_columns; i++) {
@@ -1482,25 +2258,13 @@ ovsdb_jsonrpc_monitor_change_cb(const struct ovsdb_row *old,
                             ovsdb_datum_to_json(&old->fields[idx],
                                                 &column->type));
         }
-        if (type & (OJMS_INITIAL | OJMS_INSERT | OJMS_MODIFY)) {
+        if (type & (OJMS_INSERT | OJMS_MODIFY)) {
             json_object_put(new_json, column->name,
                             ovsdb_datum_to_json(&new->fields[idx],
                                                 &column->type));
         }
     }
 
-    /* Create JSON object for transaction overall. */
-    if (!aux->json) {
-        aux->json = json_object_create();
-    }
-
-    /* Create JSON object for transaction on this table. */
-    if (!aux->table_json) {
-        aux->table_json = json_object_create();
-        json_object_put(aux->json, aux->mt->table->schema->name,
-                        aux->table_json);
-    }
-
     /* Create JSON object for transaction on this row. */
     row_json = json_object_create();
     if (old_json) {
@@ -1509,10 +2273,6 @@ ovsdb_jsonrpc_monitor_change_cb(const struct ovsdb_row *old,
     if (new_json) {
         json_object_put(row_json, "new", new_json);
     }
-
-    /* Add JSON row to JSON table. */
-    snprintf(uuid, sizeof uuid,
-             UUID_FMT, UUID_ARGS(ovsdb_row_get_uuid(new ? new : old)));
     json_object_put(aux->table_json, uuid, row_json);
 
     return true;
@@ -1529,7 +2289,7 @@ ovsdb_jsonrpc_monitor_json_length(const struct ovsdb_jsonrpc_monitor *m)
     /* Top-level overhead of monitor JSON. */
     length = 256;
 
-    SHASH_FOR_EACH (node, &m->tables) {
+    SHASH_FOR_EACH (node, &m->group->tables) {
         const struct ovsdb_jsonrpc_monitor_table *mt = node->data;
         const struct ovsdb_table *table = mt->table;
         const struct ovsdb_row *row;
@@ -1566,35 +2326,149 @@ ovsdb_jsonrpc_monitor_json_length(const struct ovsdb_jsonrpc_monitor *m)
 
 static void
 ovsdb_jsonrpc_monitor_init_aux(struct ovsdb_jsonrpc_monitor_aux *aux,
-                               const struct ovsdb_jsonrpc_monitor *m,
-                               bool initial)
+                               const struct shash *tables,
+                               const struct shash *conditions, bool initial)
 {
     aux->initial = initial;
-    aux->monitor = m;
+    aux->tables = tables;
+    aux->conditions = conditions;
     aux->json = NULL;
     aux->mt = NULL;
     aux->table_json = NULL;
 }
 
+/* Returns the name of the notification that carries updates for 'm'. */
+static const char *
+ovsdb_jsonrpc_monitor_update_method(const struct ovsdb_jsonrpc_monitor *m)
+{
+    return m->version == OVSDB_MONITOR_COND_SINCE ? "update3" : "update";
+}
+
+/* Returns the "params" for a notification that carries 'update', a
+ * <table-updates>, to 'm''s client.  If 'update' is null, omits it, to
+ * produce the leading parameters for jsonrpc_send_shared_notify(). */
+static struct json *
+ovsdb_jsonrpc_monitor_update_params(const struct ovsdb_jsonrpc_monitor *m,
+                                    struct json *update)
+{
+    struct json *params = json_array_create_1(json_clone(m->monitor_id));
+
+    if (m->version == OVSDB_MONITOR_COND_SINCE) {
+        char txn_id[UUID_LEN + 1];
+
+        snprintf(txn_id, sizeof txn_id, UUID_FMT,
+                 UUID_ARGS(&m->group->history->last_txn_id));
+        json_array_add(params, json_string_create(txn_id));
+    }
+    if (update) {
+        json_array_add(params, update);
+    }
+    return params;
+}
+
+/* Sends the changes in 'update', a JSON object in the format of the "update"
+ * notification, to the client of 'm', without changing 'update'.
+ *
+ * If the client is keeping up, the update is sent right away (after anything
+ * held back for the client's other monitors, to keep updates in order), using
+ * 'shared' (creating it from 'update' if it is null) so that all of the
+ * monitors in a group share a single copy of the serialized update.
+ * Otherwise, the changes are merged into 'm''s pending changes, to be sent in
+ * a single update once the client catches up. */
+static void
+ovsdb_jsonrpc_monitor_send_update(struct ovsdb_jsonrpc_monitor *m,
+                                  const struct json *update,
+                                  struct jsonrpc_shared **shared)
+{
+    struct ovsdb_jsonrpc_session *s = m->session;
+
+    ovsdb_jsonrpc_session_acquire(s);
+    if (!jsonrpc_session_get_backlog(s->js)) {
+        ovsdb_jsonrpc_monitor_flush_all(s);
+        if (!*shared) {
+            *shared = jsonrpc_shared_create(update);
+        }
+        jsonrpc_session_send_shared_notify(
+            s->js, ovsdb_jsonrpc_monitor_update_method(m),
+            ovsdb_jsonrpc_monitor_update_params(m, NULL), *shared);
+        s->wake_worker = true;
+    } else {
+        ovsdb_jsonrpc_monitor_defer_update(m, update);
+    }
+    ovsdb_jsonrpc_session_release(s);
+}
+
+/* Merges the changes in 'update', a <table-updates> JSON object, into 'm''s
+ * pending changes. */
+static void
+ovsdb_jsonrpc_monitor_defer_update(struct ovsdb_jsonrpc_monitor *m,
+                                   const struct json *update)
+{
+    struct shash_node *table_node;
+
+    SHASH_FOR_EACH (table_node, json_object(update)) {
+        const struct ovsdb_jsonrpc_monitor_table *mt;
+        struct shash_node *row_node;
+
+        mt = shash_find_data(&m->group->tables, table_node->name);
+        SHASH_FOR_EACH (row_node, json_object(table_node->data)) {
+            struct shash *row = json_object(row_node->data);
+            struct uuid uuid;
+
+            uuid_from_string(&uuid, row_node->name);
+            ovsdb_jsonrpc_monitor_defer(m, mt, &uuid,
+                                        shash_find_data(row, "old"),
+                                        shash_find_data(row, "new"));
+        }
+    }
+}
+
 static struct ovsdb_error *
 ovsdb_jsonrpc_monitor_commit(struct ovsdb_replica *replica,
                              const struct ovsdb_txn *txn,
                              bool durable OVS_UNUSED)
 {
-    struct ovsdb_jsonrpc_monitor *m = ovsdb_jsonrpc_monitor_cast(replica);
+    struct ovsdb_jsonrpc_monitor_group *g;
     struct ovsdb_jsonrpc_monitor_aux aux;
-
-    ovsdb_jsonrpc_monitor_init_aux(&aux, m, false);
-    ovsdb_txn_for_each_change(txn, ovsdb_jsonrpc_monitor_change_cb, &aux);
-    if (aux.json) {
-        struct jsonrpc_msg *msg;
-        struct json *params;
-
-        params = json_array_create_2(json_clone(aux.monitor->monitor_id),
-                                     aux.json);
-        msg = jsonrpc_create_notify("update", params);
-        jsonrpc_session_send(aux.monitor->session->js, msg);
+    struct jsonrpc_shared *shared;
+    struct ovsdb_jsonrpc_monitor *m;
+    bool composed;
+
+    /* Compose the update for the monitors without conditions only once, and
+     * only if there are any of them. */
+    g = ovsdb_jsonrpc_monitor_group_cast(replica);
+    ovsdb_jsonrpc_monitor_init_aux(&aux, &g->tables, NULL, false);
+    composed = false;
+    shared = NULL;
+    LIST_FOR_EACH (m, group_node, &g->monitors) {
+        if (shash_is_empty(&m->conditions)) {
+            if (!composed) {
+                ovsdb_txn_for_each_change(txn, ovsdb_jsonrpc_monitor_change_cb,
+                                          &aux);
+                composed = true;
+            }
+            if (aux.json) {
+                ovsdb_jsonrpc_monitor_send_update(m, aux.json, &shared);
+            }
+        } else {
+            struct ovsdb_jsonrpc_monitor_aux cond_aux;
+
+            ovsdb_jsonrpc_monitor_init_aux(&cond_aux, &g->tables,
+                                           &m->conditions, false);
+            ovsdb_txn_for_each_change(txn, ovsdb_jsonrpc_monitor_change_cb,
+                                      &cond_aux);
+            if (cond_aux.json) {
+                struct jsonrpc_shared *cond_shared = NULL;
+
+                ovsdb_jsonrpc_monitor_send_update(m, cond_aux.json,
+                                                  &cond_shared);
+                jsonrpc_shared_unref(cond_shared);
+                json_destroy(cond_aux.json);
+            }
+        }
     }
+    jsonrpc_shared_unref(shared);
+    json_destroy(aux.json);
 
     return NULL;
 }
@@ -1605,8 +2479,9 @@ ovsdb_jsonrpc_monitor_get_initial(const struct ovsdb_jsonrpc_monitor *m)
     struct ovsdb_jsonrpc_monitor_aux aux;
     struct shash_node *node;
 
-    ovsdb_jsonrpc_monitor_init_aux(&aux, m, true);
-    SHASH_FOR_EACH (node, &m->tables) {
+    ovsdb_jsonrpc_monitor_init_aux(&aux, &m->group->tables, &m->conditions,
+                                   true);
+    SHASH_FOR_EACH (node, &m->group->tables) {
         struct ovsdb_jsonrpc_monitor_table *mt = node->data;
 
         if (mt->select & OJMS_INITIAL) {
@@ -1620,24 +2495,615 @@ ovsdb_jsonrpc_monitor_get_initial(const struct ovsdb_jsonrpc_monitor *m)
     return aux.json ? aux.json : json_object_create();
 }
 
+/* Pending changes. */
+
+static struct ovsdb_jsonrpc_monitor_row *
+ovsdb_jsonrpc_monitor_find_row(const struct ovsdb_jsonrpc_monitor *m,
+                               const struct ovsdb_jsonrpc_monitor_table *mt,
+                               const struct uuid *uuid)
+{
+    struct ovsdb_jsonrpc_monitor_row *r;
+
+    HMAP_FOR_EACH_WITH_HASH (r, hmap_node, uuid_hash(uuid), &m->pending) {
+        if (r->mt == mt && uuid_equals(&r->uuid, uuid)) {
+            return r;
+        }
+    }
+    return NULL;
+}
+
+static void
+ovsdb_jsonrpc_monitor_remove_row(struct ovsdb_jsonrpc_monitor *m,
+                                 struct ovsdb_jsonrpc_monitor_row *r)
+{
+    hmap_remove(&m->pending, &r->hmap_node);
+    json_destroy(r->old);
+    json_destroy(r->new);
+    free(r);
+}
+
+/* Merges a change to the row with the given 'uuid' in 'mt', with old and new
+ * column values 'old' and 'new' (either of which may be null, as in an
+ * "update" notification), into 'm''s pending changes.  Does not modify 'old'
+ * or 'new'. */
+static void
+ovsdb_jsonrpc_monitor_defer(struct ovsdb_jsonrpc_monitor *m,
+                            const struct ovsdb_jsonrpc_monitor_table *mt,
+                            const struct uuid *uuid,
+                            const struct json *old, const struct json *new)
+{
+    struct ovsdb_jsonrpc_monitor_row *r;
+    struct shash_node *node, *next;
+
+    r = ovsdb_jsonrpc_monitor_find_row(m, mt, uuid);
+    if (!r) {
+        r = xmalloc(sizeof *r);
+        hmap_insert(&m->pending, &r->hmap_node, uuid_hash(uuid));
+        r->mt = mt;
+        r->uuid = *uuid;
+        r->old = old ? json_clone(old) : NULL;
+        r->new = new ? json_clone(new) : NULL;
+        return;
+    }
+
+    if (!r->old && !new) {
+        /* The client never saw this row, so it need not hear about it. */
+        ovsdb_jsonrpc_monitor_remove_row(m, r);
+        return;
+    }
+
+    /* The client needs the oldest value of each changed column, which is the
+     * one it already has, and the newest value of each column. */
+    if (r->old && old) {
+        SHASH_FOR_EACH (node, json_object(old)) {
+            if (!shash_find(json_object(r->old), node->name)) {
+                json_object_put(r->old, node->name, json_clone(node->data));
+            }
+        }
+    }
+    if (!new) {
+        json_destroy(r->new);
+        r->new = NULL;
+    } else if (!r->new) {
+        r->new = json_clone(new);
+    } else {
+        SHASH_FOR_EACH (node, json_object(new)) {
+            json_object_put(r->new, node->name, json_clone(node->data));
+        }
+    }
+
+    /* Forget about columns that changed back to their old values, and about
+     * the row as a whole if nothing is left. */
+    if (r->old && r->new) {
+        SHASH_FOR_EACH_SAFE (node, next, json_object(r->old)) {
+            const struct json *value;
+
+            value = shash_find_data(json_object(r->new), node->name);
+            if (value && json_equal(node->data, value)) {
+                json_destroy(node->data);
+                shash_delete(json_object(r->old), node);
+            }
+        }
+        if (shash_is_empty(json_object(r->old))) {
+            ovsdb_jsonrpc_monitor_remove_row(m, r);
+        }
+    }
+}
+
+/* Merges the changes made by the transactions in the history of 'm''s
+ * database that follow the one with 'last_txn_id' into 'm''s pending changes.
+ * Returns false, without changing anything, if the history does not go back
+ * far enough to include 'last_txn_id'. */
+static bool
+ovsdb_jsonrpc_monitor_catch_up(struct ovsdb_jsonrpc_monitor *m,
+                               const struct uuid *last_txn_id)
+{
+    const struct ovsdb_jsonrpc_history *history = m->group->history;
+    const struct ovsdb_jsonrpc_history_txn *ht;
+    const struct list *start, *node;
+
+    if (uuid_equals(last_txn_id, &history->base_txn_id)) {
+        start = &history->txns;
+    } else {
+        start = NULL;
+        LIST_FOR_EACH (ht, node, &history->txns) {
+            if (uuid_equals(last_txn_id, &ht->txn_id)) {
+                start = &ht->node;
+                break;
+            }
+        }
+        if (!start) {
+            return false;
+        }
+    }
+
+    for (node = start->next; node != &history->txns; node = node->next) {
+        struct ovsdb_jsonrpc_monitor_aux aux;
+        size_t i;
+
+        ht = CONTAINER_OF(node, struct ovsdb_jsonrpc_history_txn, node);
+        ovsdb_jsonrpc_monitor_init_aux(&aux, &m->group->tables,
+                                       &m->conditions, false);
+        for (i = 0; i < ht->n_rows; i++) {
+            const struct ovsdb_jsonrpc_history_row *hr = &ht->rows[i];
+
+            ovsdb_jsonrpc_monitor_change_cb(hr->old, hr->new, hr->changed,
+                                            &aux);
+        }
+        if (aux.json) {
+            ovsdb_jsonrpc_monitor_defer_update(m, aux.json);
+            json_destroy(aux.json);
+        }
+    }
+    return true;
+}
+
+/* Sends all of 'm''s pending changes to its client in a single update. */
+static void
+ovsdb_jsonrpc_monitor_flush(struct ovsdb_jsonrpc_monitor *m)
+{
+    struct json *update;
+
+    if (hmap_is_empty(&m->pending)) {
+        return;
+    }
+
+    update = ovsdb_jsonrpc_monitor_take_pending(m);
+    ovsdb_jsonrpc_session_acquire(m->session);
+    jsonrpc_session_send(m->session->js,
+                         jsonrpc_create_notify(
+                             ovsdb_jsonrpc_monitor_update_method(m),
+                             ovsdb_jsonrpc_monitor_update_params(m, update)));
+    m->session->wake_worker = true;
+    ovsdb_jsonrpc_session_release(m->session);
+}
+
+/* Removes all of 'm''s pending changes and returns them as a <table-updates>
+ * JSON object. */
+static struct json *
+ovsdb_jsonrpc_monitor_take_pending(struct ovsdb_jsonrpc_monitor *m)
+{
+    struct ovsdb_jsonrpc_monitor_row *r, *next;
+    struct json *update;
+
+    update = json_object_create();
+    HMAP_FOR_EACH_SAFE (r, next, hmap_node, &m->pending) {
+        const char *table_name = r->mt->table->schema->name;
+        struct json *table_json, *row_json;
+        char uuid[UUID_LEN + 1];
+
+        table_json = shash_find_data(json_object(update), table_name);
+        if (!table_json) {
+            table_json = json_object_create();
+            json_object_put(update, table_name, table_json);
+        }
+
+        row_json = json_object_create();
+        if (r->old) {
+            json_object_put(row_json, "old", r->old);
+        }
+        if (r->new) {
+            json_object_put(row_json, "new", r->new);
+        }
+        snprintf(uuid, sizeof uuid, UUID_FMT, UUID_ARGS(&r->uuid));
+        json_object_put(table_json, uuid, row_json);
+
+        hmap_remove(&m->pending, &r->hmap_node);
+        free(r);
+    }
+    return update;
+}
+
+/* Sends the pending changes for all of the monitors in 's'. */
+static void
+ovsdb_jsonrpc_monitor_flush_all(struct ovsdb_jsonrpc_session *s)
+{
+    struct ovsdb_jsonrpc_monitor *m;
+
+    HMAP_FOR_EACH (m, node, &s->monitors) {
+        ovsdb_jsonrpc_monitor_flush(m);
+    }
+}
+
+/* Returns true if any of the monitors in 's' has pending changes. */
+static bool
+ovsdb_jsonrpc_monitor_has_pending(const struct ovsdb_jsonrpc_session *s)
+{
+    const struct ovsdb_jsonrpc_monitor *m;
+
+    HMAP_FOR_EACH (m, node, &s->monitors) {
+        if (!hmap_is_empty(&m->pending)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Groups. */
+
+static uint32_t
+ovsdb_jsonrpc_monitor_tables_hash(const struct shash *tables)
+{
+    const struct shash_node *node;
+    uint32_t hash = 0;
+
+    /* Combine the per-table hashes with addition so that the result does not
+     * depend on the order of the tables in 'tables'. */
+    SHASH_FOR_EACH (node, tables) {
+        const struct ovsdb_jsonrpc_monitor_table *mt = node->data;
+        uint32_t table_hash = hash_pointer(mt->table, 0);
+        size_t i;
+
+        for (i = 0; i < mt->n_columns; i++) {
+            table_hash = hash_pointer(mt->columns[i].column, table_hash);
+            table_hash = hash_int(mt->columns[i].select, table_hash);
+        }
+        hash += table_hash;
+    }
+    return hash;
+}
+
+static bool
+ovsdb_jsonrpc_monitor_tables_equal(const struct shash *a,
+                                   const struct shash *b)
+{
+    const struct shash_node *node;
+
+    if (shash_count(a) != shash_count(b)) {
+        return false;
+    }
+
+    SHASH_FOR_EACH (node, a) {
+        const struct ovsdb_jsonrpc_monitor_table *mta = node->data;
+        const struct ovsdb_jsonrpc_monitor_table *mtb;
+        size_t i;
+
+        mtb = shash_find_data(b, node->name);
+        if (!mtb || mta->n_columns != mtb->n_columns) {
+            return false;
+        }
+        for (i = 0; i < mta->n_columns; i++) {
+            if (mta->columns[i].column != mtb->columns[i].column
+                || mta->columns[i].select != mtb->columns[i].select) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
 static void
-ovsdb_jsonrpc_monitor_destroy(struct ovsdb_replica *replica)
+ovsdb_jsonrpc_monitor_tables_destroy(struct shash *tables)
 {
-    struct ovsdb_jsonrpc_monitor *m = ovsdb_jsonrpc_monitor_cast(replica);
     struct shash_node *node;
 
-    json_destroy(m->monitor_id);
-    SHASH_FOR_EACH (node, &m->tables) {
+    SHASH_FOR_EACH (node, tables) {
         struct ovsdb_jsonrpc_monitor_table *mt = node->data;
         free(mt->columns);
         free(mt);
     }
-    shash_destroy(&m->tables);
+    shash_destroy(tables);
+}
+
+static void
+ovsdb_jsonrpc_monitor_conditions_destroy(struct shash *conditions)
+{
+    struct shash_node *node;
+
+    SHASH_FOR_EACH (node, conditions) {
+        struct ovsdb_condition *cond = node->data;
+        ovsdb_condition_destroy(cond);
+        free(cond);
+    }
+    shash_destroy(conditions);
+}
+
+/* Returns the group for monitors of 'db' that select 'tables', creating it if
+ * there is none yet.  Takes ownership of the contents of 'tables', leaving it
+ * empty. */
+static struct ovsdb_jsonrpc_monitor_group *
+ovsdb_jsonrpc_monitor_group_get(struct ovsdb *db, struct shash *tables)
+{
+    struct ovsdb_jsonrpc_monitor_group *g;
+    struct ovsdb_replica *replica;
+    uint32_t hash;
+
+    hash = ovsdb_jsonrpc_monitor_tables_hash(tables);
+    LIST_FOR_EACH (replica, node, &db->replicas) {
+        if (replica->class == &ovsdb_jsonrpc_replica_class) {
+            g = ovsdb_jsonrpc_monitor_group_cast(replica);
+            if (g->hash == hash
+                && ovsdb_jsonrpc_monitor_tables_equal(&g->tables, tables)) {
+                ovsdb_jsonrpc_monitor_tables_destroy(tables);
+                shash_init(tables);
+                return g;
+            }
+        }
+    }
+
+    g = xmalloc(sizeof *g);
+    ovsdb_replica_init(&g->replica, &ovsdb_jsonrpc_replica_class);
+    ovsdb_add_replica(db, &g->replica);
+    g->db = db;
+    shash_init(&g->tables);
+    shash_swap(&g->tables, tables);
+    g->hash = hash;
+    list_init(&g->monitors);
+    g->history = ovsdb_jsonrpc_history_find(db);
+    ovs_assert(g->history);
+    return g;
+}
+
+static void
+ovsdb_jsonrpc_monitor_free(struct ovsdb_jsonrpc_monitor *m)
+{
+    struct ovsdb_jsonrpc_monitor_row *r, *next;
+
+    HMAP_FOR_EACH_SAFE (r, next, hmap_node, &m->pending) {
+        ovsdb_jsonrpc_monitor_remove_row(m, r);
+    }
+    hmap_destroy(&m->pending);
+    ovsdb_jsonrpc_monitor_conditions_destroy(&m->conditions);
+    json_destroy(m->monitor_id);
     hmap_remove(&m->session->monitors, &m->node);
     free(m);
 }
 
+/* Destroys 'm', and its group too if 'm' was the last monitor in it. */
+static void
+ovsdb_jsonrpc_monitor_destroy(struct ovsdb_jsonrpc_monitor *m)
+{
+    struct ovsdb_jsonrpc_monitor_group *g = m->group;
+
+    if (m->version == OVSDB_MONITOR_COND_SINCE) {
+        ovsdb_jsonrpc_history_remove_monitor(g->history);
+    }
+    list_remove(&m->group_node);
+    ovsdb_jsonrpc_monitor_free(m);
+    if (list_is_empty(&g->monitors)) {
+        ovsdb_remove_replica(g->db, &g->replica);
+    }
+}
+
+static void
+ovsdb_jsonrpc_monitor_group_destroy(struct ovsdb_replica *replica)
+{
+    struct ovsdb_jsonrpc_monitor_group *g;
+    struct ovsdb_jsonrpc_monitor *m, *next;
+
+    g = ovsdb_jsonrpc_monitor_group_cast(replica);
+    LIST_FOR_EACH_SAFE (m, next, group_node, &g->monitors) {
+        list_remove(&m->group_node);
+        ovsdb_jsonrpc_monitor_free(m);
+    }
+    ovsdb_jsonrpc_monitor_tables_destroy(&g->tables);
+    free(g);
+}
+
 static const struct ovsdb_replica_class ovsdb_jsonrpc_replica_class = {
     ovsdb_jsonrpc_monitor_commit,
-    ovsdb_jsonrpc_monitor_destroy
+    ovsdb_jsonrpc_monitor_group_destroy,
+    NULL,                       /* is_durable */
+    NULL,                       /* durable_wait */
+};
+
+/* Transaction history. */
+
+/* The history keeps at most HISTORY_MAX_TXNS transactions.  It also drops old
+ * transactions whenever it holds more row changes than there are rows in the
+ * database, since at that point a full dump would be about as cheap, except
+ * that it always allows at least HISTORY_MIN_ROWS row changes so that small
+ * databases still get some history. */
+#define HISTORY_MAX_TXNS 100
+#define HISTORY_MIN_ROWS 1000
+
+/* How long the history keeps recording after the last "monitor_cond_since"
+ * monitor goes away. */
+#define HISTORY_IDLE_MSEC (60 * 1000)
+
+static const struct ovsdb_replica_class ovsdb_jsonrpc_history_class;
+
+static struct ovsdb_jsonrpc_history *
+ovsdb_jsonrpc_history_cast(struct ovsdb_replica *replica)
+{
+    ovs_assert(replica->class == &ovsdb_jsonrpc_history_class);
+    return CONTAINER_OF(replica, struct ovsdb_jsonrpc_history, replica);
+}
+
+static struct ovsdb_jsonrpc_history *
+ovsdb_jsonrpc_history_find(const struct ovsdb *db)
+{
+    struct ovsdb_replica *replica;
+
+    LIST_FOR_EACH (replica, node, &db->replicas) {
+        if (replica->class == &ovsdb_jsonrpc_history_class) {
+            return ovsdb_jsonrpc_history_cast(replica);
+        }
+    }
+    return NULL;
+}
+
+/* Starts keeping a history of the transactions committed to 'db'.
+ *
+ * This must happen before any monitor group is added to 'db', so that the
+ * history assigns each transaction its ID before the groups send it out. */
+static void
+ovsdb_jsonrpc_history_create(struct ovsdb *db)
+{
+    struct ovsdb_jsonrpc_history *h;
+
+    h = xmalloc(sizeof *h);
+    ovsdb_replica_init(&h->replica, &ovsdb_jsonrpc_history_class);
+    ovsdb_add_replica(db, &h->replica);
+    h->db = db;
+    h->recording = false;
+    h->n_monitors = 0;
+    h->idle_since = 0;
+    uuid_generate(&h->base_txn_id);
+    h->last_txn_id = h->base_txn_id;
+    list_init(&h->txns);
+    h->n_txns = 0;
+    h->n_rows = 0;
+}
+
+static void
+ovsdb_jsonrpc_history_txn_destroy(struct ovsdb_jsonrpc_history_txn *ht)
+{
+    size_t i;
+
+    for (i = 0; i < ht->n_rows; i++) {
+        struct ovsdb_jsonrpc_history_row *hr = &ht->rows[i];
+
+        if (hr->old) {
+            ovsdb_row_destroy(hr->old);
+        }
+        if (hr->new) {
+            ovsdb_row_destroy(hr->new);
+        }
+        free(hr->changed);
+    }
+    free(ht->rows);
+    free(ht);
+}
+
+/* Discards all of the transactions in 'h'. */
+static void
+ovsdb_jsonrpc_history_clear(struct ovsdb_jsonrpc_history *h)
+{
+    struct ovsdb_jsonrpc_history_txn *ht, *next;
+
+    LIST_FOR_EACH_SAFE (ht, next, node, &h->txns) {
+        ovsdb_jsonrpc_history_txn_destroy(ht);
+    }
+    list_init(&h->txns);
+    h->n_txns = 0;
+    h->n_rows = 0;
+}
+
+struct ovsdb_jsonrpc_history_aux {
+    struct ovsdb_jsonrpc_history_txn *ht;
+    size_t allocated_rows;
+};
+
+static bool
+ovsdb_jsonrpc_history_change_cb(const struct ovsdb_row *old,
+                                const struct ovsdb_row *new,
+                                const unsigned long int *changed,
+                                void *aux_)
+{
+    struct ovsdb_jsonrpc_history_aux *aux = aux_;
+    struct ovsdb_jsonrpc_history_txn *ht = aux->ht;
+    struct ovsdb_jsonrpc_history_row *hr;
+
+    if (ht->n_rows >= aux->allocated_rows) {
+        ht->rows = x2nrealloc(ht->rows, &aux->allocated_rows,
+                              sizeof *ht->rows);
+    }
+    hr = &ht->rows[ht->n_rows++];
+    hr->old = old ? ovsdb_row_clone(old) : NULL;
+    hr->new = new ? ovsdb_row_clone(new) : NULL;
+    hr->changed = (old && new
+                   ? bitmap_clone(changed,
+                                  shash_count(&new->table->schema->columns))
+                   : NULL);
+    return true;
+}
+
+static struct ovsdb_error *
+ovsdb_jsonrpc_history_commit(struct ovsdb_replica *replica,
+                             const struct ovsdb_txn *txn,
+                             bool durable OVS_UNUSED)
+{
+    struct ovsdb_jsonrpc_history *h = ovsdb_jsonrpc_history_cast(replica);
+    struct ovsdb_jsonrpc_history_aux aux;
+    struct ovsdb_jsonrpc_history_txn *ht;
+    size_t n_db_rows, max_rows;
+    struct shash_node *node;
+
+    if (!h->recording) {
+        return NULL;
+    } else if (!h->n_monitors
+               && time_msec() - h->idle_since >= HISTORY_IDLE_MSEC) {
+        /* No client has used the history for a while. */
+        h->recording = false;
+        ovsdb_jsonrpc_history_clear(h);
+        return NULL;
+    }
+
+    ht = xmalloc(sizeof *ht);
+    ht->rows = NULL;
+    ht->n_rows = 0;
+    aux.ht = ht;
+    aux.allocated_rows = 0;
+    ovsdb_txn_for_each_change(txn, ovsdb_jsonrpc_history_change_cb, &aux);
+    if (!ht->n_rows) {
+        ovsdb_jsonrpc_history_txn_destroy(ht);
+        return NULL;
+    }
+
+    uuid_generate(&ht->txn_id);
+    list_push_back(&h->txns, &ht->node);
+    h->last_txn_id = ht->txn_id;
+    h->n_txns++;
+    h->n_rows += ht->n_rows;
+
+    n_db_rows = 0;
+    SHASH_FOR_EACH (node, &h->db->tables) {
+        const struct ovsdb_table *table = node->data;
+        n_db_rows += hmap_count(&table->rows);
+    }
+    max_rows = MAX(n_db_rows, HISTORY_MIN_ROWS);
+    while (h->n_txns > 1
+           && (h->n_txns > HISTORY_MAX_TXNS || h->n_rows > max_rows)) {
+        ht = CONTAINER_OF(list_pop_front(&h->txns),
+                          struct ovsdb_jsonrpc_history_txn, node);
+        h->base_txn_id = ht->txn_id;
+        h->n_txns--;
+        h->n_rows -= ht->n_rows;
+        ovsdb_jsonrpc_history_txn_destroy(ht);
+    }
+
+    return NULL;
+}
+
+/* Notes that a "monitor_cond_since" monitor is using 'h', starting to record
+ * transactions if 'h' is not already doing so. */
+static void
+ovsdb_jsonrpc_history_add_monitor(struct ovsdb_jsonrpc_history *h)
+{
+    if (!h->recording) {
+        /* Transactions committed while not recording are missing, so a new
+         * ID is needed to make clients from back then fall back to a full
+         * dump. */
+        h->recording = true;
+        uuid_generate(&h->base_txn_id);
+        h->last_txn_id = h->base_txn_id;
+    }
+    h->n_monitors++;
+}
+
+/* Notes that a "monitor_cond_since" monitor is no longer using 'h'. */
+static void
+ovsdb_jsonrpc_history_remove_monitor(struct ovsdb_jsonrpc_history *h)
+{
+    ovs_assert(h->n_monitors > 0);
+    if (!--h->n_monitors) {
+        h->idle_since = time_msec();
+    }
+}
+
+static void
+ovsdb_jsonrpc_history_destroy(struct ovsdb_replica *replica)
+{
+    struct ovsdb_jsonrpc_history *h = ovsdb_jsonrpc_history_cast(replica);
+
+    ovsdb_jsonrpc_history_clear(h);
+    free(h);
+}
+
+static const struct ovsdb_replica_class ovsdb_jsonrpc_history_class = {
+    ovsdb_jsonrpc_history_commit,
+    ovsdb_jsonrpc_history_destroy,
+    NULL,                       /* is_durable */
+    NULL,                       /* durable_wait */
 };
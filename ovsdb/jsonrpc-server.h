@@ -17,6 +17,7 @@
 #define OVSDB_JSONRPC_SERVER_H 1
 
 #include <stdbool.h>
+#include <stddef.h>
 #include "openvswitch/types.h"
 
 struct ovsdb;
@@ -24,6 +25,8 @@ struct shash;
 struct simap;
 
 struct ovsdb_jsonrpc_server *ovsdb_jsonrpc_server_create(void);
+void ovsdb_jsonrpc_server_set_threads(struct ovsdb_jsonrpc_server *,
+                                      size_t n_threads);
 bool ovsdb_jsonrpc_server_add_db(struct ovsdb_jsonrpc_server *,
                                  struct ovsdb *);
 bool ovsdb_jsonrpc_server_remove_db(struct ovsdb_jsonrpc_server *,
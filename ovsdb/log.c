@@ -24,10 +24,16 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include "binary.h"
 #include "json.h"
+#include "latch.h"
 #include "lockfile.h"
+#include "ofpbuf.h"
+#include "ovs-rcu.h"
+#include "ovs-thread.h"
 #include "ovsdb.h"
 #include "ovsdb-error.h"
+#include "poll-loop.h"
 #include "sha1.h"
 #include "socket-util.h"
 #include "transaction.h"
@@ -41,6 +47,14 @@ enum ovsdb_log_mode {
     OVSDB_LOG_WRITE
 };
 
+/* Commits with seqnos in (lo, hi] were covered by an fsync() that failed with
+ * errno value 'error'. */
+struct ovsdb_log_commit_failure {
+    uint64_t lo;
+    uint64_t hi;
+    int error;
+};
+
 struct ovsdb_log {
     off_t prev_offset;
     off_t offset;
@@ -50,6 +64,25 @@ struct ovsdb_log {
     struct ovsdb_error *read_error;
     bool write_error;
     enum ovsdb_log_mode mode;
+    enum ovsdb_log_format format;
+
+    /* Asynchronous commits.  See ovsdb_log_commit_start().
+     *
+     * The commit thread is started the first time it is needed, so that
+     * processes that never commit asynchronously (or that fork after opening
+     * a log) stay single-threaded. */
+    bool commit_thread_started;
+    pthread_t commit_thread;
+    struct latch commit_latch;  /* Set by commit thread after each fsync. */
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;        /* Wakes up commit thread. */
+
+    /* Protected by 'mutex'. */
+    uint64_t commit_requested;  /* Highest seqno passed to commit_start(). */
+    uint64_t commit_synced;     /* Highest seqno that fsync() has covered. */
+    struct ovsdb_log_commit_failure *commit_failures; /* In seqno order. */
+    size_t n_commit_failures, allocated_commit_failures;
+    bool commit_exiting;        /* True to make commit thread exit. */
 };
 
 /* Attempts to open 'name' with the specified 'open_mode'.  On success, stores
@@ -135,6 +168,19 @@ ovsdb_log_open(const char *name, enum ovsdb_log_open_mode open_mode,
     file->read_error = NULL;
     file->write_error = false;
     file->mode = OVSDB_LOG_READ;
+    file->format = OVSDB_LOG_JSON;
+
+    file->commit_thread_started = false;
+    latch_init(&file->commit_latch);
+    xpthread_mutex_init(&file->mutex, NULL);
+    xpthread_cond_init(&file->cond, NULL);
+    file->commit_requested = 0;
+    file->commit_synced = 0;
+    file->commit_failures = NULL;
+    file->n_commit_failures = 0;
+    file->allocated_commit_failures = 0;
+    file->commit_exiting = false;
+
     *filep = file;
     return NULL;
 
@@ -150,6 +196,20 @@ void
 ovsdb_log_close(struct ovsdb_log *file)
 {
     if (file) {
+        if (file->commit_thread_started) {
+            /* Let the commit thread finish any fsync() already requested, so
+             * that every commit reported as started really is durable. */
+            xpthread_mutex_lock(&file->mutex);
+            file->commit_exiting = true;
+            xpthread_cond_signal(&file->cond);
+            xpthread_mutex_unlock(&file->mutex);
+            xpthread_join(file->commit_thread, NULL);
+        }
+        latch_destroy(&file->commit_latch);
+        pthread_mutex_destroy(&file->mutex);
+        pthread_cond_destroy(&file->cond);
+        free(file->commit_failures);
+
         free(file->name);
         fclose(file->stream);
         lockfile_unlock(file->lockfile);
@@ -158,21 +218,68 @@ ovsdb_log_close(struct ovsdb_log *file)
     }
 }
 
+/* Parses 's' as the name of a log format, either "json" or "binary".  If
+ * successful, stores the format in '*formatp' and returns true, otherwise
+ * returns false. */
+bool
+ovsdb_log_format_from_string(const char *s, enum ovsdb_log_format *formatp)
+{
+    if (!strcmp(s, "json")) {
+        *formatp = OVSDB_LOG_JSON;
+    } else if (!strcmp(s, "binary")) {
+        *formatp = OVSDB_LOG_BINARY;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/* Returns the format in which records will be written to 'file'.  This is the
+ * format of the first record in 'file', once it has been read, or the format
+ * most recently set with ovsdb_log_set_format(). */
+enum ovsdb_log_format
+ovsdb_log_get_format(const struct ovsdb_log *file)
+{
+    return file->format;
+}
+
+/* Sets the format in which ovsdb_log_write() will write records to 'file' to
+ * 'format'.  A log may contain records in both formats, but since reading the
+ * first record of a log sets its format to match, normally this is only
+ * useful for a log that has just been created. */
+void
+ovsdb_log_set_format(struct ovsdb_log *file, enum ovsdb_log_format format)
+{
+    file->format = format;
+}
+
 static const char magic[] = "OVSDB JSON ";
+static const char binary_magic[] = "OVSDB BINARY ";
+
+static const char *
+format_magic(enum ovsdb_log_format format)
+{
+    return format == OVSDB_LOG_BINARY ? binary_magic : magic;
+}
 
 static bool
-parse_header(char *header, unsigned long int *length,
-             uint8_t sha1[SHA1_DIGEST_SIZE])
+parse_header(char *header, enum ovsdb_log_format *format,
+             unsigned long int *length, uint8_t sha1[SHA1_DIGEST_SIZE])
 {
     char *p;
 
     /* 'header' must consist of a magic string... */
-    if (strncmp(header, magic, strlen(magic))) {
+    if (!strncmp(header, magic, strlen(magic))) {
+        *format = OVSDB_LOG_JSON;
+    } else if (!strncmp(header, binary_magic, strlen(binary_magic))) {
+        *format = OVSDB_LOG_BINARY;
+    } else {
         return false;
     }
+    p = header + strlen(format_magic(*format));
 
     /* ...followed by a length in bytes... */
-    *length = strtoul(header + strlen(magic), &p, 10);
+    *length = strtoul(p, &p, 10);
     if (!*length || *length == ULONG_MAX || *p != ' ') {
         return false;
     }
@@ -192,57 +299,58 @@ parse_header(char *header, unsigned long int *length,
     return true;
 }
 
-struct ovsdb_log_read_cbdata {
-    char input[4096];
-    struct ovsdb_log *file;
-    int error;
-    unsigned long length;
-};
-
+/* Reads the 'length'-byte body of a record, which starts at 'offset', into
+ * 'buf' and stores its SHA-1 hash in 'sha1'. */
 static struct ovsdb_error *
-parse_body(struct ovsdb_log *file, off_t offset, unsigned long int length,
-           uint8_t sha1[SHA1_DIGEST_SIZE], struct json **jsonp)
+read_body(struct ovsdb_log *file, off_t offset, unsigned long int length,
+          struct ofpbuf *buf, uint8_t sha1[SHA1_DIGEST_SIZE])
 {
-    struct json_parser *parser;
-    struct sha1_ctx ctx;
-
-    sha1_init(&ctx);
-    parser = json_parser_create(JSPF_TRAILER);
-
-    while (length > 0) {
-        char input[BUFSIZ];
-        int chunk;
+    unsigned long int remaining;
+
+    /* Read in chunks, growing the buffer as data actually arrives, instead of
+     * allocating 'length' bytes all at once, so that a corrupted length cannot
+     * cause a huge allocation. */
+    ofpbuf_init(buf, MIN(length, BUFSIZ));
+    for (remaining = length; remaining > 0; ) {
+        int chunk = MIN(remaining, BUFSIZ);
+        void *input;
+
+        if (ofpbuf_tailroom(buf) < chunk) {
+            ofpbuf_prealloc_tailroom(buf, MAX(chunk, buf->size));
+        }
+        input = ofpbuf_put_uninit(buf, chunk);
 
-        chunk = MIN(length, sizeof input);
         if (fread(input, 1, chunk, file->stream) != chunk) {
-            json_parser_abort(parser);
+            ofpbuf_uninit(buf);
             return ovsdb_io_error(ferror(file->stream) ? errno : EOF,
                                   "%s: error reading %lu bytes "
                                   "starting at offset %lld", file->name,
                                   length, (long long int) offset);
         }
-        sha1_update(&ctx, input, chunk);
-        json_parser_feed(parser, input, chunk);
-        length -= chunk;
+        remaining -= chunk;
     }
 
-    sha1_final(&ctx, sha1);
-    *jsonp = json_parser_finish(parser);
+    sha1_bytes(buf->data, buf->size, sha1);
     return NULL;
 }
 
-struct ovsdb_error *
-ovsdb_log_read(struct ovsdb_log *file, struct json **jsonp)
+/* Reads the next record from 'file' and verifies its SHA-1 hash, without
+ * parsing it and without updating any of 'file''s state other than its stream
+ * position.  On success, stores the record in '*recordp', or a null pointer
+ * if 'file' is at end of file. */
+static struct ovsdb_error *
+read_record__(struct ovsdb_log *file, struct ovsdb_log_record **recordp)
 {
     uint8_t expected_sha1[SHA1_DIGEST_SIZE];
     uint8_t actual_sha1[SHA1_DIGEST_SIZE];
+    struct ovsdb_log_record *record;
+    enum ovsdb_log_format format;
     struct ovsdb_error *error;
-    off_t data_offset;
     unsigned long data_length;
-    struct json *json;
+    off_t data_offset;
     char header[128];
 
-    *jsonp = json = NULL;
+    *recordp = NULL;
 
     if (file->read_error) {
         return ovsdb_error_clone(file->read_error);
@@ -252,55 +360,169 @@ ovsdb_log_read(struct ovsdb_log *file, struct json **jsonp)
 
     if (!fgets(header, sizeof header, file->stream)) {
         if (feof(file->stream)) {
-            error = NULL;
-        } else {
-            error = ovsdb_io_error(errno, "%s: read failed", file->name);
+            return NULL;
         }
-        goto error;
+        return ovsdb_io_error(errno, "%s: read failed", file->name);
     }
 
-    if (!parse_header(header, &data_length, expected_sha1)) {
-        error = ovsdb_syntax_error(NULL, NULL, "%s: parse error at offset "
-                                   "%lld in header line \"%.*s\"",
-                                   file->name, (long long int) file->offset,
-                                   (int) strcspn(header, "\n"), header);
-        goto error;
+    if (!parse_header(header, &format, &data_length, expected_sha1)) {
+        return ovsdb_syntax_error(NULL, NULL, "%s: parse error at offset "
+                                  "%lld in header line \"%.*s\"",
+                                  file->name, (long long int) file->offset,
+                                  (int) strcspn(header, "\n"), header);
     }
 
-    data_offset = file->offset + strlen(header);
-    error = parse_body(file, data_offset, data_length, actual_sha1, &json);
+    record = xmalloc(sizeof *record);
+    record->offset = file->offset;
+    record->data_offset = data_offset = file->offset + strlen(header);
+    record->format = format;
+    error = read_body(file, data_offset, data_length, &record->data,
+                      actual_sha1);
     if (error) {
-        goto error;
+        free(record);
+        return error;
     }
 
     if (memcmp(expected_sha1, actual_sha1, SHA1_DIGEST_SIZE)) {
-        error = ovsdb_syntax_error(NULL, NULL, "%s: %lu bytes starting at "
-                                   "offset %lld have SHA-1 hash "SHA1_FMT" "
-                                   "but should have hash "SHA1_FMT,
-                                   file->name, data_length,
-                                   (long long int) data_offset,
-                                   SHA1_ARGS(actual_sha1),
-                                   SHA1_ARGS(expected_sha1));
-        goto error;
+        ovsdb_log_record_destroy(record);
+        return ovsdb_syntax_error(NULL, NULL, "%s: %lu bytes starting at "
+                                  "offset %lld have SHA-1 hash "SHA1_FMT" "
+                                  "but should have hash "SHA1_FMT,
+                                  file->name, data_length,
+                                  (long long int) data_offset,
+                                  SHA1_ARGS(actual_sha1),
+                                  SHA1_ARGS(expected_sha1));
+    }
+
+    *recordp = record;
+    return NULL;
+}
+
+/* Marks 'record', just read from 'file' by read_record__(), as consumed. */
+static void
+consume_record(struct ovsdb_log *file, const struct ovsdb_log_record *record)
+{
+    if (!record->offset) {
+        file->format = record->format;
+    }
+    file->prev_offset = record->offset;
+    file->offset = record->data_offset + record->data.size;
+}
+
+/* Reads the next record from 'file' and verifies its SHA-1 hash, but does not
+ * parse it.  On success, returns NULL and stores the record in '*recordp'
+ * (the caller must eventually free it with ovsdb_log_record_destroy()), or a
+ * null pointer at end of file.  On failure, returns an error and stores a
+ * null pointer in '*recordp'; the error is sticky, as for ovsdb_log_read().
+ *
+ * A record read with this function must be parsed with
+ * ovsdb_log_parse_record().  Reading and parsing are separate so that a
+ * caller may parse records in a different thread from the one that reads
+ * them, for example to load a large database faster. */
+struct ovsdb_error *
+ovsdb_log_read_record(struct ovsdb_log *file,
+                      struct ovsdb_log_record **recordp)
+{
+    struct ovsdb_error *error = read_record__(file, recordp);
+
+    if (error) {
+        if (!file->read_error) {
+            file->read_error = ovsdb_error_clone(error);
+        }
+    } else if (*recordp) {
+        consume_record(file, *recordp);
+    }
+    return error;
+}
+
+/* Parses 'record', which was read from 'file', storing the JSON that it
+ * contains in '*jsonp'.  Returns NULL if successful, otherwise an error, in
+ * which case '*jsonp' is set to NULL.
+ *
+ * This function does not modify 'file', so it is safe to call from any
+ * thread, concurrently with other calls to this function or with
+ * ovsdb_log_read_record() on the same 'file'. */
+struct ovsdb_error *
+ovsdb_log_parse_record(const struct ovsdb_log *file,
+                       const struct ovsdb_log_record *record,
+                       struct json **jsonp)
+{
+    struct json *json;
+
+    if (record->format == OVSDB_LOG_BINARY) {
+        json = ovsdb_json_from_binary(record->data.data, record->data.size);
+    } else {
+        struct json_parser *parser = json_parser_create(JSPF_TRAILER);
+
+        json_parser_feed(parser, record->data.data, record->data.size);
+        json = json_parser_finish(parser);
     }
 
     if (json->type == JSON_STRING) {
-        error = ovsdb_syntax_error(NULL, NULL, "%s: %lu bytes starting at "
-                                   "offset %lld are not valid JSON (%s)",
-                                   file->name, data_length,
-                                   (long long int) data_offset,
+        struct ovsdb_error *error;
+
+        error = ovsdb_syntax_error(NULL, NULL, "%s: %zu bytes "
+                                   "starting at offset %lld are not "
+                                   "valid %s (%s)", file->name,
+                                   record->data.size,
+                                   (long long int) record->data_offset,
+                                   (record->format == OVSDB_LOG_BINARY
+                                    ? "binary data" : "JSON"),
                                    json->u.string);
-        goto error;
+        json_destroy(json);
+        *jsonp = NULL;
+        return error;
     }
 
-    file->prev_offset = file->offset;
-    file->offset = data_offset + data_length;
     *jsonp = json;
     return NULL;
+}
 
-error:
-    file->read_error = ovsdb_error_clone(error);
-    json_destroy(json);
+/* Frees 'record'. */
+void
+ovsdb_log_record_destroy(struct ovsdb_log_record *record)
+{
+    if (record) {
+        ofpbuf_uninit(&record->data);
+        free(record);
+    }
+}
+
+/* Rewinds 'file' so that the next call to ovsdb_log_write() will overwrite
+ * 'record', which must have been read from 'file' by ovsdb_log_read_record(),
+ * and everything that follows it.  Unlike ovsdb_log_unread(), this works for
+ * any record read earlier, not just the most recent one.
+ *
+ * This function is useful when a caller that reads records ahead of parsing
+ * them finds that 'record' does not make sense at a higher level. */
+void
+ovsdb_log_unread_record(struct ovsdb_log *file,
+                        const struct ovsdb_log_record *record)
+{
+    ovs_assert(file->mode == OVSDB_LOG_READ);
+    file->offset = file->prev_offset = record->offset;
+}
+
+struct ovsdb_error *
+ovsdb_log_read(struct ovsdb_log *file, struct json **jsonp)
+{
+    struct ovsdb_log_record *record;
+    struct ovsdb_error *error;
+
+    *jsonp = NULL;
+
+    error = read_record__(file, &record);
+    if (!error && record) {
+        error = ovsdb_log_parse_record(file, record, jsonp);
+        if (!error) {
+            consume_record(file, record);
+        }
+        ovsdb_log_record_destroy(record);
+    }
+
+    if (error && !file->read_error) {
+        file->read_error = ovsdb_error_clone(error);
+    }
     return error;
 }
 
@@ -325,11 +547,10 @@ ovsdb_log_write(struct ovsdb_log *file, struct json *json)
 {
     uint8_t sha1[SHA1_DIGEST_SIZE];
     struct ovsdb_error *error;
-    char *json_string;
+    struct ofpbuf body;
     char header[128];
-    size_t length;
 
-    json_string = NULL;
+    ofpbuf_init(&body, 0);
 
     if (file->mode == OVSDB_LOG_READ || file->write_error) {
         file->mode = OVSDB_LOG_WRITE;
@@ -351,20 +572,28 @@ ovsdb_log_write(struct ovsdb_log *file, struct json *json)
         goto error;
     }
 
-    /* Compose content.  Add a new-line (replacing the null terminator) to make
-     * the file easier to read, even though it has no semantic value.  */
-    json_string = json_to_string(json, 0);
-    length = strlen(json_string) + 1;
-    json_string[length - 1] = '\n';
+    /* Compose content.  For JSON, add a new-line (replacing the null
+     * terminator) to make the file easier to read, even though it has no
+     * semantic value.  */
+    if (file->format == OVSDB_LOG_BINARY) {
+        ovsdb_json_to_binary(json, &body);
+    } else {
+        char *json_string = json_to_string(json, 0);
+        size_t length = strlen(json_string) + 1;
+
+        json_string[length - 1] = '\n';
+        ofpbuf_use(&body, json_string, length);
+        body.size = length;
+    }
 
     /* Compose header. */
-    sha1_bytes(json_string, length, sha1);
+    sha1_bytes(body.data, body.size, sha1);
     snprintf(header, sizeof header, "%s%zu "SHA1_FMT"\n",
-             magic, length, SHA1_ARGS(sha1));
+             format_magic(file->format), body.size, SHA1_ARGS(sha1));
 
     /* Write. */
     if (fwrite(header, strlen(header), 1, file->stream) != 1
-        || fwrite(json_string, length, 1, file->stream) != 1
+        || fwrite(body.data, body.size, 1, file->stream) != 1
         || fflush(file->stream))
     {
         error = ovsdb_io_error(errno, "%s: write failed", file->name);
@@ -376,13 +605,13 @@ ovsdb_log_write(struct ovsdb_log *file, struct json *json)
         goto error;
     }
 
-    file->offset += strlen(header) + length;
-    free(json_string);
+    file->offset += strlen(header) + body.size;
+    ofpbuf_uninit(&body);
     return NULL;
 
 error:
     file->write_error = true;
-    free(json_string);
+    ofpbuf_uninit(&body);
     return error;
 }
 
@@ -395,6 +624,172 @@ ovsdb_log_commit(struct ovsdb_log *file)
     return NULL;
 }
 
+/* Records that the fsync() that covered the commits with seqnos greater than
+ * 'file->commit_synced' and up to 'seqno' failed with errno value 'error'.
+ * Only those commits fail: commits covered by an earlier or later fsync() that
+ * succeeded are still reported as durable.
+ *
+ * The caller must hold 'file->mutex'. */
+static void
+ovsdb_log_add_commit_failure(struct ovsdb_log *file, uint64_t seqno,
+                             int error)
+{
+    struct ovsdb_log_commit_failure *f;
+
+    f = (file->n_commit_failures
+         ? &file->commit_failures[file->n_commit_failures - 1]
+         : NULL);
+    if (f && f->hi == file->commit_synced && f->error == error) {
+        /* Consecutive failures, e.g. from a disk that has gone bad, extend a
+         * single range, so that they take constant space. */
+        f->hi = seqno;
+        return;
+    }
+
+    if (file->n_commit_failures >= file->allocated_commit_failures) {
+        file->commit_failures = x2nrealloc(file->commit_failures,
+                                           &file->allocated_commit_failures,
+                                           sizeof *file->commit_failures);
+    }
+    f = &file->commit_failures[file->n_commit_failures++];
+    f->lo = file->commit_synced;
+    f->hi = seqno;
+    f->error = error;
+}
+
+/* Returns the errno value from the failed fsync() that covered the commit with
+ * 'seqno', or 0 if that commit has not failed.
+ *
+ * The caller must hold 'file->mutex'. */
+static int
+ovsdb_log_find_commit_failure(const struct ovsdb_log *file, uint64_t seqno)
+{
+    size_t lo = 0, hi = file->n_commit_failures;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const struct ovsdb_log_commit_failure *f = &file->commit_failures[mid];
+
+        if (seqno <= f->lo) {
+            hi = mid;
+        } else if (seqno > f->hi) {
+            lo = mid + 1;
+        } else {
+            return f->error;
+        }
+    }
+    return 0;
+}
+
+static void *
+ovsdb_log_commit_main(void *file_)
+{
+    struct ovsdb_log *file = file_;
+    int fd = fileno(file->stream);
+
+    xpthread_mutex_lock(&file->mutex);
+    for (;;) {
+        uint64_t seqno;
+        int error;
+
+        while (file->commit_synced == file->commit_requested
+               && !file->commit_exiting) {
+            xpthread_cond_wait(&file->cond, &file->mutex);
+        }
+        if (file->commit_synced == file->commit_requested) {
+            break;
+        }
+
+        /* A single fsync() covers every commit requested so far, including
+         * those requested while the previous fsync() was in progress. */
+        seqno = file->commit_requested;
+        xpthread_mutex_unlock(&file->mutex);
+
+        ovsrcu_quiesce_start();
+        error = fsync(fd) ? errno : 0;
+        ovsrcu_quiesce_end();
+
+        xpthread_mutex_lock(&file->mutex);
+        if (error) {
+            ovsdb_log_add_commit_failure(file, seqno, error);
+        }
+        file->commit_synced = seqno;
+        latch_set(&file->commit_latch);
+    }
+    xpthread_mutex_unlock(&file->mutex);
+
+    return NULL;
+}
+
+/* Starts committing, in the background, everything written to 'file' so far.
+ * 'seqno' identifies the commit for later calls to ovsdb_log_commit_is_done()
+ * and ovsdb_log_commit_wait().  It must be greater than the 'seqno' passed to
+ * any previous call for 'file'.
+ *
+ * Calls that arrive while an earlier commit is in progress are grouped
+ * together into a single fsync(), so that the cost of many small durable
+ * transactions is amortized. */
+void
+ovsdb_log_commit_start(struct ovsdb_log *file, uint64_t seqno)
+{
+    if (!file->commit_thread_started) {
+        file->commit_thread_started = true;
+        xpthread_create(&file->commit_thread, NULL, ovsdb_log_commit_main,
+                        file);
+    }
+
+    xpthread_mutex_lock(&file->mutex);
+    ovs_assert(seqno > file->commit_requested);
+    file->commit_requested = seqno;
+    xpthread_cond_signal(&file->cond);
+    xpthread_mutex_unlock(&file->mutex);
+}
+
+/* Returns true if the commit started by ovsdb_log_commit_start() with
+ * 'seqno', or a later one, has finished, false if it is still in progress.
+ * When this function returns true, it also stores in '*errorp' NULL if the
+ * commit succeeded or an error that the caller must eventually free if it
+ * failed.  When it returns false, it stores NULL in '*errorp'. */
+bool
+ovsdb_log_commit_is_done(struct ovsdb_log *file, uint64_t seqno,
+                         struct ovsdb_error **errorp)
+{
+    bool done;
+
+    latch_poll(&file->commit_latch);
+
+    *errorp = NULL;
+    xpthread_mutex_lock(&file->mutex);
+    done = seqno <= file->commit_synced;
+    if (done) {
+        int error = ovsdb_log_find_commit_failure(file, seqno);
+        if (error) {
+            *errorp = ovsdb_io_error(error, "%s: fsync failed", file->name);
+        }
+    }
+    xpthread_mutex_unlock(&file->mutex);
+
+    return done;
+}
+
+/* Causes poll_block() to wake up when the commit started by
+ * ovsdb_log_commit_start() with 'seqno' finishes. */
+void
+ovsdb_log_commit_wait(struct ovsdb_log *file, uint64_t seqno)
+{
+    bool done;
+
+    xpthread_mutex_lock(&file->mutex);
+    done = seqno <= file->commit_synced;
+    xpthread_mutex_unlock(&file->mutex);
+
+    if (done) {
+        poll_immediate_wake();
+    } else {
+        latch_wait(&file->commit_latch);
+    }
+}
+
 /* Returns the current offset into the file backing 'log', in bytes.  This
  * reflects the number of bytes that have been read or written in the file.  If
  * the whole file has been read, this is the file size. */
@@ -16,8 +16,11 @@
 #ifndef OVSDB_LOG_H
 #define OVSDB_LOG_H 1
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include "compiler.h"
+#include "ofpbuf.h"
 
 struct json;
 struct ovsdb_log;
@@ -29,20 +32,56 @@ enum ovsdb_log_open_mode {
     OVSDB_LOG_CREATE            /* Create new file, read/write. */
 };
 
+/* Encoding of the records in an OVSDB log. */
+enum ovsdb_log_format {
+    OVSDB_LOG_JSON,             /* JSON text (the default). */
+    OVSDB_LOG_BINARY            /* Compact binary encoding (see binary.h). */
+};
+
+bool ovsdb_log_format_from_string(const char *, enum ovsdb_log_format *);
+
 struct ovsdb_error *ovsdb_log_open(const char *name, enum ovsdb_log_open_mode,
                                    int locking, struct ovsdb_log **)
     WARN_UNUSED_RESULT;
 void ovsdb_log_close(struct ovsdb_log *);
 
+enum ovsdb_log_format ovsdb_log_get_format(const struct ovsdb_log *);
+void ovsdb_log_set_format(struct ovsdb_log *, enum ovsdb_log_format);
+
 struct ovsdb_error *ovsdb_log_read(struct ovsdb_log *, struct json **)
     WARN_UNUSED_RESULT;
 void ovsdb_log_unread(struct ovsdb_log *);
 
+/* A log record that has been read and checked against its SHA-1 hash but not
+ * yet parsed.  See ovsdb_log_read_record(). */
+struct ovsdb_log_record {
+    off_t offset;                 /* Offset of record's header line. */
+    off_t data_offset;            /* Offset of record's body. */
+    enum ovsdb_log_format format; /* Encoding of record's body. */
+    struct ofpbuf data;           /* Record's body. */
+};
+
+struct ovsdb_error *ovsdb_log_read_record(struct ovsdb_log *,
+                                          struct ovsdb_log_record **)
+    WARN_UNUSED_RESULT;
+struct ovsdb_error *ovsdb_log_parse_record(const struct ovsdb_log *,
+                                           const struct ovsdb_log_record *,
+                                           struct json **)
+    WARN_UNUSED_RESULT;
+void ovsdb_log_record_destroy(struct ovsdb_log_record *);
+void ovsdb_log_unread_record(struct ovsdb_log *,
+                             const struct ovsdb_log_record *);
+
 struct ovsdb_error *ovsdb_log_write(struct ovsdb_log *, struct json *)
     WARN_UNUSED_RESULT;
 struct ovsdb_error *ovsdb_log_commit(struct ovsdb_log *)
     WARN_UNUSED_RESULT;
 
+void ovsdb_log_commit_start(struct ovsdb_log *, uint64_t seqno);
+bool ovsdb_log_commit_is_done(struct ovsdb_log *, uint64_t seqno,
+                              struct ovsdb_error **);
+void ovsdb_log_commit_wait(struct ovsdb_log *, uint64_t seqno);
+
 off_t ovsdb_log_get_offset(const struct ovsdb_log *);
 
 #endif /* ovsdb/log.h */
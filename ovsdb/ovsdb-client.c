@@ -37,12 +37,14 @@
 #include "ovsdb.h"
 #include "ovsdb-data.h"
 #include "ovsdb-error.h"
+#include "poll-loop.h"
 #include "sort.h"
 #include "svec.h"
 #include "stream.h"
 #include "stream-ssl.h"
 #include "table.h"
 #include "timeval.h"
+#include "unixctl.h"
 #include "util.h"
 #include "vlog.h"
 
@@ -253,6 +255,10 @@ usage(void)
            "    monitor contents of COLUMNs in TABLE in DATABASE on SERVER.\n"
            "    COLUMNs may include !initial, !insert, !delete, !modify\n"
            "    to avoid seeing the specified kinds of changes.\n"
+           "\n  monitor-cond [SERVER] [DATABASE] CONDITION TABLE "
+           "[COLUMN,...]...\n"
+           "    monitor contents of COLUMNs in the rows of TABLE that match\n"
+           "    CONDITION (a JSON array of <condition>s), as \"monitor\".\n"
            "\n  dump [SERVER] [DATABASE]\n"
            "    dump contents of DATABASE on SERVER to stdout\n"
            "\nThe default SERVER is unix:%s/db.sock.\n"
@@ -669,13 +675,51 @@ parse_monitor_columns(char *arg, const char *server, const char *database,
     return mr;
 }
 
+struct monitor_cond_aux {
+    struct jsonrpc *rpc;
+    const struct ovsdb_schema *schema;
+};
+
 static void
-do_monitor(struct jsonrpc *rpc, const char *database,
-           int argc, char *argv[])
+ovsdb_client_cond_change(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                         const char *argv[], void *aux_)
+{
+    struct monitor_cond_aux *aux = aux_;
+    struct json *where, *request, *requests, *params;
+
+    if (!shash_find(&aux->schema->tables, argv[1])) {
+        unixctl_command_reply_error(conn, "no such table");
+        return;
+    }
+
+    where = json_from_string(argv[2]);
+    if (where->type != JSON_ARRAY) {
+        unixctl_command_reply_error(conn, "condition must be a JSON array");
+        json_destroy(where);
+        return;
+    }
+
+    request = json_object_create();
+    json_object_put(request, "where", where);
+    requests = json_object_create();
+    json_object_put(requests, argv[1], request);
+    params = json_array_create_2(json_null_create(), requests);
+    jsonrpc_send(aux->rpc,
+                 jsonrpc_create_request("monitor_cond_change", params, NULL));
+    unixctl_command_reply(conn, NULL);
+}
+
+/* Implements the "monitor" command, or "monitor-cond" if 'where' is nonnull,
+ * in which case it is a JSON array of <condition>s on the table. */
+static void
+do_monitor__(struct jsonrpc *rpc, const char *database,
+             struct json *where, int argc, char *argv[])
 {
     const char *server = jsonrpc_get_name(rpc);
     const char *table_name = argv[0];
     struct ovsdb_column_set columns = OVSDB_COLUMN_SET_INITIALIZER;
+    struct unixctl_server *unixctl = NULL;
+    struct monitor_cond_aux cond_aux;
     struct ovsdb_table_schema *table;
     struct ovsdb_schema *schema;
     struct jsonrpc_msg *request;
@@ -708,48 +752,106 @@ do_monitor(struct jsonrpc *rpc, const char *database,
             parse_monitor_columns(empty, server, database, table, &columns));
     }
 
+    if (where) {
+        /* The condition applies to the table as a whole, so it only needs to
+         * go in one of the table's <monitor-request>s. */
+        json_object_put(monitor_request_array->u.array.elems[0], "where",
+                        where);
+    }
+
     monitor_requests = json_object_create();
     json_object_put(monitor_requests, table_name, monitor_request_array);
 
     monitor = json_array_create_3(json_string_create(database),
                                   json_null_create(), monitor_requests);
-    request = jsonrpc_create_request("monitor", monitor, NULL);
+    request = jsonrpc_create_request(where ? "monitor_cond" : "monitor",
+                                     monitor, NULL);
     request_id = json_clone(request->id);
     jsonrpc_send(rpc, request);
     for (;;) {
-        struct jsonrpc_msg *msg;
-        int error;
-
-        error = jsonrpc_recv_block(rpc, &msg);
-        if (error) {
-            ovsdb_schema_destroy(schema);
-            ovs_fatal(error, "%s: receive failed", server);
+        if (unixctl) {
+            unixctl_server_run(unixctl);
         }
 
-        if (msg->type == JSONRPC_REQUEST && !strcmp(msg->method, "echo")) {
-            jsonrpc_send(rpc, jsonrpc_create_reply(json_clone(msg->params),
-                                                   msg->id));
-        } else if (msg->type == JSONRPC_REPLY
-                   && json_equal(msg->id, request_id)) {
-            monitor_print(msg->result, table, &columns, true);
-            fflush(stdout);
-            if (get_detach()) {
-                daemon_save_fd(STDOUT_FILENO);
-                daemonize();
+        for (;;) {
+            struct jsonrpc_msg *msg;
+            int error;
+
+            error = jsonrpc_recv(rpc, &msg);
+            if (error == EAGAIN) {
+                break;
+            } else if (error) {
+                ovsdb_schema_destroy(schema);
+                ovs_fatal(error, "%s: receive failed", server);
             }
-        } else if (msg->type == JSONRPC_NOTIFY
-                   && !strcmp(msg->method, "update")) {
-            struct json *params = msg->params;
-            if (params->type == JSON_ARRAY
-                && params->u.array.n == 2
-                && params->u.array.elems[0]->type == JSON_NULL) {
-                monitor_print(params->u.array.elems[1],
-                              table, &columns, false);
+
+            if (msg->type == JSONRPC_REQUEST && !strcmp(msg->method, "echo")) {
+                jsonrpc_send(rpc, jsonrpc_create_reply(json_clone(msg->params),
+                                                       msg->id));
+            } else if (msg->type == JSONRPC_REPLY
+                       && json_equal(msg->id, request_id)) {
+                monitor_print(msg->result, table, &columns, true);
                 fflush(stdout);
+                if (get_detach()) {
+                    daemon_save_fd(STDOUT_FILENO);
+                    daemonize();
+                }
+                if (where) {
+                    int retval = unixctl_server_create(NULL, &unixctl);
+                    if (retval) {
+                        ovs_fatal(retval, "failed to create unixctl server");
+                    }
+                    cond_aux.rpc = rpc;
+                    cond_aux.schema = schema;
+                    unixctl_command_register("ovsdb-client/cond_change",
+                                             "TABLE CONDITION", 2, 2,
+                                             ovsdb_client_cond_change,
+                                             &cond_aux);
+                }
+            } else if (msg->type == JSONRPC_NOTIFY
+                       && !strcmp(msg->method, "update")) {
+                struct json *params = msg->params;
+                if (params->type == JSON_ARRAY
+                    && params->u.array.n == 2
+                    && params->u.array.elems[0]->type == JSON_NULL) {
+                    monitor_print(params->u.array.elems[1],
+                                  table, &columns, false);
+                    fflush(stdout);
+                }
             }
+            jsonrpc_msg_destroy(msg);
         }
-        jsonrpc_msg_destroy(msg);
+
+        jsonrpc_run(rpc);
+        jsonrpc_wait(rpc);
+        jsonrpc_recv_wait(rpc);
+        if (unixctl) {
+            unixctl_server_wait(unixctl);
+        }
+        poll_block();
+    }
+}
+
+static void
+do_monitor(struct jsonrpc *rpc, const char *database,
+           int argc, char *argv[])
+{
+    do_monitor__(rpc, database, NULL, argc, argv);
+}
+
+static void
+do_monitor_cond(struct jsonrpc *rpc, const char *database,
+                int argc, char *argv[])
+{
+    struct json *where;
+
+    where = json_from_string(argv[0]);
+    if (where->type == JSON_STRING) {
+        ovs_fatal(0, "\"%s\": %s", argv[0], json_string(where));
+    } else if (where->type != JSON_ARRAY) {
+        ovs_fatal(0, "\"%s\": condition must be a JSON array", argv[0]);
     }
+    do_monitor__(rpc, database, where, argc - 1, argv + 1);
 }
 
 struct dump_table_aux {
@@ -991,6 +1093,7 @@ static const struct ovsdb_client_command all_commands[] = {
     { "list-columns",       NEED_DATABASE, 0, 1,       do_list_columns },
     { "transact",           NEED_RPC,      1, 1,       do_transact },
     { "monitor",            NEED_DATABASE, 1, INT_MAX, do_monitor },
+    { "monitor-cond",       NEED_DATABASE, 2, INT_MAX, do_monitor_cond },
     { "dump",               NEED_DATABASE, 0, 0,       do_dump },
 
     { "help",               NEED_NONE,     0, INT_MAX, do_help },
@@ -27,6 +27,7 @@
 #include "dirs.h"
 #include "dummy.h"
 #include "dynamic-string.h"
+#include "fatal-signal.h"
 #include "file.h"
 #include "hash.h"
 #include "json.h"
@@ -38,8 +39,10 @@
 #include "ovsdb-data.h"
 #include "ovsdb-types.h"
 #include "ovsdb-error.h"
+#include "ovs-thread.h"
 #include "poll-loop.h"
 #include "process.h"
+#include "replication.h"
 #include "row.h"
 #include "simap.h"
 #include "shash.h"
@@ -72,15 +75,35 @@ static char *certificate_file;
 static char *ca_cert_file;
 static bool bootstrap_ca_cert;
 
+/* --session-threads: Number of threads for client connection I/O. */
+static unsigned int n_session_threads;
+
+/* --sync-from: Server whose databases to replicate read-only, if any. */
+static char *sync_from;
+
 static unixctl_cb_func ovsdb_server_exit;
 static unixctl_cb_func ovsdb_server_compact;
 static unixctl_cb_func ovsdb_server_reconnect;
 
+/* An "ovsdb-server/compact" command waiting for the background compactions
+ * that it started to finish. */
+struct compact_request {
+    struct list node;           /* In 'compact_requests'. */
+    struct unixctl_conn *conn;
+    struct sset dbs;            /* Names of databases still compacting. */
+    struct ds errors;           /* Errors from finished compactions. */
+};
+static struct list compact_requests = LIST_INITIALIZER(&compact_requests);
+
+static void compact_requests_db_done(const char *db_name,
+                                     const struct ovsdb_error *);
+
 struct server_config {
     struct sset *remotes;
     struct shash *all_dbs;
     FILE *config_tmpfile;
     struct ovsdb_jsonrpc_server *jsonrpc;
+    struct replication *replication; /* Nonnull only with --sync-from. */
 };
 static unixctl_cb_func ovsdb_server_add_remote;
 static unixctl_cb_func ovsdb_server_remove_remote;
@@ -141,6 +164,14 @@ main(int argc, char *argv[])
 
     parse_options(&argc, &argv, &remotes, &unixctl_path, &run_command);
 
+    /* Use spare cores to parse database files in parallel as they are read.
+     * This is not possible with --run, because process_start() requires the
+     * process to still be single-threaded. */
+    if (!run_command && count_cpu_cores() > 1) {
+        fatal_signal_init();
+        ovsdb_file_set_replay_threads(MIN(count_cpu_cores() - 1, 4));
+    }
+
     /* Create and initialize 'config_tmpfile' as a temporary file to hold
      * ovsdb-server's most basic configuration, and then save our initial
      * configuration to it.  When --monitor is used, this preserves the effects
@@ -172,10 +203,19 @@ main(int argc, char *argv[])
     /* Load the saved config. */
     load_config(config_tmpfile, &remotes, &db_filenames);
     jsonrpc = ovsdb_jsonrpc_server_create();
+    /* Session threads start along with the first session, which may be
+     * created by reconfigure_remotes() below, so they are not possible with
+     * --run either. */
+    if (!run_command) {
+        ovsdb_jsonrpc_server_set_threads(jsonrpc, n_session_threads);
+    }
 
     shash_init(&all_dbs);
     server_config.all_dbs = &all_dbs;
     server_config.jsonrpc = jsonrpc;
+    server_config.replication = (sync_from
+                                 ? replication_create(sync_from)
+                                 : NULL);
     SSET_FOR_EACH (db_filename, &db_filenames) {
         error = open_db(&server_config, db_filename);
         if (error) {
@@ -269,10 +309,19 @@ main(int argc, char *argv[])
             &remotes_error);
         report_error_if_changed(reconfigure_ssl(&all_dbs), &ssl_error);
         ovsdb_jsonrpc_server_run(jsonrpc);
+        if (server_config.replication) {
+            replication_run(server_config.replication);
+        }
 
         SHASH_FOR_EACH(node, &all_dbs) {
             struct db *db = node->data;
+            struct ovsdb_error *error;
+
             ovsdb_trigger_run(db->db, time_msec());
+            if (ovsdb_file_compact_run(db->file, &error)) {
+                compact_requests_db_done(db->db->schema->name, error);
+                ovsdb_error_destroy(error);
+            }
         }
         if (run_process) {
             process_run();
@@ -289,10 +338,14 @@ main(int argc, char *argv[])
 
         memory_wait();
         ovsdb_jsonrpc_server_wait(jsonrpc);
+        if (server_config.replication) {
+            replication_wait(server_config.replication);
+        }
         unixctl_server_wait(unixctl);
         SHASH_FOR_EACH(node, &all_dbs) {
             struct db *db = node->data;
             ovsdb_trigger_wait(db->db, time_msec());
+            ovsdb_file_compact_wait(db->file);
         }
         if (run_process) {
             process_wait(run_process);
@@ -304,6 +357,7 @@ main(int argc, char *argv[])
         poll_block();
     }
     ovsdb_jsonrpc_server_destroy(jsonrpc);
+    replication_destroy(server_config.replication);
     SHASH_FOR_EACH(node, &all_dbs) {
         struct db *db = node->data;
         ovsdb_destroy(db->db);
@@ -338,7 +392,11 @@ open_db(struct server_config *config, const char *filename)
     } else if (!ovsdb_jsonrpc_server_add_db(config->jsonrpc, db->db)) {
         error = xasprintf("%s: duplicate database name", db->db->schema->name);
     } else {
+        ovsdb_file_enable_async_commit(db->file);
         shash_add_assert(config->all_dbs, db->db->schema->name, db);
+        if (config->replication) {
+            replication_add_db(config->replication, db->db);
+        }
         return NULL;
     }
 
@@ -484,8 +542,8 @@ query_db_string(const struct shash *all_dbs, const char *name,
 
             datum = &row->fields[column->index];
             for (i = 0; i < datum->n; i++) {
-                if (datum->keys[i].string[0]) {
-                    return datum->keys[i].string;
+                if (datum->keys[i].s->string[0]) {
+                    return datum->keys[i].s->string;
                 }
             }
         }
@@ -562,13 +620,13 @@ read_map_string_column(const struct ovsdb_row *row, const char *column_name,
 
     for (i = 0; i < datum->n; i++) {
         atom_key = &datum->keys[i];
-        if (!strcmp(atom_key->string, key)){
+        if (!strcmp(atom_key->s->string, key)){
             atom_value = &datum->values[i];
             break;
         }
     }
 
-    return atom_value ? atom_value->string : NULL;
+    return atom_value ? atom_value->s->string : NULL;
 }
 
 static const union ovsdb_atom *
@@ -600,7 +658,7 @@ read_string_column(const struct ovsdb_row *row, const char *column_name,
     const union ovsdb_atom *atom;
 
     atom = read_column(row, column_name, OVSDB_TYPE_STRING);
-    *stringp = atom ? atom->string : NULL;
+    *stringp = atom ? atom->s->string : NULL;
     return atom != NULL;
 }
 
@@ -656,8 +714,10 @@ write_string_string_column(struct ovsdb_row *row, const char *column_name,
     datum->values = xmalloc(n * sizeof *datum->values);
 
     for (i = 0; i < n; ++i) {
-        datum->keys[i].string = keys[i];
-        datum->values[i].string = values[i];
+        datum->keys[i].s = ovsdb_atom_string_create(keys[i]);
+        datum->values[i].s = ovsdb_atom_string_create(values[i]);
+        free(keys[i]);
+        free(values[i]);
     }
 
     /* Sort and check constraints. */
@@ -723,7 +783,7 @@ query_db_remotes(const char *name, const struct shash *all_dbs,
 
             datum = &row->fields[column->index];
             for (i = 0; i < datum->n; i++) {
-                add_remote(remotes, datum->keys[i].string);
+                add_remote(remotes, datum->keys[i].s->string);
             }
         }
     } else if (column->type.key.type == OVSDB_TYPE_UUID
@@ -956,17 +1016,71 @@ ovsdb_server_exit(struct unixctl_conn *conn, int argc OVS_UNUSED,
     unixctl_command_reply(conn, NULL);
 }
 
+static void
+compact_request_add_error(struct compact_request *request,
+                          const struct ovsdb_error *error)
+{
+    char *s = ovsdb_error_to_string(error);
+    ds_put_format(&request->errors, "%s\n", s);
+    free(s);
+}
+
+/* Replies to 'request' and frees it, if it is not waiting for any more
+ * databases. */
+static void
+compact_request_try_reply(struct compact_request *request)
+{
+    if (sset_is_empty(&request->dbs)) {
+        if (request->errors.length) {
+            unixctl_command_reply_error(request->conn,
+                                        ds_cstr(&request->errors));
+        } else {
+            unixctl_command_reply(request->conn, NULL);
+        }
+
+        list_remove(&request->node);
+        sset_destroy(&request->dbs);
+        ds_destroy(&request->errors);
+        free(request);
+    }
+}
+
+/* Reports to the pending "ovsdb-server/compact" commands that compaction of
+ * the database named 'db_name' has finished with the given 'error' (NULL on
+ * success). */
+static void
+compact_requests_db_done(const char *db_name, const struct ovsdb_error *error)
+{
+    struct compact_request *request, *next;
+
+    LIST_FOR_EACH_SAFE (request, next, node, &compact_requests) {
+        if (sset_find_and_delete(&request->dbs, db_name)) {
+            if (error) {
+                compact_request_add_error(request, error);
+            }
+            compact_request_try_reply(request);
+        }
+    }
+}
+
+/* Compacts the requested databases in the background and replies once all of
+ * them are done, so that clients are not stalled in the meantime. */
 static void
 ovsdb_server_compact(struct unixctl_conn *conn, int argc,
                      const char *argv[], void *dbs_)
 {
+    struct compact_request *request;
     struct shash *all_dbs = dbs_;
-    struct ds reply;
     struct db *db;
     struct shash_node *node;
     int n = 0;
 
-    ds_init(&reply);
+    request = xmalloc(sizeof *request);
+    request->conn = conn;
+    sset_init(&request->dbs);
+    ds_init(&request->errors);
+    list_push_back(&compact_requests, &request->node);
+
     SHASH_FOR_EACH(node, all_dbs) {
         const char *name;
 
@@ -978,11 +1092,12 @@ ovsdb_server_compact(struct unixctl_conn *conn, int argc,
 
             VLOG_INFO("compacting %s database by user request", name);
 
-            error = ovsdb_file_compact(db->file);
+            error = ovsdb_file_compact_start(db->file);
             if (error) {
-                char *s = ovsdb_error_to_string(error);
-                ds_put_format(&reply, "%s\n", s);
-                free(s);
+                compact_request_add_error(request, error);
+                ovsdb_error_destroy(error);
+            } else {
+                sset_add(&request->dbs, name);
             }
 
             n++;
@@ -990,13 +1105,15 @@ ovsdb_server_compact(struct unixctl_conn *conn, int argc,
     }
 
     if (!n) {
+        list_remove(&request->node);
+        sset_destroy(&request->dbs);
+        ds_destroy(&request->errors);
+        free(request);
+
         unixctl_command_reply_error(conn, "no database by that name");
-    } else if (reply.length) {
-        unixctl_command_reply_error(conn, ds_cstr(&reply));
     } else {
-        unixctl_command_reply(conn, NULL);
+        compact_request_try_reply(request);
     }
-    ds_destroy(&reply);
 }
 
 /* "ovsdb-server/reconnect": makes ovsdb-server drop all of its JSON-RPC
@@ -1105,6 +1222,7 @@ ovsdb_server_remove_database(struct unixctl_conn *conn, int argc OVS_UNUSED,
                              const char *argv[], void *config_)
 {
     struct server_config *config = config_;
+    struct ovsdb_error *error;
     struct shash_node *node;
     struct db *db;
     bool ok;
@@ -1118,7 +1236,17 @@ ovsdb_server_remove_database(struct unixctl_conn *conn, int argc OVS_UNUSED,
 
     ok = ovsdb_jsonrpc_server_remove_db(config->jsonrpc, db->db);
     ovs_assert(ok);
+    if (config->replication) {
+        replication_remove_db(config->replication, db->db);
+    }
 
+    /* Destroying the database abandons any compaction in progress, so report
+     * failure to anyone waiting for it. */
+    error = ovsdb_error("compaction aborted",
+                        "%s: database removed during compaction",
+                        db->db->schema->name);
+    compact_requests_db_done(db->db->schema->name, error);
+    ovsdb_error_destroy(error);
     ovsdb_destroy(db->db);
     shash_delete(config->all_dbs, node);
     free(db->filename);
@@ -1160,6 +1288,8 @@ parse_options(int *argcp, char **argvp[],
         OPT_RUN,
         OPT_BOOTSTRAP_CA_CERT,
         OPT_ENABLE_DUMMY,
+        OPT_SESSION_THREADS,
+        OPT_SYNC_FROM,
         VLOG_OPTION_ENUMS,
         DAEMON_OPTION_ENUMS
     };
@@ -1167,6 +1297,8 @@ parse_options(int *argcp, char **argvp[],
         {"remote",      required_argument, NULL, OPT_REMOTE},
         {"unixctl",     required_argument, NULL, OPT_UNIXCTL},
         {"run",         required_argument, NULL, OPT_RUN},
+        {"session-threads", required_argument, NULL, OPT_SESSION_THREADS},
+        {"sync-from",   required_argument, NULL, OPT_SYNC_FROM},
         {"help",        no_argument, NULL, 'h'},
         {"version",     no_argument, NULL, 'V'},
         DAEMON_LONG_OPTIONS,
@@ -1204,6 +1336,22 @@ parse_options(int *argcp, char **argvp[],
             *run_command = optarg;
             break;
 
+        case OPT_SESSION_THREADS:
+            if (!str_to_uint(optarg, 10, &n_session_threads)
+                || n_session_threads > 64) {
+                ovs_fatal(0, "--session-threads argument must be between 0 "
+                          "and 64");
+            }
+            break;
+
+        case OPT_SYNC_FROM:
+            if (stream_verify_name(optarg)) {
+                ovs_fatal(0, "--sync-from argument \"%s\" is not an active "
+                          "connection method", optarg);
+            }
+            sync_from = optarg;
+            break;
+
         case 'h':
             usage();
 
@@ -1264,6 +1412,8 @@ usage(void)
     vlog_usage();
     printf("\nOther options:\n"
            "  --run COMMAND           run COMMAND as subprocess then exit\n"
+           "  --session-threads=N     use N threads for client connections\n"
+           "  --sync-from=SERVER      replicate SERVER's databases read-only\n"
            "  --unixctl=SOCKET        override default control socket name\n"
            "  -h, --help              display this help message\n"
            "  -V, --version           display version information\n");
@@ -331,6 +331,8 @@ ovsdb_create(struct ovsdb_schema *schema)
     list_init(&db->replicas);
     list_init(&db->triggers);
     db->run_triggers = false;
+    db->durable_seqno = 0;
+    db->read_only = false;
 
     shash_init(&db->tables);
     SHASH_FOR_EACH (node, &schema->tables) {
@@ -429,3 +431,46 @@ ovsdb_remove_replica(struct ovsdb *db OVS_UNUSED, struct ovsdb_replica *r)
     list_remove(&r->node);
     (r->class->destroy)(r);
 }
+
+/* Returns true if the durable commit numbered 'seqno' has reached stable
+ * storage in every replica of 'db', or false if some replica is still
+ * working on it.  Durable commits are numbered consecutively starting from 1,
+ * and the number of the latest one is 'db->durable_seqno'.  Commit 0 is
+ * always durable.
+ *
+ * When this function returns true, it also stores NULL in '*errorp' if the
+ * commit succeeded, or an error that the caller must eventually free if some
+ * replica failed to commit it.  When it returns false, it stores NULL in
+ * '*errorp'. */
+bool
+ovsdb_is_durable(struct ovsdb *db, uint64_t seqno, struct ovsdb_error **errorp)
+{
+    struct ovsdb_replica *r;
+
+    *errorp = NULL;
+    if (seqno) {
+        LIST_FOR_EACH (r, node, &db->replicas) {
+            if (r->class->is_durable
+                && !r->class->is_durable(r, seqno, errorp)) {
+                return false;
+            } else if (*errorp) {
+                return true;
+            }
+        }
+    }
+    return true;
+}
+
+/* Causes poll_block() to wake up when ovsdb_is_durable() would return true
+ * for 'seqno'. */
+void
+ovsdb_durable_wait(struct ovsdb *db, uint64_t seqno)
+{
+    struct ovsdb_replica *r;
+
+    LIST_FOR_EACH (r, node, &db->replicas) {
+        if (r->class->durable_wait) {
+            r->class->durable_wait(r, seqno);
+        }
+    }
+}
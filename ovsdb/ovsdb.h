@@ -16,12 +16,14 @@
 #ifndef OVSDB_OVSDB_H
 #define OVSDB_OVSDB_H 1
 
+#include <stdint.h>
 #include "compiler.h"
 #include "hmap.h"
 #include "list.h"
 #include "shash.h"
 
 struct json;
+struct ovsdb_error;
 struct ovsdb_log;
 struct ovsdb_session;
 struct ovsdb_txn;
@@ -62,6 +64,13 @@ struct ovsdb {
     /* Triggers. */
     struct list triggers;       /* Contains "struct ovsdb_trigger"s. */
     bool run_triggers;
+
+    /* Number of transactions committed with "durable": true so far. */
+    uint64_t durable_seqno;
+
+    /* True if this database is a replica of another server's database (see
+     * replication.h), so that clients may only read it. */
+    bool read_only;
 };
 
 struct ovsdb *ovsdb_create(struct ovsdb_schema *);
@@ -74,7 +83,8 @@ struct ovsdb_table *ovsdb_get_table(const struct ovsdb *, const char *);
 struct json *ovsdb_execute(struct ovsdb *, const struct ovsdb_session *,
                            const struct json *params,
                            long long int elapsed_msec,
-                           long long int *timeout_msec);
+                           long long int *timeout_msec,
+                           uint64_t *durable_seqno);
 
 /* Database replication. */
 
@@ -87,6 +97,16 @@ struct ovsdb_replica_class {
     struct ovsdb_error *(*commit)(struct ovsdb_replica *,
                                   const struct ovsdb_txn *, bool durable);
     void (*destroy)(struct ovsdb_replica *);
+
+    /* Optional, for replicas that finish durable commits in the background.
+     *
+     * 'is_durable' returns true if the durable commit numbered 'seqno' (see
+     * ovsdb_is_durable()) has finished, storing NULL or an error in '*errorp'
+     * as its outcome.  'durable_wait' arranges for poll_block() to wake up
+     * when that commit finishes. */
+    bool (*is_durable)(struct ovsdb_replica *, uint64_t seqno,
+                       struct ovsdb_error **errorp);
+    void (*durable_wait)(struct ovsdb_replica *, uint64_t seqno);
 };
 
 void ovsdb_replica_init(struct ovsdb_replica *,
@@ -95,4 +115,7 @@ void ovsdb_replica_init(struct ovsdb_replica *,
 void ovsdb_add_replica(struct ovsdb *, struct ovsdb_replica *);
 void ovsdb_remove_replica(struct ovsdb *, struct ovsdb_replica *);
 
+bool ovsdb_is_durable(struct ovsdb *, uint64_t seqno, struct ovsdb_error **);
+void ovsdb_durable_wait(struct ovsdb *, uint64_t seqno);
+
 #endif /* ovsdb/ovsdb.h */
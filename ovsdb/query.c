@@ -1,4 +1,4 @@
-/* Copyright (c) 2009, 2010 Nicira, Inc.
+/* Copyright (c) 2009, 2010, 2013 Nicira, Inc.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -17,10 +17,258 @@
 
 #include "query.h"
 
+#include <stdint.h>
+
 #include "column.h"
 #include "condition.h"
 #include "row.h"
+#include "skiplist.h"
 #include "table.h"
+#include "transaction.h"
+
+/* Returns the "==" clause in 'cnd' on 'column', or NULL if there is none. */
+static const struct ovsdb_clause *
+find_eq_clause(const struct ovsdb_condition *cnd,
+               const struct ovsdb_column *column)
+{
+    size_t i;
+
+    /* ovsdb_condition_from_json() sorts the "==" clauses to the front. */
+    for (i = 0; i < cnd->n_clauses && cnd->clauses[i].function == OVSDB_F_EQ;
+         i++) {
+        if (cnd->clauses[i].column == column) {
+            return &cnd->clauses[i];
+        }
+    }
+    return NULL;
+}
+
+/* Looks for an index in 'table' whose every column is constrained by an "=="
+ * clause in 'cnd'.  If there is one, returns its number and stores in '*hash'
+ * the hash that the rows matching 'cnd' must have in that index.  Otherwise,
+ * returns SIZE_MAX.
+ *
+ * Unique indexes come first in 'table->indexes', so they are preferred. */
+static size_t
+choose_index(const struct ovsdb_table *table,
+             const struct ovsdb_condition *cnd, uint32_t *hash)
+{
+    const struct ovsdb_table_schema *ts = table->schema;
+    size_t i;
+
+    if (!cnd->n_clauses || cnd->clauses[0].function != OVSDB_F_EQ) {
+        return SIZE_MAX;
+    }
+
+    for (i = 0; i < ovsdb_table_schema_n_all_indexes(ts); i++) {
+        const struct ovsdb_column_set *index = &ts->indexes[i];
+        uint32_t basis = 0;
+        size_t j;
+
+        for (j = 0; j < index->n_columns; j++) {
+            const struct ovsdb_column *column = index->columns[j];
+            const struct ovsdb_clause *clause = find_eq_clause(cnd, column);
+
+            if (!clause) {
+                break;
+            }
+            /* Hash the same way as ovsdb_row_hash_columns(). */
+            basis = ovsdb_datum_hash(&clause->arg, &column->type, basis);
+        }
+        if (j == index->n_columns) {
+            *hash = basis;
+            return i;
+        }
+    }
+    return SIZE_MAX;
+}
+
+/* Stores in '*min' and '*max' the lower and upper bounds, respectively, that
+ * 'cnd' places on the value of scalar 'column', or NULL for no bound.  Returns
+ * true if there is at least one bound, false otherwise. */
+static bool
+find_bounds(const struct ovsdb_condition *cnd,
+            const struct ovsdb_column *column,
+            const union ovsdb_atom **min, const union ovsdb_atom **max)
+{
+    enum ovsdb_atomic_type type = column->type.key.type;
+    size_t i;
+
+    *min = *max = NULL;
+    for (i = 0; i < cnd->n_clauses; i++) {
+        const struct ovsdb_clause *clause = &cnd->clauses[i];
+        const union ovsdb_atom *arg = &clause->arg.keys[0];
+        enum ovsdb_function f = clause->function;
+
+        if (clause->column != column) {
+            continue;
+        }
+        if ((f == OVSDB_F_EQ || f == OVSDB_F_GE || f == OVSDB_F_GT)
+            && (!*min || ovsdb_atom_compare_3way(arg, *min, type) > 0)) {
+            *min = arg;
+        }
+        if ((f == OVSDB_F_EQ || f == OVSDB_F_LE || f == OVSDB_F_LT)
+            && (!*max || ovsdb_atom_compare_3way(arg, *max, type) < 0)) {
+            *max = arg;
+        }
+    }
+    return *min || *max;
+}
+
+/* Returns the number of the ordered index in 'table' that can narrow down the
+ * rows matching 'cnd', or SIZE_MAX if there is none.  In the former case,
+ * stores in '*min' and '*max' the lower and upper bounds, respectively, that
+ * 'cnd' places on the indexed column's value, or NULL for no bound. */
+static size_t
+choose_ordered_index(const struct ovsdb_table *table,
+                     const struct ovsdb_condition *cnd,
+                     const union ovsdb_atom **min, const union ovsdb_atom **max)
+{
+    const struct ovsdb_table_schema *ts = table->schema;
+    size_t i;
+
+    for (i = 0; i < ts->n_ordered_indexes; i++) {
+        if (find_bounds(cnd, ts->ordered_indexes[i], min, max)) {
+            return i;
+        }
+    }
+    return SIZE_MAX;
+}
+
+/* Returns the number of the ordered index in 'table' on 'column', or SIZE_MAX
+ * if there is none. */
+static size_t
+find_ordered_index(const struct ovsdb_table *table,
+                   const struct ovsdb_column *column)
+{
+    const struct ovsdb_table_schema *ts = table->schema;
+    size_t i;
+
+    for (i = 0; i < ts->n_ordered_indexes; i++) {
+        if (ts->ordered_indexes[i] == column) {
+            return i;
+        }
+    }
+    return SIZE_MAX;
+}
+
+/* Results of a query through an index, gathered before any of them is passed
+ * to the client's 'output_row' callback, since that may modify the table. */
+struct index_query {
+    const struct ovsdb_condition *cnd;
+    struct ovsdb_row_set results;
+};
+
+static void
+index_query_init(struct index_query *iq, const struct ovsdb_condition *cnd)
+{
+    iq->cnd = cnd;
+    ovsdb_row_set_init(&iq->results);
+}
+
+/* Adds committed 'row', which was found in an index, to 'iq' if it matches.
+ *
+ * Indexes only contain committed rows.  Those that the transaction in
+ * progress has deleted or modified must be skipped here, because
+ * index_query_finish() checks the ones that it has inserted or modified
+ * separately. */
+static void
+index_query_add_committed_row(struct index_query *iq,
+                              const struct ovsdb_row *row)
+{
+    if (!row->txn_row && ovsdb_condition_evaluate(row, iq->cnd)) {
+        ovsdb_row_set_add_row(&iq->results, row);
+    }
+}
+
+static void
+index_query_add_new_row(const struct ovsdb_row *row, void *iq_)
+{
+    struct index_query *iq = iq_;
+
+    if (ovsdb_condition_evaluate(row, iq->cnd)) {
+        ovsdb_row_set_add_row(&iq->results, row);
+    }
+}
+
+static void
+index_query_finish(struct ovsdb_table *table, struct index_query *iq,
+                   bool (*output_row)(const struct ovsdb_row *, void *aux),
+                   void *aux)
+{
+    size_t i;
+
+    ovsdb_txn_table_for_each_new_row(table, index_query_add_new_row, iq);
+    for (i = 0; i < iq->results.n_rows; i++) {
+        if (!output_row(iq->results.rows[i], aux)) {
+            break;
+        }
+    }
+    ovsdb_row_set_destroy(&iq->results);
+}
+
+/* Queries 'table' for rows matching 'cnd' through hash index number 'idx', in
+ * which matching rows have hash value 'hash'. */
+static void
+ovsdb_query_index(struct ovsdb_table *table, const struct ovsdb_condition *cnd,
+                  size_t idx, uint32_t hash,
+                  bool (*output_row)(const struct ovsdb_row *, void *aux),
+                  void *aux)
+{
+    struct index_query iq;
+    struct hmap_node *node;
+
+    index_query_init(&iq, cnd);
+    for (node = hmap_first_with_hash(&table->indexes[idx], hash); node;
+         node = hmap_next_with_hash(node)) {
+        index_query_add_committed_row(
+            &iq, ovsdb_row_from_index_node(node, table, idx));
+    }
+    index_query_finish(table, &iq, output_row, aux);
+}
+
+/* Adds to 'iq' the committed rows in ordered index number 'idx' in 'table'
+ * that match 'iq''s condition and whose indexed value is between 'min' and
+ * 'max' (either of which may be NULL for no bound), in index order. */
+static void
+index_query_add_ordered_range(struct index_query *iq,
+                              const struct ovsdb_table *table, size_t idx,
+                              const union ovsdb_atom *min,
+                              const union ovsdb_atom *max)
+{
+    const struct ovsdb_column *column = table->schema->ordered_indexes[idx];
+    struct skiplist *sl = table->ordered_indexes[idx];
+    struct skiplist_node *node;
+
+    for (node = (min
+                 ? skiplist_lower_bound(sl, min,
+                                        ovsdb_ordered_index_compare_key)
+                 : skiplist_first(sl));
+         node; node = skiplist_next(node)) {
+        const struct ovsdb_row *row = skiplist_node_data(node);
+
+        if (max && ovsdb_ordered_index_compare_key(row, max, column) > 0) {
+            break;
+        }
+        index_query_add_committed_row(iq, row);
+    }
+}
+
+/* Queries 'table' for rows matching 'cnd' through ordered index number 'idx',
+ * visiting only the rows whose indexed value is between 'min' and 'max'
+ * (either of which may be NULL for no bound). */
+static void
+ovsdb_query_ordered_index(
+    struct ovsdb_table *table, const struct ovsdb_condition *cnd, size_t idx,
+    const union ovsdb_atom *min, const union ovsdb_atom *max,
+    bool (*output_row)(const struct ovsdb_row *, void *aux), void *aux)
+{
+    struct index_query iq;
+
+    index_query_init(&iq, cnd);
+    index_query_add_ordered_range(&iq, table, idx, min, max);
+    index_query_finish(table, &iq, output_row, aux);
+}
 
 void
 ovsdb_query(struct ovsdb_table *table, const struct ovsdb_condition *cnd,
@@ -38,12 +286,29 @@ ovsdb_query(struct ovsdb_table *table, const struct ovsdb_condition *cnd,
             output_row(row, aux);
         }
     } else {
-        /* Linear scan. */
-        const struct ovsdb_row *row, *next;
+        const union ovsdb_atom *min, *max;
+        uint32_t hash;
+        size_t idx;
 
-        HMAP_FOR_EACH_SAFE (row, next, hmap_node, &table->rows) {
-            if (ovsdb_condition_evaluate(row, cnd) && !output_row(row, aux)) {
-                break;
+        idx = choose_index(table, cnd, &hash);
+        if (idx != SIZE_MAX) {
+            ovsdb_query_index(table, cnd, idx, hash, output_row, aux);
+            return;
+        }
+
+        idx = choose_ordered_index(table, cnd, &min, &max);
+        if (idx != SIZE_MAX) {
+            ovsdb_query_ordered_index(table, cnd, idx, min, max,
+                                      output_row, aux);
+        } else {
+            /* Linear scan. */
+            const struct ovsdb_row *row, *next;
+
+            HMAP_FOR_EACH_SAFE (row, next, hmap_node, &table->rows) {
+                if (ovsdb_condition_evaluate(row, cnd)
+                    && !output_row(row, aux)) {
+                    break;
+                }
             }
         }
     }
@@ -95,3 +360,80 @@ ovsdb_query_distinct(struct ovsdb_table *table,
         ovsdb_row_hash_destroy(&hash, false);
     }
 }
+
+/* Like ovsdb_query_distinct(), but stores the rows in 'results' sorted on the
+ * columns in 'sort' (as by ovsdb_row_set_sort()).
+ *
+ * If 'sort' is a single column with an ordered index, and 'condition' cannot
+ * be answered more cheaply through another index, the rows are read from that
+ * index in order, taking O(log n + k) time for a range query on the column
+ * that returns k rows, instead of being sorted afterward. */
+void
+ovsdb_query_distinct_sorted(struct ovsdb_table *table,
+                            const struct ovsdb_condition *condition,
+                            const struct ovsdb_column_set *columns,
+                            const struct ovsdb_column_set *sort,
+                            struct ovsdb_row_set *results)
+{
+    const union ovsdb_atom *min, *max;
+    struct index_query iq, new_iq;
+    struct ovsdb_row_hash hash;
+    uint32_t index_hash;
+    bool distinct;
+    size_t i, j;
+    size_t idx;
+
+    idx = (sort->n_columns == 1
+           ? find_ordered_index(table, sort->columns[0])
+           : SIZE_MAX);
+    if (idx == SIZE_MAX
+        || (condition->n_clauses
+            && condition->clauses[0].column->index == OVSDB_COL_UUID
+            && condition->clauses[0].function == OVSDB_F_EQ)
+        || choose_index(table, condition, &index_hash) != SIZE_MAX
+        || (!find_bounds(condition, sort->columns[0], &min, &max)
+            && choose_ordered_index(table, condition,
+                                    &min, &max) != SIZE_MAX)) {
+        /* Narrowing down the rows through another index is cheaper. */
+        ovsdb_query_distinct(table, condition, columns, results);
+        ovsdb_row_set_sort(results, sort);
+        return;
+    }
+
+    /* Committed rows come out of the index in order.  Rows inserted or
+     * modified by the transaction in progress are not in the index, so sort
+     * them separately and merge them in. */
+    index_query_init(&iq, condition);
+    find_bounds(condition, sort->columns[0], &min, &max);
+    index_query_add_ordered_range(&iq, table, idx, min, max);
+
+    index_query_init(&new_iq, condition);
+    ovsdb_txn_table_for_each_new_row(table, index_query_add_new_row, &new_iq);
+    ovsdb_row_set_sort(&new_iq.results, sort);
+
+    distinct = columns && !ovsdb_column_set_contains(columns, OVSDB_COL_UUID);
+    if (distinct) {
+        ovsdb_row_hash_init(&hash, columns);
+    }
+    for (i = j = 0; i < iq.results.n_rows || j < new_iq.results.n_rows; ) {
+        const struct ovsdb_row *row;
+
+        if (j >= new_iq.results.n_rows
+            || (i < iq.results.n_rows
+                && ovsdb_row_compare_columns_3way(iq.results.rows[i],
+                                                  new_iq.results.rows[j],
+                                                  sort) <= 0)) {
+            row = iq.results.rows[i++];
+        } else {
+            row = new_iq.results.rows[j++];
+        }
+        if (!distinct || ovsdb_row_hash_insert(&hash, row)) {
+            ovsdb_row_set_add_row(results, row);
+        }
+    }
+    if (distinct) {
+        ovsdb_row_hash_destroy(&hash, false);
+    }
+    ovsdb_row_set_destroy(&new_iq.results);
+    ovsdb_row_set_destroy(&iq.results);
+}
@@ -33,5 +33,10 @@ void ovsdb_query_row_set(struct ovsdb_table *, const struct ovsdb_condition *,
 void ovsdb_query_distinct(struct ovsdb_table *, const struct ovsdb_condition *,
                           const struct ovsdb_column_set *,
                           struct ovsdb_row_set *);
+void ovsdb_query_distinct_sorted(struct ovsdb_table *,
+                                 const struct ovsdb_condition *,
+                                 const struct ovsdb_column_set *columns,
+                                 const struct ovsdb_column_set *sort,
+                                 struct ovsdb_row_set *);
 
 #endif /* ovsdb/query.h */
@@ -0,0 +1,387 @@
+/* Copyright (c) 2013 Nicira, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include "replication.h"
+
+#include <limits.h>
+
+#include "column.h"
+#include "json.h"
+#include "jsonrpc.h"
+#include "ovsdb.h"
+#include "ovsdb-error.h"
+#include "row.h"
+#include "shash.h"
+#include "table.h"
+#include "transaction.h"
+#include "uuid.h"
+#include "vlog.h"
+
+VLOG_DEFINE_THIS_MODULE(replication);
+
+static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 5);
+
+struct replication {
+    struct jsonrpc_session *session;
+    unsigned int seqno;         /* 'session' seqno when monitors were sent. */
+    struct shash dbs;           /* Contains "struct replication_db"s. */
+};
+
+/* A database replicated from the primary. */
+struct replication_db {
+    struct ovsdb *db;
+    struct json *request_id;    /* Outstanding "monitor" request, if any. */
+};
+
+static void replication_send_monitor(struct replication *,
+                                     struct replication_db *);
+static void replication_process_msg(struct replication *,
+                                    const struct jsonrpc_msg *);
+
+/* Creates and returns a new replication that follows the OVSDB server at
+ * 'remote', an active JSON-RPC connection method, e.g. "unix:file" or
+ * "tcp:ip:port".  The replication starts out with no databases. */
+struct replication *
+replication_create(const char *remote)
+{
+    struct replication *r = xmalloc(sizeof *r);
+
+    r->session = jsonrpc_session_open(remote, true);
+    r->seqno = UINT_MAX;
+    shash_init(&r->dbs);
+    return r;
+}
+
+void
+replication_destroy(struct replication *r)
+{
+    if (r) {
+        struct shash_node *node;
+
+        SHASH_FOR_EACH (node, &r->dbs) {
+            struct replication_db *rdb = node->data;
+
+            rdb->db->read_only = false;
+            json_destroy(rdb->request_id);
+            free(rdb);
+        }
+        shash_destroy(&r->dbs);
+        jsonrpc_session_close(r->session);
+        free(r);
+    }
+}
+
+/* Starts replicating 'db' from the primary's database with the same name and
+ * makes 'db' read-only to clients. */
+void
+replication_add_db(struct replication *r, struct ovsdb *db)
+{
+    struct replication_db *rdb = xmalloc(sizeof *rdb);
+
+    rdb->db = db;
+    rdb->request_id = NULL;
+    shash_add_assert(&r->dbs, db->schema->name, rdb);
+    db->read_only = true;
+
+    /* If replication_run() has not yet requested the primary's contents on
+     * the current connection, it will do so for this database too. */
+    if (jsonrpc_session_is_connected(r->session)
+        && r->seqno == jsonrpc_session_get_seqno(r->session)) {
+        replication_send_monitor(r, rdb);
+    }
+}
+
+/* Stops replicating 'db', which the caller is about to destroy. */
+void
+replication_remove_db(struct replication *r, struct ovsdb *db)
+{
+    struct shash_node *node = shash_find(&r->dbs, db->schema->name);
+
+    if (node) {
+        struct replication_db *rdb = node->data;
+        struct json *params;
+
+        params = json_array_create_1(json_string_create(db->schema->name));
+        jsonrpc_session_send(r->session,
+                             jsonrpc_create_request("monitor_cancel", params,
+                                                    NULL));
+
+        db->read_only = false;
+        json_destroy(rdb->request_id);
+        free(rdb);
+        shash_delete(&r->dbs, node);
+    }
+}
+
+void
+replication_run(struct replication *r)
+{
+    int i;
+
+    jsonrpc_session_run(r->session);
+    for (i = 0; jsonrpc_session_is_connected(r->session) && i < 50; i++) {
+        struct jsonrpc_msg *msg;
+        unsigned int seqno;
+
+        /* Request the primary's full contents each time we (re)connect. */
+        seqno = jsonrpc_session_get_seqno(r->session);
+        if (seqno != r->seqno) {
+            struct shash_node *node;
+
+            r->seqno = seqno;
+            SHASH_FOR_EACH (node, &r->dbs) {
+                replication_send_monitor(r, node->data);
+            }
+            break;
+        }
+
+        msg = jsonrpc_session_recv(r->session);
+        if (!msg) {
+            break;
+        }
+        replication_process_msg(r, msg);
+        jsonrpc_msg_destroy(msg);
+    }
+}
+
+void
+replication_wait(struct replication *r)
+{
+    jsonrpc_session_wait(r->session);
+    jsonrpc_session_recv_wait(r->session);
+}
+
+/* Sends the primary a request to monitor every column of every table in
+ * 'rdb''s database.  The database's monitor ID is its name. */
+static void
+replication_send_monitor(struct replication *r, struct replication_db *rdb)
+{
+    const struct ovsdb_schema *schema = rdb->db->schema;
+    struct json *monitor_requests;
+    struct jsonrpc_msg *request;
+    struct shash_node *node;
+
+    monitor_requests = json_object_create();
+    SHASH_FOR_EACH (node, &schema->tables) {
+        const struct ovsdb_table_schema *ts = node->data;
+        struct json *monitor_request, *columns;
+        struct shash_node *node2;
+
+        columns = json_array_create_empty();
+        SHASH_FOR_EACH (node2, &ts->columns) {
+            const struct ovsdb_column *column = node2->data;
+
+            if (column->index >= OVSDB_N_STD_COLUMNS) {
+                json_array_add(columns, json_string_create(column->name));
+            }
+        }
+
+        monitor_request = json_object_create();
+        json_object_put(monitor_request, "columns", columns);
+        json_object_put(monitor_requests, ts->name, monitor_request);
+    }
+
+    json_destroy(rdb->request_id);
+    request = jsonrpc_create_request(
+        "monitor",
+        json_array_create_3(json_string_create(schema->name),
+                            json_string_create(schema->name),
+                            monitor_requests),
+        &rdb->request_id);
+    jsonrpc_session_send(r->session, request);
+}
+
+/* Applies 'row_update', the <row-update> for the row in 'table' whose UUID
+ * is 'uuid_string', within 'txn'. */
+static struct ovsdb_error *
+replication_apply_row_update(struct ovsdb_txn *txn, struct ovsdb_table *table,
+                             const char *uuid_string,
+                             const struct json *row_update)
+{
+    const struct ovsdb_row *row;
+    const struct json *new;
+    struct uuid uuid;
+
+    if (!uuid_from_string(&uuid, uuid_string)) {
+        return ovsdb_syntax_error(row_update, NULL,
+                                  "\"%s\" is not a valid UUID", uuid_string);
+    }
+    if (row_update->type != JSON_OBJECT) {
+        return ovsdb_syntax_error(row_update, NULL,
+                                  "<row-update> must be an object");
+    }
+
+    row = ovsdb_table_get_row(table, &uuid);
+    new = shash_find_data(json_object(row_update), "new");
+    if (!new) {
+        if (row) {
+            ovsdb_txn_row_delete(txn, row);
+        }
+        return NULL;
+    } else if (!row) {
+        struct ovsdb_row *new_row = ovsdb_row_create(table);
+        struct ovsdb_error *error;
+
+        *ovsdb_row_get_uuid_rw(new_row) = uuid;
+        error = ovsdb_row_from_json(new_row, new, NULL, NULL);
+        if (error) {
+            ovsdb_row_destroy(new_row);
+            return error;
+        }
+        ovsdb_txn_row_insert(txn, new_row);
+        return NULL;
+    } else {
+        return ovsdb_row_from_json(ovsdb_txn_row_modify(txn, row), new,
+                                   NULL, NULL);
+    }
+}
+
+/* Applies 'table_updates', the <table-updates> from an "update" notification
+ * or, if 'initial' is true, from the reply to a "monitor" request, to 'db' in
+ * a single transaction.  The contents of a reply replace everything already
+ * in 'db'. */
+static struct ovsdb_error *
+replication_apply_updates(struct ovsdb *db, const struct json *table_updates,
+                          bool initial)
+{
+    struct ovsdb_error *error;
+    struct shash_node *node;
+    struct ovsdb_txn *txn;
+
+    if (table_updates->type != JSON_OBJECT) {
+        return ovsdb_syntax_error(table_updates, NULL,
+                                  "<table-updates> must be an object");
+    }
+
+    txn = ovsdb_txn_create(db);
+    if (initial) {
+        /* Delete the rows that the primary does not have. */
+        SHASH_FOR_EACH (node, &db->tables) {
+            const struct json *table_update;
+            struct ovsdb_table *table = node->data;
+            struct ovsdb_row *row, *next;
+
+            table_update = shash_find_data(json_object(table_updates),
+                                           node->name);
+            HMAP_FOR_EACH_SAFE (row, next, hmap_node, &table->rows) {
+                char uuid[UUID_LEN + 1];
+
+                snprintf(uuid, sizeof uuid,
+                         UUID_FMT, UUID_ARGS(ovsdb_row_get_uuid(row)));
+                if (!table_update
+                    || table_update->type != JSON_OBJECT
+                    || !shash_find(json_object(table_update), uuid)) {
+                    ovsdb_txn_row_delete(txn, row);
+                }
+            }
+        }
+    }
+
+    SHASH_FOR_EACH (node, json_object(table_updates)) {
+        const struct json *table_update = node->data;
+        struct ovsdb_table *table;
+        struct shash_node *node2;
+
+        table = ovsdb_get_table(db, node->name);
+        if (!table) {
+            error = ovsdb_syntax_error(table_updates, NULL,
+                                       "unknown table %s", node->name);
+            goto error;
+        }
+        if (table_update->type != JSON_OBJECT) {
+            error = ovsdb_syntax_error(table_update, NULL,
+                                       "<table-update> must be an object");
+            goto error;
+        }
+
+        SHASH_FOR_EACH (node2, json_object(table_update)) {
+            error = replication_apply_row_update(txn, table, node2->name,
+                                                 node2->data);
+            if (error) {
+                goto error;
+            }
+        }
+    }
+
+    return ovsdb_txn_commit(txn, false);
+
+error:
+    ovsdb_txn_abort(txn);
+    return error;
+}
+
+static void
+replication_apply(struct replication *r, struct replication_db *rdb,
+                  const struct json *table_updates, bool initial)
+{
+    struct ovsdb_error *error;
+
+    error = replication_apply_updates(rdb->db, table_updates, initial);
+    if (error) {
+        char *s = ovsdb_error_to_string(error);
+
+        /* Start over from a fresh copy of the primary's contents. */
+        VLOG_WARN_RL(&rl, "%s: failed to replicate database %s (%s), "
+                     "reconnecting", jsonrpc_session_get_name(r->session),
+                     rdb->db->schema->name, s);
+        free(s);
+        ovsdb_error_destroy(error);
+        jsonrpc_session_force_reconnect(r->session);
+    }
+}
+
+static void
+replication_process_msg(struct replication *r, const struct jsonrpc_msg *msg)
+{
+    if (msg->type == JSONRPC_NOTIFY
+        && !strcmp(msg->method, "update")
+        && msg->params->type == JSON_ARRAY
+        && msg->params->u.array.n == 2
+        && msg->params->u.array.elems[0]->type == JSON_STRING) {
+        const char *db_name = json_string(msg->params->u.array.elems[0]);
+        struct replication_db *rdb = shash_find_data(&r->dbs, db_name);
+
+        /* Ignore updates that precede the reply to our latest request, since
+         * the reply will supersede them. */
+        if (rdb && !rdb->request_id) {
+            replication_apply(r, rdb, msg->params->u.array.elems[1], false);
+        }
+    } else if (msg->type == JSONRPC_REPLY || msg->type == JSONRPC_ERROR) {
+        struct shash_node *node;
+
+        SHASH_FOR_EACH (node, &r->dbs) {
+            struct replication_db *rdb = node->data;
+
+            if (rdb->request_id && json_equal(rdb->request_id, msg->id)) {
+                json_destroy(rdb->request_id);
+                rdb->request_id = NULL;
+
+                if (msg->type == JSONRPC_ERROR) {
+                    char *s = json_to_string(msg->error, 0);
+                    VLOG_WARN_RL(&rl, "%s: primary refused to replicate "
+                                 "database %s (%s)",
+                                 jsonrpc_session_get_name(r->session),
+                                 rdb->db->schema->name, s);
+                    free(s);
+                } else {
+                    replication_apply(r, rdb, msg->result, true);
+                }
+                break;
+            }
+        }
+    }
+}
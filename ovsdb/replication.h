@@ -0,0 +1,42 @@
+/* Copyright (c) 2013 Nicira, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OVSDB_REPLICATION_H
+#define OVSDB_REPLICATION_H 1
+
+struct ovsdb;
+
+/* Read-only replication of databases from another OVSDB server.
+ *
+ * A replication connects to a remote OVSDB server (the "primary") and
+ * monitors every column of every table of each of its databases that has the
+ * same name as a local database.  The local database is first made to match
+ * the primary's contents and then kept up-to-date with each change the
+ * primary reports.  While a database is replicated, its clients may read and
+ * monitor it, but transactions that would modify it fail (see
+ * ovsdb_execute()).
+ *
+ * The local database must have the same schema as the primary's. */
+
+struct replication *replication_create(const char *remote);
+void replication_destroy(struct replication *);
+
+void replication_add_db(struct replication *, struct ovsdb *);
+void replication_remove_db(struct replication *, struct ovsdb *);
+
+void replication_run(struct replication *);
+void replication_wait(struct replication *);
+
+#endif /* ovsdb/replication.h */
@@ -30,7 +30,7 @@ static struct ovsdb_row *
 allocate_row(const struct ovsdb_table *table)
 {
     size_t n_fields = shash_count(&table->schema->columns);
-    size_t n_indexes = table->schema->n_indexes;
+    size_t n_indexes = ovsdb_table_schema_n_all_indexes(table->schema);
     size_t row_size = (offsetof(struct ovsdb_row, fields)
                        + sizeof(struct ovsdb_datum) * n_fields
                        + sizeof(struct hmap_node) * n_indexes);
@@ -43,6 +43,33 @@ allocate_row(const struct ovsdb_table *table)
     return row;
 }
 
+/* Returns the offset in bytes from the start of an ovsdb_row for 'table' to
+ * the hmap_node for the index numbered 'i'. */
+static size_t
+ovsdb_row_index_offset__(const struct ovsdb_table *table, size_t i)
+{
+    size_t n_fields = shash_count(&table->schema->columns);
+    return (offsetof(struct ovsdb_row, fields)
+            + n_fields * sizeof(struct ovsdb_datum)
+            + i * sizeof(struct hmap_node));
+}
+
+/* Returns the hmap_node in 'row' for the index numbered 'i'. */
+struct hmap_node *
+ovsdb_row_get_index_node(struct ovsdb_row *row, size_t i)
+{
+    return (void *) ((char *) row + ovsdb_row_index_offset__(row->table, i));
+}
+
+/* Returns the ovsdb_row given 'index_node', which is a pointer to that row's
+ * hmap_node for the index numbered 'i' within 'table'. */
+struct ovsdb_row *
+ovsdb_row_from_index_node(struct hmap_node *index_node,
+                          const struct ovsdb_table *table, size_t i)
+{
+    return (void *) ((char *) index_node - ovsdb_row_index_offset__(table, i));
+}
+
 struct ovsdb_row *
 ovsdb_row_create(const struct ovsdb_table *table)
 {
@@ -96,6 +123,13 @@ ovsdb_row_destroy(struct ovsdb_row *row)
             free(weak);
         }
 
+        if (row->table->n_pins) {
+            /* Another thread may still be reading 'row'.  With its weak
+             * references gone, ovsdb_table_unpin() can finish the job. */
+            ovsdb_table_add_dead_row(row->table, row);
+            return;
+        }
+
         SHASH_FOR_EACH (node, &table->schema->columns) {
             const struct ovsdb_column *column = node->data;
             ovsdb_datum_destroy(&row->fields[column->index], &column->type);
@@ -24,6 +24,7 @@
 #include "ovsdb-data.h"
 
 struct ovsdb_column_set;
+struct ovsdb_table;
 
 /* A weak reference.
  *
@@ -62,11 +63,17 @@ struct ovsdb_row {
      * elements). */
     struct ovsdb_datum fields[];
 
-    /* Followed by table->schema->n_indexes "struct hmap_node"s.  In rows that
-     * have have been committed as part of the database, the hmap_node with
-     * index 'i' is contained in hmap table->indexes[i].  */
+    /* Followed by ovsdb_table_schema_n_all_indexes(table->schema) "struct
+     * hmap_node"s.  In rows that have have been committed as part of the
+     * database, the hmap_node with index 'i' is contained in hmap
+     * table->indexes[i].  */
 };
 
+struct hmap_node *ovsdb_row_get_index_node(struct ovsdb_row *, size_t i);
+struct ovsdb_row *ovsdb_row_from_index_node(struct hmap_node *,
+                                            const struct ovsdb_table *,
+                                            size_t i);
+
 struct ovsdb_row *ovsdb_row_create(const struct ovsdb_table *);
 struct ovsdb_row *ovsdb_row_clone(const struct ovsdb_row *);
 void ovsdb_row_destroy(struct ovsdb_row *);
@@ -1,4 +1,4 @@
-/* Copyright (c) 2009, 2010, 2011, 2012 Nicira, Inc.
+/* Copyright (c) 2009, 2010, 2011, 2012, 2013 Nicira, Inc.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -25,6 +25,7 @@
 #include "ovsdb-parser.h"
 #include "ovsdb-types.h"
 #include "row.h"
+#include "skiplist.h"
 
 static void
 add_column(struct ovsdb_table_schema *ts, struct ovsdb_column *column)
@@ -57,8 +58,12 @@ ovsdb_table_schema_create(const char *name, bool mutable,
     ovs_assert(version->index == OVSDB_COL_VERSION);
 
     ts->n_indexes = 0;
+    ts->n_secondary_indexes = 0;
     ts->indexes = NULL;
 
+    ts->ordered_indexes = NULL;
+    ts->n_ordered_indexes = 0;
+
     return ts;
 }
 
@@ -83,8 +88,10 @@ ovsdb_table_schema_clone(const struct ovsdb_table_schema *old)
     }
 
     new->n_indexes = old->n_indexes;
-    new->indexes = xmalloc(new->n_indexes * sizeof *new->indexes);
-    for (i = 0; i < new->n_indexes; i++) {
+    new->n_secondary_indexes = old->n_secondary_indexes;
+    new->indexes = xmalloc(ovsdb_table_schema_n_all_indexes(new)
+                           * sizeof *new->indexes);
+    for (i = 0; i < ovsdb_table_schema_n_all_indexes(new); i++) {
         const struct ovsdb_column_set *old_index = &old->indexes[i];
         struct ovsdb_column_set *new_index = &new->indexes[i];
         size_t j;
@@ -99,6 +106,14 @@ ovsdb_table_schema_clone(const struct ovsdb_table_schema *old)
         }
     }
 
+    new->n_ordered_indexes = old->n_ordered_indexes;
+    new->ordered_indexes = xmalloc(new->n_ordered_indexes
+                                   * sizeof *new->ordered_indexes);
+    for (i = 0; i < new->n_ordered_indexes; i++) {
+        new->ordered_indexes[i] = ovsdb_table_schema_get_column(
+            new, old->ordered_indexes[i]->name);
+    }
+
     return new;
 }
 
@@ -108,10 +123,11 @@ ovsdb_table_schema_destroy(struct ovsdb_table_schema *ts)
     struct shash_node *node;
     size_t i;
 
-    for (i = 0; i < ts->n_indexes; i++) {
+    for (i = 0; i < ovsdb_table_schema_n_all_indexes(ts); i++) {
         ovsdb_column_set_destroy(&ts->indexes[i]);
     }
     free(ts->indexes);
+    free(ts->ordered_indexes);
 
     SHASH_FOR_EACH (node, &ts->columns) {
         ovsdb_column_destroy(node->data);
@@ -121,12 +137,104 @@ ovsdb_table_schema_destroy(struct ovsdb_table_schema *ts)
     free(ts);
 }
 
+/* Parses 'indexes', the JSON array of <column-set>s in the "indexes" (if
+ * 'unique' is true) or "secondaryIndexes" (otherwise) member of 'json', and
+ * appends them to the indexes in 'ts'. */
+static struct ovsdb_error *
+parse_indexes(const struct json *json, const struct json *indexes, bool unique,
+              struct ovsdb_table_schema *ts)
+{
+    size_t i;
+
+    for (i = 0; i < indexes->u.array.n; i++) {
+        struct ovsdb_column_set *index;
+        struct ovsdb_error *error;
+        size_t j;
+
+        index = &ts->indexes[ovsdb_table_schema_n_all_indexes(ts)];
+        error = ovsdb_column_set_from_json(indexes->u.array.elems[i],
+                                           ts, index);
+        if (error) {
+            return error;
+        }
+        if (index->n_columns == 0) {
+            ovsdb_column_set_destroy(index);
+            return ovsdb_syntax_error(json, NULL, "index must have "
+                                      "at least one column");
+        }
+        if (unique) {
+            ts->n_indexes++;
+        } else {
+            ts->n_secondary_indexes++;
+        }
+
+        for (j = 0; unique && j < index->n_columns; j++) {
+            const struct ovsdb_column *column = index->columns[j];
+
+            if (!column->persistent) {
+                return ovsdb_syntax_error(json, NULL, "ephemeral columns "
+                                          "(such as %s) may not be "
+                                          "indexed", column->name);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/* Parses 'ordered_indexes', the JSON array of column names in the
+ * "orderedIndexes" member of 'json', into 'ts'. */
+static struct ovsdb_error *
+parse_ordered_indexes(const struct json *json,
+                      const struct json *ordered_indexes,
+                      struct ovsdb_table_schema *ts)
+{
+    const struct json_array *array = json_array(ordered_indexes);
+    size_t i;
+
+    ts->ordered_indexes = xmalloc(array->n * sizeof *ts->ordered_indexes);
+    for (i = 0; i < array->n; i++) {
+        const struct ovsdb_column *column;
+        size_t j;
+
+        if (array->elems[i]->type != JSON_STRING) {
+            return ovsdb_syntax_error(json, NULL, "array of distinct column "
+                                      "names expected");
+        }
+
+        column = ovsdb_table_schema_get_column(ts,
+                                               json_string(array->elems[i]));
+        if (!column) {
+            return ovsdb_syntax_error(json, NULL, "%s is not a valid column "
+                                      "name", json_string(array->elems[i]));
+        }
+        if (!ovsdb_type_is_scalar(&column->type)
+            || (column->type.key.type != OVSDB_TYPE_INTEGER
+                && column->type.key.type != OVSDB_TYPE_REAL)) {
+            return ovsdb_syntax_error(json, NULL, "ordered index column %s "
+                                      "must be a scalar integer or real",
+                                      column->name);
+        }
+        for (j = 0; j < ts->n_ordered_indexes; j++) {
+            if (ts->ordered_indexes[j] == column) {
+                return ovsdb_syntax_error(json, NULL, "array of distinct "
+                                          "column names expected");
+            }
+        }
+
+        ts->ordered_indexes[ts->n_ordered_indexes++] = column;
+    }
+
+    return NULL;
+}
+
 struct ovsdb_error *
 ovsdb_table_schema_from_json(const struct json *json, const char *name,
                              struct ovsdb_table_schema **tsp)
 {
     struct ovsdb_table_schema *ts;
     const struct json *columns, *mutable, *max_rows, *is_root, *indexes;
+    const struct json *secondary_indexes, *ordered_indexes;
     struct shash_node *node;
     struct ovsdb_parser parser;
     struct ovsdb_error *error;
@@ -142,6 +250,10 @@ ovsdb_table_schema_from_json(const struct json *json, const char *name,
                                    OP_INTEGER | OP_OPTIONAL);
     is_root = ovsdb_parser_member(&parser, "isRoot", OP_BOOLEAN | OP_OPTIONAL);
     indexes = ovsdb_parser_member(&parser, "indexes", OP_ARRAY | OP_OPTIONAL);
+    secondary_indexes = ovsdb_parser_member(&parser, "secondaryIndexes",
+                                            OP_ARRAY | OP_OPTIONAL);
+    ordered_indexes = ovsdb_parser_member(&parser, "orderedIndexes",
+                                          OP_ARRAY | OP_OPTIONAL);
     error = ovsdb_parser_finish(&parser);
     if (error) {
         return error;
@@ -184,36 +296,26 @@ ovsdb_table_schema_from_json(const struct json *json, const char *name,
         add_column(ts, column);
     }
 
-    if (indexes) {
-        size_t i;
+    if (indexes || secondary_indexes) {
+        size_t n = ((indexes ? indexes->u.array.n : 0)
+                    + (secondary_indexes ? secondary_indexes->u.array.n : 0));
 
-        ts->indexes = xmalloc(indexes->u.array.n * sizeof *ts->indexes);
-        for (i = 0; i < indexes->u.array.n; i++) {
-            struct ovsdb_column_set *index = &ts->indexes[i];
-            size_t j;
+        ts->indexes = xmalloc(n * sizeof *ts->indexes);
 
-            error = ovsdb_column_set_from_json(indexes->u.array.elems[i],
-                                               ts, index);
-            if (error) {
-                goto error;
-            }
-            if (index->n_columns == 0) {
-                error = ovsdb_syntax_error(json, NULL, "index must have "
-                                           "at least one column");
-                goto error;
-            }
-            ts->n_indexes++;
-
-            for (j = 0; j < index->n_columns; j++) {
-                const struct ovsdb_column *column = index->columns[j];
+        /* Unique indexes must precede secondary indexes. */
+        error = (indexes ? parse_indexes(json, indexes, true, ts) : NULL);
+        if (!error && secondary_indexes) {
+            error = parse_indexes(json, secondary_indexes, false, ts);
+        }
+        if (error) {
+            goto error;
+        }
+    }
 
-                if (!column->persistent) {
-                    error = ovsdb_syntax_error(json, NULL, "ephemeral columns "
-                                               "(such as %s) may not be "
-                                               "indexed", column->name);
-                    goto error;
-                }
-            }
+    if (ordered_indexes) {
+        error = parse_ordered_indexes(json, ordered_indexes, ts);
+        if (error) {
+            goto error;
         }
     }
 
@@ -276,6 +378,33 @@ ovsdb_table_schema_to_json(const struct ovsdb_table_schema *ts,
                         json_array_create(indexes, ts->n_indexes));
     }
 
+    if (ts->n_secondary_indexes) {
+        struct json **indexes;
+        size_t i;
+
+        indexes = xmalloc(ts->n_secondary_indexes * sizeof *indexes);
+        for (i = 0; i < ts->n_secondary_indexes; i++) {
+            const struct ovsdb_column_set *index;
+
+            index = &ts->indexes[ts->n_indexes + i];
+            indexes[i] = ovsdb_column_set_to_json(index);
+        }
+        json_object_put(json, "secondaryIndexes",
+                        json_array_create(indexes, ts->n_secondary_indexes));
+    }
+
+    if (ts->n_ordered_indexes) {
+        struct json *ordered_indexes = json_array_create_empty();
+        size_t i;
+
+        for (i = 0; i < ts->n_ordered_indexes; i++) {
+            const struct ovsdb_column *column = ts->ordered_indexes[i];
+
+            json_array_add(ordered_indexes, json_string_create(column->name));
+        }
+        json_object_put(json, "orderedIndexes", ordered_indexes);
+    }
+
     return json;
 }
 
@@ -286,6 +415,38 @@ ovsdb_table_schema_get_column(const struct ovsdb_table_schema *ts,
     return shash_find_data(&ts->columns, name);
 }
 
+/* Compares rows 'a_' and 'b_' by the value of 'column_', then by UUID. */
+static int
+compare_rows_by_column(const void *a_, const void *b_, const void *column_)
+{
+    const struct ovsdb_row *a = a_;
+    const struct ovsdb_row *b = b_;
+    const struct ovsdb_column *column = column_;
+    int cmp;
+
+    cmp = ovsdb_atom_compare_3way(&a->fields[column->index].keys[0],
+                                  &b->fields[column->index].keys[0],
+                                  column->type.key.type);
+    return cmp ? cmp : uuid_compare_3way(ovsdb_row_get_uuid(a),
+                                         ovsdb_row_get_uuid(b));
+}
+
+/* Compares the value of 'column_' in 'row_' against 'atom_' ("const union
+ * ovsdb_atom *").  Suitable for passing to skiplist_lower_bound() on one of a
+ * table's 'ordered_indexes', to find the first row whose value is not less
+ * than 'atom_'. */
+int
+ovsdb_ordered_index_compare_key(const void *row_, const void *atom_,
+                                const void *column_)
+{
+    const struct ovsdb_row *row = row_;
+    const union ovsdb_atom *atom = atom_;
+    const struct ovsdb_column *column = column_;
+
+    return ovsdb_atom_compare_3way(&row->fields[column->index].keys[0], atom,
+                                   column->type.key.type);
+}
+
 struct ovsdb_table *
 ovsdb_table_create(struct ovsdb_table_schema *ts)
 {
@@ -295,11 +456,21 @@ ovsdb_table_create(struct ovsdb_table_schema *ts)
     table = xmalloc(sizeof *table);
     table->schema = ts;
     table->txn_table = NULL;
-    table->indexes = xmalloc(ts->n_indexes * sizeof *table->indexes);
-    for (i = 0; i < ts->n_indexes; i++) {
+    table->indexes = xmalloc(ovsdb_table_schema_n_all_indexes(ts)
+                             * sizeof *table->indexes);
+    for (i = 0; i < ovsdb_table_schema_n_all_indexes(ts); i++) {
         hmap_init(&table->indexes[i]);
     }
+    table->ordered_indexes = xmalloc(ts->n_ordered_indexes
+                                     * sizeof *table->ordered_indexes);
+    for (i = 0; i < ts->n_ordered_indexes; i++) {
+        table->ordered_indexes[i] = skiplist_create(compare_rows_by_column,
+                                                    ts->ordered_indexes[i]);
+    }
     hmap_init(&table->rows);
+    table->n_pins = 0;
+    table->dead_rows = NULL;
+    table->n_dead_rows = table->allocated_dead_rows = 0;
 
     return table;
 }
@@ -311,16 +482,23 @@ ovsdb_table_destroy(struct ovsdb_table *table)
         struct ovsdb_row *row, *next;
         size_t i;
 
+        ovs_assert(!table->n_pins);
         HMAP_FOR_EACH_SAFE (row, next, hmap_node, &table->rows) {
             ovsdb_row_destroy(row);
         }
         hmap_destroy(&table->rows);
 
-        for (i = 0; i < table->schema->n_indexes; i++) {
+        for (i = 0; i < ovsdb_table_schema_n_all_indexes(table->schema);
+             i++) {
             hmap_destroy(&table->indexes[i]);
         }
         free(table->indexes);
 
+        for (i = 0; i < table->schema->n_ordered_indexes; i++) {
+            skiplist_destroy(table->ordered_indexes[i]);
+        }
+        free(table->ordered_indexes);
+
         ovsdb_table_schema_destroy(table->schema);
         free(table);
     }
@@ -339,3 +517,77 @@ ovsdb_table_get_row(const struct ovsdb_table *table, const struct uuid *uuid)
 
     return NULL;
 }
+
+/* Adds committed row 'row' to each of the ordered indexes in 'table'. */
+void
+ovsdb_table_ordered_index_insert(struct ovsdb_table *table,
+                                 const struct ovsdb_row *row)
+{
+    size_t i;
+
+    for (i = 0; i < table->schema->n_ordered_indexes; i++) {
+        skiplist_insert(table->ordered_indexes[i], row);
+    }
+}
+
+/* Removes committed row 'row' from each of the ordered indexes in 'table'. */
+void
+ovsdb_table_ordered_index_remove(struct ovsdb_table *table,
+                                 const struct ovsdb_row *row)
+{
+    size_t i;
+
+    for (i = 0; i < table->schema->n_ordered_indexes; i++) {
+        ovs_assert(skiplist_delete(table->ordered_indexes[i], row));
+    }
+}
+
+/* Pins 'table', so that every row committed to it at the time of the call
+ * stays allocated, with unchanged columns, until a matching call to
+ * ovsdb_table_unpin(), even if transactions delete or modify it in the
+ * meantime.  Transactions never change the columns of a committed row in
+ * place, so this only has to delay freeing the rows that they replace or
+ * delete.  This allows another thread to read the columns of a consistent
+ * snapshot of the table's rows while this thread keeps committing
+ * transactions to it.  (Their hmap nodes and weak references do change,
+ * so that thread must not use them.)
+ *
+ * Pinning takes constant time.  Only the thread that owns 'table' may pin,
+ * unpin, or otherwise change it. */
+void
+ovsdb_table_pin(struct ovsdb_table *table)
+{
+    table->n_pins++;
+}
+
+/* Releases a pin on 'table' taken by ovsdb_table_pin().  When the last pin is
+ * released, frees the rows that were removed from 'table' while it was
+ * pinned. */
+void
+ovsdb_table_unpin(struct ovsdb_table *table)
+{
+    ovs_assert(table->n_pins > 0);
+    if (!--table->n_pins) {
+        size_t i;
+
+        for (i = 0; i < table->n_dead_rows; i++) {
+            ovsdb_row_destroy(table->dead_rows[i]);
+        }
+        free(table->dead_rows);
+        table->dead_rows = NULL;
+        table->n_dead_rows = table->allocated_dead_rows = 0;
+    }
+}
+
+/* Sets aside 'row', which ovsdb_row_destroy() has unlinked from the other rows
+ * of pinned 'table', to be freed by ovsdb_table_unpin(). */
+void
+ovsdb_table_add_dead_row(struct ovsdb_table *table, struct ovsdb_row *row)
+{
+    if (table->n_dead_rows >= table->allocated_dead_rows) {
+        table->dead_rows = x2nrealloc(table->dead_rows,
+                                      &table->allocated_dead_rows,
+                                      sizeof *table->dead_rows);
+    }
+    table->dead_rows[table->n_dead_rows++] = row;
+}
@@ -1,4 +1,4 @@
-/* Copyright (c) 2009, 2010, 2011 Nicira, Inc.
+/* Copyright (c) 2009, 2010, 2011, 2013 Nicira, Inc.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -22,6 +22,8 @@
 #include "shash.h"
 
 struct json;
+struct ovsdb_row;
+struct skiplist;
 struct uuid;
 
 /* Schema for a database table. */
@@ -31,10 +33,29 @@ struct ovsdb_table_schema {
     struct shash columns;       /* Contains "struct ovsdb_column *"s. */
     unsigned int max_rows;      /* Maximum number of rows. */
     bool is_root;               /* Part of garbage collection root set? */
+
+    /* Indexes.  The first 'n_indexes' elements of 'indexes' are the unique
+     * indexes declared in "indexes", the following 'n_secondary_indexes' are
+     * the non-unique indexes declared in "secondaryIndexes".  Both kinds are
+     * maintained the same way and may speed up queries, but only the former
+     * are checked for uniqueness at commit time. */
     struct ovsdb_column_set *indexes;
     size_t n_indexes;
+    size_t n_secondary_indexes;
+
+    /* Ordered indexes, declared in "orderedIndexes", each on a single scalar
+     * integer or real column.  They allow range queries. */
+    const struct ovsdb_column **ordered_indexes;
+    size_t n_ordered_indexes;
 };
 
+/* Returns the total number of indexes, unique and secondary, in 'ts'. */
+static inline size_t
+ovsdb_table_schema_n_all_indexes(const struct ovsdb_table_schema *ts)
+{
+    return ts->n_indexes + ts->n_secondary_indexes;
+}
+
 struct ovsdb_table_schema *ovsdb_table_schema_create(
     const char *name, bool mutable, unsigned int max_rows, bool is_root);
 struct ovsdb_table_schema *ovsdb_table_schema_clone(
@@ -58,10 +79,24 @@ struct ovsdb_table {
     struct ovsdb_txn_table *txn_table; /* Only if table is in a transaction. */
     struct hmap rows;           /* Contains "struct ovsdb_row"s. */
 
-    /* An array of schema->n_indexes hmaps, each of which contains "struct
-     * ovsdb_row"s.  Each of the hmap_nodes in indexes[i] are at index 'i' at
-     * the end of struct ovsdb_row, following the 'fields' member. */
+    /* An array of ovsdb_table_schema_n_all_indexes(schema) hmaps, each of
+     * which contains "struct ovsdb_row"s.  Each of the hmap_nodes in
+     * indexes[i] are at index 'i' at the end of struct ovsdb_row, following
+     * the 'fields' member.  Only committed rows are indexed. */
     struct hmap *indexes;
+
+    /* An array of schema->n_ordered_indexes skiplists, each of which contains
+     * the committed "struct ovsdb_row"s ordered by the value of the column in
+     * schema->ordered_indexes[i], then by UUID. */
+    struct skiplist **ordered_indexes;
+
+    /* While 'n_pins' is nonzero, ovsdb_row_destroy() does not free this
+     * table's rows but adds them to 'dead_rows', so that another thread may
+     * keep reading rows that were committed when the table was pinned.  See
+     * ovsdb_table_pin(). */
+    unsigned int n_pins;
+    struct ovsdb_row **dead_rows;
+    size_t n_dead_rows, allocated_dead_rows;
 };
 
 struct ovsdb_table *ovsdb_table_create(struct ovsdb_table_schema *);
@@ -70,4 +105,15 @@ void ovsdb_table_destroy(struct ovsdb_table *);
 const struct ovsdb_row *ovsdb_table_get_row(const struct ovsdb_table *,
                                             const struct uuid *);
 
+void ovsdb_table_ordered_index_insert(struct ovsdb_table *,
+                                      const struct ovsdb_row *);
+void ovsdb_table_ordered_index_remove(struct ovsdb_table *,
+                                      const struct ovsdb_row *);
+int ovsdb_ordered_index_compare_key(const void *row, const void *atom,
+                                    const void *column);
+
+void ovsdb_table_pin(struct ovsdb_table *);
+void ovsdb_table_unpin(struct ovsdb_table *);
+void ovsdb_table_add_dead_row(struct ovsdb_table *, struct ovsdb_row *);
+
 #endif /* ovsdb/table.h */
@@ -137,33 +137,6 @@ ovsdb_txn_row_abort(struct ovsdb_txn *txn OVS_UNUSED,
     return NULL;
 }
 
-/* Returns the offset in bytes from the start of an ovsdb_row for 'table' to
- * the hmap_node for the index numbered 'i'. */
-static size_t
-ovsdb_row_index_offset__(const struct ovsdb_table *table, size_t i)
-{
-    size_t n_fields = shash_count(&table->schema->columns);
-    return (offsetof(struct ovsdb_row, fields)
-            + n_fields * sizeof(struct ovsdb_datum)
-            + i * sizeof(struct hmap_node));
-}
-
-/* Returns the hmap_node in 'row' for the index numbered 'i'. */
-static struct hmap_node *
-ovsdb_row_get_index_node(struct ovsdb_row *row, size_t i)
-{
-    return (void *) ((char *) row + ovsdb_row_index_offset__(row->table, i));
-}
-
-/* Returns the ovsdb_row given 'index_node', which is a pointer to that row's
- * hmap_node for the index numbered 'i' within 'table'. */
-static struct ovsdb_row *
-ovsdb_row_from_index_node(struct hmap_node *index_node,
-                          const struct ovsdb_table *table, size_t i)
-{
-    return (void *) ((char *) index_node - ovsdb_row_index_offset__(table, i));
-}
-
 void
 ovsdb_txn_abort(struct ovsdb_txn *txn)
 {
@@ -404,23 +377,33 @@ static struct ovsdb_error *
 ovsdb_txn_row_commit(struct ovsdb_txn *txn OVS_UNUSED,
                      struct ovsdb_txn_row *txn_row)
 {
-    size_t n_indexes = txn_row->table->schema->n_indexes;
+    const struct ovsdb_table_schema *ts = txn_row->table->schema;
+    size_t n_all_indexes = ovsdb_table_schema_n_all_indexes(ts);
 
     if (txn_row->old) {
         size_t i;
 
-        for (i = 0; i < n_indexes; i++) {
+        for (i = 0; i < n_all_indexes; i++) {
             struct hmap_node *node = ovsdb_row_get_index_node(txn_row->old, i);
             hmap_remove(&txn_row->table->indexes[i], node);
         }
+        ovsdb_table_ordered_index_remove(txn_row->table, txn_row->old);
     }
     if (txn_row->new) {
         size_t i;
 
-        for (i = 0; i < n_indexes; i++) {
+        /* check_index_uniqueness() already hashed the unique indexes. */
+        for (i = 0; i < ts->n_indexes; i++) {
             struct hmap_node *node = ovsdb_row_get_index_node(txn_row->new, i);
             hmap_insert(&txn_row->table->indexes[i], node, node->hash);
         }
+        for (; i < n_all_indexes; i++) {
+            struct hmap_node *node = ovsdb_row_get_index_node(txn_row->new, i);
+            uint32_t hash = ovsdb_row_hash_columns(txn_row->new,
+                                                   &ts->indexes[i], 0);
+            hmap_insert(&txn_row->table->indexes[i], node, hash);
+        }
+        ovsdb_table_ordered_index_insert(txn_row->table, txn_row->new);
     }
 
     ovsdb_txn_row_prefree(txn_row);
@@ -800,6 +783,9 @@ ovsdb_txn_commit(struct ovsdb_txn *txn, bool durable)
     }
 
     /* Send the commit to each replica. */
+    if (durable) {
+        txn->db->durable_seqno++;
+    }
     LIST_FOR_EACH (replica, node, &txn->db->replicas) {
         error = (replica->class->commit)(replica, txn, durable);
         if (error) {
@@ -836,6 +822,26 @@ ovsdb_txn_for_each_change(const struct ovsdb_txn *txn,
    }
 }
 
+/* Calls 'cb' for each row that the transaction in progress, if any, has
+ * inserted into or modified within 'table'.  These are the rows in
+ * 'table->rows' that are not (yet) reflected in 'table->indexes'. */
+void
+ovsdb_txn_table_for_each_new_row(const struct ovsdb_table *table,
+                                 void (*cb)(const struct ovsdb_row *,
+                                            void *aux),
+                                 void *aux)
+{
+    if (table->txn_table) {
+        struct ovsdb_txn_row *r;
+
+        HMAP_FOR_EACH (r, hmap_node, &table->txn_table->txn_rows) {
+            if (r->new) {
+                cb(r->new, aux);
+            }
+        }
+    }
+}
+
 static struct ovsdb_txn_table *
 ovsdb_txn_create_txn_table(struct ovsdb_txn *txn, struct ovsdb_table *table)
 {
@@ -902,6 +908,11 @@ ovsdb_txn_row_modify(struct ovsdb_txn *txn, const struct ovsdb_row *ro_row_)
         struct ovsdb_table *table = ro_row->table;
         struct ovsdb_row *rw_row;
 
+        /* The copy shares its string atoms with 'ro_row', so it costs one
+         * allocation per row and per key or value array.  It is an ordinary
+         * heap row, not one carved out of a per-transaction arena, because
+         * when the transaction commits the copy becomes the table's row and
+         * outlives the transaction. */
         rw_row = ovsdb_row_clone(ro_row);
         rw_row->n_refs = ro_row->n_refs;
         uuid_generate(ovsdb_row_get_version_rw(rw_row));
@@ -22,10 +22,12 @@
 #include "json.h"
 #include "jsonrpc.h"
 #include "ovsdb.h"
+#include "ovsdb-error.h"
 #include "poll-loop.h"
 #include "server.h"
 
 static bool ovsdb_trigger_try(struct ovsdb_trigger *, long long int now);
+static bool ovsdb_trigger_try_durable(struct ovsdb_trigger *);
 static void ovsdb_trigger_complete(struct ovsdb_trigger *);
 
 void
@@ -38,6 +40,7 @@ ovsdb_trigger_init(struct ovsdb_session *session, struct ovsdb *db,
     list_push_back(&trigger->db->triggers, &trigger->node);
     trigger->request = request;
     trigger->result = NULL;
+    trigger->durable_seqno = 0;
     trigger->created = now;
     trigger->timeout_msec = LLONG_MAX;
     ovsdb_trigger_try(trigger, now);
@@ -54,7 +57,7 @@ ovsdb_trigger_destroy(struct ovsdb_trigger *trigger)
 bool
 ovsdb_trigger_is_complete(const struct ovsdb_trigger *trigger)
 {
-    return trigger->result != NULL;
+    return trigger->result && !trigger->durable_seqno;
 }
 
 struct json *
@@ -74,7 +77,9 @@ ovsdb_trigger_run(struct ovsdb *db, long long int now)
     run_triggers = db->run_triggers;
     db->run_triggers = false;
     LIST_FOR_EACH_SAFE (t, next, node, &db->triggers) {
-        if (run_triggers || now - t->created >= t->timeout_msec) {
+        if (t->result) {
+            ovsdb_trigger_try_durable(t);
+        } else if (run_triggers || now - t->created >= t->timeout_msec) {
             ovsdb_trigger_try(t, now);
         }
     }
@@ -90,7 +95,9 @@ ovsdb_trigger_wait(struct ovsdb *db, long long int now)
         struct ovsdb_trigger *t;
 
         LIST_FOR_EACH (t, node, &db->triggers) {
-            if (t->created < LLONG_MAX - t->timeout_msec) {
+            if (t->result) {
+                ovsdb_durable_wait(db, t->durable_seqno);
+            } else if (t->created < LLONG_MAX - t->timeout_msec) {
                 long long int t_deadline = t->created + t->timeout_msec;
                 if (deadline > t_deadline) {
                     deadline = t_deadline;
@@ -111,13 +118,30 @@ static bool
 ovsdb_trigger_try(struct ovsdb_trigger *t, long long int now)
 {
     t->result = ovsdb_execute(t->db, t->session,
-                              t->request, now - t->created, &t->timeout_msec);
-    if (t->result) {
-        ovsdb_trigger_complete(t);
-        return true;
-    } else {
+                              t->request, now - t->created, &t->timeout_msec,
+                              &t->durable_seqno);
+    return t->result ? ovsdb_trigger_try_durable(t) : false;
+}
+
+/* Completes 't', which has a result, if the transaction that produced the
+ * result does not need to be durable or has become durable.  Until then, the
+ * reply to a durable transaction is held back, so that the client never hears
+ * that a transaction committed before it is actually on disk. */
+static bool
+ovsdb_trigger_try_durable(struct ovsdb_trigger *t)
+{
+    struct ovsdb_error *error;
+
+    if (!ovsdb_is_durable(t->db, t->durable_seqno, &error)) {
         return false;
     }
+    if (error) {
+        json_array_add(t->result, ovsdb_error_to_json(error));
+        ovsdb_error_destroy(error);
+    }
+    t->durable_seqno = 0;
+    ovsdb_trigger_complete(t);
+    return true;
 }
 
 static void
@@ -126,4 +150,8 @@ ovsdb_trigger_complete(struct ovsdb_trigger *t)
     ovs_assert(t->result != NULL);
     list_remove(&t->node);
     list_push_back(&t->session->completions, &t->node);
+
+    /* Make sure that the session sends the reply promptly, even if it already
+     * ran in this iteration of the main loop. */
+    poll_immediate_wake();
 }
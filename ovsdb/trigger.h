@@ -23,10 +23,11 @@ struct ovsdb;
 struct ovsdb_trigger {
     struct ovsdb_session *session; /* Session that owns this trigger. */
     struct ovsdb *db;           /* Database on which trigger acts. */
-    struct list node;           /* !result: in db->triggers;
-                                 * result: in session->completions. */
+    struct list node;           /* Incomplete: in db->triggers;
+                                 * complete: in session->completions. */
     struct json *request;       /* Database request. */
     struct json *result;        /* Result (null if none yet). */
+    uint64_t durable_seqno;     /* Durable commit to await, 0 if none. */
     long long int created;      /* Time created. */
     long long int timeout_msec; /* Max wait duration. */
 };
@@ -189,7 +189,7 @@ class Atom(object):
             else:
                 return ['%s.boolean = false;']
         elif self.type == ovs.db.types.StringType:
-            return ['%s.string = xstrdup("%s");'
+            return ['%s.s = ovsdb_atom_string_create("%s");'
                     % (var, escapeCString(self.value))]
         elif self.type == ovs.db.types.UuidType:
             return ovs.ovsuuid.to_c_assignment(self.value, var)
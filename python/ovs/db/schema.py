@@ -163,13 +163,16 @@ def column_set_from_json(json, columns):
 
 class TableSchema(object):
     def __init__(self, name, columns, mutable=True, max_rows=sys.maxint,
-                 is_root=True, indexes=[]):
+                 is_root=True, indexes=[], secondary_indexes=[],
+                 ordered_indexes=[]):
         self.name = name
         self.columns = columns
         self.mutable = mutable
         self.max_rows = max_rows
         self.is_root = is_root
         self.indexes = indexes
+        self.secondary_indexes = secondary_indexes
+        self.ordered_indexes = ordered_indexes
 
     @staticmethod
     def from_json(json, name):
@@ -179,6 +182,10 @@ class TableSchema(object):
         max_rows = parser.get_optional("maxRows", [int])
         is_root = parser.get_optional("isRoot", [bool], False)
         indexes_json = parser.get_optional("indexes", [list], [])
+        secondary_indexes_json = parser.get_optional("secondaryIndexes",
+                                                     [list], [])
+        ordered_indexes_json = parser.get_optional("orderedIndexes", [list],
+                                                   [])
         parser.finish()
 
         if max_rows == None:
@@ -208,7 +215,23 @@ class TableSchema(object):
                                       "not be indexed" % column.name, json)
             indexes.append(index)
 
-        return TableSchema(name, columns, mutable, max_rows, is_root, indexes)
+        secondary_indexes = []
+        for index_json in secondary_indexes_json:
+            index = column_set_from_json(index_json, columns)
+            if not index:
+                raise error.Error("index must have at least one column", json)
+            secondary_indexes.append(index)
+
+        ordered_indexes = column_set_from_json(ordered_indexes_json, columns)
+        for column in ordered_indexes:
+            if (not column.type.is_scalar()
+                or column.type.key.type not in [types.IntegerType,
+                                                types.RealType]):
+                raise error.Error("ordered index column %s must be a scalar "
+                                  "integer or real" % column.name, json)
+
+        return TableSchema(name, columns, mutable, max_rows, is_root, indexes,
+                           secondary_indexes, list(ordered_indexes))
 
     def to_json(self, default_is_root=False):
         """Returns this table schema serialized into JSON.
@@ -241,6 +264,16 @@ class TableSchema(object):
             for index in self.indexes:
                 json["indexes"].append([column.name for column in index])
 
+        if self.secondary_indexes:
+            json["secondaryIndexes"] = []
+            for index in self.secondary_indexes:
+                json["secondaryIndexes"].append([column.name
+                                                 for column in index])
+
+        if self.ordered_indexes:
+            json["orderedIndexes"] = [column.name
+                                      for column in self.ordered_indexes]
+
         return json
 
 
@@ -344,23 +344,25 @@ class BaseType(object):
     def toAtomicType(self):
         return "OVSDB_TYPE_%s" % self.type.to_string().upper()
 
-    def copyCValue(self, dst, src):
-        args = {'dst': dst, 'src': src}
-        if self.ref_table_name:
-            return ("%(dst)s = %(src)s->header_.uuid;") % args
-        elif self.type == StringType:
-            return "%(dst)s = xstrdup(%(src)s);" % args
+    def cAtomValue(self, atom):
+        """Returns a C expression for the value of 'atom', a C expression of
+        type "union ovsdb_atom" that has this type."""
+        if self.type == StringType:
+            return "%s.s->string" % atom
         else:
-            return "%(dst)s = %(src)s;" % args
+            return "%s.%s" % (atom, self.type.to_string())
 
-    def assign_c_value_casting_away_const(self, dst, src):
+    def copyCValue(self, dst, src):
+        """Returns a C statement that initializes 'dst', a C expression of
+        type "union ovsdb_atom", from 'src', a C value of this type."""
         args = {'dst': dst, 'src': src}
         if self.ref_table_name:
-            return ("%(dst)s = %(src)s->header_.uuid;") % args
+            return ("%(dst)s.uuid = %(src)s->header_.uuid;") % args
         elif self.type == StringType:
-            return "%(dst)s = CONST_CAST(char *, %(src)s);" % args
+            return "%(dst)s.s = ovsdb_atom_string_create(%(src)s);" % args
         else:
-            return "%(dst)s = %(src)s;" % args
+            return ("%(dst)s.%(member)s = %(src)s;"
+                    % dict(args, member=self.type.to_string()))
 
     def initCDefault(self, var, is_optional):
         if self.ref_table_name:
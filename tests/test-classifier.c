@@ -33,8 +33,12 @@
 #include "command-line.h"
 #include "flow.h"
 #include "ofp-util.h"
+#include "ovs-atomic.h"
+#include "ovs-rcu.h"
+#include "ovs-thread.h"
 #include "packets.h"
 #include "random.h"
+#include "timeval.h"
 #include "unaligned.h"
 
 #undef NDEBUG
@@ -996,6 +1000,283 @@ test_many_rules_in_five_tables(int argc OVS_UNUSED, char *argv[] OVS_UNUSED)
     test_many_rules_in_n_tables(5);
 }
 
+/* Concurrency tests. */
+
+/* A simple per-thread pseudo-random number generator, since random_uint32()
+ * isn't thread-safe. */
+static uint32_t
+xorshift32(uint32_t *state)
+{
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+enum { N_STABLE_RULES = 64 };
+
+struct concurrent_aux {
+    struct classifier *cls;
+    atomic_bool stop;
+    atomic_uint n_lookups;
+    unsigned int seed;
+};
+
+static void
+make_concurrent_flow(struct flow *flow, int i)
+{
+    memset(flow, 0, sizeof *flow);
+    flow->dl_type = htons(ETH_TYPE_IP);
+    flow->nw_src = htonl(i);
+    flow->tp_src = htons(i % 7);
+}
+
+static void *
+concurrent_reader(void *aux_)
+{
+    struct concurrent_aux *aux = aux_;
+    uint32_t state = aux->seed;
+    unsigned int n = 0;
+    unsigned int orig;
+
+    for (;;) {
+        const struct test_rule *rule;
+        struct cls_rule *cr;
+        struct flow flow;
+        bool stop;
+        int i;
+
+        atomic_read(&aux->stop, &stop);
+        if (stop) {
+            break;
+        }
+
+        /* Every flow matches one of the stable rules, at priority 100, so a
+         * lookup must never find nothing or anything with a lower priority,
+         * however the writer is changing the classifier. */
+        i = xorshift32(&state) % N_STABLE_RULES;
+        make_concurrent_flow(&flow, i);
+        cr = classifier_lookup(aux->cls, &flow, NULL);
+        assert(cr != NULL);
+        rule = test_rule_from_cls_rule(cr);
+        assert(cr->priority >= 100);
+        assert(cr->priority > 100 || rule->aux == i);
+        n++;
+
+        ovsrcu_quiesce();
+    }
+    atomic_add(&aux->n_lookups, n, &orig);
+
+    return NULL;
+}
+
+static struct test_rule *
+make_concurrent_rule(int i, bool match_tp_src, unsigned int priority)
+{
+    struct test_rule *rule;
+    struct match match;
+    struct flow flow;
+
+    make_concurrent_flow(&flow, i);
+    match_init_catchall(&match);
+    match_set_dl_type(&match, flow.dl_type);
+    match_set_nw_src(&match, flow.nw_src);
+    if (match_tp_src) {
+        match_set_nw_proto(&match, 0);
+        match_set_tp_src(&match, flow.tp_src);
+    }
+
+    rule = xzalloc(sizeof *rule);
+    rule->aux = i;
+    cls_rule_init(&rule->cls_rule, &match, priority);
+    return rule;
+}
+
+/* Tests that lookups in several threads return sensible results while another
+ * thread keeps adding and removing rules, including whole tables. */
+static void
+test_concurrent_lookups(int argc OVS_UNUSED, char *argv[] OVS_UNUSED)
+{
+    enum { N_READERS = 4 };
+    enum { N_TRANSIENT = 64 };
+    struct test_rule *stable[N_STABLE_RULES];
+    struct test_rule *transient[N_TRANSIENT];
+    struct concurrent_aux aux[N_READERS];
+    pthread_t threads[N_READERS];
+    struct classifier cls;
+    uint32_t state = 1;
+    int i;
+
+    classifier_init(&cls);
+    for (i = 0; i < N_STABLE_RULES; i++) {
+        stable[i] = make_concurrent_rule(i, false, 100);
+        classifier_insert(&cls, &stable[i]->cls_rule);
+    }
+    memset(transient, 0, sizeof transient);
+
+    for (i = 0; i < N_READERS; i++) {
+        aux[i].cls = &cls;
+        atomic_init(&aux[i].stop, false);
+        atomic_init(&aux[i].n_lookups, 0);
+        aux[i].seed = i + 1;
+        xpthread_create(&threads[i], NULL, concurrent_reader, &aux[i]);
+    }
+
+    for (i = 0; i < 20000; i++) {
+        int j = xorshift32(&state) % N_TRANSIENT;
+
+        if (transient[j]) {
+            classifier_remove(&cls, &transient[j]->cls_rule);
+            ovsrcu_postpone(free_rule, transient[j]);
+            transient[j] = NULL;
+        } else {
+            /* Rules in their own table, at lower and higher priority than the
+             * stable rules, so that tables get created, destroyed, and
+             * reordered. */
+            struct test_rule *old;
+            int k;
+
+            transient[j] = make_concurrent_rule(xorshift32(&state)
+                                                % N_STABLE_RULES, true,
+                                                j & 1 ? 50 : 200);
+            old = test_rule_from_cls_rule(
+                classifier_replace(&cls, &transient[j]->cls_rule));
+            if (old) {
+                for (k = 0; transient[k] != old; k++) {
+                    continue;
+                }
+                transient[k] = NULL;
+                ovsrcu_postpone(free_rule, old);
+            }
+        }
+        ovsrcu_quiesce();
+    }
+
+    for (i = 0; i < N_READERS; i++) {
+        atomic_store(&aux[i].stop, true);
+        pthread_join(threads[i], NULL);
+    }
+
+    destroy_classifier(&cls);
+}
+
+static void *
+benchmark_reader(void *aux_)
+{
+    struct concurrent_aux *aux = aux_;
+    uint32_t state = aux->seed;
+    unsigned int n_lookups;
+    unsigned int i;
+
+    atomic_read(&aux->n_lookups, &n_lookups);
+    for (i = 0; i < n_lookups; i++) {
+        struct flow flow;
+        int j = xorshift32(&state) % N_STABLE_RULES;
+
+        make_concurrent_flow(&flow, j);
+        flow.nw_proto = IPPROTO_TCP;
+        flow.nw_dst = htonl(xorshift32(&state) % 256);
+        flow.tp_dst = htons(xorshift32(&state) % 1024);
+        classifier_lookup(aux->cls, &flow, NULL);
+    }
+
+    return NULL;
+}
+
+/* Returns a new rule that matches IPv4 TCP packets on a random subset of the
+ * source and destination addresses and ports, so that rules are spread across
+ * up to 16 tables. */
+static struct test_rule *
+make_benchmark_rule(uint32_t *state)
+{
+    uint32_t fields = xorshift32(state);
+    struct test_rule *rule;
+    struct match match;
+
+    match_init_catchall(&match);
+    match_set_dl_type(&match, htons(ETH_TYPE_IP));
+    match_set_nw_proto(&match, IPPROTO_TCP);
+    if (fields & 1) {
+        match_set_nw_src(&match, htonl(xorshift32(state) % N_STABLE_RULES));
+    }
+    if (fields & 2) {
+        match_set_nw_dst(&match, htonl(xorshift32(state) % 256));
+    }
+    if (fields & 4) {
+        match_set_tp_src(&match, htons(xorshift32(state) % 7));
+    }
+    if (fields & 8) {
+        match_set_tp_dst(&match, htons(xorshift32(state) % 1024));
+    }
+
+    rule = xzalloc(sizeof *rule);
+    cls_rule_init(&rule->cls_rule, &match, xorshift32(state) % 1000);
+    return rule;
+}
+
+/* Measures lookup throughput with 1, 2, ..., N_THREADS reader threads in a
+ * classifier that contains N_RULES rules spread across several tables.  With
+ * no concurrent modifications, throughput should scale linearly with the
+ * number of threads (up to the number of cores). */
+static void
+benchmark(int argc, char *argv[])
+{
+    int max_threads = argc > 1 ? atoi(argv[1]) : 4;
+    int n_rules = argc > 2 ? atoi(argv[2]) : 1000;
+    int n_lookups = argc > 3 ? atoi(argv[3]) : 1000000;
+    struct test_rule **rules;
+    struct classifier cls;
+    uint32_t state = 1;
+    int n_threads;
+    int i;
+
+    classifier_init(&cls);
+    rules = xmalloc(n_rules * sizeof *rules);
+    for (i = 0; i < n_rules; i++) {
+        struct test_rule *old;
+
+        rules[i] = make_benchmark_rule(&state);
+        old = test_rule_from_cls_rule(classifier_replace(&cls,
+                                                         &rules[i]->cls_rule));
+        if (old) {
+            free_rule(old);
+        }
+    }
+    printf("%d rules in %zu tables\n",
+           classifier_count(&cls), hmap_count(&cls.tables));
+
+    for (n_threads = 1; n_threads <= max_threads; n_threads++) {
+        struct concurrent_aux *aux = xmalloc(n_threads * sizeof *aux);
+        pthread_t *threads = xmalloc(n_threads * sizeof *threads);
+        long long int start, elapsed;
+
+        start = time_msec();
+        for (i = 0; i < n_threads; i++) {
+            aux[i].cls = &cls;
+            atomic_init(&aux[i].n_lookups, n_lookups);
+            aux[i].seed = i + 1;
+            xpthread_create(&threads[i], NULL, benchmark_reader, &aux[i]);
+        }
+        for (i = 0; i < n_threads; i++) {
+            pthread_join(threads[i], NULL);
+        }
+        elapsed = MAX(time_msec() - start, 1);
+
+        printf("%d threads: %d lookups each in %lld ms, "
+               "%.0f lookups/s total\n",
+               n_threads, n_lookups, elapsed,
+               (double) n_threads * n_lookups * 1000 / elapsed);
+        free(threads);
+        free(aux);
+    }
+
+    destroy_classifier(&cls);
+    free(rules);
+}
+
 /* Miniflow tests. */
 
 static uint32_t
@@ -1303,6 +1584,8 @@ static const struct command commands[] = {
     {"many-rules-in-one-table", 0, 0, test_many_rules_in_one_table},
     {"many-rules-in-two-tables", 0, 0, test_many_rules_in_two_tables},
     {"many-rules-in-five-tables", 0, 0, test_many_rules_in_five_tables},
+    {"concurrent-lookups", 0, 0, test_concurrent_lookups},
+    {"benchmark", 0, 3, benchmark},
 
     /* Miniflow and minimask tests. */
     {"miniflow", 0, 0, test_miniflow},
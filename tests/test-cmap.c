@@ -0,0 +1,495 @@
+/*
+ * Copyright (c) 2013 Nicira, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* A non-exhaustive test for some of the functions and macros declared in
+ * cmap.h. */
+
+#include <config.h>
+#include "cmap.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hash.h"
+#include "hmap.h"
+#include "ovs-rcu.h"
+#include "ovs-thread.h"
+#include "random.h"
+#include "timeval.h"
+#include "util.h"
+
+#undef NDEBUG
+#include <assert.h>
+
+/* Sample cmap element. */
+struct element {
+    int value;
+    struct cmap_node node;
+};
+
+typedef size_t hash_func(int value);
+
+static int
+compare_ints(const void *a_, const void *b_)
+{
+    const int *a = a_;
+    const int *b = b_;
+    return *a < *b ? -1 : *a > *b;
+}
+
+/* Verifies that 'cmap' contains exactly the 'n' values in 'values'. */
+static void
+check_cmap(struct cmap *cmap, const int values[], size_t n,
+           hash_func *hash)
+{
+    int *sort_values, *cmap_values;
+    struct cmap_position pos;
+    struct cmap_cursor cursor;
+    struct cmap_node *node;
+    struct element *e;
+    size_t i;
+
+    /* Check that all the values are there in iteration. */
+    sort_values = xmalloc(sizeof *sort_values * n);
+    cmap_values = xmalloc(sizeof *sort_values * n);
+
+    i = 0;
+    CMAP_FOR_EACH (e, node, &cursor, cmap) {
+        assert(i < n);
+        cmap_values[i++] = e->value;
+    }
+    assert(i == n);
+
+    memcpy(sort_values, values, sizeof *sort_values * n);
+    qsort(sort_values, n, sizeof *sort_values, compare_ints);
+    qsort(cmap_values, n, sizeof *cmap_values, compare_ints);
+
+    for (i = 0; i < n; i++) {
+        assert(sort_values[i] == cmap_values[i]);
+    }
+
+    /* Check that iteration by position visits the same values. */
+    memset(&pos, 0, sizeof pos);
+    i = 0;
+    while ((node = cmap_next_position(cmap, &pos)) != NULL) {
+        assert(i < n);
+        e = CONTAINER_OF(node, struct element, node);
+        cmap_values[i++] = e->value;
+    }
+    assert(i == n);
+
+    qsort(cmap_values, n, sizeof *cmap_values, compare_ints);
+    for (i = 0; i < n; i++) {
+        assert(sort_values[i] == cmap_values[i]);
+    }
+
+    free(cmap_values);
+    free(sort_values);
+
+    /* Check that all the values are there in lookup. */
+    for (i = 0; i < n; i++) {
+        size_t count = 0;
+
+        CMAP_FOR_EACH_WITH_HASH (e, node, hash(values[i]), cmap) {
+            count += e->value == values[i];
+        }
+        assert(count == 1);
+
+        count = 0;
+        CMAP_FOR_EACH_WITH_HASH_PROTECTED (e, node, hash(values[i]), cmap) {
+            count += e->value == values[i];
+        }
+        assert(count == 1);
+    }
+
+    /* Check counters. */
+    assert(cmap_is_empty(cmap) == !n);
+    assert(cmap_count(cmap) == n);
+}
+
+static void
+shuffle(int *p, size_t n)
+{
+    for (; n > 1; n--, p++) {
+        int *q = &p[random_range(n)];
+        int tmp = *p;
+        *p = *q;
+        *q = tmp;
+    }
+}
+
+static size_t
+identity_hash(int value)
+{
+    return value;
+}
+
+static size_t
+good_hash(int value)
+{
+    return hash_int(value, 0x1234abcd);
+}
+
+static size_t
+constant_hash(int value OVS_UNUSED)
+{
+    return 123;
+}
+
+/* Tests basic cmap insertion, replacement, and deletion.  Checking the whole
+ * map after every change would take quadratic time, so this only checks it
+ * periodically. */
+static void
+test_cmap_insert_replace_delete(hash_func *hash)
+{
+    enum { N_ELEMS = 1000 };
+
+    struct element elements[N_ELEMS];
+    struct element copies[N_ELEMS];
+    int values[N_ELEMS];
+    struct cmap cmap;
+    size_t i;
+
+    cmap_init(&cmap);
+    for (i = 0; i < N_ELEMS; i++) {
+        elements[i].value = i;
+        cmap_insert(&cmap, &elements[i].node, hash(i));
+        values[i] = i;
+        if (is_pow2(i + 1) || i % 97 == 0) {
+            check_cmap(&cmap, values, i + 1, hash);
+        }
+    }
+    check_cmap(&cmap, values, N_ELEMS, hash);
+    shuffle(values, N_ELEMS);
+    for (i = 0; i < N_ELEMS; i++) {
+        if (values[i] % 2) {
+            copies[values[i]].value = values[i];
+            cmap_replace(&cmap, &elements[values[i]].node,
+                         &copies[values[i]].node, hash(values[i]));
+        }
+    }
+    check_cmap(&cmap, values, N_ELEMS, hash);
+    shuffle(values, N_ELEMS);
+    for (i = 0; i < N_ELEMS; i++) {
+        struct element *e = (values[i] % 2
+                             ? &copies[values[i]]
+                             : &elements[values[i]]);
+
+        cmap_remove(&cmap, &e->node, hash(values[i]));
+        if (is_pow2(N_ELEMS - i) || i % 97 == 0) {
+            check_cmap(&cmap, values + (i + 1), N_ELEMS - (i + 1), hash);
+        }
+    }
+    cmap_destroy(&cmap);
+}
+
+/* Tests that the thread writing a cmap may remove the current element during
+ * CMAP_FOR_EACH. */
+static void
+test_cmap_for_each_remove(hash_func *hash)
+{
+    enum { MAX_ELEMS = 10 };
+    size_t n;
+    unsigned long int pattern;
+
+    for (n = 0; n <= MAX_ELEMS; n++) {
+        for (pattern = 0; pattern < 1ul << n; pattern++) {
+            struct element elements[MAX_ELEMS];
+            int values[MAX_ELEMS];
+            struct cmap_cursor cursor;
+            struct cmap cmap;
+            struct element *e;
+            size_t n_remaining;
+            size_t i;
+
+            cmap_init(&cmap);
+            for (i = 0; i < n; i++) {
+                elements[i].value = i;
+                cmap_insert(&cmap, &elements[i].node, hash(i));
+                values[i] = i;
+            }
+
+            i = 0;
+            n_remaining = n;
+            CMAP_FOR_EACH (e, node, &cursor, &cmap) {
+                assert(i < n);
+                if (pattern & (1ul << e->value)) {
+                    size_t j;
+
+                    cmap_remove(&cmap, &e->node, hash(e->value));
+                    for (j = 0; ; j++) {
+                        assert(j < n_remaining);
+                        if (values[j] == e->value) {
+                            values[j] = values[--n_remaining];
+                            break;
+                        }
+                    }
+                }
+                i++;
+            }
+            assert(i == n);
+            check_cmap(&cmap, values, n_remaining, hash);
+
+            cmap_destroy(&cmap);
+        }
+    }
+}
+
+static void
+run_test(void (*function)(hash_func *))
+{
+    hash_func *hash_funcs[] = { identity_hash, good_hash, constant_hash };
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(hash_funcs); i++) {
+        function(hash_funcs[i]);
+        ovsrcu_quiesce();
+        printf(".");
+        fflush(stdout);
+    }
+}
+
+static void
+run_tests(void)
+{
+    run_test(test_cmap_insert_replace_delete);
+    run_test(test_cmap_for_each_remove);
+    printf("\n");
+}
+
+/* Benchmarks. */
+
+static int n_elems;             /* Number of elements to insert. */
+static int n_threads;           /* Number of threads to search and mutate. */
+
+struct benchmark_aux {
+    const struct cmap *cmap;
+    const struct hmap *hmap;
+    int start;
+};
+
+static long long int
+elapsed(const struct timeval *start)
+{
+    struct timeval end;
+
+    xgettimeofday(&end);
+    return timeval_to_msec(&end) - timeval_to_msec(start);
+}
+
+struct hmap_element {
+    int value;
+    struct hmap_node node;
+};
+
+static void *
+search_cmap(void *aux_)
+{
+    const struct benchmark_aux *aux = aux_;
+    int i;
+
+    for (i = 0; i < n_elems; i++) {
+        int value = (aux->start + i) % n_elems;
+        struct element *e;
+        bool found = false;
+
+        CMAP_FOR_EACH_WITH_HASH (e, node, hash_int(value, 0), aux->cmap) {
+            if (e->value == value) {
+                found = true;
+                break;
+            }
+        }
+        assert(found);
+    }
+    return NULL;
+}
+
+static void *
+search_hmap(void *aux_)
+{
+    const struct benchmark_aux *aux = aux_;
+    int i;
+
+    for (i = 0; i < n_elems; i++) {
+        int value = (aux->start + i) % n_elems;
+        struct hmap_element *e;
+        bool found = false;
+
+        HMAP_FOR_EACH_WITH_HASH (e, node, hash_int(value, 0), aux->hmap) {
+            if (e->value == value) {
+                found = true;
+                break;
+            }
+        }
+        assert(found);
+    }
+    return NULL;
+}
+
+/* Runs 'search' in 'n_threads' threads (or in the current thread, if
+ * 'n_threads' is 0) and returns the elapsed time in milliseconds. */
+static long long int
+run_searches(void *(*search)(void *), const struct cmap *cmap,
+             const struct hmap *hmap)
+{
+    struct benchmark_aux *aux;
+    pthread_t *threads;
+    struct timeval start;
+    int i;
+
+    aux = xmalloc(MAX(n_threads, 1) * sizeof *aux);
+    threads = xmalloc(MAX(n_threads, 1) * sizeof *threads);
+    for (i = 0; i < MAX(n_threads, 1); i++) {
+        aux[i].cmap = cmap;
+        aux[i].hmap = hmap;
+        aux[i].start = (long long int) n_elems * i / MAX(n_threads, 1);
+    }
+
+    xgettimeofday(&start);
+    if (!n_threads) {
+        search(&aux[0]);
+    } else {
+        for (i = 0; i < n_threads; i++) {
+            xpthread_create(&threads[i], NULL, search, &aux[i]);
+        }
+        for (i = 0; i < n_threads; i++) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+
+    free(threads);
+    free(aux);
+    return elapsed(&start);
+}
+
+static void
+benchmark_cmap(void)
+{
+    struct element *elements;
+    struct cmap_cursor cursor;
+    struct timeval start;
+    struct element *e;
+    struct cmap cmap;
+    int i;
+
+    elements = xmalloc(n_elems * sizeof *elements);
+
+    /* Insertions. */
+    xgettimeofday(&start);
+    cmap_init(&cmap);
+    for (i = 0; i < n_elems; i++) {
+        elements[i].value = i;
+        cmap_insert(&cmap, &elements[i].node, hash_int(i, 0));
+    }
+    printf("cmap insert:  %5lld ms\n", elapsed(&start));
+
+    /* Iteration. */
+    xgettimeofday(&start);
+    i = 0;
+    CMAP_FOR_EACH (e, node, &cursor, &cmap) {
+        i++;
+    }
+    assert(i == n_elems);
+    printf("cmap iterate: %5lld ms\n", elapsed(&start));
+
+    /* Search. */
+    printf("cmap search:  %5lld ms\n", run_searches(search_cmap, &cmap, NULL));
+
+    /* Destruction. */
+    xgettimeofday(&start);
+    CMAP_FOR_EACH (e, node, &cursor, &cmap) {
+        cmap_remove(&cmap, &e->node, hash_int(e->value, 0));
+    }
+    cmap_destroy(&cmap);
+    printf("cmap destroy: %5lld ms\n", elapsed(&start));
+
+    ovsrcu_synchronize();
+    free(elements);
+}
+
+static void
+benchmark_hmap(void)
+{
+    struct hmap_element *elements;
+    struct hmap_element *e, *next;
+    struct timeval start;
+    struct hmap hmap;
+    int i;
+
+    elements = xmalloc(n_elems * sizeof *elements);
+
+    /* Insertions. */
+    xgettimeofday(&start);
+    hmap_init(&hmap);
+    for (i = 0; i < n_elems; i++) {
+        elements[i].value = i;
+        hmap_insert(&hmap, &elements[i].node, hash_int(i, 0));
+    }
+    printf("hmap insert:  %5lld ms\n", elapsed(&start));
+
+    /* Iteration. */
+    xgettimeofday(&start);
+    i = 0;
+    HMAP_FOR_EACH (e, node, &hmap) {
+        i++;
+    }
+    assert(i == n_elems);
+    printf("hmap iterate: %5lld ms\n", elapsed(&start));
+
+    /* Search.  An hmap needs a lock to be shared among threads, but searches
+     * alone do not change it, so it is safe to run them in parallel here. */
+    printf("hmap search:  %5lld ms\n", run_searches(search_hmap, NULL, &hmap));
+
+    /* Destruction. */
+    xgettimeofday(&start);
+    HMAP_FOR_EACH_SAFE (e, next, node, &hmap) {
+        hmap_remove(&hmap, &e->node);
+    }
+    hmap_destroy(&hmap);
+    printf("hmap destroy: %5lld ms\n", elapsed(&start));
+
+    free(elements);
+}
+
+/* "test-cmap benchmark [N_ELEMS [N_THREADS]]": inserts N_ELEMS (default
+ * 1000000) elements into a cmap and into an hmap, then times iteration,
+ * searching for every element from N_THREADS threads (default 0, meaning the
+ * main thread), and removal. */
+static void
+run_benchmarks(int argc, char *argv[])
+{
+    n_elems = argc > 2 ? atoi(argv[2]) : 1000000;
+    n_threads = argc > 3 ? atoi(argv[3]) : 0;
+    if (n_elems <= 0 || n_threads < 0) {
+        ovs_fatal(0, "usage: %s benchmark [N_ELEMS [N_THREADS]]", argv[0]);
+    }
+
+    printf("Benchmarking with n=%d, %d threads.\n", n_elems, n_threads);
+    benchmark_cmap();
+    putchar('\n');
+    benchmark_hmap();
+}
+
+int
+main(int argc, char *argv[])
+{
+    set_program_name(argv[0]);
+    if (argc > 1 && !strcmp(argv[1], "benchmark")) {
+        run_benchmarks(argc, argv);
+    } else {
+        run_tests();
+    }
+    return 0;
+}
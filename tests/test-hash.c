@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2009, 2012 Nicira, Inc.
+ * Copyright (c) 2009, 2012, 2013 Nicira, Inc.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -19,8 +19,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "flow.h"
 #include "hash.h"
 #include "jhash.h"
+#include "packets.h"
+#include "random.h"
+#include "timeval.h"
+#include "util.h"
 
 #undef NDEBUG
 #include <assert.h>
@@ -53,10 +58,34 @@ hash_int_cb(uint32_t input)
     return hash_int(input, 0);
 }
 
+/* Exits with an error if 'collisions', the number of partial collisions that
+ * check_word_hash() or check_3word_hash() found among 'n_comparisons'
+ * comparisons of 'min_unique' bits each, is much higher than a random function
+ * would yield. */
+static void
+check_partial_collisions(const char *name, int collisions, int n_comparisons,
+                         int min_unique)
+{
+    double expected = (double) n_comparisons / (UINT32_C(1) << min_unique);
+
+    if (collisions > expected * 3 + 3) {
+        printf("%s: %d partial collisions in %d bits of output "
+               "(expected about %.1f)\n",
+               name, collisions, min_unique, expected);
+        exit(1);
+    }
+}
+
+/* Checks the hashes of inputs with one 1-bit (or no 1-bits) set for
+ * collisions in every run of 'min_unique' consecutive bits of output.  If
+ * 'exact' is true, there must be no collisions at all, otherwise there must not
+ * be many more than for a random function. */
 static void
 check_word_hash(uint32_t (*hash)(uint32_t), const char *name,
-                int min_unique)
+                int min_unique, bool exact)
 {
+    int collisions = 0;
+    int n_comparisons = 0;
     int i, j;
 
     for (i = 0; i <= 32; i++) {
@@ -70,7 +99,10 @@ check_word_hash(uint32_t (*hash)(uint32_t), const char *name,
             for (ofs = 0; ofs < 32 - min_unique; ofs++) {
                 uint32_t bits1 = (out1 >> ofs) & unique_mask;
                 uint32_t bits2 = (out2 >> ofs) & unique_mask;
-                if (bits1 == bits2) {
+                n_comparisons++;
+                if (bits1 == bits2 && !exact) {
+                    collisions++;
+                } else if (bits1 == bits2) {
                     printf("Partial collision for '%s':\n", name);
                     printf("%s(%08"PRIx32") = %08"PRIx32"\n", name, in1, out1);
                     printf("%s(%08"PRIx32") = %08"PRIx32"\n", name, in2, out2);
@@ -81,26 +113,37 @@ check_word_hash(uint32_t (*hash)(uint32_t), const char *name,
             }
         }
     }
+    check_partial_collisions(name, collisions, n_comparisons, min_unique);
 }
 
+/* Checks the hashes of 3-word inputs with one 1-bit (or no 1-bits) set for
+ * collisions in their low-order 12 bits.  'exact' has the same meaning as for
+ * check_word_hash(). */
 static void
 check_3word_hash(uint32_t (*hash)(const uint32_t[], size_t, uint32_t),
-                 const char *name)
+                 const char *name, bool exact)
 {
+    const int min_unique = 12;
+    int collisions = 0;
+    int n_comparisons = 0;
     int i, j;
 
     for (i = 0; i <= 96; i++) {
         for (j = i + 1; j <= 96; j++) {
             uint32_t in1[3], in2[3];
             uint32_t out1, out2;
-            const int min_unique = 12;
             const uint32_t unique_mask = (UINT32_C(1) << min_unique) - 1;
 
             set_bit(in1, i);
             set_bit(in2, j);
             out1 = hash(in1, 3, 0);
             out2 = hash(in2, 3, 0);
-            if ((out1 & unique_mask) == (out2 & unique_mask)) {
+            n_comparisons++;
+            if ((out1 & unique_mask) != (out2 & unique_mask)) {
+                continue;
+            } else if (!exact) {
+                collisions++;
+            } else {
                 printf("%s has a partial collision:\n", name);
                 printf("hash(1 << %d) == %08"PRIx32"\n", i, out1);
                 printf("hash(1 << %d) == %08"PRIx32"\n", j, out2);
@@ -109,11 +152,156 @@ check_3word_hash(uint32_t (*hash)(const uint32_t[], size_t, uint32_t),
             }
         }
     }
+    check_partial_collisions(name, collisions, n_comparisons, min_unique);
+}
+
+/* Checks that flipping any single input bit of a 3-word key flips each bit of
+ * 'hash''s output with probability close to 1/2 ("strict avalanche"). */
+static void
+check_avalanche(uint32_t (*hash)(const uint32_t[], size_t, uint32_t),
+                const char *name)
+{
+    enum { N_SAMPLES = 1000 };
+    static int flips[96][32];
+    int i, j, k;
+
+    memset(flips, 0, sizeof flips);
+    random_set_seed(0x12345678);
+    for (k = 0; k < N_SAMPLES; k++) {
+        uint32_t in[3];
+        uint32_t out;
+
+        in[0] = random_uint32();
+        in[1] = random_uint32();
+        in[2] = random_uint32();
+        out = hash(in, 3, 0);
+        for (i = 0; i < 96; i++) {
+            uint32_t diff;
+
+            in[i / 32] ^= UINT32_C(1) << (i % 32);
+            diff = out ^ hash(in, 3, 0);
+            in[i / 32] ^= UINT32_C(1) << (i % 32);
+
+            for (j = 0; j < 32; j++) {
+                flips[i][j] += (diff >> j) & 1;
+            }
+        }
+    }
+
+    /* With 1000 samples the standard deviation of each count is about 16, so
+     * a count outside [350, 650] is more than 9 standard deviations off. */
+    for (i = 0; i < 96; i++) {
+        for (j = 0; j < 32; j++) {
+            if (flips[i][j] < N_SAMPLES * 35 / 100
+                || flips[i][j] > N_SAMPLES * 65 / 100) {
+                printf("%s: flipping input bit %d flips output bit %d "
+                       "in %d of %d samples\n",
+                       name, i, j, flips[i][j], N_SAMPLES);
+                exit(1);
+            }
+        }
+    }
+}
+
+/* Hashes a set of flows that differ only in a few fields, the way that a
+ * typical flow table does, and checks that the number of collisions in the
+ * low-order bits used by an hmap with 2**16 buckets is not much higher than
+ * a random function would yield. */
+static void
+check_flow_collisions(void)
+{
+    enum { N_FLOWS = 1 << 14 };
+    enum { N_BUCKETS = 1 << 16 };
+    uint8_t *buckets = xzalloc(N_BUCKETS);
+    int collisions = 0;
+    int expected;
+    int i;
+
+    for (i = 0; i < N_FLOWS; i++) {
+        struct flow flow;
+        uint32_t hash;
+
+        memset(&flow, 0, sizeof flow);
+        flow.dl_type = htons(ETH_TYPE_IP);
+        flow.nw_proto = IPPROTO_TCP;
+        flow.in_port.ofp_port = u16_to_ofp(i & 0xf);
+        flow.nw_src = htonl(0x0a000000 | (i >> 4));
+        flow.nw_dst = htonl(0x0a000001);
+        flow.tp_src = htons(1024 + (i & 0xff));
+        flow.tp_dst = htons(80);
+
+        hash = flow_hash(&flow, 0);
+        if (buckets[hash % N_BUCKETS]++) {
+            collisions++;
+        }
+    }
+    free(buckets);
+
+    /* A random function is expected to yield about C(N_FLOWS, 2) / N_BUCKETS
+     * colliding pairs, which here is about 2048. */
+    expected = (N_FLOWS / 2) * (N_FLOWS - 1) / N_BUCKETS;
+    if (collisions > expected * 3 / 2) {
+        printf("flow_hash: %d collisions among %d flows in %d buckets "
+               "(expected about %d)\n",
+               collisions, N_FLOWS, N_BUCKETS, expected);
+        exit(1);
+    }
+}
+
+static void
+benchmark(int n)
+{
+    static const char *const names[] = { "hash_words", "hash_bytes",
+                                         "jhash_words", "flow_hash" };
+    struct flow flow;
+    uint32_t words[8];
+    size_t i;
+
+    memset(&flow, 0, sizeof flow);
+    random_bytes(words, sizeof words);
+    printf("hash backend: %s\n", HASH_BACKEND);
+    for (i = 0; i < ARRAY_SIZE(names); i++) {
+        long long int start;
+        uint32_t hash = 0;
+        int j;
+
+        start = time_msec();
+        for (j = 0; j < n; j++) {
+            switch (i) {
+            case 0:
+                hash = hash_words(words, ARRAY_SIZE(words), hash);
+                break;
+            case 1:
+                hash = hash_bytes(words, sizeof words, hash);
+                break;
+            case 2:
+                hash = jhash_words(words, ARRAY_SIZE(words), hash);
+                break;
+            case 3:
+                flow.nw_src = htonl(j);
+                hash = flow_hash(&flow, hash);
+                break;
+            }
+        }
+        printf("%s: %d hashes in %lld ms (result %08"PRIx32")\n",
+               names[i], n, time_msec() - start, hash);
+    }
 }
 
 int
-main(void)
+main(int argc, char *argv[])
 {
+    /* Murmurhash, and hence jhash, which is similar, are known to pass the
+     * exact collision checks below, even though a random function usually
+     * would not.  The CRC32-C backend only has to do as well as a random
+     * function. */
+    bool exact = !strcmp(HASH_BACKEND, "murmurhash");
+
+    if (argc >= 2 && !strcmp(argv[1], "benchmark")) {
+        benchmark(argc >= 3 ? atoi(argv[2]) : 10000000);
+        return 0;
+    }
+
     /* Check that all hashes computed with hash_words with one 1-bit (or no
      * 1-bits) set within a single 32-bit word have different values in all
      * 11-bit consecutive runs.
@@ -130,8 +318,8 @@ main(void)
      * those 11-bit runs would be (1-0.22)**21 =~ .0044.  Obviously
      * independence must be a bad assumption :-)
      */
-    check_word_hash(hash_words_cb, "hash_words", 11);
-    check_word_hash(jhash_words_cb, "jhash_words", 11);
+    check_word_hash(hash_words_cb, "hash_words", 11, exact);
+    check_word_hash(jhash_words_cb, "jhash_words", 11, true);
 
     /* Check that all hash functions of with one 1-bit (or no 1-bits) set
      * within three 32-bit words have different values in their lowest 12
@@ -146,8 +334,8 @@ main(void)
      *
      * so we are doing pretty well to not have any collisions in 12 bits.
      */
-    check_3word_hash(hash_words, "hash_words");
-    check_3word_hash(jhash_words, "jhash_words");
+    check_3word_hash(hash_words, "hash_words", exact);
+    check_3word_hash(jhash_words, "jhash_words", true);
 
     /* Check that all hashes computed with hash_int with one 1-bit (or no
      * 1-bits) set within a single 32-bit word have different values in all
@@ -166,7 +354,11 @@ main(void)
      * assumption of independence, which makes it seem like a good hash
      * function.
      */
-    check_word_hash(hash_int_cb, "hash_int", 12);
+    check_word_hash(hash_int_cb, "hash_int", 12, exact);
+
+    /* Check the statistical quality of the hash functions used for flows. */
+    check_avalanche(hash_words, "hash_words");
+    check_flow_collisions();
 
     return 0;
 }
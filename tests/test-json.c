@@ -23,6 +23,8 @@
 #include <getopt.h>
 #include <stdio.h>
 
+#include "dynamic-string.h"
+#include "timeval.h"
 #include "util.h"
 
 /* --pretty: If set, the JSON output is pretty-printed, instead of printed as
@@ -33,6 +35,27 @@ static int pretty = 0;
  * instead of exactly one object or array. */
 static int multiple = 0;
 
+/* Checks that serializing 'json' incrementally, in the smallest possible
+ * chunks, yields the same text as serializing it all at once. */
+static void
+check_stream_serializer(const struct json *json)
+{
+    struct json_stream_serializer *serializer;
+    struct json *copy = json_clone(json);
+    char *expected = json_to_string(copy, 0);
+    struct ds actual = DS_EMPTY_INITIALIZER;
+
+    serializer = json_stream_serializer_create(copy);
+    while (!json_stream_serializer_next(serializer, &actual, 1)) {
+        continue;
+    }
+    json_stream_serializer_destroy(serializer);
+
+    ovs_assert(!strcmp(expected, ds_cstr(&actual)));
+    free(expected);
+    ds_destroy(&actual);
+}
+
 static bool
 print_and_free_json(struct json *json)
 {
@@ -43,6 +66,7 @@ print_and_free_json(struct json *json)
     } else {
         char *s = json_to_string(json, JSSF_SORT | (pretty ? JSSF_PRETTY : 0));
         ovs_assert(pretty || json_serialized_length(json) == strlen(s));
+        check_stream_serializer(json);
         puts(s);
         free(s);
         ok = true;
@@ -104,6 +128,123 @@ parse_multiple(FILE *stream)
     return ok;
 }
 
+/* Returns a JSON-RPC "update" notification that reports 'n_rows' new rows in
+ * the Interface table, resembling what ovsdb-server sends to ovs-vswitchd. */
+static struct json *
+make_benchmark_update(int n_rows)
+{
+    static const char *stats[] = {
+        "collisions", "rx_bytes", "rx_crc_err", "rx_dropped", "rx_errors",
+        "rx_frame_err", "rx_over_err", "rx_packets", "tx_bytes",
+        "tx_dropped", "tx_errors", "tx_packets",
+    };
+    struct json *rows = json_object_create();
+    struct json *update;
+    int i;
+
+    for (i = 0; i < n_rows; i++) {
+        struct json *row = json_object_create();
+        struct json *row_update;
+        struct json *pairs;
+        char uuid[64];
+        size_t j;
+
+        json_object_put(row, "name",
+                        json_string_create_nocopy(xasprintf("tap%05d", i)));
+        json_object_put_string(row, "admin_state", "up");
+        json_object_put_string(row, "link_state", "up");
+        json_object_put(row, "ofport", json_integer_create(i + 1));
+        json_object_put(row, "mtu", json_integer_create(1500));
+        json_object_put_string(row, "mac_in_use", "fe:16:3e:12:34:56");
+
+        pairs = json_array_create_empty();
+        for (j = 0; j < ARRAY_SIZE(stats); j++) {
+            json_array_add(pairs,
+                           json_array_create_2(
+                               json_string_create(stats[j]),
+                               json_integer_create(i * 1000003LL + j)));
+        }
+        json_object_put(row, "statistics",
+                        json_array_create_2(json_string_create("map"),
+                                            pairs));
+
+        snprintf(uuid, sizeof uuid,
+                 "%08x-5a1c-4d2e-9f3b-%012x", i, i * 7919);
+        pairs = json_array_create_empty();
+        json_array_add(pairs, json_array_create_2(
+                           json_string_create("attached-mac"),
+                           json_string_create("fa:16:3e:12:34:56")));
+        json_array_add(pairs, json_array_create_2(
+                           json_string_create("iface-id"),
+                           json_string_create(uuid)));
+        json_array_add(pairs, json_array_create_2(
+                           json_string_create("iface-status"),
+                           json_string_create("active")));
+        json_object_put(row, "external_ids",
+                        json_array_create_2(json_string_create("map"),
+                                            pairs));
+
+        row_update = json_object_create();
+        json_object_put(row_update, "new", row);
+        json_object_put(rows, uuid, row_update);
+    }
+
+    update = json_object_create();
+    json_object_put(update, "Interface", rows);
+    return json_array_create_3(json_string_create("update"),
+                               json_array_create_2(json_null_create(),
+                                                   update),
+                               json_null_create());
+}
+
+/* "test-json benchmark [N_ROWS [N_PASSES]]": serializes an update message
+ * for N_ROWS (default 10000) rows, then times parsing it N_PASSES (default
+ * 10) times, feeding the parser in 4096-byte pieces as jsonrpc does. */
+static void
+run_benchmark(int argc, char *argv[])
+{
+    int n_rows = argc > 2 ? atoi(argv[2]) : 10000;
+    int n_passes = argc > 3 ? atoi(argv[3]) : 10;
+    struct json *json;
+    long long int start, elapsed;
+    size_t length;
+    char *text;
+    int i;
+
+    if (n_rows <= 0 || n_passes <= 0) {
+        ovs_fatal(0, "usage: %s benchmark [N_ROWS [N_PASSES]]", argv[0]);
+    }
+
+    json = make_benchmark_update(n_rows);
+    text = json_to_string(json, 0);
+    length = strlen(text);
+
+    elapsed = 0;
+    for (i = 0; i < n_passes; i++) {
+        struct json_parser *parser;
+        struct json *parsed;
+        size_t ofs;
+
+        start = time_msec();
+        parser = json_parser_create(0);
+        for (ofs = 0; ofs < length; ofs += 4096) {
+            json_parser_feed(parser, &text[ofs], MIN(4096, length - ofs));
+        }
+        parsed = json_parser_finish(parser);
+        elapsed += time_msec() - start;
+
+        ovs_assert(json_equal(parsed, json));
+        json_destroy(parsed);
+    }
+
+    printf("parsed %zu bytes %d times in %lld ms (%.1f MB/s)\n",
+           length, n_passes, elapsed,
+           elapsed ? length * n_passes / 1000.0 / elapsed : 0.0);
+
+    free(text);
+    json_destroy(json);
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -113,6 +254,11 @@ main(int argc, char *argv[])
 
     set_program_name(argv[0]);
 
+    if (argc > 1 && !strcmp(argv[1], "benchmark")) {
+        run_benchmark(argc, argv);
+        return 0;
+    }
+
     for (;;) {
         static const struct option options[] = {
             {"pretty", no_argument, &pretty, 1},
@@ -184,7 +184,10 @@ usage(void)
            "    connect to SERVER and dump the contents of the database\n"
            "    as seen initially by the IDL implementation and after\n"
            "    executing each TRANSACTION.  (Each TRANSACTION must modify\n"
-           "    the database or this command will hang.)\n",
+           "    the database or this command will hang.)\n"
+           "  idl-track SERVER [TRANSACTION...]\n"
+           "    same as idl, but with change tracking enabled, and dump\n"
+           "    only the rows in the \"simple\" table that changed.\n",
            program_name, program_name);
     vlog_usage();
     printf("\nOther options:\n"
@@ -304,6 +307,14 @@ do_log_io(int argc, char *argv[])
             json_destroy(json);
         } else if (!strcmp(command, "commit")) {
             error = ovsdb_log_commit(log);
+        } else if (!strncmp(command, "format:", 7)) {
+            enum ovsdb_log_format format;
+
+            if (!ovsdb_log_format_from_string(command + 7, &format)) {
+                ovs_fatal(0, "unknown log format \"%s\"", command + 7);
+            }
+            ovsdb_log_set_format(log, format);
+            error = NULL;
         } else {
             ovs_fatal(0, "unknown log-io command \"%s\"", command);
         }
@@ -990,7 +1001,15 @@ put_row(struct ovsdb_table *table, struct ovsdb_row *row)
 {
     const struct uuid *uuid = ovsdb_row_get_uuid(row);
     if (!ovsdb_table_get_row(table, uuid)) {
+        const struct ovsdb_table_schema *ts = table->schema;
+        size_t i;
+
         hmap_insert(&table->rows, &row->hmap_node, uuid_hash(uuid));
+        for (i = 0; i < ovsdb_table_schema_n_all_indexes(ts); i++) {
+            hmap_insert(&table->indexes[i], ovsdb_row_get_index_node(row, i),
+                        ovsdb_row_hash_columns(row, &ts->indexes[i], 0));
+        }
+        ovsdb_table_ordered_index_insert(table, row);
     }
 }
 
@@ -1266,7 +1285,7 @@ do_execute(int argc OVS_UNUSED, char *argv[])
         char *s;
 
         params = parse_json(argv[i]);
-        result = ovsdb_execute(db, NULL, params, 0, NULL);
+        result = ovsdb_execute(db, NULL, params, 0, NULL, NULL);
         s = json_to_string(result, JSSF_SORT);
         printf("%s\n", s);
         free(s);
@@ -1673,6 +1692,35 @@ print_idl(struct ovsdb_idl *idl, int step)
     }
 }
 
+/* Prints the rows of the "simple" table that changed since the last call, then
+ * forgets the changes. */
+static void
+print_idl_track(struct ovsdb_idl *idl, int step)
+{
+    const struct idltest_simple *s;
+
+    IDLTEST_SIMPLE_FOR_EACH_TRACKED (s, idl) {
+        if (idltest_simple_is_deleted(s)) {
+            printf("%03d: deleted uuid="UUID_FMT"\n",
+                   step, UUID_ARGS(&s->header_.uuid));
+        } else if (idltest_simple_is_new(s)) {
+            printf("%03d: inserted i=%"PRId64" uuid="UUID_FMT"\n",
+                   step, s->i, UUID_ARGS(&s->header_.uuid));
+        } else {
+            printf("%03d: updated i=%"PRId64" %s%s%suuid="UUID_FMT"\n",
+                   step, s->i,
+                   idltest_simple_is_updated(s, IDLTEST_SIMPLE_COL_I)
+                   ? "column i, " : "",
+                   idltest_simple_is_updated(s, IDLTEST_SIMPLE_COL_R)
+                   ? "column r, " : "",
+                   idltest_simple_is_updated(s, IDLTEST_SIMPLE_COL_S)
+                   ? "column s, " : "",
+                   UUID_ARGS(&s->header_.uuid));
+        }
+    }
+    ovsdb_idl_track_clear(idl);
+}
+
 static void
 parse_uuids(const struct json *json, struct ovsdb_symbol_table *symtab,
             size_t *n)
@@ -1875,7 +1923,7 @@ idl_set(struct ovsdb_idl *idl, char *commands, int step)
 }
 
 static void
-do_idl(int argc, char *argv[])
+do_idl__(int argc, char *argv[], bool track)
 {
     struct jsonrpc *rpc;
     struct ovsdb_idl *idl;
@@ -1889,6 +1937,9 @@ do_idl(int argc, char *argv[])
     idltest_init();
 
     idl = ovsdb_idl_create(argv[1], &idltest_idl_class, true, true);
+    if (track) {
+        ovsdb_idl_track_add_all(idl);
+    }
     if (argc > 2) {
         struct stream *stream;
 
@@ -1927,7 +1978,11 @@ do_idl(int argc, char *argv[])
             }
 
             /* Print update. */
-            print_idl(idl, step++);
+            if (track) {
+                print_idl_track(idl, step++);
+            } else {
+                print_idl(idl, step++);
+            }
         }
         seqno = ovsdb_idl_get_seqno(idl);
 
@@ -1966,11 +2021,27 @@ do_idl(int argc, char *argv[])
         ovsdb_idl_wait(idl);
         poll_block();
     }
-    print_idl(idl, step++);
+    if (track) {
+        print_idl_track(idl, step++);
+    } else {
+        print_idl(idl, step++);
+    }
     ovsdb_idl_destroy(idl);
     printf("%03d: done\n", step);
 }
 
+static void
+do_idl(int argc, char *argv[])
+{
+    do_idl__(argc, argv, false);
+}
+
+static void
+do_idl_track(int argc, char *argv[])
+{
+    do_idl__(argc, argv, true);
+}
+
 static struct command all_commands[] = {
     { "log-io", 2, INT_MAX, do_log_io },
     { "default-atoms", 0, 0, do_default_atoms },
@@ -1998,6 +2069,7 @@ static struct command all_commands[] = {
     { "execute", 2, INT_MAX, do_execute },
     { "trigger", 2, INT_MAX, do_trigger },
     { "idl", 1, INT_MAX, do_idl },
+    { "idl-track", 1, INT_MAX, do_idl_track },
     { "help", 0, INT_MAX, do_help },
     { NULL, 0, 0, NULL },
 };
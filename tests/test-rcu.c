@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2013 Nicira, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include "ovs-rcu.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <time.h>
+#include "ovs-atomic.h"
+#include "ovs-thread.h"
+#include "timeval.h"
+#include "util.h"
+
+#define OBJECT_MAGIC 0x5eadbeef
+
+struct object {
+    unsigned int magic;
+};
+
+static atomic_uint n_called = ATOMIC_VAR_INIT(0);
+
+static void
+count_call(struct object *object OVS_UNUSED)
+{
+    unsigned int orig;
+
+    atomic_add(&n_called, 1, &orig);
+}
+
+static unsigned int
+get_n_called(void)
+{
+    unsigned int n;
+
+    atomic_read(&n_called, &n);
+    return n;
+}
+
+static void
+poison_and_free(struct object *object)
+{
+    ovs_assert(object->magic == OBJECT_MAGIC);
+    object->magic = 0;
+    free(object);
+    count_call(NULL);
+}
+
+static void
+sleep_msec(int msec)
+{
+    struct timespec delay;
+
+    delay.tv_sec = msec / 1000;
+    delay.tv_nsec = (msec % 1000) * 1000 * 1000;
+    while (nanosleep(&delay, &delay) && errno == EINTR) {
+        continue;
+    }
+}
+
+/* Quiesces repeatedly until 'n' postponed callbacks have run in total,
+ * aborting if that takes more than 10 seconds. */
+static void
+wait_for_calls(unsigned int n)
+{
+    long long int deadline = time_msec() + 10000;
+
+    while (get_n_called() < n) {
+        ovs_assert(time_msec() < deadline);
+        ovsrcu_quiesce();
+        sleep_msec(1);
+    }
+}
+
+/* While the process is single-threaded, postponed callbacks run as soon as
+ * the thread quiesces, and not before. */
+static void
+test_single_threaded(void)
+{
+    struct object dummy;
+    int i;
+
+    ovs_assert(single_threaded());
+
+    ovsrcu_postpone(count_call, &dummy);
+    ovs_assert(get_n_called() == 0);
+    ovsrcu_quiesce();
+    ovs_assert(get_n_called() == 1);
+
+    /* More callbacks than fit in a single batch. */
+    for (i = 0; i < 40; i++) {
+        ovsrcu_postpone(count_call, &dummy);
+    }
+    ovs_assert(get_n_called() == 1);
+    ovsrcu_quiesce_start();
+    ovs_assert(get_n_called() == 41);
+    ovsrcu_quiesce_end();
+
+    ovsrcu_synchronize();
+    atomic_store(&n_called, 0);
+}
+
+static OVSRCU_TYPE(struct object *) global_object;
+static atomic_bool stop = ATOMIC_VAR_INIT(false);
+
+static struct object *
+new_object(void)
+{
+    struct object *object = xmalloc(sizeof *object);
+
+    object->magic = OBJECT_MAGIC;
+    return object;
+}
+
+static void *
+reader_main(void *aux OVS_UNUSED)
+{
+    for (;;) {
+        struct object *object;
+        bool done;
+        int i;
+
+        atomic_read(&stop, &done);
+        if (done) {
+            break;
+        }
+
+        /* Between quiescent states, the object must stay intact. */
+        object = ovsrcu_get(struct object *, &global_object);
+        for (i = 0; i < 100; i++) {
+            ovs_assert(object->magic == OBJECT_MAGIC);
+        }
+        ovsrcu_quiesce();
+    }
+    return NULL;
+}
+
+/* Readers must never see an object freed by the writer, and the writer's
+ * postponed callbacks must all eventually run. */
+static void
+test_multithreaded(void)
+{
+    enum { N_READERS = 4 };
+    enum { N_UPDATES = 10000 };
+    pthread_t threads[N_READERS];
+    int i;
+
+    ovsrcu_init(&global_object, new_object());
+    for (i = 0; i < N_READERS; i++) {
+        xpthread_create(&threads[i], NULL, reader_main, NULL);
+    }
+
+    for (i = 0; i < N_UPDATES; i++) {
+        struct object *old;
+
+        old = ovsrcu_get_protected(struct object *, &global_object);
+        ovsrcu_set(&global_object, new_object());
+        ovsrcu_postpone(poison_and_free, old);
+        if (i % 100 == 0) {
+            ovsrcu_quiesce();
+        }
+    }
+
+    atomic_store(&stop, true);
+    for (i = 0; i < N_READERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    wait_for_calls(N_UPDATES);
+
+    free(ovsrcu_get_protected(struct object *, &global_object));
+    atomic_store(&n_called, 0);
+}
+
+static atomic_bool blocker_release = ATOMIC_VAR_INIT(false);
+static atomic_bool blocker_started = ATOMIC_VAR_INIT(false);
+
+static void *
+blocker_main(void *aux OVS_UNUSED)
+{
+    bool release;
+
+    atomic_store(&blocker_started, true);
+    do {
+        sleep_msec(1);
+        atomic_read(&blocker_release, &release);
+    } while (!release);
+    ovsrcu_quiesce_start();
+
+    return NULL;
+}
+
+/* A callback must not run while some thread that was active when it was
+ * postponed has not yet quiesced. */
+static void
+test_grace_period(void)
+{
+    struct object dummy;
+    pthread_t thread;
+    bool started;
+
+    xpthread_create(&thread, NULL, blocker_main, NULL);
+    do {
+        sleep_msec(1);
+        atomic_read(&blocker_started, &started);
+    } while (!started);
+
+    ovsrcu_postpone(count_call, &dummy);
+    ovsrcu_quiesce();
+    sleep_msec(100);
+    ovs_assert(get_n_called() == 0);
+
+    atomic_store(&blocker_release, true);
+    wait_for_calls(1);
+    pthread_join(thread, NULL);
+}
+
+int
+main(void)
+{
+    test_single_threaded();
+    test_multithreaded();
+    test_grace_period();
+    return 0;
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2013 Nicira, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* A test for the functions and macros declared in skiplist.h. */
+
+#include <config.h>
+#include "skiplist.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "random.h"
+#include "util.h"
+
+#undef NDEBUG
+#include <assert.h>
+
+static int
+compare_ints(const void *a_, const void *b_, const void *aux OVS_UNUSED)
+{
+    const int *a = a_;
+    const int *b = b_;
+
+    return *a < *b ? -1 : *a > *b;
+}
+
+/* Compares the element 'a_' against the integer key 'b_', ignoring the last
+ * digit of the element, to test lower bounds with a comparator that is
+ * coarser than the skiplist's own. */
+static int
+compare_int_tens(const void *a_, const void *b_, const void *aux OVS_UNUSED)
+{
+    const int *a = a_;
+    const int *b = b_;
+    int a_tens = *a / 10;
+
+    return a_tens < *b ? -1 : a_tens > *b;
+}
+
+static int
+compare_ints_qsort(const void *a, const void *b)
+{
+    return compare_ints(a, b, NULL);
+}
+
+/* Verifies that 'sl' contains exactly the 'n' values in 'values' (which need
+ * not be sorted and is sorted in place). */
+static void
+check_skiplist(const struct skiplist *sl, int values[], size_t n)
+{
+    struct skiplist_node *node;
+    const int *value;
+    size_t i;
+
+    assert(skiplist_count(sl) == n);
+
+    qsort(values, n, sizeof *values, compare_ints_qsort);
+    i = 0;
+    SKIPLIST_FOR_EACH (value, node, sl) {
+        assert(i < n);
+        assert(*value == values[i]);
+        assert(skiplist_find(sl, &values[i]) == value);
+        i++;
+    }
+    assert(i == n);
+
+    /* Check lower bounds on a few keys, including some with no match. */
+    for (i = 0; i < 20; i++) {
+        int key = i * 5;
+        size_t j;
+
+        for (j = 0; j < n && values[j] / 10 < key; j++) {
+            continue;
+        }
+        node = skiplist_lower_bound(sl, &key, compare_int_tens);
+        if (j < n) {
+            assert(node && *(int *) skiplist_node_data(node) == values[j]);
+        } else {
+            assert(!node);
+        }
+    }
+}
+
+static void
+shuffle(int *p, size_t n)
+{
+    for (; n > 1; n--, p++) {
+        int *q = &p[random_range(n)];
+        int tmp = *p;
+        *p = *q;
+        *q = tmp;
+    }
+}
+
+/* Inserts values in random order, deleting them again in a different random
+ * order, checking the skiplist after each step. */
+static void
+test_insert_delete(void)
+{
+    enum { N = 64 };
+    int elements[N];            /* The data stored in the skiplist. */
+    int order[N];               /* Order in which to delete 'elements'. */
+    int values[N];              /* Copies of what should be in the list. */
+    struct skiplist *sl;
+    size_t i;
+
+    for (i = 0; i < N; i++) {
+        elements[i] = i * 3;
+    }
+    shuffle(elements, N);
+
+    sl = skiplist_create(compare_ints, NULL);
+    for (i = 0; i < N; i++) {
+        skiplist_insert(sl, &elements[i]);
+        memcpy(values, elements, (i + 1) * sizeof *values);
+        check_skiplist(sl, values, i + 1);
+    }
+
+    memcpy(order, elements, sizeof order);
+    shuffle(order, N);
+    for (i = 0; i < N; i++) {
+        int missing = order[i] + 1;
+
+        /* Delete by value, through a pointer other than the one inserted. */
+        assert(!skiplist_delete(sl, &missing));
+        assert(skiplist_delete(sl, &order[i]));
+        assert(!skiplist_find(sl, &order[i]));
+        memcpy(values, &order[i + 1], (N - i - 1) * sizeof *values);
+        check_skiplist(sl, values, N - i - 1);
+    }
+    skiplist_destroy(sl);
+}
+
+/* Exercises a larger skiplist with interleaved insertions and deletions. */
+static void
+test_random(void)
+{
+    enum { N = 10000 };
+    int *elements = xmalloc(N * sizeof *elements);
+    bool *present = xzalloc(N * sizeof *present);
+    int *values = xmalloc(N * sizeof *values);
+    struct skiplist *sl;
+    size_t n, i;
+
+    for (i = 0; i < N; i++) {
+        elements[i] = i;
+    }
+
+    sl = skiplist_create(compare_ints, NULL);
+    for (i = 0; i < 4 * N; i++) {
+        int j = random_range(N);
+
+        if (present[j]) {
+            assert(skiplist_delete(sl, &elements[j]));
+        } else {
+            skiplist_insert(sl, &elements[j]);
+        }
+        present[j] = !present[j];
+    }
+
+    n = 0;
+    for (i = 0; i < N; i++) {
+        if (present[i]) {
+            values[n++] = elements[i];
+        }
+    }
+    check_skiplist(sl, values, n);
+    skiplist_destroy(sl);
+
+    free(elements);
+    free(present);
+    free(values);
+}
+
+static void
+run_test(void (*function)(void))
+{
+    function();
+    putchar('.');
+    fflush(stdout);
+}
+
+int
+main(void)
+{
+    run_test(test_insert_delete);
+    run_test(test_random);
+    putchar('\n');
+    return 0;
+}
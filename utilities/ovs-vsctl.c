@@ -2673,7 +2673,7 @@ get_row_by_id(struct vsctl_context *ctx, const struct vsctl_table_class *table,
 
             name = ovsdb_idl_get(row, id->name_column,
                                  OVSDB_TYPE_STRING, OVSDB_TYPE_VOID);
-            if (name->n == 1 && !strcmp(name->keys[0].string, record_id)) {
+            if (name->n == 1 && !strcmp(name->keys[0].s->string, record_id)) {
                 if (referrer) {
                     vsctl_fatal("multiple rows in %s match \"%s\"",
                                 table->class->name, record_id);
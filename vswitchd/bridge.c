@@ -104,6 +104,7 @@ struct mirror {
 
 struct port {
     struct hmap_node hmap_node; /* Element in struct bridge's "ports" hmap. */
+    struct hmap_node cfg_node;  /* Element in 'ports_by_cfg'. */
     struct bridge *bridge;
     char *name;
 
@@ -112,6 +113,24 @@ struct port {
     /* An ordinary bridge port has 1 interface.
      * A bridge port for bonding has at least 2 interfaces. */
     struct list ifaces;         /* List of "struct iface"s. */
+
+    /* In struct bridge's 'changed_ports' if the port is new or its
+     * configuration changed, so that bridge_reconfigure_continue() must
+     * configure it, otherwise list_is_empty(). */
+    struct list changed_node;
+};
+
+/* Bridge-wide configuration that bridge_reconfigure_continue() must redo, as
+ * bits in struct bridge's 'need_reconfigure'.  Changes to ports only affect
+ * the first few.  The rest depend only on the Bridge record and the tables
+ * that it references, so only a full reconfiguration redoes them. */
+enum {
+    BR_RECONF_DATAPATH_ID = 1 << 0, /* Ports' MACs pick the bridge's MAC. */
+    BR_RECONF_STP = 1 << 1,         /* Per-port STP settings. */
+    BR_RECONF_MIRRORS = 1 << 2,     /* Mirrors select and output to ports. */
+    BR_RECONF_REMOTES = 1 << 3,     /* In-band control uses the local port. */
+    BR_RECONF_OTHER = 1 << 4,       /* NetFlow, sFlow, tables, etc. */
+    BR_RECONF_ALL = (1 << 5) - 1
 };
 
 struct bridge {
@@ -134,9 +153,21 @@ struct bridge {
     struct hmap if_cfg_todo;    /* "struct if_cfg"s slated for creation.
                                    Indexed on 'cfg->name'. */
 
+    struct hmap if_cfg_failed;  /* "struct if_cfg"s that could not be
+                                   created, to retry on the next
+                                   reconfiguration.  Indexed on
+                                   'cfg->name'. */
+
     /* Port mirroring. */
     struct hmap mirrors;        /* "struct mirror" indexed by UUID. */
 
+    /* Incremental reconfiguration (see 'reconfigure_all'). */
+    unsigned int need_reconfigure; /* BR_RECONF_* bits. */
+    struct list changed_ports;  /* "struct port"s to configure. */
+    struct sset changed_ifaces; /* Names of interfaces, and of their ports,
+                                 * to check against 'ofproto'. */
+    struct port *ea_port;       /* Port whose MAC is 'ea', if any. */
+
     /* Synthetic local port if necessary. */
     struct ovsrec_port synth_local_port;
     struct ovsrec_interface synth_local_iface;
@@ -146,6 +177,10 @@ struct bridge {
 /* All bridges, indexed by name. */
 static struct hmap all_bridges = HMAP_INITIALIZER(&all_bridges);
 
+/* All ports in all bridges, indexed by their 'cfg' pointers, so that ports
+ * can be found from their Port records even after the records are deleted. */
+static struct hmap ports_by_cfg = HMAP_INITIALIZER(&ports_by_cfg);
+
 /* OVSDB IDL used to obtain configuration. */
 static struct ovsdb_idl *idl;
 
@@ -185,6 +220,18 @@ static long long int iface_stats_timer = LLONG_MIN;
 #define OFP_PORT_ACTION_WINDOW 10
 static bool reconfiguring = false;
 
+/* Most database changes only add, remove, or modify a few ports and
+ * interfaces.  bridge_reconfigure() uses the IDL's change tracking to find out
+ * which, and then only adds, removes, and refreshes those ports and
+ * interfaces.  bridge_reconfigure_continue() then configures only the ports
+ * in each bridge's 'changed_ports' and the bridge-wide settings in its
+ * 'need_reconfigure'.  Any other kind of change sets 'reconfigure_all', which
+ * makes both functions handle every bridge and port from scratch. */
+static bool reconfigure_all = true;
+
+static bool bridge_changes_are_incremental(void);
+static void bridge_add_del_changed_ports(void);
+static void bridge_refresh_changed_ofp_ports(struct bridge *);
 static void add_del_bridges(const struct ovsrec_open_vswitch *);
 static void bridge_update_ofprotos(void);
 static void bridge_create(const struct ovsrec_bridge *);
@@ -212,13 +259,21 @@ static void bridge_configure_remotes(struct bridge *,
                                      size_t n_managers);
 static void bridge_pick_local_hw_addr(struct bridge *,
                                       uint8_t ea[ETH_ADDR_LEN],
-                                      struct iface **hw_addr_iface);
+                                      struct iface **hw_addr_iface,
+                                      struct port **hw_addr_port);
+static bool bridge_changed_ports_affect_hw_addr(const struct bridge *);
 static uint64_t bridge_pick_datapath_id(struct bridge *,
                                         const uint8_t bridge_ea[ETH_ADDR_LEN],
                                         struct iface *hw_addr_iface);
 static void bridge_queue_if_cfg(struct bridge *,
                                 const struct ovsrec_interface *,
                                 const struct ovsrec_port *);
+static void bridge_queue_port_ifaces(struct bridge *,
+                                     const struct ovsrec_port *);
+static bool bridge_port_is_mirrored(const struct bridge *,
+                                    const struct port *);
+static void bridge_note_port_change(struct bridge *, const struct port *,
+                                    bool stp);
 static uint64_t dpid_from_hash(const void *, size_t nbytes);
 static bool bridge_has_bond_fake_iface(const struct bridge *,
                                        const char *name);
@@ -230,6 +285,10 @@ static struct port *port_create(struct bridge *, const struct ovsrec_port *);
 static void port_del_ifaces(struct port *);
 static void port_destroy(struct port *);
 static struct port *port_lookup(const struct bridge *, const char *name);
+static struct port *port_find_by_cfg(const struct ovsrec_port *);
+static void port_set_cfg(struct port *, const struct ovsrec_port *);
+static void port_mark_changed(struct port *, bool stp);
+static void port_note_ifaces_changed(const struct port *);
 static void port_configure(struct port *);
 static struct lacp_settings *port_configure_lacp(struct port *,
                                                  struct lacp_settings *);
@@ -407,6 +466,8 @@ bridge_init(const char *remote)
 
     ovsdb_idl_omit(idl, &ovsrec_ssl_col_external_ids);
 
+    ovsdb_idl_track_add_all(idl);
+
     /* Register unixctl commands. */
     unixctl_command_register("qos/show", "interface", 1, 1,
                              qos_unixctl_show, NULL);
@@ -505,6 +566,8 @@ bridge_reconfigure(const struct ovsrec_open_vswitch *ovs_cfg)
     bridge_configure_flow_miss_model(smap_get(&ovs_cfg->other_config,
                                               "force-miss-model"));
 
+    reconfigure_all = !bridge_changes_are_incremental();
+
     /* Destroy "struct bridge"s, "struct port"s, and "struct iface"s according
      * to 'ovs_cfg' while update the "if_cfg_queue", with only very minimal
      * configuration otherwise.
@@ -512,11 +575,19 @@ bridge_reconfigure(const struct ovsrec_open_vswitch *ovs_cfg)
      * This is mostly an update to bridge data structures. Nothing is pushed
      * down to ofproto or lower layers. */
     add_del_bridges(ovs_cfg);
-    splinter_vlans = collect_splinter_vlans(ovs_cfg);
-    HMAP_FOR_EACH (br, node, &all_bridges) {
-        bridge_add_del_ports(br, splinter_vlans);
+    if (reconfigure_all) {
+        splinter_vlans = collect_splinter_vlans(ovs_cfg);
+        HMAP_FOR_EACH (br, node, &all_bridges) {
+            bridge_add_del_ports(br, splinter_vlans);
+        }
+        free(splinter_vlans);
+    } else {
+        bridge_add_del_changed_ports();
     }
-    free(splinter_vlans);
+
+    /* Deleted rows are freed here, so no "struct port" or "struct iface" may
+     * point to one any longer. */
+    ovsdb_idl_track_clear(idl);
 
     /* Delete datapaths that are no longer configured, and create ones which
      * don't exist but should. */
@@ -524,7 +595,11 @@ bridge_reconfigure(const struct ovsrec_open_vswitch *ovs_cfg)
 
     /* Make sure each "struct iface" has a correct ofp_port in its ofproto. */
     HMAP_FOR_EACH (br, node, &all_bridges) {
-        bridge_refresh_ofp_port(br);
+        if (reconfigure_all) {
+            bridge_refresh_ofp_port(br);
+        } else {
+            bridge_refresh_changed_ofp_ports(br);
+        }
     }
 
     /* Clear database records for "if_cfg"s which haven't been instantiated. */
@@ -587,6 +662,23 @@ bridge_reconfigure_ofp(void)
     return true;
 }
 
+/* Pushes the configuration of 'port' and its interfaces down to ofproto. */
+static void
+port_reconfigure(struct port *port)
+{
+    struct iface *iface;
+
+    port_configure(port);
+
+    LIST_FOR_EACH (iface, port_elem, &port->ifaces) {
+        iface_configure_cfm(iface);
+        iface_configure_qos(iface, port->cfg->qos);
+        iface_set_mac(iface);
+        ofproto_port_set_bfd(port->bridge->ofproto, iface->ofp_port,
+                             &iface->cfg->bfd);
+    }
+}
+
 static bool
 bridge_reconfigure_continue(const struct ovsrec_open_vswitch *ovs_cfg)
 {
@@ -603,41 +695,83 @@ bridge_reconfigure_continue(const struct ovsrec_open_vswitch *ovs_cfg)
     sflow_bridge_number = 0;
     collect_in_band_managers(ovs_cfg, &managers, &n_managers);
     HMAP_FOR_EACH (br, node, &all_bridges) {
-        struct port *port;
+        unsigned int need = (reconfigure_all ? BR_RECONF_ALL
+                             : br->need_reconfigure);
+        struct port *port, *next;
+
+        if (!reconfigure_all && bridge_changed_ports_affect_hw_addr(br)) {
+            need |= BR_RECONF_DATAPATH_ID;
+        }
 
         /* We need the datapath ID early to allow LACP ports to use it as the
          * default system ID. */
-        bridge_configure_datapath_id(br);
+        if (need & BR_RECONF_DATAPATH_ID) {
+            uint8_t old_ea[ETH_ADDR_LEN];
 
-        HMAP_FOR_EACH (port, hmap_node, &br->ports) {
-            struct iface *iface;
+            memcpy(old_ea, br->ea, ETH_ADDR_LEN);
+            bridge_configure_datapath_id(br);
+            if (!reconfigure_all && !eth_addr_equals(old_ea, br->ea)) {
+                /* LACP and STP default their system IDs to 'br->ea'. */
+                HMAP_FOR_EACH (port, hmap_node, &br->ports) {
+                    port_mark_changed(port, false);
+                }
+                need |= BR_RECONF_STP;
+            }
+        }
 
-            port_configure(port);
+        if (reconfigure_all) {
+            HMAP_FOR_EACH (port, hmap_node, &br->ports) {
+                port_reconfigure(port);
+            }
+        } else {
+            LIST_FOR_EACH (port, changed_node, &br->changed_ports) {
+                port_reconfigure(port);
+            }
+        }
 
-            LIST_FOR_EACH (iface, port_elem, &port->ifaces) {
-                iface_configure_cfm(iface);
-                iface_configure_qos(iface, port->cfg->qos);
-                iface_set_mac(iface);
-                ofproto_port_set_bfd(br->ofproto, iface->ofp_port,
-                                     &iface->cfg->bfd);
+        /* If we're not done, we'll be back to configure them again. */
+        if (done) {
+            LIST_FOR_EACH_SAFE (port, next, changed_node,
+                                &br->changed_ports) {
+                list_remove(&port->changed_node);
+                list_init(&port->changed_node);
             }
+            br->need_reconfigure = 0;
+        } else {
+            br->need_reconfigure = need;
         }
-        bridge_configure_mirrors(br);
-        bridge_configure_forward_bpdu(br);
-        bridge_configure_mac_table(br);
-        bridge_configure_remotes(br, managers, n_managers);
-        bridge_configure_netflow(br);
-        bridge_configure_sflow(br, &sflow_bridge_number);
-        bridge_configure_ipfix(br);
-        bridge_configure_stp(br);
-        bridge_configure_tables(br);
-        bridge_configure_dp_desc(br);
 
-        if (smap_get(&br->cfg->other_config, "flow-eviction-threshold")) {
-            /* XXX: Remove this warning message eventually. */
-            VLOG_WARN_ONCE("As of June 2013, flow-eviction-threshold has been"
-                           " moved to the Open_vSwitch table.  Ignoring its"
-                           " setting in the bridge table.");
+        if (need & BR_RECONF_MIRRORS) {
+            bridge_configure_mirrors(br);
+        }
+        if (need & BR_RECONF_OTHER) {
+            bridge_configure_forward_bpdu(br);
+            bridge_configure_mac_table(br);
+        }
+        if (need & BR_RECONF_REMOTES) {
+            bridge_configure_remotes(br, managers, n_managers);
+        }
+        if (need & BR_RECONF_OTHER) {
+            bridge_configure_netflow(br);
+            bridge_configure_sflow(br, &sflow_bridge_number);
+            bridge_configure_ipfix(br);
+        } else if (br->cfg->sflow) {
+            /* Keep the sFlow sub-IDs of the bridges after this one. */
+            sflow_bridge_number++;
+        }
+        if (need & BR_RECONF_STP) {
+            bridge_configure_stp(br);
+        }
+        if (need & BR_RECONF_OTHER) {
+            bridge_configure_tables(br);
+            bridge_configure_dp_desc(br);
+
+            if (smap_get(&br->cfg->other_config, "flow-eviction-threshold")) {
+                /* XXX: Remove this warning message eventually. */
+                VLOG_WARN_ONCE("As of June 2013, flow-eviction-threshold has "
+                               "been moved to the Open_vSwitch table.  "
+                               "Ignoring its setting in the bridge table.");
+            }
         }
     }
     free(managers);
@@ -836,7 +970,7 @@ bridge_configure_datapath_id(struct bridge *br)
     struct iface *hw_addr_iface;
     char *dpid_string;
 
-    bridge_pick_local_hw_addr(br, ea, &hw_addr_iface);
+    bridge_pick_local_hw_addr(br, ea, &hw_addr_iface, &br->ea_port);
     local_iface = iface_from_ofp_port(br, OFPP_LOCAL);
     if (local_iface) {
         int error = netdev_set_etheraddr(local_iface->netdev, ea);
@@ -1254,6 +1388,222 @@ port_is_bond_fake_iface(const struct port *port)
     return port->cfg->bond_fake_iface && !list_is_short(&port->ifaces);
 }
 
+/* Returns true if bridge_reconfigure() can apply the database changes that
+ * the IDL tracked since the last reconfiguration incrementally, with
+ * bridge_add_del_changed_ports() and bridge_refresh_changed_ofp_ports().
+ * That is the case if nothing changed except for Port and Interface records,
+ * the set of ports in at most one bridge, and the Open_vSwitch record's
+ * "next_cfg" column, which ovs-vsctl increments with every change, and if
+ * each changed record can be matched up with the bridge it belongs to.  Any
+ * other change might affect every bridge or port.
+ *
+ * This function only looks at the changes.  It must not modify anything,
+ * because bridge_reconfigure() falls back to a full reconfiguration if it
+ * returns false. */
+static bool
+bridge_changes_are_incremental(void)
+{
+    const struct ovsrec_open_vswitch *ovs_cfg;
+    const struct ovsrec_interface *iface_cfg;
+    const struct ovsrec_port *port_cfg;
+    const struct ovsrec_bridge *br_cfg;
+    struct bridge *ports_br = NULL;
+    size_t i;
+
+    /* The ports synthesized for VLAN splinters are only ever rebuilt
+     * wholesale. */
+    if (vlan_splinters_enabled_anywhere) {
+        return false;
+    }
+
+    for (i = 0; i < OVSREC_N_TABLES; i++) {
+        if (i != OVSREC_TABLE_OPEN_VSWITCH && i != OVSREC_TABLE_BRIDGE
+            && i != OVSREC_TABLE_PORT && i != OVSREC_TABLE_INTERFACE
+            && ovsdb_idl_track_get_first(idl, &ovsrec_table_classes[i])) {
+            return false;
+        }
+    }
+
+    OVSREC_OPEN_VSWITCH_FOR_EACH_TRACKED (ovs_cfg, idl) {
+        enum ovsrec_open_vswitch_column_id column;
+
+        if (ovsrec_open_vswitch_is_new(ovs_cfg)
+            || ovsrec_open_vswitch_is_deleted(ovs_cfg)) {
+            return false;
+        }
+        for (column = 0; column < OVSREC_OPEN_VSWITCH_N_COLUMNS; column++) {
+            if (column != OVSREC_OPEN_VSWITCH_COL_NEXT_CFG
+                && ovsrec_open_vswitch_is_updated(ovs_cfg, column)) {
+                return false;
+            }
+        }
+    }
+
+    OVSREC_BRIDGE_FOR_EACH_TRACKED (br_cfg, idl) {
+        enum ovsrec_bridge_column_id column;
+
+        if (ovsrec_bridge_is_new(br_cfg) || ovsrec_bridge_is_deleted(br_cfg)) {
+            return false;
+        }
+        for (column = 0; column < OVSREC_BRIDGE_N_COLUMNS; column++) {
+            if (column != OVSREC_BRIDGE_COL_PORTS
+                && ovsrec_bridge_is_updated(br_cfg, column)) {
+                return false;
+            }
+        }
+        if (ovsrec_bridge_is_updated(br_cfg, OVSREC_BRIDGE_COL_PORTS)) {
+            /* With more than one such bridge, a port might have moved from
+             * one to another. */
+            if (ports_br) {
+                return false;
+            }
+            ports_br = bridge_lookup(br_cfg->name);
+            if (!ports_br || ports_br->cfg != br_cfg) {
+                return false;
+            }
+        }
+    }
+
+    OVSREC_PORT_FOR_EACH_TRACKED (port_cfg, idl) {
+        if (ovsrec_port_is_deleted(port_cfg)) {
+            continue;
+        } else if (ovsrec_port_is_new(port_cfg)) {
+            struct port *port;
+
+            /* A new port belongs to the bridge whose ports changed.  A port
+             * named after the bridge might replace a synthesized one, and a
+             * port whose name is still in use is a duplicate. */
+            if (!ports_br || !strcmp(port_cfg->name, ports_br->name)) {
+                return false;
+            }
+            port = port_lookup(ports_br, port_cfg->name);
+            if (port && !ovsrec_port_is_deleted(port->cfg)) {
+                return false;
+            }
+        } else if (!port_find_by_cfg(port_cfg)) {
+            /* None of the port's interfaces could be created so far. */
+            return false;
+        }
+    }
+
+    OVSREC_INTERFACE_FOR_EACH_TRACKED (iface_cfg, idl) {
+        struct iface *iface;
+
+        if (ovsrec_interface_is_deleted(iface_cfg)) {
+            continue;
+        } else if (vlan_splinters_is_enabled(iface_cfg)) {
+            return false;
+        } else if (ovsrec_interface_is_new(iface_cfg)) {
+            /* Its Port record changed too, which takes care of it. */
+            continue;
+        }
+
+        iface = iface_find(iface_cfg->name);
+        if (!iface || iface->cfg != iface_cfg) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Incremental counterpart to bridge_add_del_ports(), for use when
+ * bridge_changes_are_incremental() returns true.  Destroys the "struct port"s
+ * and "struct iface"s whose records were deleted, updates the ones whose
+ * records changed, and queues the interfaces of new ports, and of ports that
+ * failed to be created earlier, for creation.  Records the names of all of
+ * these in their bridge's 'changed_ifaces', for
+ * bridge_refresh_changed_ofp_ports(). */
+static void
+bridge_add_del_changed_ports(void)
+{
+    const struct ovsrec_interface *iface_cfg;
+    const struct ovsrec_port *port_cfg;
+    const struct ovsrec_bridge *br_cfg;
+    struct bridge *ports_br = NULL;
+    struct bridge *br;
+
+    OVSREC_BRIDGE_FOR_EACH_TRACKED (br_cfg, idl) {
+        if (ovsrec_bridge_is_updated(br_cfg, OVSREC_BRIDGE_COL_PORTS)) {
+            ports_br = bridge_lookup(br_cfg->name);
+        }
+    }
+
+    /* Get rid of deleted ports. */
+    OVSREC_PORT_FOR_EACH_TRACKED (port_cfg, idl) {
+        if (ovsrec_port_is_deleted(port_cfg)) {
+            struct port *port = port_find_by_cfg(port_cfg);
+
+            if (port) {
+                port_note_ifaces_changed(port);
+                port_destroy(port);
+            }
+        }
+    }
+
+    /* Retry the interfaces that could not be created last time, as
+     * bridge_add_del_ports() would, unless they have since been deleted. */
+    HMAP_FOR_EACH (br, node, &all_bridges) {
+        struct if_cfg *if_cfg, *next;
+
+        ovs_assert(hmap_is_empty(&br->if_cfg_todo));
+        HMAP_FOR_EACH_SAFE (if_cfg, next, hmap_node, &br->if_cfg_failed) {
+            hmap_remove(&br->if_cfg_failed, &if_cfg->hmap_node);
+            if (!ovsrec_interface_is_deleted(if_cfg->cfg)
+                && !ovsrec_port_is_deleted(if_cfg->parent)) {
+                bridge_queue_if_cfg(br, if_cfg->cfg, if_cfg->parent);
+                sset_add(&br->changed_ifaces, if_cfg->cfg->name);
+            }
+            free(if_cfg);
+        }
+    }
+
+    /* Get rid of deleted interfaces on changed ports and queue the new
+     * interfaces on changed and new ports for creation. */
+    OVSREC_PORT_FOR_EACH_TRACKED (port_cfg, idl) {
+        if (ovsrec_port_is_deleted(port_cfg)) {
+            continue;
+        } else if (ovsrec_port_is_new(port_cfg)) {
+            br = ports_br;
+        } else {
+            struct port *port = port_find_by_cfg(port_cfg);
+            bool stp;
+
+            br = port->bridge;
+            stp = (ovsrec_port_is_updated(port_cfg,
+                                          OVSREC_PORT_COL_OTHER_CONFIG)
+                   || ovsrec_port_is_updated(port_cfg,
+                                             OVSREC_PORT_COL_INTERFACES));
+            port_mark_changed(port, stp);
+            port_note_ifaces_changed(port);
+            port_del_ifaces(port);
+        }
+        bridge_queue_port_ifaces(br, port_cfg);
+    }
+
+    /* Update the interfaces whose records changed. */
+    OVSREC_INTERFACE_FOR_EACH_TRACKED (iface_cfg, idl) {
+        struct iface *iface;
+
+        if (ovsrec_interface_is_deleted(iface_cfg)
+            || ovsrec_interface_is_new(iface_cfg)) {
+            continue;
+        }
+
+        /* The interface might just have been destroyed above, if it moved
+         * from one port to another. */
+        iface = iface_find(iface_cfg->name);
+        if (iface && iface->cfg == iface_cfg) {
+            br = iface->port->bridge;
+            iface->type = iface_get_type(iface_cfg, br->cfg);
+            sset_add(&br->changed_ifaces, iface->name);
+            port_mark_changed(iface->port,
+                              ovsrec_interface_is_updated(
+                                  iface_cfg, OVSREC_INTERFACE_COL_TYPE));
+        }
+    }
+}
+
 static void
 add_del_bridges(const struct ovsrec_open_vswitch *cfg)
 {
@@ -1395,6 +1745,9 @@ bridge_refresh_ofp_port(struct bridge *br)
     struct ofproto_port ofproto_port;
     struct port *port, *port_next;
 
+    /* Every port and interface is refreshed, changed or not. */
+    sset_clear(&br->changed_ifaces);
+
     /* Clear each "struct iface"s ofp_port so we can get its correct value. */
     hmap_clear(&br->ifaces);
     HMAP_FOR_EACH (port, hmap_node, &br->ports) {
@@ -1435,6 +1788,62 @@ bridge_refresh_ofp_port(struct bridge *br)
     }
 }
 
+/* Incremental counterpart to bridge_refresh_ofp_port(), for use after
+ * bridge_add_del_changed_ports().  Does the same for just the ports and
+ * interfaces named in 'br->changed_ifaces', then clears it. */
+static void
+bridge_refresh_changed_ofp_ports(struct bridge *br)
+{
+    const char *name;
+
+    SSET_FOR_EACH (name, &br->changed_ifaces) {
+        struct ofproto_port ofproto_port;
+        struct iface *iface;
+
+        /* Clear the "struct iface"'s ofp_port so we can get its correct
+         * value. */
+        iface = iface_lookup(br, name);
+        if (iface && iface->ofp_port != OFPP_NONE) {
+            hmap_remove(&br->ifaces, &iface->ofp_port_node);
+            iface->ofp_port = OFPP_NONE;
+        }
+
+        /* Obtain the correct "ofp_port" from ofproto, as
+         * bridge_refresh_ofp_port() does. */
+        if (!ofproto_port_query_by_name(br->ofproto, name, &ofproto_port)) {
+            if (!bridge_refresh_one_ofp_port(br, &ofproto_port)) {
+                struct ofpp_garbage *garbage = xmalloc(sizeof *garbage);
+                garbage->ofp_port = ofproto_port.ofp_port;
+                list_push_front(&br->ofpp_garbage, &garbage->list_node);
+            }
+            ofproto_port_destroy(&ofproto_port);
+        }
+
+        /* Demote the iface to an "if_cfg" if it has no "ofp_port". */
+        iface = iface_lookup(br, name);
+        if (iface && iface->ofp_port == OFPP_NONE) {
+            struct port *port = iface->port;
+
+            bridge_queue_if_cfg(br, iface->cfg, port->cfg);
+            iface_destroy(iface);
+            if (list_is_empty(&port->ifaces)) {
+                port_destroy(port);
+            }
+        }
+    }
+
+    /* Get rid of ports whose interfaces were all deleted. */
+    SSET_FOR_EACH (name, &br->changed_ifaces) {
+        struct port *port = port_lookup(br, name);
+
+        if (port && list_is_empty(&port->ifaces)) {
+            port_destroy(port);
+        }
+    }
+
+    sset_clear(&br->changed_ifaces);
+}
+
 /* Opens a network device for 'if_cfg' and configures it.  If '*ofp_portp'
  * is OFPP_NONE, adds the network device to br->ofproto and stores the OpenFlow
  * port number in '*ofp_portp'; otherwise leaves br->ofproto and '*ofp_portp'
@@ -1505,7 +1914,8 @@ error:
 /* Creates a new iface on 'br' based on 'if_cfg'.  The new iface has OpenFlow
  * port number 'ofp_port'.  If ofp_port is OFPP_NONE, an OpenFlow port is
  * automatically allocated for the iface.  Takes ownership of and
- * deallocates 'if_cfg'.
+ * deallocates 'if_cfg', or on failure moves it to 'br->if_cfg_failed' so that
+ * the next reconfiguration retries it.
  *
  * Return true if an iface is successfully created, false otherwise. */
 static bool
@@ -1541,6 +1951,7 @@ iface_create(struct bridge *br, struct if_cfg *if_cfg, ofp_port_t ofp_port)
     if (!port) {
         port = port_create(br, port_cfg);
     }
+    port_mark_changed(port, true);
 
     /* Create the iface structure. */
     iface = xzalloc(sizeof *iface);
@@ -1587,7 +1998,12 @@ iface_create(struct bridge *br, struct if_cfg *if_cfg, ofp_port_t ofp_port)
 
 done:
     hmap_remove(&br->if_cfg_todo, &if_cfg->hmap_node);
-    free(if_cfg);
+    if (ok) {
+        free(if_cfg);
+    } else {
+        hmap_insert(&br->if_cfg_failed, &if_cfg->hmap_node,
+                    hash_string(if_cfg->cfg->name, 0));
+    }
 
     return ok;
 }
@@ -1625,18 +2041,86 @@ bridge_configure_mac_table(struct bridge *br)
     ofproto_set_mac_table_config(br->ofproto, idle_time, mac_table_size);
 }
 
+/* Returns true if the user configured a valid MAC address for 'br', storing
+ * it in 'ea', false otherwise. */
+static bool
+bridge_get_configured_hw_addr(const struct bridge *br,
+                              uint8_t ea[ETH_ADDR_LEN])
+{
+    const char *hwaddr = smap_get(&br->cfg->other_config, "hwaddr");
+
+    return (hwaddr && eth_addr_from_string(hwaddr, ea)
+            && !eth_addr_is_multicast(ea) && !eth_addr_is_zero(ea));
+}
+
+/* Chooses the MAC address that represents 'port' when picking its bridge's
+ * MAC address.  If there is a usable one, stores it in 'ea', stores the
+ * interface that has it (or a null pointer if none of them does) in
+ * '*ifacep', and returns true.  Otherwise, returns false. */
+static bool
+port_get_hw_addr(const struct port *port, uint8_t ea[ETH_ADDR_LEN],
+                 struct iface **ifacep)
+{
+    struct iface *candidate;
+    struct iface *iface;
+
+    /* Choose the MAC address to represent the port. */
+    iface = NULL;
+    if (port->cfg->mac && eth_addr_from_string(port->cfg->mac, ea)) {
+        /* Find the interface with this Ethernet address (if any) so that
+         * we can provide the correct devname to the caller. */
+        LIST_FOR_EACH (candidate, port_elem, &port->ifaces) {
+            uint8_t candidate_ea[ETH_ADDR_LEN];
+            if (!netdev_get_etheraddr(candidate->netdev, candidate_ea)
+                && eth_addr_equals(ea, candidate_ea)) {
+                iface = candidate;
+            }
+        }
+    } else {
+        /* Choose the interface whose MAC address will represent the port.
+         * The Linux kernel bonding code always chooses the MAC address of
+         * the first slave added to a bond, and the Fedora networking
+         * scripts always add slaves to a bond in alphabetical order, so
+         * for compatibility we choose the interface with the name that is
+         * first in alphabetical order. */
+        LIST_FOR_EACH (candidate, port_elem, &port->ifaces) {
+            if (!iface || strcmp(candidate->name, iface->name) < 0) {
+                iface = candidate;
+            }
+        }
+
+        /* The local port doesn't count (since we're trying to choose its
+         * MAC address anyway). */
+        if (!iface || iface->ofp_port == OFPP_LOCAL) {
+            return false;
+        }
+
+        /* Grab MAC. */
+        if (netdev_get_etheraddr(iface->netdev, ea)) {
+            return false;
+        }
+    }
+
+    *ifacep = iface;
+    return (!eth_addr_is_multicast(ea) &&
+            !eth_addr_is_local(ea) &&
+            !eth_addr_is_reserved(ea) &&
+            !eth_addr_is_zero(ea));
+}
+
 static void
 bridge_pick_local_hw_addr(struct bridge *br, uint8_t ea[ETH_ADDR_LEN],
-                          struct iface **hw_addr_iface)
+                          struct iface **hw_addr_iface,
+                          struct port **hw_addr_port)
 {
     struct hmapx mirror_output_ports;
     const char *hwaddr;
     struct port *port;
     bool found_addr = false;
-    int error;
     int i;
 
     *hw_addr_iface = NULL;
+    *hw_addr_port = NULL;
 
     /* Did the user request a particular MAC? */
     hwaddr = smap_get(&br->cfg->other_config, "hwaddr");
@@ -1667,7 +2151,6 @@ bridge_pick_local_hw_addr(struct bridge *br, uint8_t ea[ETH_ADDR_LEN],
      * interfaces. */
     HMAP_FOR_EACH (port, hmap_node, &br->ports) {
         uint8_t iface_ea[ETH_ADDR_LEN];
-        struct iface *candidate;
         struct iface *iface;
 
         /* Mirror output ports don't participate. */
@@ -1675,53 +2158,12 @@ bridge_pick_local_hw_addr(struct bridge *br, uint8_t ea[ETH_ADDR_LEN],
             continue;
         }
 
-        /* Choose the MAC address to represent the port. */
-        iface = NULL;
-        if (port->cfg->mac && eth_addr_from_string(port->cfg->mac, iface_ea)) {
-            /* Find the interface with this Ethernet address (if any) so that
-             * we can provide the correct devname to the caller. */
-            LIST_FOR_EACH (candidate, port_elem, &port->ifaces) {
-                uint8_t candidate_ea[ETH_ADDR_LEN];
-                if (!netdev_get_etheraddr(candidate->netdev, candidate_ea)
-                    && eth_addr_equals(iface_ea, candidate_ea)) {
-                    iface = candidate;
-                }
-            }
-        } else {
-            /* Choose the interface whose MAC address will represent the port.
-             * The Linux kernel bonding code always chooses the MAC address of
-             * the first slave added to a bond, and the Fedora networking
-             * scripts always add slaves to a bond in alphabetical order, so
-             * for compatibility we choose the interface with the name that is
-             * first in alphabetical order. */
-            LIST_FOR_EACH (candidate, port_elem, &port->ifaces) {
-                if (!iface || strcmp(candidate->name, iface->name) < 0) {
-                    iface = candidate;
-                }
-            }
-
-            /* The local port doesn't count (since we're trying to choose its
-             * MAC address anyway). */
-            if (iface->ofp_port == OFPP_LOCAL) {
-                continue;
-            }
-
-            /* Grab MAC. */
-            error = netdev_get_etheraddr(iface->netdev, iface_ea);
-            if (error) {
-                continue;
-            }
-        }
-
         /* Compare against our current choice. */
-        if (!eth_addr_is_multicast(iface_ea) &&
-            !eth_addr_is_local(iface_ea) &&
-            !eth_addr_is_reserved(iface_ea) &&
-            !eth_addr_is_zero(iface_ea) &&
-            (!found_addr || eth_addr_compare_3way(iface_ea, ea) < 0))
-        {
+        if (port_get_hw_addr(port, iface_ea, &iface)
+            && (!found_addr || eth_addr_compare_3way(iface_ea, ea) < 0)) {
             memcpy(ea, iface_ea, ETH_ADDR_LEN);
             *hw_addr_iface = iface;
+            *hw_addr_port = port;
             found_addr = true;
         }
     }
@@ -1734,6 +2176,105 @@ bridge_pick_local_hw_addr(struct bridge *br, uint8_t ea[ETH_ADDR_LEN],
     hmapx_destroy(&mirror_output_ports);
 }
 
+/* Returns true if one of the ports in 'br''s 'changed_ports' might change the
+ * MAC address that bridge_pick_local_hw_addr() would pick for 'br', that is,
+ * if it provided the current address or if it has a lower one.  (A port that
+ * provided the current address and was destroyed already set
+ * BR_RECONF_DATAPATH_ID.) */
+static bool
+bridge_changed_ports_affect_hw_addr(const struct bridge *br)
+{
+    uint8_t ea[ETH_ADDR_LEN];
+    struct port *port;
+
+    if (list_is_empty(&br->changed_ports)
+        || bridge_get_configured_hw_addr(br, ea)) {
+        return false;
+    }
+
+    LIST_FOR_EACH (port, changed_node, &br->changed_ports) {
+        struct iface *iface;
+        size_t i;
+
+        if (port == br->ea_port) {
+            return true;
+        }
+
+        for (i = 0; i < br->cfg->n_mirrors; i++) {
+            if (br->cfg->mirrors[i]->output_port == port->cfg) {
+                break;
+            }
+        }
+        if (i < br->cfg->n_mirrors) {
+            /* Mirror output ports don't participate. */
+            continue;
+        }
+
+        if (port_get_hw_addr(port, ea, &iface)
+            && (!br->ea_port || eth_addr_compare_3way(ea, br->ea) < 0)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Returns true if one of 'br''s mirrors selects packets on 'port' or outputs
+ * them to it, so that adding, removing, or changing 'port' requires
+ * reconfiguring the mirrors. */
+static bool
+bridge_port_is_mirrored(const struct bridge *br, const struct port *port)
+{
+    size_t i, j;
+
+    for (i = 0; i < br->cfg->n_mirrors; i++) {
+        const struct ovsrec_mirror *m = br->cfg->mirrors[i];
+
+        if (m->select_all
+            || (m->output_port && !strcmp(m->output_port->name, port->name))) {
+            return true;
+        }
+        for (j = 0; j < m->n_select_src_port; j++) {
+            if (!strcmp(m->select_src_port[j]->name, port->name)) {
+                return true;
+            }
+        }
+        for (j = 0; j < m->n_select_dst_port; j++) {
+            if (!strcmp(m->select_dst_port[j]->name, port->name)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/* Sets the BR_RECONF_* bits in 'br->need_reconfigure' for the bridge-wide
+ * configuration that depends on 'port', which is being added, changed, or
+ * destroyed.  'stp' should be true if the change might affect the port's STP
+ * settings.  (A port's MAC address only matters to the datapath ID, which
+ * bridge_changed_ports_affect_hw_addr() checks later.) */
+static void
+bridge_note_port_change(struct bridge *br, const struct port *port, bool stp)
+{
+    if (reconfigure_all || !br->cfg) {
+        /* Everything gets reconfigured anyway. */
+        return;
+    }
+
+    if (stp && br->cfg->stp_enable) {
+        br->need_reconfigure |= BR_RECONF_STP;
+    }
+    if (!strcmp(port->name, br->name)) {
+        /* The local port: its MAC is the default datapath ID and in-band
+         * control depends on it. */
+        br->need_reconfigure |= BR_RECONF_DATAPATH_ID | BR_RECONF_REMOTES;
+    } else if (port == br->ea_port) {
+        br->need_reconfigure |= BR_RECONF_DATAPATH_ID;
+    }
+    if (bridge_port_is_mirrored(br, port)) {
+        br->need_reconfigure |= BR_RECONF_MIRRORS;
+    }
+}
+
 /* Choose and returns the datapath ID for bridge 'br' given that the bridge
  * Ethernet address is 'bridge_ea'.  If 'bridge_ea' is the Ethernet address of
  * an interface on 'br', then that interface must be passed in as
@@ -2652,7 +3193,11 @@ bridge_create(const struct ovsrec_bridge *br_cfg)
     hmap_init(&br->mirrors);
 
     hmap_init(&br->if_cfg_todo);
+    hmap_init(&br->if_cfg_failed);
     list_init(&br->ofpp_garbage);
+    br->need_reconfigure = BR_RECONF_ALL;
+    list_init(&br->changed_ports);
+    sset_init(&br->changed_ifaces);
 
     hmap_insert(&all_bridges, &br->node, hash_string(br->name, 0));
 }
@@ -2666,6 +3211,9 @@ bridge_destroy(struct bridge *br)
         struct if_cfg *if_cfg, *next_if_cfg;
         struct ofpp_garbage *garbage, *next_garbage;
 
+        /* Its ports go away with it, so there is nothing to mark. */
+        br->cfg = NULL;
+
         HMAP_FOR_EACH_SAFE (port, next_port, hmap_node, &br->ports) {
             port_destroy(port);
         }
@@ -2676,6 +3224,11 @@ bridge_destroy(struct bridge *br)
             hmap_remove(&br->if_cfg_todo, &if_cfg->hmap_node);
             free(if_cfg);
         }
+        HMAP_FOR_EACH_SAFE (if_cfg, next_if_cfg, hmap_node,
+                            &br->if_cfg_failed) {
+            hmap_remove(&br->if_cfg_failed, &if_cfg->hmap_node);
+            free(if_cfg);
+        }
         LIST_FOR_EACH_SAFE (garbage, next_garbage, list_node,
                             &br->ofpp_garbage) {
             list_remove(&garbage->list_node);
@@ -2689,6 +3242,8 @@ bridge_destroy(struct bridge *br)
         hmap_destroy(&br->iface_by_name);
         hmap_destroy(&br->mirrors);
         hmap_destroy(&br->if_cfg_todo);
+        hmap_destroy(&br->if_cfg_failed);
+        sset_destroy(&br->changed_ifaces);
         free(br->name);
         free(br->type);
         free(br);
@@ -2779,8 +3334,13 @@ bridge_queue_if_cfg(struct bridge *br,
                     const struct ovsrec_interface *cfg,
                     const struct ovsrec_port *parent)
 {
-    struct if_cfg *if_cfg = xmalloc(sizeof *if_cfg);
+    struct if_cfg *if_cfg;
 
+    if (if_cfg_lookup(br, cfg->name)) {
+        return;
+    }
+
+    if_cfg = xmalloc(sizeof *if_cfg);
     if_cfg->cfg = cfg;
     if_cfg->parent = parent;
     if_cfg->ofport = iface_pick_ofport(cfg);
@@ -2795,6 +3355,7 @@ static void
 bridge_add_del_ports(struct bridge *br,
                      const unsigned long int *splinter_vlans)
 {
+    struct if_cfg *if_cfg, *next_if_cfg;
     struct shash_node *port_node;
     struct port *port, *next;
     struct shash new_ports;
@@ -2802,6 +3363,12 @@ bridge_add_del_ports(struct bridge *br,
 
     ovs_assert(hmap_is_empty(&br->if_cfg_todo));
 
+    /* Interfaces that failed to be created are queued again below. */
+    HMAP_FOR_EACH_SAFE (if_cfg, next_if_cfg, hmap_node, &br->if_cfg_failed) {
+        hmap_remove(&br->if_cfg_failed, &if_cfg->hmap_node);
+        free(if_cfg);
+    }
+
     /* Collect new ports. */
     shash_init(&new_ports);
     for (i = 0; i < br->cfg->n_ports; i++) {
@@ -2838,7 +3405,7 @@ bridge_add_del_ports(struct bridge *br,
     /* Get rid of deleted ports.
      * Get rid of deleted interfaces on ports that still exist. */
     HMAP_FOR_EACH_SAFE (port, next, hmap_node, &br->ports) {
-        port->cfg = shash_find_data(&new_ports, port->name);
+        port_set_cfg(port, shash_find_data(&new_ports, port->name));
         if (!port->cfg) {
             port_destroy(port);
         } else {
@@ -2849,31 +3416,41 @@ bridge_add_del_ports(struct bridge *br,
     /* Update iface->cfg and iface->type in interfaces that still exist.
      * Add new interfaces to creation queue. */
     SHASH_FOR_EACH (port_node, &new_ports) {
-        const struct ovsrec_port *port = port_node->data;
-        size_t i;
-
-        for (i = 0; i < port->n_interfaces; i++) {
-            const struct ovsrec_interface *cfg = port->interfaces[i];
-            struct iface *iface = iface_lookup(br, cfg->name);
-            const char *type = iface_get_type(cfg, br->cfg);
-
-            if (iface) {
-                iface->cfg = cfg;
-                iface->type = type;
-            } else if (!strcmp(type, "null")) {
-                VLOG_WARN_ONCE("%s: The null interface type is deprecated and"
-                               " may be removed in February 2013. Please email"
-                               " dev@openvswitch.org with concerns.",
-                               cfg->name);
-            } else {
-                bridge_queue_if_cfg(br, cfg, port);
-            }
-        }
+        bridge_queue_port_ifaces(br, port_node->data);
     }
 
     shash_destroy(&new_ports);
 }
 
+/* Updates iface->cfg and iface->type in the interfaces of 'port_cfg' that
+ * exist in 'br' and adds the others to the creation queue.  Records the
+ * names of the port and of its interfaces in 'br->changed_ifaces'. */
+static void
+bridge_queue_port_ifaces(struct bridge *br, const struct ovsrec_port *port_cfg)
+{
+    size_t i;
+
+    sset_add(&br->changed_ifaces, port_cfg->name);
+    for (i = 0; i < port_cfg->n_interfaces; i++) {
+        const struct ovsrec_interface *cfg = port_cfg->interfaces[i];
+        struct iface *iface = iface_lookup(br, cfg->name);
+        const char *type = iface_get_type(cfg, br->cfg);
+
+        sset_add(&br->changed_ifaces, cfg->name);
+        if (iface) {
+            iface->cfg = cfg;
+            iface->type = type;
+        } else if (!strcmp(type, "null")) {
+            VLOG_WARN_ONCE("%s: The null interface type is deprecated and"
+                           " may be removed in February 2013. Please email"
+                           " dev@openvswitch.org with concerns.",
+                           cfg->name);
+        } else {
+            bridge_queue_if_cfg(br, cfg, port_cfg);
+        }
+    }
+}
+
 /* Initializes 'oc' appropriately as a management service controller for
  * 'br'.
  *
@@ -3185,11 +3762,65 @@ port_create(struct bridge *br, const struct ovsrec_port *cfg)
     port->name = xstrdup(cfg->name);
     port->cfg = cfg;
     list_init(&port->ifaces);
+    list_init(&port->changed_node);
 
     hmap_insert(&br->ports, &port->hmap_node, hash_string(port->name, 0));
+    hmap_insert(&ports_by_cfg, &port->cfg_node, hash_pointer(cfg, 0));
+    port_mark_changed(port, true);
     return port;
 }
 
+/* Changes 'port''s configuration record to 'cfg', which may be NULL. */
+static void
+port_set_cfg(struct port *port, const struct ovsrec_port *cfg)
+{
+    hmap_remove(&ports_by_cfg, &port->cfg_node);
+    port->cfg = cfg;
+    hmap_insert(&ports_by_cfg, &port->cfg_node, hash_pointer(cfg, 0));
+}
+
+/* Returns the "struct port" whose configuration record is 'cfg', if any. */
+static struct port *
+port_find_by_cfg(const struct ovsrec_port *cfg)
+{
+    struct port *port;
+
+    HMAP_FOR_EACH_WITH_HASH (port, cfg_node, hash_pointer(cfg, 0),
+                             &ports_by_cfg) {
+        if (port->cfg == cfg) {
+            return port;
+        }
+    }
+    return NULL;
+}
+
+/* Adds 'port' to its bridge's 'changed_ports', for
+ * bridge_reconfigure_continue() to configure, and flags the bridge-wide
+ * configuration that depends on it.  'stp' should be true if the change
+ * might affect the port's STP settings. */
+static void
+port_mark_changed(struct port *port, bool stp)
+{
+    if (list_is_empty(&port->changed_node)) {
+        list_push_back(&port->bridge->changed_ports, &port->changed_node);
+    }
+    bridge_note_port_change(port->bridge, port, stp);
+}
+
+/* Records the names of 'port' and of its interfaces in its bridge's
+ * 'changed_ifaces', for bridge_refresh_changed_ofp_ports(). */
+static void
+port_note_ifaces_changed(const struct port *port)
+{
+    struct sset *changed_ifaces = &port->bridge->changed_ifaces;
+    struct iface *iface;
+
+    sset_add(changed_ifaces, port->name);
+    LIST_FOR_EACH (iface, port_elem, &port->ifaces) {
+        sset_add(changed_ifaces, iface->name);
+    }
+}
+
 /* Deletes interfaces from 'port' that are no longer configured for it. */
 static void
 port_del_ifaces(struct port *port)
@@ -3233,7 +3864,16 @@ port_destroy(struct port *port)
             iface_destroy(iface);
         }
 
+        bridge_note_port_change(br, port, true);
+        if (br->ea_port == port) {
+            br->ea_port = NULL;
+        }
+        if (!list_is_empty(&port->changed_node)) {
+            list_remove(&port->changed_node);
+        }
+
         hmap_remove(&br->ports, &port->hmap_node);
+        hmap_remove(&ports_by_cfg, &port->cfg_node);
         free(port->name);
         free(port);
     }
@@ -3461,6 +4101,7 @@ iface_destroy(struct iface *iface)
 
         list_remove(&iface->port_elem);
         hmap_remove(&br->iface_by_name, &iface->name_node);
+        port_mark_changed(port, true);
 
         netdev_close(iface->netdev);
 